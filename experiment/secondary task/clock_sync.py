@@ -0,0 +1,284 @@
+#!/usr/bin/env python3
+
+from socket import socket, AF_INET, SOCK_DGRAM, timeout as SocketTimeout
+from struct import Struct
+from threading import Thread, Lock, Event
+from time import perf_counter, sleep, time
+from os.path import isfile
+from math import nan, isnan, sqrt
+import argparse
+
+
+###################################################################################
+### Clock synchronization with the robot PC (the clock_sync_server node, see
+### ros2_ws/src/ros2_package/include/ros2_package/clock_sync.hpp for the protocol).
+###
+### A ClockSyncClient runs in the background for the whole session, estimates the
+### offset and drift of a local clock against the controller clock, reports them
+### to the robot PC and logs them to a csv file, so every local sample maps onto
+### the controller timeline (and onto time_from_start during a trial):
+###
+###     robot_time = local_time + offset + drift * 1e-6 * (local_time - local_ref)
+###
+### Usage on the robot PC, without the Windows machine:
+###     python clock_sync.py --loopback 127.0.0.1 --offset 3.2 --drift 40
+### and on the Windows machine, without the robot PC:
+###     python clock_sync.py --stand-in          (in one terminal)
+###     python clock_sync.py --loopback 127.0.0.1
+###################################################################################
+
+
+PACKET = Struct('<4sIII8d16s')      # 96 bytes, clock_sync::Packet
+MAGIC = b'ACSY'
+REQUEST, REPLY, REPORT = 0, 1, 2
+
+DEFAULT_PORT = 15000
+
+
+##########################################################################################
+class OffsetEstimator():
+    """ offset and drift of the server clock against the local one, from the (t1, t2, t3, t4) exchanges """
+
+    def __init__(self, window=120.0, max_samples=512, best_fraction=0.25, min_span=5.0):
+        self.window = window                # [s] of samples kept
+        self.max_samples = max_samples
+        self.best_fraction = best_fraction  # only the exchanges with the shortest round trips are used
+        self.min_span = min_span            # [s] of samples before the drift is estimated
+        self.samples = []                   # (local mid time, offset, round trip)
+
+    #############################################
+    def add(self, t1, t2, t3, t4):
+        offset = ((t2 - t1) + (t3 - t4)) / 2
+        round_trip = (t4 - t1) - (t3 - t2)
+        if round_trip < 0:
+            return      # a clock stepped during the exchange
+        self.samples.append(((t1 + t4) / 2, offset, round_trip))
+        while len(self.samples) > self.max_samples or self.samples[-1][0] - self.samples[0][0] > self.window:
+            self.samples.pop(0)
+
+    #############################################
+    def estimate(self):
+        """ dict with offset [s] at local_ref, drift [ppm], uncertainty [s] (1 sigma), round_trip [s], None without samples """
+
+        if not self.samples:
+            return None
+
+        # the queueing delays only ever add to the round trip, the shortest ones are the least biased
+        n_best = max(3, int(len(self.samples) * self.best_fraction))
+        best = sorted(self.samples, key=lambda s: s[2])[:n_best]
+        n = len(best)
+        local_ref = self.samples[-1][0]
+        xs = [s[0] - local_ref for s in best]
+        ys = [s[1] for s in best]
+        x_mean = sum(xs) / n
+        y_mean = sum(ys) / n
+        sxx = sum((x - x_mean) ** 2 for x in xs)
+
+        if n >= 3 and self.samples[-1][0] - self.samples[0][0] >= self.min_span and sxx > 0:
+            slope = sum((x - x_mean) * (y - y_mean) for (x, y) in zip(xs, ys)) / sxx
+            offset = y_mean - slope * x_mean        # at local_ref (x = 0)
+            residual = sum((y - offset - slope * x) ** 2 for (x, y) in zip(xs, ys)) / max(n - 2, 1)
+            uncertainty = sqrt(residual * (1.0 / n + x_mean ** 2 / sxx))
+        else:
+            slope = 0.0
+            offset = y_mean
+            residual = sum((y - y_mean) ** 2 for y in ys) / max(n - 1, 1)
+            uncertainty = sqrt(residual / n)
+
+        return {'local_ref': local_ref, 'offset': offset, 'drift': slope * 1e6, 'uncertainty': uncertainty,
+                'round_trip': best[0][2], 'n_samples': n}
+
+
+##########################################################################################
+class ClockSyncClient():
+
+    def __init__(self, host, port=DEFAULT_PORT, name='client', clock=perf_counter, csv_file=None,
+                 period=0.2, report_period=1.0):
+
+        self.host = host
+        self.port = port
+        self.name = name
+        self.clock = clock                  # local clock of the samples to map, perf_counter is sub-microsecond on Windows
+        self.csv_file = csv_file            # estimates log, None = no file
+        self.period = period                # [s] between exchanges
+        self.report_period = report_period  # [s] between estimates
+
+        self.estimator = OffsetEstimator()
+        self.lock = Lock()
+        self.current = None
+        self.traj_origin = nan
+        self.lost = 0
+
+        self.sock = socket(AF_INET, SOCK_DGRAM)
+        self.sock.settimeout(0.5)
+        self.stop_event = Event()
+        self.thread = Thread(target=self.run, daemon=True)
+
+    #############################################
+    def start(self):
+        self.thread.start()
+        return self
+
+    def stop(self):
+        self.stop_event.set()
+        self.thread.join()
+        self.sock.close()
+
+    #############################################
+    def run(self):
+        seq = 0
+        next_report = self.clock() + self.report_period
+        while not self.stop_event.is_set():
+            seq += 1
+            self.exchange(seq)
+            if self.clock() >= next_report:
+                next_report += self.report_period
+                self.report(seq)
+            self.stop_event.wait(self.period)
+
+    def exchange(self, seq):
+        t1 = self.clock()
+        try:
+            self.sock.sendto(PACKET.pack(MAGIC, REQUEST, seq, 0, t1, 0, 0, 0, 0, 0, 0, 0, self.name.encode()[:16]),
+                             (self.host, self.port))
+        except OSError:
+            self.lost += 1      # no route to the robot PC (yet)
+            return
+        while True:
+            try:
+                data = self.sock.recv(PACKET.size)
+            except (SocketTimeout, OSError):
+                self.lost += 1
+                return
+            t4 = self.clock()
+            if len(data) != PACKET.size:
+                continue
+            magic, kind, reply_seq, _, r_t1, t2, t3, traj_origin = PACKET.unpack(data)[:8]
+            if magic == MAGIC and kind == REPLY and reply_seq == seq and r_t1 == t1:
+                break       # late replies of earlier requests are dropped
+
+        with self.lock:
+            self.estimator.add(t1, t2, t3, t4)
+            self.traj_origin = traj_origin
+
+    def report(self, seq):
+        with self.lock:
+            self.current = self.estimator.estimate()
+            current = self.current
+            traj_origin = self.traj_origin
+        if current is None:
+            return
+
+        try:
+            self.sock.sendto(PACKET.pack(MAGIC, REPORT, seq, current['n_samples'], 0, 0, 0, traj_origin,
+                                         current['offset'], current['drift'], current['uncertainty'], current['round_trip'],
+                                         self.name.encode()[:16]), (self.host, self.port))
+        except OSError:
+            pass
+
+        if self.csv_file is not None:
+            file_exists = isfile(self.csv_file)
+            with open(self.csv_file, 'a', newline='') as f:
+                if not file_exists:
+                    f.write("local_ref,offset,drift_ppm,uncertainty,round_trip,n_samples,traj_origin,lost\n")
+                f.write("%.9f,%.9f,%.3f,%.9f,%.9f,%d,%.9f,%d\n" % (current['local_ref'], current['offset'], current['drift'],
+                        current['uncertainty'], current['round_trip'], current['n_samples'], traj_origin, self.lost))
+
+    #############################################
+    def to_robot_time(self, local_time=None):
+        """ (robot time, uncertainty) of a local clock reading (default: now), (nan, nan) before the first estimate """
+
+        if local_time is None:
+            local_time = self.clock()
+        with self.lock:
+            current = self.current or self.estimator.estimate()
+        if current is None:
+            return nan, nan
+        robot_time = local_time + current['offset'] + current['drift'] * 1e-6 * (local_time - current['local_ref'])
+        return robot_time, current['uncertainty']
+
+    def to_time_from_start(self, local_time=None):
+        """ (time_from_start of the current trial, uncertainty), nan before the first trial event """
+
+        robot_time, uncertainty = self.to_robot_time(local_time)
+        with self.lock:
+            traj_origin = self.traj_origin
+        return robot_time - traj_origin, uncertainty
+
+
+##########################################################################################
+def stand_in(port):
+    """ replies like the clock_sync_server node, with the system clock, to test the client without the robot PC """
+
+    sock = socket(AF_INET, SOCK_DGRAM)
+    sock.bind(('', port))
+    print("Clock sync stand-in listening on UDP port %d" % port)
+    while True:
+        data, address = sock.recvfrom(PACKET.size)
+        t2 = time()
+        if len(data) != PACKET.size:
+            continue
+        fields = list(PACKET.unpack(data))
+        if fields[0] != MAGIC:
+            continue
+        if fields[1] == REPORT:
+            print("%s: offset = %.6f s, drift = %.2f ppm, uncertainty = %.1f us, round trip = %.1f us" % (
+                fields[12].rstrip(b'\0').decode(), fields[8], fields[9], fields[10] * 1e6, fields[11] * 1e6))
+        if fields[1] != REQUEST:
+            continue
+        fields[1] = REPLY
+        fields[5] = t2
+        fields[7] = nan
+        fields[6] = time()
+        sock.sendto(PACKET.pack(*fields), address)
+
+
+def loopback(host, port, offset, drift, duration):
+    """ client with an artificially offset and drifting clock, against a server on the same machine """
+
+    t0 = time()
+    skewed = lambda: time() + offset + drift * 1e-6 * (time() - t0)
+    client = ClockSyncClient(host, port, name='loopback', clock=skewed).start()
+
+    errors = []
+    start = time()
+    while time() - start < duration:
+        sleep(1.0)
+        local = skewed()
+        truth = time()
+        robot_time, uncertainty = client.to_robot_time(local)
+        if isnan(robot_time):
+            continue
+        errors.append(robot_time - truth)
+        print("error = %8.1f us, uncertainty = %6.1f us, drift = %7.2f ppm (true %.2f)" % (
+            errors[-1] * 1e6, uncertainty * 1e6, client.current['drift'] if client.current else nan, -drift))
+    client.stop()
+
+    if errors:
+        worst = max(abs(e) for e in errors[len(errors) // 2:])
+        print("\nWorst error over the second half: %.1f us, %d exchanges lost" % (worst * 1e6, client.lost))
+
+
+##########################################################################################
+def main():
+
+    parser = argparse.ArgumentParser(description='Clock sync client test tools')
+    parser.add_argument('--stand-in', action='store_true', help='run a stand-in server with the system clock')
+    parser.add_argument('--loopback', metavar='HOST', help='run a skewed client against the server at HOST')
+    parser.add_argument('--port', type=int, default=DEFAULT_PORT)
+    parser.add_argument('--offset', type=float, default=2.5, help='offset of the skewed clock [s]')
+    parser.add_argument('--drift', type=float, default=50.0, help='drift of the skewed clock [ppm]')
+    parser.add_argument('--duration', type=float, default=60.0, help='[s]')
+    args = parser.parse_args()
+
+    if args.stand_in:
+        stand_in(args.port)
+    elif args.loopback:
+        loopback(args.loopback, args.port, args.offset, args.drift, args.duration)
+    else:
+        parser.print_help()
+
+
+##########################################################################################
+if __name__ == "__main__":
+    main()
@@ -1,9 +1,11 @@
 #!/usr/bin/env python3
 
 from keyboard import read_key
-from time import time
+from time import time, perf_counter
 from os import getcwd
+from os.path import isfile
 from utils import TappingDataLogger, EyeDataLogger, get_timestamps
+from clock_sync import ClockSyncClient
 from playsound import playsound
 import tobii_research as tr
 import matplotlib.pyplot as plt
@@ -42,12 +44,16 @@ MAX_TIME = 10       # seconds
 
 USE_EYETRACKER = False
 
+# map the taps (and the gaze samples) onto the controller timeline (clock_sync_server node on the robot PC)
+USE_CLOCK_SYNC = False
+ROBOT_HOST = '127.0.0.1'    # set to the address of the robot PC
+
 
 ##########################################################################################
 class RhythmMethod():
     
     def __init__(self, log_tap_data, log_eye_data, part_id, alpha_id, traj_id, 
-                 rhythm_id, tempo, max_time, use_eyetracker):
+                 rhythm_id, tempo, max_time, use_eyetracker, use_clock_sync=False, robot_host=None):
         
         self.use_eyetracker = use_eyetracker
         if self.use_eyetracker:
@@ -59,6 +65,8 @@ class RhythmMethod():
             self.right_gaze_points = []
             self.left_pupil_sizes = []
             self.right_pupil_sizes = []
+            self.gaze_system_times = []     # [us] Tobii system clock of every gaze sample
+            self.eye_clock_offset = 0.0     # [s] perf_counter - Tobii system clock
         
         self.log_tap_data = log_tap_data
         self.log_eye_data = log_eye_data
@@ -86,6 +94,13 @@ class RhythmMethod():
         self.tap_csv_dir = cwd + '\secondary task\data'
         self.eye_csv_dir = cwd + '\secondary task\data_tobii'
         
+        # runs from now on, so the estimate has settled by the first tap
+        self.use_clock_sync = use_clock_sync
+        self.tap_clock_times = []
+        if self.use_clock_sync:
+            self.clock_sync = ClockSyncClient(robot_host, name='rhythm_method', clock=perf_counter,
+                                              csv_file=self.tap_csv_dir + "\clock_sync_part" + str(self.part_id) + ".csv").start()
+        
         rhythms_dir = cwd + "\secondary task" + "\\" + "rhythms"
         match self.rhythm_id:
             case 1: 
@@ -128,6 +143,7 @@ class RhythmMethod():
                     playsound(self.sound)
             
             if entry == "space":
+                self.tap_clock_times.append(perf_counter())
                 self.times_from_start.append(time() - self.start_time - 5)
                 if not self.recording_started:
                     self.recorded.append(0.0)
@@ -135,6 +151,7 @@ class RhythmMethod():
                     self.recording_start_time = time()
                     print("\n Heard first tap, started recording taps! \n")
                     if self.use_eyetracker:
+                        self.eye_clock_offset = self.measure_eye_clock_offset()
                         self.my_eyetracker.subscribe_to(tr.EYETRACKER_GAZE_DATA,
                                             self.gaze_data_callback, as_dictionary=True)
                         print("\n Using eyetracker, started listening to eye-tracker data!\n")
@@ -148,6 +165,12 @@ class RhythmMethod():
                     self.my_eyetracker.unsubscribe_from(tr.EYETRACKER_GAZE_DATA, self.gaze_data_callback)
                 break
         
+        if self.use_clock_sync:
+            self.map_taps_to_robot_time()
+            if self.use_eyetracker:
+                self.map_gaze_to_robot_time()
+            self.clock_sync.stop()
+        
         self.clean_up_record()
         self.calculate_error()
         
@@ -236,6 +259,54 @@ class RhythmMethod():
         tdl.log_data()
         
     
+    ################################  CLOCK SYNC STUFF  ################################
+    # time_from_start of the controller of every tap (incl. the duplicates), with the uncertainty of the mapping
+    def map_taps_to_robot_time(self):
+        
+        file_name = self.tap_csv_dir + "\clock_sync_taps_part" + str(self.part_id) + ".csv"
+        file_exists = isfile(file_name)
+        with open(file_name, 'a', newline='') as f:
+            if not file_exists:
+                f.write("alpha_id,traj_id,rhythm_id,tap,local_time,robot_time,time_from_start,uncertainty\n")
+            for i, t in enumerate(self.tap_clock_times):
+                robot_time, uncertainty = self.clock_sync.to_robot_time(t)
+                time_from_start, _ = self.clock_sync.to_time_from_start(t)
+                f.write("%d,%d,%d,%d,%.6f,%.6f,%.6f,%.6f\n" % (self.alpha_id, self.traj_id, self.rhythm_id, i, t,
+                                                               robot_time, time_from_start, uncertainty))
+        
+        if self.tap_clock_times:
+            time_from_start, uncertainty = self.clock_sync.to_time_from_start(self.tap_clock_times[0])
+            print("First tap at time_from_start = %.4f s (+- %.3f ms)\n" % (time_from_start, uncertainty * 1000))
+    
+    # same for every gaze sample, through its Tobii system time stamp (the EyeDataLogger csv keeps the sample order)
+    def map_gaze_to_robot_time(self):
+        
+        file_name = self.eye_csv_dir + "\clock_sync_gaze_part" + str(self.part_id) + ".csv"
+        file_exists = isfile(file_name)
+        with open(file_name, 'a', newline='') as f:
+            if not file_exists:
+                f.write("alpha_id,traj_id,rhythm_id,sample,system_time_stamp,local_time,robot_time,time_from_start,uncertainty\n")
+            for i, ts in enumerate(self.gaze_system_times):
+                t = ts * 1e-6 + self.eye_clock_offset
+                robot_time, uncertainty = self.clock_sync.to_robot_time(t)
+                time_from_start, _ = self.clock_sync.to_time_from_start(t)
+                f.write("%d,%d,%d,%d,%d,%.6f,%.6f,%.6f,%.6f\n" % (self.alpha_id, self.traj_id, self.rhythm_id, i, ts, t,
+                                                                  robot_time, time_from_start, uncertainty))
+        print("Mapped %d gaze samples onto the controller timeline\n" % len(self.gaze_system_times))
+    
+    # perf_counter - Tobii system clock [s], from the tightest of n back-to-back readings
+    def measure_eye_clock_offset(self, n=20):
+        
+        best_gap, offset = float('inf'), 0.0
+        for _ in range(n):
+            t0 = perf_counter()
+            ts = tr.get_system_time_stamp() * 1e-6
+            t1 = perf_counter()
+            if t1 - t0 < best_gap:
+                best_gap, offset = t1 - t0, (t0 + t1) / 2 - ts
+        return offset
+    
+    
     ################################  EYE TRACKER STUFF  ################################
     def gaze_data_callback(self, gaze_data):
         # get gaze points
@@ -251,6 +322,7 @@ class RhythmMethod():
         print("(left, right) pupil diameters = (%.3f, %.3f)" % 
               (left_pupil_diameter, right_pupil_diameter))
         
+        self.gaze_system_times.append(gaze_data['system_time_stamp'])
         self.left_gaze_points.append(new_left_eye_gaze)
         self.right_gaze_points.append(new_right_eye_gaze)
         self.left_pupil_sizes.append(left_pupil_diameter)
@@ -312,7 +384,7 @@ class RhythmMethod():
 def main():
     
     rm = RhythmMethod(SAVE_TAP_DATA, SAVE_EYE_DATA, PART_ID, ALPHA_ID, TRAJ_ID, 
-                           RHYTHM_ID, TEMPO, MAX_TIME, USE_EYETRACKER)
+                           RHYTHM_ID, TEMPO, MAX_TIME, USE_EYETRACKER, USE_CLOCK_SYNC, ROBOT_HOST)
     
     rm.run()
     
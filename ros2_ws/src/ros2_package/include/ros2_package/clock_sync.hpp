@@ -0,0 +1,184 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Wire format and UDP socket of the clock sync server, which lets the
+//   external recording machines (eye tracker / tapping task) estimate the
+//   offset and drift of their clock against the robot PC
+//
+// - Protocol (NTP-style, one 96 byte datagram each way, little endian):
+//   1. the client sends a REQUEST stamped t1 with its own clock
+//   2. the server stamps its receive time t2 (kernel timestamp of the
+//      datagram when available) and its send time t3, and echoes t1
+//   3. the client stamps the reply t4, so that
+//        offset = ((t2 - t1) + (t3 - t4)) / 2,  round trip = (t4 - t1) - (t3 - t2)
+//   4. the client sends its current estimate as a REPORT (no reply), logged
+//      on the robot side
+//
+// - The server clock is CLOCK_REALTIME, the clock of this->now() in the
+//   nodes (no sim time), so the replies are on the controller timeline.
+//   The reply also carries the traj_origin of the current trial (NaN before
+//   the first trial event), time_from_start = server time - traj_origin
+//
+// - The Python side is experiment/secondary task/clock_sync.py
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__CLOCK_SYNC_HPP_
+#define ROS2_PACKAGE__CLOCK_SYNC_HPP_
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+
+namespace ros2_package
+{
+
+namespace clock_sync
+{
+
+enum Type : uint32_t
+{
+  REQUEST = 0,
+  REPLY = 1,
+  REPORT = 2
+};
+
+// struct '<4sIII8d16s' in Python
+struct Packet
+{
+  char magic[4];        // "ACSY"
+  uint32_t type;
+  uint32_t seq;
+  uint32_t n_samples;   // REPORT: samples used in the fit
+  double t1;            // client send time (client clock)
+  double t2;            // server receive time
+  double t3;            // server send time
+  double traj_origin;   // REPLY: start of the current trajectory on the server clock, NaN if none
+  double offset;        // REPORT: server - client [s]
+  double drift;         // REPORT: [ppm]
+  double uncertainty;   // REPORT: 1 sigma [s]
+  double round_trip;    // REPORT: best round trip [s]
+  char client[16];      // name of the client, not null terminated when 16 long
+};
+static_assert(sizeof(Packet) == 96, "the layout is shared with the Python client");
+
+inline double seconds(const timespec & ts) { return (double) ts.tv_sec + 1e-9 * (double) ts.tv_nsec; }
+
+// the server clock, in [s] since the epoch
+inline double now()
+{
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return seconds(ts);
+}
+
+}  // namespace clock_sync
+
+
+class ClockSyncSocket
+{
+public:
+
+  ClockSyncSocket() = default;
+  ClockSyncSocket(const ClockSyncSocket &) = delete;
+  ClockSyncSocket & operator=(const ClockSyncSocket &) = delete;
+
+  ~ClockSyncSocket() { close(); }
+
+  // binds the UDP port on every interface, error is set when false
+  bool open(int port, std::string & error)
+  {
+    close();
+    fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd_ < 0) return fail("socket", error);
+
+    // kernel receive timestamps, the closest to the wire t2 can get without PTP hardware
+    int on = 1;
+    kernel_stamps_ = setsockopt(fd_, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) == 0;
+
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((uint16_t) port);
+    if (bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) return fail("bind", error);
+    return true;
+  }
+
+  void close()
+  {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+  }
+
+  bool is_open() const { return fd_ >= 0; }
+  bool kernel_stamps() const { return kernel_stamps_; }
+
+  // waits up to timeout_ms for one datagram and answers it if it is a request, the datagram
+  // is copied to received. false on timeout or for anything but a request or a report
+  bool serve_one(int timeout_ms, double traj_origin, clock_sync::Packet & received, sockaddr_in & from)
+  {
+    pollfd p {fd_, POLLIN, 0};
+    if (poll(&p, 1, timeout_ms) <= 0) return false;
+
+    clock_sync::Packet packet;
+    iovec iov {&packet, sizeof(packet)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(timespec))];
+    msghdr msg {};
+    msg.msg_name = &from;
+    msg.msg_namelen = sizeof(from);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    const ssize_t n = recvmsg(fd_, &msg, 0);
+    double t2 = clock_sync::now();
+    if (n != (ssize_t) sizeof(packet) || std::memcmp(packet.magic, "ACSY", 4) != 0) return false;
+
+    for (cmsghdr * c = CMSG_FIRSTHDR(&msg); c != nullptr; c = CMSG_NXTHDR(&msg, c)) {
+      if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+        timespec ts;
+        std::memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+        t2 = clock_sync::seconds(ts);
+      }
+    }
+
+    received = packet;
+    if (packet.type != clock_sync::REQUEST) return packet.type == clock_sync::REPORT;
+
+    packet.type = clock_sync::REPLY;
+    packet.t2 = t2;
+    packet.traj_origin = traj_origin;
+    packet.t3 = clock_sync::now();    // as late as possible
+    sendto(fd_, &packet, sizeof(packet), 0, reinterpret_cast<const sockaddr *>(&from), sizeof(from));
+    return true;
+  }
+
+private:
+
+  bool fail(const std::string & what, std::string & error)
+  {
+    error = what + ": " + std::strerror(errno);
+    close();
+    return false;
+  }
+
+  int fd_ = -1;
+  bool kernel_stamps_ = false;
+};
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__CLOCK_SYNC_HPP_
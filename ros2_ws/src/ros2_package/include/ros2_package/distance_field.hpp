@@ -0,0 +1,246 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Signed Euclidean distance field of the static task scene,
+//   precomputed offline and queried by the controller
+//
+// - Main functionalities:
+//   1. Exact squared Euclidean distance transform of a voxel
+//      occupancy grid (Felzenszwalb & Huttenlocher, separable per axis)
+//   2. Binary grid format (header + nx*ny*nz floats), written by the
+//      scene_sdf_builder node and loaded with mmap
+//   3. Constant-cost trilinear query of the distance and its gradient
+//
+// - Distances are in [meters], positive in free space and negative
+//   inside obstacles, the gradient points away from the closest obstacle
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__DISTANCE_FIELD_HPP_
+#define ROS2_PACKAGE__DISTANCE_FIELD_HPP_
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "ros2_package/mapped_file.hpp"
+
+
+namespace ros2_package
+{
+
+/////////////// FILE HEADER //////////////
+
+struct DistanceFieldHeader
+{
+  char magic[8];          // "CLTSDF"
+  uint32_t version;
+  uint32_t n[3];          // voxels along {x, y, z}
+  double min[3];          // center of the first voxel, in the robot base frame [m]
+  double voxel_size;      // [m]
+};
+
+static const char distance_field_magic[8] = {'C', 'L', 'T', 'S', 'D', 'F', '\0', '\0'};
+static const uint32_t distance_field_version = 1;
+
+
+/////////////// DISTANCE TRANSFORM //////////////
+
+// 1D squared distance transform of f (lower envelope of parabolas), n values with a given stride
+inline void squared_edt_1d(float * f, size_t n, size_t stride, std::vector<float> & d, std::vector<int> & v, std::vector<float> & z)
+{
+  const float inf = std::numeric_limits<float>::infinity();
+  d.resize(n);
+  v.resize(n);
+  z.resize(n + 1);
+
+  // first finite sample, a line without any stays at infinity
+  size_t q0 = 0;
+  while (q0 < n && f[q0 * stride] == inf) q0++;
+  if (q0 == n) return;
+
+  auto intersection = [&](size_t q, int p) {
+    return ((f[q * stride] + (float) q * q) - (f[p * stride] + (float) p * p)) / (2.0f * ((float) q - p));
+  };
+
+  int k = 0;
+  v[0] = (int) q0;
+  z[0] = -inf;
+  z[1] = inf;
+  for (size_t q=q0+1; q<n; q++) {
+    if (f[q * stride] == inf) continue;
+    float s = intersection(q, v[k]);
+    while (s <= z[k]) {   // z[0] = -inf ends the loop
+      k--;
+      s = intersection(q, v[k]);
+    }
+    k++;
+    v[k] = (int) q;
+    z[k] = s;
+    z[k + 1] = inf;
+  }
+
+  int j = 0;
+  for (size_t q=0; q<n; q++) {
+    while (z[j + 1] < (float) q) j++;
+    const float dq = (float) q - v[j];
+    d[q] = dq * dq + f[v[j] * stride];
+  }
+  for (size_t q=0; q<n; q++) f[q * stride] = d[q];
+}
+
+// squared distance (in voxels) from every voxel to the closest voxel with occupied == target
+inline void squared_edt_3d(const std::vector<uint8_t> & occupied, uint8_t target, const uint32_t n[3], std::vector<float> & out)
+{
+  const size_t nx = n[0], ny = n[1], nz = n[2];
+  out.assign(nx * ny * nz, std::numeric_limits<float>::infinity());
+  for (size_t i=0; i<out.size(); i++) if (occupied[i] == target) out[i] = 0.0f;
+
+  std::vector<float> d, z;
+  std::vector<int> v;
+  for (size_t ix=0; ix<nx; ix++)
+    for (size_t iy=0; iy<ny; iy++) squared_edt_1d(&out[(ix * ny + iy) * nz], nz, 1, d, v, z);
+  for (size_t ix=0; ix<nx; ix++)
+    for (size_t iz=0; iz<nz; iz++) squared_edt_1d(&out[ix * ny * nz + iz], ny, nz, d, v, z);
+  for (size_t iy=0; iy<ny; iy++)
+    for (size_t iz=0; iz<nz; iz++) squared_edt_1d(&out[iy * nz + iz], nx, ny * nz, d, v, z);
+}
+
+// signed distance field [m] of an occupancy grid, ordered as (ix * ny + iy) * nz + iz
+inline void compute_signed_distance(const std::vector<uint8_t> & occupied, const uint32_t n[3], double voxel_size,
+                                    std::vector<float> & sdf)
+{
+  std::vector<float> to_obstacle, to_free;
+  squared_edt_3d(occupied, 1, n, to_obstacle);
+  squared_edt_3d(occupied, 0, n, to_free);
+
+  // an empty scene stays at a large positive distance
+  const float far = 1e3f;
+  sdf.resize(occupied.size());
+  for (size_t i=0; i<sdf.size(); i++) {
+    if (occupied[i]) sdf[i] = -(std::sqrt(to_free[i]) - 0.5f) * (float) voxel_size;
+    else sdf[i] = std::isinf(to_obstacle[i]) ? far : (std::sqrt(to_obstacle[i]) - 0.5f) * (float) voxel_size;
+  }
+}
+
+inline bool write_distance_field(const std::string & path, const uint32_t n[3], const double min[3], double voxel_size,
+                                 const std::vector<float> & values)
+{
+  if (values.size() != (size_t) n[0] * n[1] * n[2]) return false;
+
+  DistanceFieldHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, distance_field_magic, sizeof(header.magic));
+  header.version = distance_field_version;
+  for (size_t i=0; i<3; i++) {
+    header.n[i] = n[i];
+    header.min[i] = min[i];
+  }
+  header.voxel_size = voxel_size;
+
+  FILE * f = std::fopen(path.c_str(), "wb");
+  if (f == nullptr) return false;
+  bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1;
+  ok = ok && std::fwrite(values.data(), sizeof(float), values.size(), f) == values.size();
+  ok = (std::fclose(f) == 0) && ok;
+  return ok;
+}
+
+
+/////////////// QUERY //////////////
+
+class DistanceField
+{
+public:
+
+  // returns false (and leaves the field unloaded) if the file is missing or malformed
+  bool load(const std::string & path)
+  {
+    loaded_ = false;
+    if (!file_.open(path)) return false;
+    if (file_.size() < sizeof(DistanceFieldHeader)) return false;
+
+    const DistanceFieldHeader * h = file_.as<DistanceFieldHeader>();
+    if (std::memcmp(h->magic, distance_field_magic, sizeof(h->magic)) != 0) return false;
+    if (h->version != distance_field_version || !(h->voxel_size > 0.0)) return false;
+    for (size_t i=0; i<3; i++) {
+      if (h->n[i] < 2) return false;
+      n_[i] = h->n[i];
+      min_[i] = h->min[i];
+    }
+    voxel_size_ = h->voxel_size;
+    if (file_.size() != sizeof(DistanceFieldHeader) + (size_t) n_[0] * n_[1] * n_[2] * sizeof(float)) return false;
+
+    values_ = file_.as<float>(sizeof(DistanceFieldHeader));
+    loaded_ = true;
+    return true;
+  }
+
+  bool loaded() const { return loaded_; }
+
+  // distance [m] and its gradient at p[3], false if p is outside the grid
+  bool query(const double p[3], double & distance, double gradient[3]) const
+  {
+    if (!loaded_) return false;
+
+    size_t idx[3];
+    double w[3];
+    for (size_t i=0; i<3; i++) {
+      const double u = (p[i] - min_[i]) / voxel_size_;
+      if (u < 0.0 || u > n_[i] - 1) return false;
+      size_t k = (size_t) u;
+      if (k > n_[i] - 2) k = n_[i] - 2;
+      idx[i] = k;
+      w[i] = u - k;
+    }
+
+    double c[2][2][2];
+    for (size_t dx=0; dx<2; dx++)
+      for (size_t dy=0; dy<2; dy++)
+        for (size_t dz=0; dz<2; dz++) c[dx][dy][dz] = value(idx[0] + dx, idx[1] + dy, idx[2] + dz);
+
+    // interpolate along z, then y, then x (keeping the partial derivatives)
+    double cy[2][2], cx[2], dcx_dy[2], dcy_dz[2][2];
+    for (size_t dx=0; dx<2; dx++) {
+      for (size_t dy=0; dy<2; dy++) {
+        cy[dx][dy] = c[dx][dy][0] + w[2] * (c[dx][dy][1] - c[dx][dy][0]);
+        dcy_dz[dx][dy] = c[dx][dy][1] - c[dx][dy][0];
+      }
+      cx[dx] = cy[dx][0] + w[1] * (cy[dx][1] - cy[dx][0]);
+      dcx_dy[dx] = cy[dx][1] - cy[dx][0];
+    }
+    distance = cx[0] + w[0] * (cx[1] - cx[0]);
+
+    const double dz0 = dcy_dz[0][0] + w[1] * (dcy_dz[0][1] - dcy_dz[0][0]);
+    const double dz1 = dcy_dz[1][0] + w[1] * (dcy_dz[1][1] - dcy_dz[1][0]);
+    gradient[0] = (cx[1] - cx[0]) / voxel_size_;
+    gradient[1] = (dcx_dy[0] + w[0] * (dcx_dy[1] - dcx_dy[0])) / voxel_size_;
+    gradient[2] = (dz0 + w[0] * (dz1 - dz0)) / voxel_size_;
+    return true;
+  }
+
+private:
+
+  double value(size_t ix, size_t iy, size_t iz) const
+  {
+    return values_[(ix * n_[1] + iy) * n_[2] + iz];
+  }
+
+  MappedFile file_;
+  const float * values_ = nullptr;
+  bool loaded_ = false;
+
+  size_t n_[3] {2, 2, 2};
+  double min_[3] {0.0, 0.0, 0.0};
+  double voxel_size_ {1.0};
+};
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__DISTANCE_FIELD_HPP_
@@ -0,0 +1,70 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Array kernels shared by the controllers and the Python side
+//   (exposed as ros2_package._kernels, see src/python_bindings.cpp)
+//
+// - Main functionalities:
+//   1. Samples the sum-of-sines reference over n points, like
+//      traj_utils.get_sine_ref_points (same linspace, same formula)
+//   2. Blends human and robot offsets with the per-axis alphas
+//   3. Per-axis and Euclidean tracking errors against the reference,
+//      like DataLogger.calc_error (x is left out without depth)
+//
+// - Points are packed row-major as {x0, y0, z0, x1, y1, z1, ...}
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__ERROR_KERNELS_HPP_
+#define ROS2_PACKAGE__ERROR_KERNELS_HPP_
+
+#include <cmath>
+#include <cstddef>
+
+#include "ros2_package/traj_utils.hpp"
+
+
+namespace ros2_package
+{
+
+// n reference points over t in [0, 2pi], plus the origin
+inline void sine_ref_points(const SineTrajectory & traj, size_t n_points, const double origin[3], double * out)
+{
+  const double step = n_points > 1 ? 2*M_PI / (n_points - 1) : 0.0;
+  for (size_t i=0; i<n_points; i++) {
+    const double t = (n_points > 1 && i == n_points - 1) ? 2*M_PI : i * step;   // numpy's linspace hits the end exactly
+    traj.offset(t, out + 3*i);
+    for (size_t k=0; k<3; k++) out[3*i + k] += origin[k];
+  }
+}
+
+// tcp position = origin + alpha * human + (1 - alpha) * robot, per axis
+inline void blend_point(const double alpha[3], const double human[3], const double robot[3], const double origin[3], double out[3])
+{
+  for (size_t k=0; k<3; k++) out[k] = origin[k] + alpha[k] * human[k] + (1-alpha[k]) * robot[k];
+}
+
+inline void blend_points(const double alpha[3], const double * human, const double * robot, const double origin[3], size_t n, double * out)
+{
+  for (size_t i=0; i<n; i++) blend_point(alpha, human + 3*i, robot + 3*i, origin, out + 3*i);
+}
+
+// |pos - ref| per axis into dim_err (n x 3) and the Euclidean norm into norm_err (n)
+inline void tracking_errors(const double * pos, const double * ref, size_t n, int use_depth, double * dim_err, double * norm_err)
+{
+  for (size_t i=0; i<n; i++) {
+    const double * p = pos + 3*i;
+    const double * r = ref + 3*i;
+    double * d = dim_err + 3*i;
+    for (size_t k=0; k<3; k++) d[k] = std::fabs(p[k] - r[k]);
+
+    if (use_depth) norm_err[i] = std::sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+    else norm_err[i] = std::sqrt(d[1]*d[1] + d[2]*d[2]);
+  }
+}
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__ERROR_KERNELS_HPP_
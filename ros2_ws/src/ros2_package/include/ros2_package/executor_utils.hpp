@@ -0,0 +1,74 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Executor selection for the nodes, from their "executor" parameter
+//
+// - Main functionalities:
+//   1. "single": rclcpp::executors::SingleThreadedExecutor (the rclcpp::spin default)
+//   2. "static": StaticSingleThreadedExecutor, the wait set is only rebuilt
+//      when entities are added or removed, not on every wakeup
+//   3. "multi": MultiThreadedExecutor, callback groups run in parallel
+//      (the nodes put sensing and control in separate groups)
+//   4. "events": the experimental EventsExecutor when this rclcpp ships it,
+//      otherwise "static"
+//
+// - Measure before picking one: ros2 run ros2_package executor_benchmark
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__EXECUTOR_UTILS_HPP_
+#define ROS2_PACKAGE__EXECUTOR_UTILS_HPP_
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "rclcpp/rclcpp.hpp"
+
+#if __has_include("rclcpp/experimental/executors/events_executor/events_executor.hpp")
+#include "rclcpp/experimental/executors/events_executor/events_executor.hpp"
+#define ROS2_PACKAGE_HAVE_EVENTS_EXECUTOR 1
+#else
+#define ROS2_PACKAGE_HAVE_EVENTS_EXECUTOR 0
+#endif
+
+
+namespace ros2_package
+{
+
+inline bool valid_executor(const std::string & name)
+{
+  return name == "single" || name == "static" || name == "multi" || name == "events";
+}
+
+// executor by name, n_threads only matters for "multi" (0 = one per core)
+inline std::shared_ptr<rclcpp::Executor> make_executor(const std::string & name, size_t n_threads = 2)
+{
+  if (name == "static") return std::make_shared<rclcpp::executors::StaticSingleThreadedExecutor>();
+  if (name == "multi") return std::make_shared<rclcpp::executors::MultiThreadedExecutor>(rclcpp::ExecutorOptions(), n_threads);
+  if (name == "events") {
+#if ROS2_PACKAGE_HAVE_EVENTS_EXECUTOR
+    return std::make_shared<rclcpp::experimental::executors::EventsExecutor>();
+#else
+    std::cout << "The events executor is not available in this rclcpp, using the static one" << std::endl;
+    return std::make_shared<rclcpp::executors::StaticSingleThreadedExecutor>();
+#endif
+  }
+  if (name != "single") std::cout << "Unknown executor '" << name << "', using the single-threaded one" << std::endl;
+  return std::make_shared<rclcpp::executors::SingleThreadedExecutor>();
+}
+
+// replaces rclcpp::spin(node)
+inline void spin_node(const rclcpp::Node::SharedPtr & node, const std::string & executor, size_t n_threads = 2)
+{
+  auto exec = make_executor(executor, n_threads);
+  exec->add_node(node);
+  exec->spin();
+  exec->remove_node(node);
+}
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__EXECUTOR_UTILS_HPP_
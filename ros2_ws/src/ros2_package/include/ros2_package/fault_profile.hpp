@@ -0,0 +1,125 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Scripted network fault profile, deciding for every message of a
+//   topic when (and how many times) it is delivered
+//
+// - Main functionalities:
+//   1. A script of phases, each starting at a time since the first
+//      message, with its delay, jitter, drop, duplication and reorder settings
+//   2. Drops come in bursts of consecutive messages, a reordered message
+//      is held back long enough for the following ones to overtake it
+//   3. Seeded random stream consumed in a fixed pattern per message, so the
+//      same script, seed and message sequence always give the same faults
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__FAULT_PROFILE_HPP_
+#define ROS2_PACKAGE__FAULT_PROFILE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+
+namespace ros2_package
+{
+
+struct FaultPhase
+{
+  double start = 0.0;         // [s] since the first message
+  double delay = 0.0;         // [s]
+  double jitter = 0.0;        // [s], uniform in [0, jitter] on top of the delay
+  double drop_prob = 0.0;     // probability that a drop burst starts at a message
+  int drop_burst = 1;         // messages dropped per burst
+  double dup_prob = 0.0;      // probability that a message is delivered twice
+  double reorder_prob = 0.0;  // probability that a message is held back by reorder_hold
+  double reorder_hold = 0.005;   // [s]
+};
+
+struct FaultCounters
+{
+  uint64_t received = 0;
+  uint64_t dropped = 0;
+  uint64_t duplicated = 0;
+  uint64_t reordered = 0;
+};
+
+class FaultProfile
+{
+public:
+
+  // phases must be sorted by start time, the first one should start at 0
+  void configure(const std::vector<FaultPhase> & phases, unsigned int seed)
+  {
+    phases_ = phases;
+    if (phases_.empty()) phases_.push_back(FaultPhase());
+    rng_.seed(seed);
+    burst_left_ = 0;
+    counters_.assign(phases_.size(), FaultCounters());
+  }
+
+  // index of the phase active at t [s] since the first message
+  size_t phase_at(double t) const
+  {
+    size_t k = 0;
+    while (k + 1 < phases_.size() && phases_[k + 1].start <= t) k++;
+    return k;
+  }
+
+  // delivery delays [s] of a message arriving at t (0, 1 or 2 entries), returns the phase index
+  size_t decide(double t, std::vector<double> & delays)
+  {
+    const size_t k = phase_at(t);
+    const FaultPhase & p = phases_[k];
+    FaultCounters & c = counters_[k];
+    delays.clear();
+    c.received++;
+
+    // always draw the same numbers per message, whatever the outcome
+    const double u_drop = uniform_(rng_);
+    const double u_dup = uniform_(rng_);
+    const double u_reorder = uniform_(rng_);
+    const double u_jitter_a = uniform_(rng_);
+    const double u_jitter_b = uniform_(rng_);
+
+    if (burst_left_ == 0 && u_drop < p.drop_prob) burst_left_ = p.drop_burst > 0 ? p.drop_burst : 1;
+    if (burst_left_ > 0) {
+      burst_left_--;
+      c.dropped++;
+      return k;
+    }
+
+    double d = p.delay + p.jitter * u_jitter_a;
+    if (u_reorder < p.reorder_prob) {
+      d += p.reorder_hold;
+      c.reordered++;
+    }
+    delays.push_back(d);
+
+    if (u_dup < p.dup_prob) {
+      delays.push_back(p.delay + p.jitter * u_jitter_b);
+      c.duplicated++;
+    }
+    return k;
+  }
+
+  // counters of phase k
+  const FaultCounters & counters(size_t k) const { return counters_.at(k); }
+  const std::vector<FaultPhase> & phases() const { return phases_; }
+
+private:
+
+  std::vector<FaultPhase> phases_ {FaultPhase()};
+  std::mt19937_64 rng_;
+  std::uniform_real_distribution<double> uniform_ {0.0, 1.0};
+  int burst_left_ = 0;
+  std::vector<FaultCounters> counters_ {FaultCounters()};
+};
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__FAULT_PROFILE_HPP_
@@ -0,0 +1,157 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Upsampler for the desired_joint_vals stream, bridging the
+//   500 Hz RealController to the 1 kHz ros2_control update loop
+//
+// - Main functionalities:
+//   1. Stores the latest timestamped commands in a fixed ring
+//      (no allocation, safe to use inside a controller update())
+//   2. Evaluates a cubic Hermite segment (Catmull-Rom tangents) through
+//      the commands at (t - look_behind), so the segment end tangents
+//      are known before the segment is played
+//   3. Holds the last command and counts an underrun whenever the
+//      evaluation time runs past the newest command (late arrival)
+//
+// - Times are in [s] and only need to share one clock (e.g. the header
+//   stamp of the commands and the controller update time)
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__JOINT_COMMAND_UPSAMPLER_HPP_
+#define ROS2_PACKAGE__JOINT_COMMAND_UPSAMPLER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace ros2_package
+{
+
+template<size_t N_JOINTS, size_t CAPACITY = 8>
+class JointCommandUpsampler
+{
+  static_assert(CAPACITY >= 4, "the Hermite segment needs 4 commands");
+
+public:
+
+  enum Status { EMPTY, OK, UNDERRUN };
+
+  // look_behind : evaluation delay [s], should be a bit more than one command period
+  explicit JointCommandUpsampler(double look_behind = 0.003)
+  : look_behind_(look_behind) {}
+
+  void configure(double look_behind) { look_behind_ = look_behind; }
+
+  void reset()
+  {
+    size_ = 0;
+    head_ = 0;
+    in_underrun_ = false;
+  }
+
+  // a new command q[] stamped at time t, out-of-order or duplicate stamps are dropped
+  bool push(double t, const double q[N_JOINTS])
+  {
+    if (size_ > 0 && t <= time(0)) {
+      dropped_++;
+      return false;
+    }
+    head_ = (head_ + CAPACITY - 1) % CAPACITY;
+    t_[head_] = t;
+    for (size_t j=0; j<N_JOINTS; j++) q_[head_][j] = q[j];
+    if (size_ < CAPACITY) size_++;
+    received_++;
+    return true;
+  }
+
+  // interpolated command at update time t, written into out[]
+  Status evaluate(double t, double out[N_JOINTS])
+  {
+    if (size_ == 0) return EMPTY;
+
+    const double te = t - look_behind_;
+
+    // late: the stream has not reached the evaluation time yet, hold the newest command
+    if (te > time(0)) {
+      for (size_t j=0; j<N_JOINTS; j++) out[j] = q_[head_][j];
+      const double late = te - time(0);
+      if (late > max_late_) max_late_ = late;
+      if (!in_underrun_) underruns_++;
+      in_underrun_ = true;
+      late_ticks_++;
+      return UNDERRUN;
+    }
+    in_underrun_ = false;
+
+    // older than the whole ring (start-up), hold the oldest command
+    if (size_ == 1 || te <= time(size_ - 1)) {
+      for (size_t j=0; j<N_JOINTS; j++) out[j] = q_[slot(size_ - 1)][j];
+      return OK;
+    }
+
+    // find the segment [i+1, i] (index 0 = newest) containing te
+    size_t i = 0;
+    while (time(i + 1) > te) i++;
+
+    const double t0 = time(i + 1);
+    const double t1 = time(i);
+    const double h = t1 - t0;
+    const double s = (te - t0) / h;
+
+    const double s2 = s * s;
+    const double s3 = s2 * s;
+    const double h00 = 2.0 * s3 - 3.0 * s2 + 1.0;
+    const double h10 = s3 - 2.0 * s2 + s;
+    const double h01 = -2.0 * s3 + 3.0 * s2;
+    const double h11 = s3 - s2;
+
+    for (size_t j=0; j<N_JOINTS; j++) {
+      const double m0 = tangent(i + 1, j);
+      const double m1 = tangent(i, j);
+      out[j] = h00 * q_[slot(i + 1)][j] + h10 * h * m0 + h01 * q_[slot(i)][j] + h11 * h * m1;
+    }
+    return OK;
+  }
+
+  // diagnostics
+  uint64_t received() const { return received_; }
+  uint64_t dropped() const { return dropped_; }
+  uint64_t underruns() const { return underruns_; }     // number of late episodes
+  uint64_t late_ticks() const { return late_ticks_; }   // number of updates spent holding
+  double max_late() const { return max_late_; }         // worst lateness [s]
+
+private:
+
+  size_t slot(size_t i) const { return (head_ + i) % CAPACITY; }
+  double time(size_t i) const { return t_[slot(i)]; }
+
+  // Catmull-Rom tangent at command i, one-sided at the ends of the ring
+  double tangent(size_t i, size_t j) const
+  {
+    const size_t newer = i > 0 ? i - 1 : i;
+    const size_t older = i + 1 < size_ ? i + 1 : i;
+    if (newer == older) return 0.0;
+    return (q_[slot(newer)][j] - q_[slot(older)][j]) / (time(newer) - time(older));
+  }
+
+  double look_behind_;
+
+  double t_[CAPACITY];
+  double q_[CAPACITY][N_JOINTS];
+  size_t head_ = 0;
+  size_t size_ = 0;
+
+  bool in_underrun_ = false;
+  uint64_t received_ {0};
+  uint64_t dropped_ {0};
+  uint64_t underruns_ {0};
+  uint64_t late_ticks_ {0};
+  double max_late_ {0.0};
+};
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__JOINT_COMMAND_UPSAMPLER_HPP_
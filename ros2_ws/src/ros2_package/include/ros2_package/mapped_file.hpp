@@ -0,0 +1,86 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Small RAII wrapper around a read-only memory-mapped file
+//
+// - Used for loading precomputed binary tables (lookup tables,
+//   distance fields, ...) without parsing them at startup
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__MAPPED_FILE_HPP_
+#define ROS2_PACKAGE__MAPPED_FILE_HPP_
+
+#include <cstddef>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace ros2_package
+{
+
+class MappedFile
+{
+public:
+
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile & operator=(const MappedFile &) = delete;
+
+  ~MappedFile() { close(); }
+
+  // returns false if the file cannot be opened or mapped
+  bool open(const std::string & path)
+  {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+      ::close(fd);
+      return false;
+    }
+
+    void * addr = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);    // the mapping stays valid after closing the descriptor
+    if (addr == MAP_FAILED) return false;
+
+    data_ = addr;
+    size_ = (size_t) st.st_size;
+    return true;
+  }
+
+  void close()
+  {
+    if (data_ != nullptr) munmap(data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+  bool is_open() const { return data_ != nullptr; }
+  const void * data() const { return data_; }
+  size_t size() const { return size_; }
+
+  template<typename T>
+  const T * as(size_t offset = 0) const
+  {
+    return reinterpret_cast<const T *>(static_cast<const char *>(data_) + offset);
+  }
+
+private:
+
+  void * data_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__MAPPED_FILE_HPP_
@@ -0,0 +1,205 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Kinematic model of the Panda arm (KDL chain panda_link0 ->
+//   panda_grasptarget) and the position-only IK used by the controllers
+//
+// - Main functionalities:
+//   1. Builds the chain once, and the FK / IK solvers with it, from the
+//      chain compiled into panda_chain_data.hpp at build time (default, no
+//      XML parsing at startup) or from a URDF file given at runtime
+//   2. Solves the IK for a TCP position, keeping the TCP orientation
+//      captured on the first call
+//   3. Forward kinematics of the links of the capsule model (capsule_collision.hpp),
+//      the one segment -> link mapping shared by the controller and the scene builder
+//
+// - Every controller owns its own instance, so several nodes (or
+//   sessions) can run in one process without sharing any state
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__PANDA_KINEMATICS_HPP_
+#define ROS2_PACKAGE__PANDA_KINEMATICS_HPP_
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <kdl_parser/kdl_parser.hpp>
+#include <kdl/chain.hpp>
+#include <kdl/chainfksolverpos_recursive.hpp>
+#include <kdl/chainiksolverpos_nr.hpp>
+#include <kdl/chainiksolvervel_pinv.hpp>
+#include <kdl/frames.hpp>
+#include <kdl/jntarray.hpp>
+
+#include "ros2_package/panda_chain_data.hpp"
+
+
+namespace ros2_package
+{
+
+class PandaKinematics
+{
+public:
+
+  static const unsigned int n_joints = 7;
+
+  // chain compiled from urdf/panda.urdf (validated by the build)
+  bool load()
+  {
+    chain_ = KDL::Chain();
+    for (size_t i=0; i<n_panda_chain_joints; i++) {
+      const PandaChainJoint & j = panda_chain_joints[i];
+      const KDL::Rotation R(j.R[0], j.R[1], j.R[2], j.R[3], j.R[4], j.R[5], j.R[6], j.R[7], j.R[8]);
+      const KDL::Frame origin(R, KDL::Vector(j.p[0], j.p[1], j.p[2]));
+
+      // same joint / segment layout as kdl_parser, so the segment poses match exactly
+      KDL::Joint joint(j.joint, KDL::Joint::None);
+      if (!j.fixed) joint = KDL::Joint(j.joint, origin.p, R * KDL::Vector(j.axis[0], j.axis[1], j.axis[2]), KDL::Joint::RotAxis);
+      chain_.addSegment(KDL::Segment(j.link, joint, origin));
+    }
+    source_ = std::string("embedded panda.urdf (sha256 ") + panda_urdf_sha256 + ")";
+    make_solvers();
+    return true;
+  }
+
+  // chain parsed from a URDF file, returns false if it cannot be parsed
+  bool load(const std::string & urdf_path)
+  {
+    if (urdf_path.empty()) return load();
+
+    if (!kdl_parser::treeFromFile(urdf_path, tree_)) {
+      std::cout << "Failed to construct kdl tree" << std::endl;
+      return false;
+    }
+    if (!tree_.getChain(panda_chain_base, panda_chain_tip, chain_)) {
+      std::cout << "Failed to get the panda_link0 -> panda_grasptarget chain" << std::endl;
+      return false;
+    }
+    source_ = urdf_path;
+    make_solvers();
+    return true;
+  }
+
+  const KDL::Chain & chain() const { return chain_; }
+
+  // where the chain came from, for the logs
+  const std::string & source() const { return source_; }
+
+  // the next IK call captures the current TCP orientation again
+  void reset_orientation() { got_orientation_ = false; }
+
+  // joint values res_vals reaching desired_tcp_pos, starting from (and keeping the orientation of) curr_vals
+  void compute_ik(const std::vector<double>& desired_tcp_pos, const std::vector<double>& curr_vals, std::vector<double>& res_vals,
+                  bool display_time = false)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    //Create the KDL array of current joint values
+    for (unsigned int i=0; i<n_joints; i++) {
+      jnt_pos_start_(i) = curr_vals.at(i);
+    }
+
+    //Write in the initial orientation if not already done so
+    if (!got_orientation_) {
+      //Compute current tcp position
+      KDL::Frame tcp_pos_start;
+      fk_solver_->JntToCart(jnt_pos_start_, tcp_pos_start);
+      orientation_ = tcp_pos_start.M;
+      got_orientation_ = true;
+    }
+
+    //Create the task-space goal object
+    KDL::Vector vec_tcp_pos_goal(desired_tcp_pos.at(0), desired_tcp_pos.at(1), desired_tcp_pos.at(2));
+    KDL::Frame tcp_pos_goal(orientation_, vec_tcp_pos_goal);
+
+    //Compute inverse kinematics
+    ik_solver_->CartToJnt(jnt_pos_start_, tcp_pos_goal, jnt_pos_goal_);
+
+    //Change the control joint values and finish the function
+    for (unsigned int i=0; i<n_joints; i++) {
+      res_vals.at(i) = jnt_pos_goal_.data(i);
+    }
+
+    if (display_time) {
+      auto finish = std::chrono::high_resolution_clock::now();
+      auto duration = std::chrono::duration_cast<std::chrono::microseconds>(finish - start);
+      std::cout << "Execution of my IK solver function took " << duration.count() << " [microseconds]" << std::endl;
+    }
+  }
+
+  // capsule model link of a chain segment: 1-7 = panda_link1-7, 8 = panda_hand, -1 if none
+  static int link_index(const std::string & segment_name)
+  {
+    if (segment_name == "panda_hand") return 8;
+    for (int i=1; i<=7; i++) {
+      if (segment_name == "panda_link" + std::to_string(i)) return i;
+    }
+    return -1;
+  }
+
+  // pose of every capsule model link at the joint values q (n_joints of them), in one pass over the chain:
+  // set_pose(link, R, p) with R row-major (KDL::Rotation::data) and p in the base frame
+  template <typename SetPose>
+  void link_poses(const double * q, SetPose && set_pose) const
+  {
+    KDL::Frame frame = KDL::Frame::Identity();
+    unsigned int j = 0;
+    for (unsigned int i=0; i<chain_.getNrOfSegments(); i++) {
+      const KDL::Segment & segment = chain_.getSegment(i);
+      double q_i = 0.0;
+      if (segment.getJoint().getType() != KDL::Joint::None && j < n_joints) q_i = q[j++];
+      frame = frame * segment.pose(q_i);
+      if (segment_links_[i] >= 0) set_pose(segment_links_[i], frame.M.data, frame.p.data);
+    }
+  }
+
+  // tcp position of the joint values q (n_joints of them)
+  void compute_fk(const double * q, double tcp[3])
+  {
+    KDL::JntArray jnt(n_joints);
+    for (unsigned int i=0; i<n_joints; i++) jnt(i) = q[i];
+
+    KDL::Frame frame;
+    fk_solver_->JntToCart(jnt, frame);
+    for (unsigned int k=0; k<3; k++) tcp[k] = frame.p(k);
+  }
+
+protected:
+
+  // the solvers keep references to the chain, so they are (re)built whenever the chain changes
+  void make_solvers()
+  {
+    fk_solver_ = std::make_unique<KDL::ChainFkSolverPos_recursive>(chain_);
+    vel_ik_solver_ = std::make_unique<KDL::ChainIkSolverVel_pinv>(chain_, 0.0001, 1000);
+    ik_solver_ = std::make_unique<KDL::ChainIkSolverPos_NR>(chain_, *fk_solver_, *vel_ik_solver_, 1000);
+    segment_links_.clear();
+    for (unsigned int i=0; i<chain_.getNrOfSegments(); i++) segment_links_.push_back(link_index(chain_.getSegment(i).getName()));
+    jnt_pos_start_.resize(n_joints);
+    jnt_pos_goal_.resize(n_joints);
+    got_orientation_ = false;
+  }
+
+  KDL::Tree tree_;
+  KDL::Chain chain_;
+  std::string source_;
+  std::vector<int> segment_links_;   // capsule model link of each chain segment, -1 if none
+
+  std::unique_ptr<KDL::ChainFkSolverPos_recursive> fk_solver_;
+  std::unique_ptr<KDL::ChainIkSolverVel_pinv> vel_ik_solver_;
+  std::unique_ptr<KDL::ChainIkSolverPos_NR> ik_solver_;
+  KDL::JntArray jnt_pos_start_;
+  KDL::JntArray jnt_pos_goal_;
+
+  KDL::Rotation orientation_;
+  bool got_orientation_ = false;
+};
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__PANDA_KINEMATICS_HPP_
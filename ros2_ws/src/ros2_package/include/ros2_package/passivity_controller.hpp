@@ -0,0 +1,135 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Time-domain passivity observer / passivity controller
+//   for the forces rendered on the Falcon joystick
+//
+// - Main functionalities:
+//   1. Observes the energy absorbed by the rendered environment, per axis
+//   2. Injects an adaptive damping force ONLY when the observed energy
+//      goes negative (i.e. the environment has become active)
+//   3. O(1) work and fixed state per axis, so it can run every servo tick
+//
+// - Sign convention: f is the force applied ON the handle, v is the handle
+//   velocity, so the power flowing INTO the environment is -f * v
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__PASSIVITY_CONTROLLER_HPP_
+#define ROS2_PACKAGE__PASSIVITY_CONTROLLER_HPP_
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+
+namespace ros2_package
+{
+
+/////////////// SINGLE AXIS OBSERVER + CONTROLLER //////////////
+
+class AxisPassivityController
+{
+public:
+
+  // max_damping : upper bound on the injected damping [N.s/m]
+  // energy_cap  : upper bound on the stored energy "credit" [J], limits how much
+  //               previously absorbed energy can later be returned without damping
+  AxisPassivityController(double max_damping = 40.0,
+                          double energy_cap = std::numeric_limits<double>::infinity())
+  : max_damping_(max_damping), energy_cap_(energy_cap) {}
+
+  void configure(double max_damping, double energy_cap)
+  {
+    max_damping_ = max_damping;
+    energy_cap_ = energy_cap;
+  }
+
+  void reset()
+  {
+    energy_ = 0.0;
+    prev_force_ = 0.0;
+    alpha_ = 0.0;
+    dissipated_ = 0.0;
+  }
+
+  // f_desired : force computed by the rendered environment for this tick [N]
+  // v         : (filtered) handle velocity [m/s]
+  // dt        : time since the last tick [s]
+  // returns the force to actually send to the device
+  double step(double f_desired, double v, double dt)
+  {
+    // the force sent last tick was held over the interval that just ended
+    energy_ -= prev_force_ * v * dt;
+    if (energy_ > energy_cap_) energy_ = energy_cap_;
+
+    // the environment generated energy => dissipate the deficit over the next interval
+    alpha_ = 0.0;
+    const double v2 = v * v;
+    if (energy_ < 0.0 && v2 > 1e-12 && dt > 0.0) {
+      alpha_ = -energy_ / (dt * v2);
+      if (alpha_ > max_damping_) alpha_ = max_damping_;
+      dissipated_ += alpha_ * v2 * dt;
+    }
+
+    const double f = f_desired - alpha_ * v;
+    prev_force_ = f;
+    return f;
+  }
+
+  double energy() const { return energy_; }
+  double damping() const { return alpha_; }
+  double dissipated() const { return dissipated_; }
+
+private:
+
+  double max_damping_;
+  double energy_cap_;
+
+  double energy_ {0.0};       // observed energy absorbed by the environment [J]
+  double prev_force_ {0.0};   // force sent on the previous tick [N]
+  double alpha_ {0.0};        // damping injected on the current tick [N.s/m]
+  double dissipated_ {0.0};   // total energy dissipated by the controller [J]
+};
+
+
+/////////////// 3D PASSIVITY CONTROLLER //////////////
+
+class PassivityController
+{
+public:
+
+  PassivityController(double max_damping = 40.0,
+                      double energy_cap = std::numeric_limits<double>::infinity())
+  {
+    configure(max_damping, energy_cap);
+  }
+
+  void configure(double max_damping, double energy_cap)
+  {
+    for (size_t i=0; i<3; i++) axes_[i].configure(max_damping, energy_cap);
+  }
+
+  void reset()
+  {
+    for (size_t i=0; i<3; i++) axes_[i].reset();
+  }
+
+  // modifies f[3] in place
+  void step(double f[3], const double v[3], double dt)
+  {
+    for (size_t i=0; i<3; i++) f[i] = axes_[i].step(f[i], v[i], dt);
+  }
+
+  const AxisPassivityController & axis(size_t i) const { return axes_[i]; }
+
+private:
+
+  AxisPassivityController axes_[3];
+};
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__PASSIVITY_CONTROLLER_HPP_
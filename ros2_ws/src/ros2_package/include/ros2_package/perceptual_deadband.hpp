@@ -0,0 +1,180 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Weber-law perceptual deadband coding for the haptic
+//   position stream (Falcon -> controller)
+//
+// - Main functionalities:
+//   1. DeadbandEncoder: decides on the talker side whether a sample
+//      differs enough from the last transmitted one to be sent
+//   2. DeadbandDecoder: reconstructs the stream on the controller side,
+//      holding or extrapolating the last transmitted samples
+//
+// - Both sides must be configured with the same {k, min_threshold} so
+//   that the decoder can bound its extrapolation by the deadband
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__PERCEPTUAL_DEADBAND_HPP_
+#define ROS2_PACKAGE__PERCEPTUAL_DEADBAND_HPP_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace ros2_package
+{
+
+// deadband around a transmitted sample: k * |sample|, but never below the absolute floor
+inline double deadband_threshold(const double ref[3], double k, double min_threshold)
+{
+  const double mag = std::sqrt(ref[0] * ref[0] + ref[1] * ref[1] + ref[2] * ref[2]);
+  const double thres = k * mag;
+  return thres > min_threshold ? thres : min_threshold;
+}
+
+
+/////////////// TALKER SIDE //////////////
+
+class DeadbandEncoder
+{
+public:
+
+  // k             : Weber fraction (relative just-noticeable difference)
+  // min_threshold : absolute floor of the deadband, in the units of the samples
+  // heartbeat     : a sample is always sent after this long without transmitting [s]
+  DeadbandEncoder(double k = 0.05, double min_threshold = 3e-4, double heartbeat = 0.1)
+  : k_(k), min_threshold_(min_threshold), heartbeat_(heartbeat) {}
+
+  void configure(double k, double min_threshold, double heartbeat)
+  {
+    k_ = k;
+    min_threshold_ = min_threshold;
+    heartbeat_ = heartbeat;
+  }
+
+  // returns true if p[3] should be transmitted, t is a monotonic time in [s]
+  bool should_send(const double p[3], double t)
+  {
+    bool send = !has_sent_ || (t - last_sent_time_) >= heartbeat_;
+
+    if (!send) {
+      const double dx = p[0] - last_sent_[0];
+      const double dy = p[1] - last_sent_[1];
+      const double dz = p[2] - last_sent_[2];
+      const double thres = deadband_threshold(last_sent_, k_, min_threshold_);
+      send = (dx * dx + dy * dy + dz * dz) > thres * thres;
+    }
+
+    if (send) {
+      for (size_t i=0; i<3; i++) last_sent_[i] = p[i];
+      last_sent_time_ = t;
+      has_sent_ = true;
+      transmitted_++;
+    } else {
+      suppressed_++;
+    }
+    return send;
+  }
+
+  uint64_t transmitted() const { return transmitted_; }
+  uint64_t suppressed() const { return suppressed_; }
+
+  // fraction of the samples that were actually sent, in [0, 1]
+  double transmit_ratio() const
+  {
+    const uint64_t total = transmitted_ + suppressed_;
+    return total == 0 ? 1.0 : (double) transmitted_ / total;
+  }
+
+private:
+
+  double k_;
+  double min_threshold_;
+  double heartbeat_;
+
+  double last_sent_[3] {0.0, 0.0, 0.0};
+  double last_sent_time_ {0.0};
+  bool has_sent_ = false;
+
+  uint64_t transmitted_ {0};
+  uint64_t suppressed_ {0};
+};
+
+
+/////////////// CONTROLLER SIDE //////////////
+
+class DeadbandDecoder
+{
+public:
+
+  // extrapolate : 0 = zero-order hold, 1 = first-order extrapolation
+  // horizon     : extrapolation is frozen after this long without a new sample [s]
+  DeadbandDecoder(double k = 0.05, double min_threshold = 3e-4, int extrapolate = 1, double horizon = 0.1)
+  : k_(k), min_threshold_(min_threshold), extrapolate_(extrapolate), horizon_(horizon) {}
+
+  void configure(double k, double min_threshold, int extrapolate, double horizon)
+  {
+    k_ = k;
+    min_threshold_ = min_threshold;
+    extrapolate_ = extrapolate;
+    horizon_ = horizon;
+  }
+
+  // a transmitted sample arrived at time t [s]
+  void receive(const double p[3], double t)
+  {
+    if (received_ > 0 && t > last_time_) {
+      const double dt = t - last_time_;
+      for (size_t i=0; i<3; i++) vel_[i] = (p[i] - last_[i]) / dt;
+    } else {
+      for (size_t i=0; i<3; i++) vel_[i] = 0.0;
+    }
+    for (size_t i=0; i<3; i++) last_[i] = p[i];
+    last_time_ = t;
+    received_++;
+  }
+
+  // reconstructed sample at time t [s], written into out[3]
+  void sample(double t, double out[3]) const
+  {
+    for (size_t i=0; i<3; i++) out[i] = last_[i];
+    if (!extrapolate_ || received_ < 2) return;
+
+    double h = t - last_time_;
+    if (h <= 0.0) return;
+    if (h > horizon_) h = horizon_;
+
+    // the true signal is still inside the deadband (otherwise it would have been sent),
+    // so never extrapolate further than the deadband around the last sample
+    double d[3];
+    double norm2 = 0.0;
+    for (size_t i=0; i<3; i++) { d[i] = vel_[i] * h; norm2 += d[i] * d[i]; }
+    const double thres = deadband_threshold(last_, k_, min_threshold_);
+    double scale = 1.0;
+    if (norm2 > thres * thres) scale = thres / std::sqrt(norm2);
+
+    for (size_t i=0; i<3; i++) out[i] += scale * d[i];
+  }
+
+  uint64_t received() const { return received_; }
+
+private:
+
+  double k_;
+  double min_threshold_;
+  int extrapolate_;
+  double horizon_;
+
+  double last_[3] {0.0, 0.0, 0.0};
+  double vel_[3] {0.0, 0.0, 0.0};
+  double last_time_ {0.0};
+  uint64_t received_ {0};
+};
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__PERCEPTUAL_DEADBAND_HPP_
@@ -0,0 +1,465 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Drawing surfaces of the batch trial plotter, CPU only (no GPU, no
+//   plotting library), so that hundreds of figures render in parallel
+//
+// - Main functionalities:
+//   1. Surface: the few primitives the figures need (filled rectangles,
+//      polylines, text), in pixels with y down
+//   2. RasterSurface: anti-aliased software rasterization into an RGB
+//      Canvas, clipped to a region, so that several threads draw the cells
+//      of one contact sheet into the same canvas
+//   3. SvgSurface: the same primitives as SVG elements
+//   4. GlyphCache: the text of the raster figures, a built-in 5x7 font
+//      rasterized once per size with area coverage and shared by all threads
+//   5. write_png() (zlib) and write_svg()
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__PLOT_SURFACE_HPP_
+#define ROS2_PACKAGE__PLOT_SURFACE_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+
+namespace ros2_package
+{
+
+struct Color
+{
+  uint8_t r, g, b;
+
+  std::string hex() const
+  {
+    char s[8];
+    std::snprintf(s, sizeof(s), "#%02x%02x%02x", r, g, b);
+    return s;
+  }
+};
+
+struct Point
+{
+  double x, y;
+};
+
+struct Rect
+{
+  double x, y, w, h;
+
+  double right() const { return x + w; }
+  double bottom() const { return y + h; }
+  Rect inset(double left, double top, double r, double b) const { return {x + left, y + top, w - left - r, h - top - b}; }
+};
+
+enum class Align { left, center, right };
+
+
+class Surface
+{
+public:
+
+  virtual ~Surface() = default;
+
+  virtual void fill_rect(const Rect & r, Color c) = 0;
+  // a NaN point breaks the line
+  virtual void polyline(const std::vector<Point> & points, Color c, double width) = 0;
+  // y is the baseline, size the cap height in pixels
+  virtual void text(double x, double y, const std::string & s, double size, Color c, Align align = Align::left) = 0;
+
+  void line(Point a, Point b, Color c, double width) { polyline({a, b}, c, width); }
+  void stroke_rect(const Rect & r, Color c, double width)
+  {
+    polyline({{r.x, r.y}, {r.right(), r.y}, {r.right(), r.bottom()}, {r.x, r.bottom()}, {r.x, r.y}}, c, width);
+  }
+};
+
+
+///////////////////////////////////// FONT /////////////////////////////////////
+
+namespace plot_font
+{
+
+// classic 5x7 font, ASCII 32-126, one byte per column, bit 0 = top row, bit 7 = descender row
+const uint8_t columns[95][5] = {
+  {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00}, {0x14, 0x7F, 0x14, 0x7F, 0x14},
+  {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62}, {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00},
+  {0x00, 0x1C, 0x22, 0x41, 0x00}, {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x08, 0x2A, 0x1C, 0x2A, 0x08}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+  {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00}, {0x20, 0x10, 0x08, 0x04, 0x02},
+  {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00}, {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31},
+  {0x18, 0x14, 0x12, 0x7F, 0x10}, {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+  {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00}, {0x00, 0x56, 0x36, 0x00, 0x00},
+  {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14}, {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06},
+  {0x32, 0x49, 0x79, 0x41, 0x3E}, {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+  {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x01, 0x01}, {0x3E, 0x41, 0x41, 0x51, 0x32},
+  {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00}, {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41},
+  {0x7F, 0x40, 0x40, 0x40, 0x40}, {0x7F, 0x02, 0x04, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+  {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46}, {0x46, 0x49, 0x49, 0x49, 0x31},
+  {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F}, {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x7F, 0x20, 0x18, 0x20, 0x7F},
+  {0x63, 0x14, 0x08, 0x14, 0x63}, {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x00},
+  {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7F, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04}, {0x40, 0x40, 0x40, 0x40, 0x40},
+  {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78}, {0x7F, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20},
+  {0x38, 0x44, 0x44, 0x48, 0x7F}, {0x38, 0x54, 0x54, 0x54, 0x18}, {0x08, 0x7E, 0x09, 0x01, 0x02}, {0x18, 0xA4, 0xA4, 0xA4, 0x7C},
+  {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x40, 0x80, 0x84, 0x7D, 0x00}, {0x7F, 0x10, 0x28, 0x44, 0x00},
+  {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x18, 0x04, 0x78}, {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38},
+  {0xFC, 0x24, 0x24, 0x24, 0x18}, {0x18, 0x24, 0x24, 0x24, 0xFC}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20},
+  {0x04, 0x3F, 0x44, 0x40, 0x20}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C}, {0x3C, 0x40, 0x30, 0x40, 0x3C},
+  {0x44, 0x28, 0x10, 0x28, 0x44}, {0x1C, 0xA0, 0xA0, 0xA0, 0x7C}, {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00},
+  {0x00, 0x00, 0x7F, 0x00, 0x00}, {0x00, 0x41, 0x36, 0x08, 0x00}, {0x08, 0x04, 0x08, 0x10, 0x08}
+};
+
+const int cell_width = 6;    // 5 columns + spacing
+const int cap_height = 7;
+const int cell_height = 8;   // the descenders of g, j, p, q, y use row 7
+
+}  // namespace plot_font
+
+// the glyphs of one size, coverage 0-255, row major
+struct GlyphSet
+{
+  int size;           // cap height in pixels
+  int width;          // advance
+  int height;
+  std::vector<std::vector<uint8_t>> masks;   // 95 glyphs
+
+  const uint8_t * mask(char ch) const
+  {
+    const int i = (ch < 32 || ch > 126) ? ('?' - 32) : (ch - 32);
+    return masks[(size_t) i].data();
+  }
+};
+
+// one GlyphSet per size, built on first use and never freed, so the references stay valid for every thread
+class GlyphCache
+{
+public:
+
+  const GlyphSet & get(int size)
+  {
+    size = std::max(size, 5);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sets_.find(size);
+    if (it == sets_.end()) it = sets_.emplace(size, build(size)).first;
+    return *it->second;
+  }
+
+private:
+
+  static std::unique_ptr<GlyphSet> build(int size)
+  {
+    using namespace plot_font;
+    auto set = std::make_unique<GlyphSet>();
+    const double scale = (double) size / cap_height;   // pixels per font cell
+    set->size = size;
+    set->width = (int) std::ceil(cell_width * scale);
+    set->height = (int) std::ceil(cell_height * scale);
+
+    // exact area of every output pixel covered by the lit font cells
+    for (int g=0; g<95; g++) {
+      std::vector<uint8_t> mask((size_t) (set->width * set->height), 0);
+      for (int py=0; py<set->height; py++) {
+        for (int px=0; px<set->width; px++) {
+          const double x0 = px / scale, x1 = (px + 1) / scale, y0 = py / scale, y1 = (py + 1) / scale;
+          double area = 0.0;
+          for (int col=std::max(0, (int) x0); col<std::min(5, (int) std::ceil(x1)); col++) {
+            for (int row=std::max(0, (int) y0); row<std::min(cell_height, (int) std::ceil(y1)); row++) {
+              if (!(columns[g][col] >> row & 1)) continue;
+              area += (std::min(x1, col + 1.0) - std::max(x0, (double) col)) * (std::min(y1, row + 1.0) - std::max(y0, (double) row));
+            }
+          }
+          mask[(size_t) (py * set->width + px)] = (uint8_t) std::lround(std::min(1.0, area * scale * scale) * 255);
+        }
+      }
+      set->masks.push_back(std::move(mask));
+    }
+    return set;
+  }
+
+  std::mutex mutex_;
+  std::map<int, std::unique_ptr<GlyphSet>> sets_;
+};
+
+
+///////////////////////////////////// RASTER /////////////////////////////////////
+
+// RGB, 8 bits per channel
+struct Canvas
+{
+  int width, height;
+  std::vector<uint8_t> pixels;
+
+  Canvas(int w, int h, Color background = {255, 255, 255})
+  : width(w), height(h), pixels((size_t) (w * h * 3))
+  {
+    for (size_t i=0; i<pixels.size(); i+=3) {
+      pixels[i] = background.r;
+      pixels[i + 1] = background.g;
+      pixels[i + 2] = background.b;
+    }
+  }
+};
+
+class RasterSurface : public Surface
+{
+public:
+
+  // draws into the clip region of the canvas only
+  RasterSurface(Canvas & canvas, GlyphCache & glyphs, Rect clip)
+  : canvas_(canvas), glyphs_(glyphs)
+  {
+    x0_ = std::max(0, (int) std::floor(clip.x));
+    y0_ = std::max(0, (int) std::floor(clip.y));
+    x1_ = std::min(canvas.width, (int) std::ceil(clip.right()));
+    y1_ = std::min(canvas.height, (int) std::ceil(clip.bottom()));
+  }
+
+  RasterSurface(Canvas & canvas, GlyphCache & glyphs)
+  : RasterSurface(canvas, glyphs, {0, 0, (double) canvas.width, (double) canvas.height}) {}
+
+  void fill_rect(const Rect & r, Color c) override
+  {
+    const int xa = std::max(x0_, (int) std::lround(r.x)), xb = std::min(x1_, (int) std::lround(r.right()));
+    const int ya = std::max(y0_, (int) std::lround(r.y)), yb = std::min(y1_, (int) std::lround(r.bottom()));
+    for (int y=ya; y<yb; y++) {
+      for (int x=xa; x<xb; x++) blend(x, y, c, 255);
+    }
+  }
+
+  // every segment is a capsule, the coverage of a pixel is its distance to the segment against the half width.
+  // the coverage of the whole line is accumulated first (max over the segments), so the joints are not blended twice
+  void polyline(const std::vector<Point> & points, Color c, double width) override
+  {
+    if (x1_ <= x0_ || y1_ <= y0_) return;
+    if (coverage_.empty()) coverage_.assign((size_t) ((x1_ - x0_) * (y1_ - y0_)), 0);
+    dirty_x0_ = x1_; dirty_y0_ = y1_; dirty_x1_ = x0_; dirty_y1_ = y0_;
+
+    const double r = std::max(0.5, width / 2);
+    Point prev {NAN, NAN};
+    for (const Point & p : points) {
+      if (std::isnan(p.x) || std::isnan(p.y)) {
+        prev = p;
+        continue;
+      }
+      // points closer than a quarter pixel add nothing but overdraw
+      if (!std::isnan(prev.x) && std::hypot(p.x - prev.x, p.y - prev.y) < 0.25 && &p != &points.back()) continue;
+      if (!std::isnan(prev.x)) segment(prev, p, r);
+      else if (points.size() == 1) segment(p, p, r);
+      prev = p;
+    }
+
+    const int w = x1_ - x0_;
+    for (int y=dirty_y0_; y<dirty_y1_; y++) {
+      for (int x=dirty_x0_; x<dirty_x1_; x++) {
+        uint8_t & a = coverage_[(size_t) ((y - y0_) * w + x - x0_)];
+        if (a) blend(x, y, c, a);
+        a = 0;
+      }
+    }
+  }
+
+  void text(double x, double y, const std::string & s, double size, Color c, Align align) override
+  {
+    const GlyphSet & g = glyphs_.get((int) std::lround(size));
+    const double scale = (double) g.size / plot_font::cap_height;
+    const int advance = g.width;
+    const int total = advance * (int) s.size() - (int) std::lround(scale);   // no spacing after the last one
+    int left = (int) std::lround(x) - (align == Align::center ? total / 2 : align == Align::right ? total : 0);
+    const int top = (int) std::lround(y) - g.size;
+
+    for (char ch : s) {
+      const uint8_t * mask = g.mask(ch);
+      for (int py=0; py<g.height; py++) {
+        for (int px=0; px<advance; px++) {
+          const uint8_t a = mask[py * advance + px];
+          if (a) blend(left + px, top + py, c, a);
+        }
+      }
+      left += advance;
+    }
+  }
+
+private:
+
+  void segment(Point a, Point b, double r)
+  {
+    const int xa = std::max(x0_, (int) std::floor(std::min(a.x, b.x) - r - 1));
+    const int xb = std::min(x1_, (int) std::ceil(std::max(a.x, b.x) + r + 1));
+    const int ya = std::max(y0_, (int) std::floor(std::min(a.y, b.y) - r - 1));
+    const int yb = std::min(y1_, (int) std::ceil(std::max(a.y, b.y) + r + 1));
+    const double dx = b.x - a.x, dy = b.y - a.y;
+    const double len2 = dx * dx + dy * dy;
+    const int w = x1_ - x0_;
+    dirty_x0_ = std::min(dirty_x0_, xa); dirty_x1_ = std::max(dirty_x1_, xb);
+    dirty_y0_ = std::min(dirty_y0_, ya); dirty_y1_ = std::max(dirty_y1_, yb);
+
+    for (int y=ya; y<yb; y++) {
+      for (int x=xa; x<xb; x++) {
+        // pixel centers
+        const double px = x + 0.5 - a.x, py = y + 0.5 - a.y;
+        const double t = len2 > 0 ? std::clamp((px * dx + py * dy) / len2, 0.0, 1.0) : 0.0;
+        const double d = std::hypot(px - t * dx, py - t * dy);
+        const uint8_t coverage = (uint8_t) std::lround(std::clamp(r + 0.5 - d, 0.0, 1.0) * 255);
+        uint8_t & a = coverage_[(size_t) ((y - y0_) * w + x - x0_)];
+        a = std::max(a, coverage);
+      }
+    }
+  }
+
+  void blend(int x, int y, Color c, uint8_t a)
+  {
+    if (x < x0_ || x >= x1_ || y < y0_ || y >= y1_) return;
+    uint8_t * p = &canvas_.pixels[(size_t) ((y * canvas_.width + x) * 3)];
+    if (a == 255) {
+      p[0] = c.r; p[1] = c.g; p[2] = c.b;
+      return;
+    }
+    const int inv = 255 - a;
+    p[0] = (uint8_t) ((c.r * a + p[0] * inv + 127) / 255);
+    p[1] = (uint8_t) ((c.g * a + p[1] * inv + 127) / 255);
+    p[2] = (uint8_t) ((c.b * a + p[2] * inv + 127) / 255);
+  }
+
+  Canvas & canvas_;
+  GlyphCache & glyphs_;
+  int x0_, y0_, x1_, y1_;                          // clip region
+  std::vector<uint8_t> coverage_;                  // of the polyline being drawn, over the clip region
+  int dirty_x0_, dirty_y0_, dirty_x1_, dirty_y1_;
+};
+
+
+///////////////////////////////////// SVG /////////////////////////////////////
+
+class SvgSurface : public Surface
+{
+public:
+
+  void fill_rect(const Rect & r, Color c) override
+  {
+    out_ << "<rect x=\"" << r.x << "\" y=\"" << r.y << "\" width=\"" << r.w << "\" height=\"" << r.h
+         << "\" fill=\"" << c.hex() << "\"/>\n";
+  }
+
+  void polyline(const std::vector<Point> & points, Color c, double width) override
+  {
+    std::ostringstream pts;
+    pts.precision(6);
+    size_t n = 0;
+    Point prev {NAN, NAN};
+    auto flush = [&]() {
+      if (n >= 2) {
+        out_ << "<polyline fill=\"none\" stroke=\"" << c.hex() << "\" stroke-width=\"" << width
+             << "\" stroke-linejoin=\"round\" points=\"" << pts.str() << "\"/>\n";
+      }
+      pts.str("");
+      n = 0;
+    };
+    for (const Point & p : points) {
+      if (std::isnan(p.x) || std::isnan(p.y)) {
+        flush();
+        prev = p;
+        continue;
+      }
+      if (n > 0 && std::hypot(p.x - prev.x, p.y - prev.y) < 0.25 && &p != &points.back()) continue;
+      pts << (n ? " " : "") << p.x << "," << p.y;
+      n++;
+      prev = p;
+    }
+    flush();
+  }
+
+  void text(double x, double y, const std::string & s, double size, Color c, Align align) override
+  {
+    std::string escaped;
+    for (char ch : s) {
+      if (ch == '<') escaped += "&lt;";
+      else if (ch == '>') escaped += "&gt;";
+      else if (ch == '&') escaped += "&amp;";
+      else escaped += ch;
+    }
+    const char * anchor = align == Align::center ? "middle" : align == Align::right ? "end" : "start";
+    // a sans-serif cap height is about 0.7 of the font size
+    out_ << "<text x=\"" << x << "\" y=\"" << y << "\" font-family=\"sans-serif\" font-size=\"" << size / 0.7
+         << "\" fill=\"" << c.hex() << "\" text-anchor=\"" << anchor << "\">" << escaped << "</text>\n";
+  }
+
+  std::string body() const { return out_.str(); }
+
+  // another surface's elements, e.g. a cell of a contact sheet drawn by another thread
+  void append(const SvgSurface & other) { out_ << other.out_.str(); }
+
+private:
+
+  std::ostringstream out_;
+};
+
+
+///////////////////////////////////// FILES /////////////////////////////////////
+
+inline bool write_svg(const std::string & path, int width, int height, const SvgSurface & svg)
+{
+  FILE * f = std::fopen(path.c_str(), "w");
+  if (!f) return false;
+  std::fprintf(f, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\" viewBox=\"0 0 %d %d\">\n",
+               width, height, width, height);
+  const std::string body = svg.body();
+  bool ok = std::fwrite(body.data(), 1, body.size(), f) == body.size();
+  ok = std::fputs("</svg>\n", f) >= 0 && ok;
+  return std::fclose(f) == 0 && ok;
+}
+
+inline bool write_png(const std::string & path, const Canvas & canvas)
+{
+  // scanlines with the Sub filter (flat plot backgrounds compress to almost nothing)
+  const size_t stride = (size_t) canvas.width * 3;
+  std::vector<uint8_t> raw((stride + 1) * (size_t) canvas.height);
+  for (int y=0; y<canvas.height; y++) {
+    uint8_t * out = &raw[(size_t) y * (stride + 1)];
+    const uint8_t * in = &canvas.pixels[(size_t) y * stride];
+    out[0] = 1;
+    for (size_t i=0; i<stride; i++) out[i + 1] = (uint8_t) (in[i] - (i >= 3 ? in[i - 3] : 0));
+  }
+
+  uLongf compressed_size = compressBound((uLong) raw.size());
+  std::vector<uint8_t> compressed(compressed_size);
+  if (compress2(compressed.data(), &compressed_size, raw.data(), (uLong) raw.size(), 6) != Z_OK) return false;
+
+  FILE * f = std::fopen(path.c_str(), "wb");
+  if (!f) return false;
+  bool ok = true;
+  auto chunk = [&](const char * type, const uint8_t * data, size_t size) {
+    const uint8_t length[4] = {(uint8_t) (size >> 24), (uint8_t) (size >> 16), (uint8_t) (size >> 8), (uint8_t) size};
+    uLong crc = crc32(0, reinterpret_cast<const Bytef *>(type), 4);
+    if (size) crc = crc32(crc, data, (uInt) size);
+    const uint8_t crc_bytes[4] = {(uint8_t) (crc >> 24), (uint8_t) (crc >> 16), (uint8_t) (crc >> 8), (uint8_t) crc};
+    ok = ok && std::fwrite(length, 1, 4, f) == 4 && std::fwrite(type, 1, 4, f) == 4 &&
+         (size == 0 || std::fwrite(data, 1, size, f) == size) && std::fwrite(crc_bytes, 1, 4, f) == 4;
+  };
+
+  const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  ok = std::fwrite(signature, 1, 8, f) == 8;
+  const uint32_t w = (uint32_t) canvas.width, h = (uint32_t) canvas.height;
+  const uint8_t header[13] = {(uint8_t) (w >> 24), (uint8_t) (w >> 16), (uint8_t) (w >> 8), (uint8_t) w,
+                              (uint8_t) (h >> 24), (uint8_t) (h >> 16), (uint8_t) (h >> 8), (uint8_t) h,
+                              8, 2, 0, 0, 0};   // 8 bit RGB
+  chunk("IHDR", header, sizeof(header));
+  chunk("IDAT", compressed.data(), compressed_size);
+  chunk("IEND", nullptr, 0);
+  return std::fclose(f) == 0 && ok;
+}
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__PLOT_SURFACE_HPP_
@@ -0,0 +1,228 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Named QoS profiles per topic, and live statistics of the subscriptions
+//
+// - Main functionalities:
+//   1. topic_qos(node, topic, default_profile) looks up the profile of a topic in
+//      the "qos.<topic>" parameter ('/' -> '.'), loaded from config/qos_profiles.yaml:
+//        "control": best effort, keep last 1 (only the newest sample matters,
+//                   a slow consumer drops stale commands instead of queueing them)
+//        "event":   reliable, transient local, keep last 1 (late joiners get the last one)
+//        "default": reliable, keep last 10 (what every topic used before)
+//   2. TopicStats counts, per subscription: received rate, gaps in the publication
+//      sequence numbers, age at the callback (source timestamp -> take) and the
+//      high-water mark of the subscription queue
+//   3. TopicStatsPublisher publishes them (tutorial_interfaces/TopicStats) on
+//      "topic_stats", once per period
+//
+// - Note: a best effort publisher does not reach a reliable subscriber, so the
+//   subscribers of a "control" topic outside this package must be best effort too.
+//   Best effort subscribers are fine with any publisher.
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__QOS_PROFILES_HPP_
+#define ROS2_PACKAGE__QOS_PROFILES_HPP_
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "tutorial_interfaces/msg/topic_stats.hpp"
+
+
+namespace ros2_package
+{
+
+inline bool valid_qos_profile(const std::string & name)
+{
+  return name == "control" || name == "event" || name == "default";
+}
+
+inline rclcpp::QoS qos_profile(const std::string & name)
+{
+  if (name == "control") return rclcpp::QoS(rclcpp::KeepLast(1)).best_effort().durability_volatile();
+  if (name == "event") return rclcpp::QoS(rclcpp::KeepLast(1)).reliable().transient_local();
+  if (name != "default") std::cout << "Unknown QoS profile '" << name << "', using the default one" << std::endl;
+  return rclcpp::QoS(rclcpp::KeepLast(10)).reliable().durability_volatile();
+}
+
+// "franka/joint_states" -> "qos.franka.joint_states"
+inline std::string qos_parameter_name(const std::string & topic)
+{
+  std::string name = "qos." + topic;
+  std::replace(name.begin(), name.end(), '/', '.');
+  return name;
+}
+
+// profile name of a topic, the parameter is declared on first use
+inline std::string topic_qos_profile(rclcpp::Node * node, const std::string & topic, const std::string & default_profile)
+{
+  const std::string param = qos_parameter_name(topic);
+  if (!node->has_parameter(param)) node->declare_parameter(param, default_profile);
+  return node->get_parameter(param).as_string();
+}
+
+inline rclcpp::QoS topic_qos(rclcpp::Node * node, const std::string & topic, const std::string & default_profile = "default")
+{
+  return qos_profile(topic_qos_profile(node, topic, default_profile));
+}
+
+
+// statistics of one subscription, fed from the callbacks taking a rclcpp::MessageInfo
+class TopicStats
+{
+public:
+
+  // the raw publisher gid, compared as bytes (no string built per message)
+  using PublisherGid = std::array<uint8_t, RMW_GID_STORAGE_SIZE>;
+
+  TopicStats(const std::string & topic, const std::string & profile)
+  : topic_(topic), profile_(profile) {}
+
+  const std::string & topic() const { return topic_; }
+  const std::string & profile() const { return profile_; }
+
+  // timestamps in [ns] since the epoch (0 = not provided by the middleware), seq 0 = unsupported
+  void add(int64_t take_ns, int64_t source_ns, int64_t received_ns, const PublisherGid & publisher, uint64_t seq)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    received_++;
+    period_count_++;
+
+    if (source_ns > 0 && take_ns >= source_ns) {
+      const double age = 1e-6 * (take_ns - source_ns);
+      age_sum_ += age;
+      age_max_ = std::max(age_max_, age);
+      age_count_++;
+    }
+
+    if (seq != 0 && seq != UINT64_MAX) {
+      auto it = last_seq_.find(publisher);
+      if (it == last_seq_.end()) {
+        last_seq_.emplace(publisher, seq);   // allocates once per publisher
+      } else {
+        if (seq > it->second + 1) gaps_ += seq - it->second - 1;
+        it->second = seq;
+      }
+    }
+
+    // every earlier message still waiting to be taken when this one arrived had it queued behind
+    if (received_ns > 0) {
+      for (auto it = takes_.rbegin(); it != takes_.rend() && it->first > received_ns; ++it) {
+        it->second++;
+        queue_high_water_ = std::max(queue_high_water_, it->second);
+      }
+      takes_.push_back({take_ns, 1});
+      if (takes_.size() > max_takes) takes_.pop_front();
+    }
+    queue_high_water_ = std::max(queue_high_water_, (uint32_t) 1);
+  }
+
+  void add(const rclcpp::MessageInfo & info)
+  {
+    const rmw_message_info_t & rmw = info.get_rmw_message_info();
+    const int64_t take_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+    PublisherGid publisher;
+    std::copy(std::begin(rmw.publisher_gid.data), std::end(rmw.publisher_gid.data), publisher.begin());
+    add(take_ns, rmw.source_timestamp, rmw.received_timestamp, publisher, rmw.publication_sequence_number);
+  }
+
+  // fills the message and starts a new period
+  void report(tutorial_interfaces::msg::TopicStats & msg, double period)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    msg.topic = topic_;
+    msg.qos_profile = profile_;
+    msg.rate = period > 0.0 ? period_count_ / period : 0.0;
+    msg.received = received_;
+    msg.gaps = gaps_;
+    msg.age_mean = age_count_ > 0 ? age_sum_ / age_count_ : 0.0;
+    msg.age_max = age_max_;
+    msg.queue_high_water = queue_high_water_;
+
+    period_count_ = 0;
+    age_sum_ = 0.0;
+    age_max_ = 0.0;
+    age_count_ = 0;
+  }
+
+private:
+
+  static const size_t max_takes = 256;
+
+  std::string topic_;
+  std::string profile_;
+  std::mutex mutex_;
+
+  uint64_t received_ {0};
+  uint64_t gaps_ {0};
+  uint32_t queue_high_water_ {0};
+  std::map<PublisherGid, uint64_t> last_seq_;   // per publisher gid
+  std::deque<std::pair<int64_t, uint32_t>> takes_;   // (take time, queue depth at the take) of the latest messages
+
+  uint64_t period_count_ {0};
+  double age_sum_ {0.0};
+  double age_max_ {0.0};
+  uint64_t age_count_ {0};
+};
+
+
+// publishes the statistics of the tracked subscriptions of a node on "topic_stats"
+class TopicStatsPublisher
+{
+public:
+
+  // period in [s], 0 = nothing is published (the counting is cheap and stays on)
+  TopicStatsPublisher(rclcpp::Node * node, double period = 1.0)
+  : node_(node), period_(period)
+  {
+    if (period_ <= 0.0) return;
+    pub_ = node_->create_publisher<tutorial_interfaces::msg::TopicStats>("topic_stats", 10);
+    timer_ = node_->create_wall_timer(std::chrono::duration<double>(period_), [this]() { publish(); });
+  }
+
+  std::shared_ptr<TopicStats> track(const std::string & topic, const std::string & profile)
+  {
+    stats_.push_back(std::make_shared<TopicStats>(topic, profile));
+    return stats_.back();
+  }
+
+  const std::vector<std::shared_ptr<TopicStats>> & tracked() const { return stats_; }
+
+private:
+
+  void publish()
+  {
+    for (auto & stats : stats_) {
+      msg_.stamp = node_->now();
+      msg_.node = node_->get_fully_qualified_name();
+      stats->report(msg_, period_);
+      pub_->publish(msg_);
+    }
+  }
+
+  rclcpp::Node * node_;
+  double period_;
+  std::vector<std::shared_ptr<TopicStats>> stats_;
+  tutorial_interfaces::msg::TopicStats msg_;
+  rclcpp::Publisher<tutorial_interfaces::msg::TopicStats>::SharedPtr pub_;
+  rclcpp::TimerBase::SharedPtr timer_;
+};
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__QOS_PROFILES_HPP_
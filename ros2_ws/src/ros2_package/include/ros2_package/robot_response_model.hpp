@@ -0,0 +1,161 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Online-identified response model of the robot joints
+//   (commanded desired_joint_vals -> measured joint states),
+//   used as a Smith-predictor stage in the controller
+//
+// - Model, per joint, with a pure delay of d ticks:
+//     y[k] = y[k-1] + b * (u[k-1-d] - y[k-1])
+//
+// - Main functionalities:
+//   1. Identifies {d, b} per joint with exponentially-forgotten least squares,
+//      one estimator per candidate delay, keeping the delay with the lowest
+//      prediction error
+//   2. Predicts the joint state at command time by replaying the commands
+//      still "in flight" (the last d ones) through the model, starting from
+//      the latest measurement
+//   3. Fixed-size state and O(max_delay) work per joint per tick
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__ROBOT_RESPONSE_MODEL_HPP_
+#define ROS2_PACKAGE__ROBOT_RESPONSE_MODEL_HPP_
+
+#include <cmath>
+#include <cstddef>
+
+
+namespace ros2_package
+{
+
+template<size_t N_JOINTS, size_t MAX_DELAY = 16>
+class RobotResponseModel
+{
+public:
+
+  // forgetting : exponential forgetting factor of the estimators, in (0, 1]
+  explicit RobotResponseModel(double forgetting = 0.999)
+  : forgetting_(forgetting)
+  {
+    reset();
+  }
+
+  void reset()
+  {
+    for (size_t j=0; j<N_JOINTS; j++) {
+      for (size_t d=0; d<MAX_DELAY; d++) {
+        s_ee_[j][d] = 0.0;
+        s_ey_[j][d] = 0.0;
+        cost_[j][d] = 0.0;
+      }
+      for (size_t k=0; k<MAX_DELAY + 1; k++) u_hist_[j][k] = 0.0;
+      y_prev_[j] = 0.0;
+      delay_[j] = 0;
+      gain_[j] = 1.0;
+    }
+    head_ = 0;
+    samples_ = 0;
+  }
+
+  // one tick: u[] is the command sent on this tick, y[] the latest measured joint state
+  void update(const double u[N_JOINTS], const double y[N_JOINTS])
+  {
+    if (samples_ > 0) {
+      for (size_t j=0; j<N_JOINTS; j++) identify(j, y[j]);
+    }
+
+    // push the new command into the ring (index 0 = most recent)
+    head_ = (head_ + MAX_DELAY) % (MAX_DELAY + 1);
+    for (size_t j=0; j<N_JOINTS; j++) {
+      u_hist_[j][head_] = u[j];
+      y_prev_[j] = y[j];
+    }
+    if (samples_ < MAX_DELAY + 1) samples_++;
+  }
+
+  // predicted joint state at command time, from the measured state y[]
+  void predict(const double y[N_JOINTS], double y_pred[N_JOINTS]) const
+  {
+    for (size_t j=0; j<N_JOINTS; j++) {
+      double yp = y[j];
+      // the measurement already reflects u[k-1-d] and older, replay the d newer ones (oldest first)
+      const size_t d = delay_[j] < samples_ ? delay_[j] : 0;
+      for (size_t i=d; i>0; i--) yp += gain_[j] * (command(j, i - 1) - yp);
+      y_pred[j] = yp;
+    }
+  }
+
+  // identified parameters
+  size_t delay(size_t j) const { return delay_[j]; }       // [ticks]
+  double gain(size_t j) const { return gain_[j]; }          // per-tick first-order gain b
+  bool ready() const { return samples_ > MAX_DELAY; }
+
+  // equivalent first-order time constant [s] for a given tick period
+  double time_constant(size_t j, double dt) const
+  {
+    const double b = gain_[j];
+    if (b <= 0.0 || b >= 1.0) return 0.0;
+    return -dt / std::log(1.0 - b);
+  }
+
+private:
+
+  // command sent i ticks before the most recent one
+  double command(size_t j, size_t i) const
+  {
+    return u_hist_[j][(head_ + i) % (MAX_DELAY + 1)];
+  }
+
+  void identify(size_t j, double y)
+  {
+    const double dy = y - y_prev_[j];
+    size_t best = delay_[j];
+    double best_cost = -1.0;
+
+    for (size_t d=0; d<MAX_DELAY && d < samples_; d++) {
+      // regressor u[k-1-d] - y[k-1]; the ring has not been pushed yet, so u[k-1] is index 0
+      const double e = command(j, d) - y_prev_[j];
+
+      const double b = s_ee_[j][d] > 1e-12 ? s_ey_[j][d] / s_ee_[j][d] : 1.0;
+      const double r = dy - b * e;
+      cost_[j][d] = forgetting_ * cost_[j][d] + r * r;
+
+      s_ee_[j][d] = forgetting_ * s_ee_[j][d] + e * e;
+      s_ey_[j][d] = forgetting_ * s_ey_[j][d] + e * dy;
+
+      if (best_cost < 0.0 || cost_[j][d] < best_cost) {
+        best_cost = cost_[j][d];
+        best = d;
+      }
+    }
+
+    delay_[j] = best;
+    if (s_ee_[j][best] > 1e-12) {
+      double b = s_ey_[j][best] / s_ee_[j][best];
+      if (b < 0.0) b = 0.0;
+      if (b > 1.0) b = 1.0;
+      gain_[j] = b;
+    }
+  }
+
+  double forgetting_;
+
+  double s_ee_[N_JOINTS][MAX_DELAY];
+  double s_ey_[N_JOINTS][MAX_DELAY];
+  double cost_[N_JOINTS][MAX_DELAY];
+
+  double u_hist_[N_JOINTS][MAX_DELAY + 1];
+  double y_prev_[N_JOINTS];
+  size_t head_ = 0;
+  size_t samples_ = 0;
+
+  size_t delay_[N_JOINTS];
+  double gain_[N_JOINTS];
+};
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__ROBOT_RESPONSE_MODEL_HPP_
@@ -0,0 +1,53 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Summary statistics of a batch of timing samples (latencies, jitter,
+//   solve times), shared by the session self-test and the executor benchmark
+//
+// - Main functionalities:
+//   1. Count, mean, median, 99th percentile and maximum, in the unit
+//      of the samples
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__SAMPLE_STATS_HPP_
+#define ROS2_PACKAGE__SAMPLE_STATS_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+
+namespace ros2_package
+{
+
+struct SampleStats
+{
+  size_t n = 0;
+  double mean = 0.0;
+  double p50 = 0.0;
+  double p99 = 0.0;
+  double max = 0.0;
+
+  // takes the samples by value, they are sorted in place
+  static SampleStats of(std::vector<double> samples)
+  {
+    SampleStats s;
+    s.n = samples.size();
+    if (samples.empty()) return s;
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double x : samples) sum += x;
+    s.mean = sum / s.n;
+    s.p50 = samples.at((size_t) (0.50 * (s.n - 1)));
+    s.p99 = samples.at((size_t) (0.99 * (s.n - 1)));
+    s.max = samples.back();
+    return s;
+  }
+};
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__SAMPLE_STATS_HPP_
@@ -0,0 +1,143 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Fixed-size Kalman filter for estimating the Falcon
+//   joystick state {position, velocity, acceleration}
+//   from the raw position readings
+//
+// - Main functionalities:
+//   1. Constant-acceleration (white-noise jerk) model per axis
+//   2. Predict + update in one call, run at the haptic servo rate
+//   3. No dynamic allocation, so it is safe inside the haptic loop
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__STATE_ESTIMATOR_HPP_
+#define ROS2_PACKAGE__STATE_ESTIMATOR_HPP_
+
+#include <cstddef>
+
+
+namespace ros2_package
+{
+
+/////////////// SINGLE AXIS FILTER //////////////
+
+class AxisKalmanFilter
+{
+public:
+
+  // meas_std : standard deviation of the position reading [m]
+  // jerk_psd : power spectral density of the (white) jerk driving the model [m^2/s^5]
+  AxisKalmanFilter(double meas_std = 6e-5, double jerk_psd = 10.0)
+  {
+    configure(meas_std, jerk_psd);
+  }
+
+  void configure(double meas_std, double jerk_psd)
+  {
+    r_ = meas_std * meas_std;
+    q_ = jerk_psd;
+  }
+
+  // start from a known position at rest, with a wide covariance on the derivatives
+  void reset(double pos)
+  {
+    x_[0] = pos; x_[1] = 0.0; x_[2] = 0.0;
+    for (int i=0; i<3; i++) for (int j=0; j<3; j++) P_[i][j] = 0.0;
+    P_[0][0] = r_;
+    P_[1][1] = 1.0;
+    P_[2][2] = 100.0;
+    initialized_ = true;
+  }
+
+  // one predict + update step, dt is the time since the last call in [seconds]
+  void step(double z, double dt)
+  {
+    if (!initialized_) { reset(z); return; }
+
+    ///////// predict: x = F x, P = F P F' + Q /////////
+    const double dt2 = dt * dt;
+    const double dt3 = dt2 * dt;
+    const double F[3][3] = {{1.0, dt, 0.5 * dt2}, {0.0, 1.0, dt}, {0.0, 0.0, 1.0}};
+
+    double xp[3];
+    for (int i=0; i<3; i++) xp[i] = F[i][0] * x_[0] + F[i][1] * x_[1] + F[i][2] * x_[2];
+
+    double FP[3][3];
+    for (int i=0; i<3; i++)
+      for (int j=0; j<3; j++)
+        FP[i][j] = F[i][0] * P_[0][j] + F[i][1] * P_[1][j] + F[i][2] * P_[2][j];
+
+    const double Q[3][3] = {
+      {q_ * dt3 * dt2 / 20.0, q_ * dt2 * dt2 / 8.0, q_ * dt3 / 6.0},
+      {q_ * dt2 * dt2 / 8.0,  q_ * dt3 / 3.0,       q_ * dt2 / 2.0},
+      {q_ * dt3 / 6.0,        q_ * dt2 / 2.0,       q_ * dt}
+    };
+
+    double Pp[3][3];
+    for (int i=0; i<3; i++)
+      for (int j=0; j<3; j++)
+        Pp[i][j] = FP[i][0] * F[j][0] + FP[i][1] * F[j][1] + FP[i][2] * F[j][2] + Q[i][j];
+
+    ///////// update with the scalar position measurement (H = [1 0 0]) /////////
+    const double s = Pp[0][0] + r_;
+    const double K[3] = {Pp[0][0] / s, Pp[1][0] / s, Pp[2][0] / s};
+    const double innovation = z - xp[0];
+
+    for (int i=0; i<3; i++) x_[i] = xp[i] + K[i] * innovation;
+    for (int i=0; i<3; i++)
+      for (int j=0; j<3; j++)
+        P_[i][j] = Pp[i][j] - K[i] * Pp[0][j];
+  }
+
+  double position() const { return x_[0]; }
+  double velocity() const { return x_[1]; }
+  double acceleration() const { return x_[2]; }
+
+private:
+
+  double x_[3] {0.0, 0.0, 0.0};
+  double P_[3][3] {};
+  double r_ {0.0};
+  double q_ {0.0};
+  bool initialized_ = false;
+};
+
+
+/////////////// 3D STATE ESTIMATOR //////////////
+
+class StateEstimator
+{
+public:
+
+  StateEstimator(double meas_std = 6e-5, double jerk_psd = 10.0)
+  {
+    configure(meas_std, jerk_psd);
+  }
+
+  void configure(double meas_std, double jerk_psd)
+  {
+    for (size_t i=0; i<3; i++) axes_[i].configure(meas_std, jerk_psd);
+  }
+
+  // raw position p[3] in [meters], dt in [seconds]
+  void step(const double p[3], double dt)
+  {
+    for (size_t i=0; i<3; i++) axes_[i].step(p[i], dt);
+  }
+
+  void get_position(double p[3]) const { for (size_t i=0; i<3; i++) p[i] = axes_[i].position(); }
+  void get_velocity(double v[3]) const { for (size_t i=0; i<3; i++) v[i] = axes_[i].velocity(); }
+  void get_acceleration(double a[3]) const { for (size_t i=0; i<3; i++) a[i] = axes_[i].acceleration(); }
+
+private:
+
+  AxisKalmanFilter axes_[3];
+};
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__STATE_ESTIMATOR_HPP_
@@ -0,0 +1,161 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - CPU placement of the threads of a node: affinity mask, scheduling
+//   policy and priority, from the per-machine config/placement/<machine>.yaml
+//   (the launch files turn it into the "placement_*" parameters of the node)
+//
+// - Main functionalities:
+//   1. ThreadPlacement: role, cores, policy ("other" | "batch" | "idle" |
+//      "fifo" | "rr") and priority (1-99 for fifo / rr, the nice value otherwise)
+//   2. apply_placement(tid, placement) places one thread (0 = the calling one)
+//   3. place_process(placement) places every thread the process already has
+//      (middleware and device SDK threads included), threads created later
+//      inherit the affinity and the policy of their creator
+//   4. declare_placement(node) reads the "placement_*" parameters
+//
+// - The isolation of the roles is verified by scripts/placement_check.py
+//
+// - Note: fifo / rr need CAP_SYS_NICE or an rtprio limit (/etc/security/limits.conf),
+//   a failure is reported and the node keeps running unplaced
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__THREAD_PLACEMENT_HPP_
+#define ROS2_PACKAGE__THREAD_PLACEMENT_HPP_
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+
+#include "rclcpp/rclcpp.hpp"
+
+
+namespace ros2_package
+{
+
+struct ThreadPlacement
+{
+  std::string role {""};
+  std::vector<int> cpus;           // empty = the affinity is left alone
+  std::string policy {"other"};
+  int priority {0};
+
+  bool empty() const { return cpus.empty() && policy == "other" && priority == 0; }
+
+  std::string describe() const
+  {
+    if (empty()) return "none";
+    std::ostringstream out;
+    out << (role.empty() ? "" : role + ": ") << "cpus ";
+    if (cpus.empty()) out << "any";
+    for (size_t i=0; i<cpus.size(); i++) out << (i ? "," : "") << cpus.at(i);
+    out << ", " << policy << " " << priority;
+    return out.str();
+  }
+};
+
+inline bool sched_policy_from_name(const std::string & name, int & policy)
+{
+  if (name == "other") policy = SCHED_OTHER;
+  else if (name == "batch") policy = SCHED_BATCH;
+  else if (name == "idle") policy = SCHED_IDLE;
+  else if (name == "fifo") policy = SCHED_FIFO;
+  else if (name == "rr") policy = SCHED_RR;
+  else return false;
+  return true;
+}
+
+// places one thread (tid 0 = the calling thread), error is set when false
+inline bool apply_placement(pid_t tid, const ThreadPlacement & placement, std::string & error)
+{
+  if (!placement.cpus.empty()) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : placement.cpus) {
+      if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        error = "invalid cpu " + std::to_string(cpu);
+        return false;
+      }
+      CPU_SET(cpu, &set);
+    }
+    if (sched_setaffinity(tid, sizeof(set), &set) != 0) {
+      error = std::string("sched_setaffinity: ") + std::strerror(errno);
+      return false;
+    }
+  }
+
+  int policy = SCHED_OTHER;
+  if (!sched_policy_from_name(placement.policy, policy)) {
+    error = "unknown scheduling policy '" + placement.policy + "'";
+    return false;
+  }
+  const bool realtime = policy == SCHED_FIFO || policy == SCHED_RR;
+  sched_param param {};
+  param.sched_priority = realtime ? placement.priority : 0;
+  if (sched_setscheduler(tid, policy, &param) != 0) {
+    error = std::string("sched_setscheduler(") + placement.policy + "): " + std::strerror(errno);
+    return false;
+  }
+
+  // the priority of the non real-time policies is the nice value (per thread on Linux)
+  if (!realtime && placement.priority != 0 && setpriority(PRIO_PROCESS, (id_t) tid, placement.priority) != 0) {
+    error = std::string("setpriority: ") + std::strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+// places every thread of the process, returns the number of threads that could not be placed
+inline int place_process(const ThreadPlacement & placement)
+{
+  if (placement.empty()) return 0;
+
+  int failed = 0;
+  std::string error;
+  if (DIR * dir = opendir("/proc/self/task")) {
+    while (dirent * entry = readdir(dir)) {
+      if (entry->d_name[0] == '.') continue;
+      if (!apply_placement((pid_t) std::atoi(entry->d_name), placement, error)) failed++;
+    }
+    closedir(dir);
+  } else if (!apply_placement(0, placement, error)) {
+    failed++;
+  }
+
+  if (failed) std::cout << "Could not place " << failed << " thread(s) (" << placement.describe() << "): " << error << std::endl;
+  return failed;
+}
+
+// "placement_role", "placement_cpus", "placement_policy" and "placement_priority" parameters of the node
+inline ThreadPlacement declare_placement(rclcpp::Node * node, const std::string & default_role = "")
+{
+  std::vector<std::string> param_names = {"placement_role", "placement_cpus", "placement_policy", "placement_priority"};
+  node->declare_parameter(param_names.at(0), default_role);
+  node->declare_parameter(param_names.at(1), std::vector<int64_t>{});
+  node->declare_parameter(param_names.at(2), "other");
+  node->declare_parameter(param_names.at(3), 0);
+
+  std::vector<rclcpp::Parameter> params = node->get_parameters(param_names);
+  ThreadPlacement placement;
+  placement.role = params.at(0).as_string();
+  for (int64_t cpu : params.at(1).as_integer_array()) placement.cpus.push_back((int) cpu);
+  placement.policy = params.at(2).as_string();
+  placement.priority = std::stoi(params.at(3).value_to_string().c_str());
+  return placement;
+}
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__THREAD_PLACEMENT_HPP_
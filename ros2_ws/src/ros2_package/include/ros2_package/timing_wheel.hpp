@@ -0,0 +1,202 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Hierarchical timing wheel over a preallocated ring of entries, for
+//   delays from one tick (10 us by default) up to hours, shared by the
+//   fault injector and the delay line
+//
+// - Main functionalities:
+//   1. Four levels of 256 slots, an item sits in the coarsest level that
+//      still separates it from the current tick and cascades down to the
+//      finer levels as time approaches, so insertion and expiry are O(1)
+//   2. Entries live in a fixed pool allocated up front, slots are intrusive
+//      lists of pool indices, so nothing is allocated while running
+//   3. Advancing to the current time releases every due item in release
+//      time order (ties in insertion order)
+//   4. next_due_ns() tells the releasing thread how long it can sleep
+//
+// - Not thread-safe, the owner serializes schedule() and advance()
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__TIMING_WHEEL_HPP_
+#define ROS2_PACKAGE__TIMING_WHEEL_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+namespace ros2_package
+{
+
+template<typename T>
+class TimingWheel
+{
+public:
+
+  static const int n_levels = 4;
+  static const int slot_bits = 8;
+  static const int64_t n_slots = 1 << slot_bits;
+
+  // tick in [ns], capacity = most items in flight at once
+  explicit TimingWheel(int64_t tick_ns = 10000, size_t capacity = 65536)
+  : tick_ns_(tick_ns), pool_(capacity), heads_(n_levels * n_slots, -1)
+  {
+    for (size_t i=0; i<capacity; i++) pool_[i].next = (i + 1 < capacity) ? (int32_t) (i + 1) : -1;
+    free_ = capacity > 0 ? 0 : -1;
+    pending_.reserve(capacity);
+  }
+
+  // the first advance() releases nothing older than this time
+  void start(int64_t now_ns)
+  {
+    current_tick_ = now_ns / tick_ns_;
+    started_ = true;
+  }
+
+  // release item at time t_ns, false if the ring is full (items already due go out with the next advance)
+  bool schedule(int64_t t_ns, T item)
+  {
+    if (free_ < 0) return false;
+    const int32_t i = free_;
+    free_ = pool_[i].next;
+
+    int64_t tick = (t_ns + tick_ns_ - 1) / tick_ns_;
+    if (tick <= current_tick_) tick = current_tick_ + 1;
+    tick = std::min(tick, current_tick_ + max_ticks());   // beyond the top level, wait at its horizon
+
+    pool_[i].t_ns = t_ns;
+    pool_[i].seq = next_seq_++;
+    pool_[i].tick = tick;
+    pool_[i].item = std::move(item);
+    place(i);
+    size_++;
+    return true;
+  }
+
+  // releases every item due up to now_ns through release(t_ns, item), returns how many
+  template<typename F>
+  size_t advance(int64_t now_ns, F && release)
+  {
+    if (!started_) start(now_ns);
+    const int64_t now_tick = now_ns / tick_ns_;
+
+    while (current_tick_ < now_tick) {
+      // nothing in flight, jump straight to now
+      if (size_ == pending_.size()) {
+        current_tick_ = now_tick;
+        break;
+      }
+      current_tick_++;
+
+      // at a level boundary, cascade the coarser slots first
+      for (int level=n_levels-1; level>0; level--) {
+        const int64_t mask = ((int64_t) 1 << (slot_bits * level)) - 1;
+        if ((current_tick_ & mask) == 0) cascade(level, (current_tick_ >> (slot_bits * level)) & (n_slots - 1));
+      }
+
+      int32_t & head = heads_[current_tick_ & (n_slots - 1)];
+      for (int32_t i=head; i>=0; i=pool_[i].next) pending_.push_back(i);
+      head = -1;
+    }
+
+    std::sort(pending_.begin(), pending_.end(), [this](int32_t a, int32_t b) {
+      return pool_[a].t_ns != pool_[b].t_ns ? pool_[a].t_ns < pool_[b].t_ns : pool_[a].seq < pool_[b].seq;
+    });
+    const size_t released = pending_.size();
+    for (int32_t i : pending_) {
+      release(pool_[i].t_ns, pool_[i].item);
+      pool_[i].item = T();
+      pool_[i].next = free_;
+      free_ = i;
+    }
+    size_ -= released;
+    pending_.clear();
+    return released;
+  }
+
+  // earliest time an advance() can release something, -1 if nothing is in flight (a lower bound for the
+  // items in the coarser levels, which are only sorted into their exact tick once they cascade down)
+  int64_t next_due_ns() const
+  {
+    if (size_ == 0) return -1;
+
+    // level 0 holds the rest of the current 256-tick span
+    const int64_t base0 = current_tick_ & ~(n_slots - 1);
+    for (int64_t s=(current_tick_ & (n_slots - 1)) + 1; s<n_slots; s++) {
+      if (heads_[s] >= 0) return (base0 + s) * tick_ns_;
+    }
+
+    // the coarser levels, from the slot after the current one (the top level wraps around)
+    for (int level=1; level<n_levels; level++) {
+      const int shift = slot_bits * level;
+      const int64_t current = (current_tick_ >> shift) & (n_slots - 1);
+      const int64_t span = (current_tick_ >> shift) - current;   // first slot of the current turn of this level
+      const int64_t last = level == n_levels - 1 ? current + n_slots : n_slots - 1;
+      for (int64_t s=current+1; s<=last; s++) {
+        if (heads_[level * n_slots + (s & (n_slots - 1))] >= 0) return ((span + s) << shift) * tick_ns_;
+      }
+    }
+    return (current_tick_ + 1) * tick_ns_;
+  }
+
+  size_t size() const { return size_; }
+  size_t capacity() const { return pool_.size(); }
+  int64_t tick_ns() const { return tick_ns_; }
+  int64_t max_delay_ns() const { return max_ticks() * tick_ns_; }
+
+private:
+
+  struct Entry
+  {
+    int64_t t_ns = 0;
+    uint64_t seq = 0;
+    int64_t tick = 0;
+    T item {};
+    int32_t next = -1;
+  };
+
+  static int64_t max_ticks() { return ((int64_t) 1 << (slot_bits * n_levels)) - 1; }
+
+  // finest level whose current slot span still contains the release tick
+  void place(int32_t i)
+  {
+    const int64_t tick = pool_[i].tick;
+    int level = 0;
+    while (level < n_levels - 1 && (tick >> (slot_bits * (level + 1))) != (current_tick_ >> (slot_bits * (level + 1)))) level++;
+
+    int32_t & head = heads_[level * n_slots + ((tick >> (slot_bits * level)) & (n_slots - 1))];
+    pool_[i].next = head;
+    head = i;
+  }
+
+  void cascade(int level, int64_t slot)
+  {
+    int32_t i = heads_[level * n_slots + slot];
+    heads_[level * n_slots + slot] = -1;
+    while (i >= 0) {
+      const int32_t next = pool_[i].next;
+      place(i);
+      i = next;
+    }
+  }
+
+  int64_t tick_ns_;
+  std::vector<Entry> pool_;
+  std::vector<int32_t> heads_;     // level * n_slots + slot -> first pool index, -1 = empty
+  std::vector<int32_t> pending_;
+  int32_t free_ = -1;
+  int64_t current_tick_ = 0;
+  bool started_ = false;
+  uint64_t next_seq_ = 0;
+  size_t size_ = 0;
+};
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__TIMING_WHEEL_HPP_
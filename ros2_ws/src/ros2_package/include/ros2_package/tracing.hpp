@@ -0,0 +1,220 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Static tracepoints of the control graph, compiled out unless the
+//   package is built with -DAUTONOMY_TRACING=ON
+//
+// - Main functionalities:
+//   1. Every tracepoint is a USDT probe (provider "autonomy") when
+//      <sys/sdt.h> is available, for perf / bpftrace / SystemTap
+//   2. It is also stored into a per-thread ring buffer in memory (32 bytes,
+//      no lock, no allocation after the first event of a thread), written to
+//      $AUTONOMY_TRACE_DIR/autonomy_trace_<pid>.bin (default /tmp) at exit
+//   3. The files of all processes are turned into per-tick critical paths
+//      and a Chrome trace by scripts/trace_analyzer.py
+//
+// - Usage:
+//   AUTONOMY_TRACE_CALLBACK("controller_publisher", count);   // start now, end with the scope
+//   AUTONOMY_TRACE(ik_start, "compute_ik", count);
+//
+//   the label must be a string literal (its address identifies it), the value
+//   is free (tick count, sequence number ...)
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__TRACING_HPP_
+#define ROS2_PACKAGE__TRACING_HPP_
+
+#include <cstdint>
+
+#ifdef AUTONOMY_TRACING
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define AUTONOMY_TRACE_USDT(event, label, value) DTRACE_PROBE2(autonomy, event, label, value)
+#else
+#define AUTONOMY_TRACE_USDT(event, label, value) do {} while (0)
+#endif
+
+
+namespace ros2_package
+{
+namespace tracing
+{
+
+// event ids, also the USDT probe names (keep in sync with scripts/trace_analyzer.py)
+enum Event : uint16_t
+{
+  callback_start = 0,
+  callback_end = 1,
+  ik_start = 2,
+  ik_end = 3,
+  publish = 4,
+  device_read = 5,
+  device_write_start = 6,
+  device_write_end = 7
+};
+
+struct Record
+{
+  int64_t t_ns;          // steady clock (CLOCK_MONOTONIC, the same in every process)
+  uint16_t event;
+  uint16_t reserved;
+  uint32_t reserved2;
+  uint64_t label;        // address of the label literal
+  int64_t value;
+};
+static_assert(sizeof(Record) == 32, "trace records are 32 bytes");
+
+struct Ring
+{
+  static const size_t n_records = 1 << 18;   // per thread, the oldest are overwritten
+
+  uint32_t tid = 0;
+  std::atomic<uint64_t> head {0};
+  std::vector<Record> records = std::vector<Record>(n_records);
+};
+
+// every ring of the process, written out once at exit
+class Registry
+{
+public:
+
+  static Registry & instance()
+  {
+    static Registry registry;
+    return registry;
+  }
+
+  Ring * add_ring()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Ring * ring = new Ring();   // never freed, a thread may still trace while the process exits
+    ring->tid = (uint32_t) syscall(SYS_gettid);
+    rings_.push_back(ring);
+    return ring;
+  }
+
+  ~Registry() { write(); }
+
+  // binary layout read by scripts/trace_analyzer.py
+  void write()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const char * dir = std::getenv("AUTONOMY_TRACE_DIR");
+    const std::string path = std::string(dir ? dir : "/tmp") + "/autonomy_trace_" + std::to_string(getpid()) + ".bin";
+    FILE * f = std::fopen(path.c_str(), "wb");
+    if (!f) return;
+
+    char comm[16] = {0};
+    if (FILE * c = std::fopen("/proc/self/comm", "r")) {
+      if (std::fgets(comm, sizeof(comm), c)) comm[std::strcspn(comm, "\n")] = 0;
+      std::fclose(c);
+    }
+    const uint32_t version = 1, n_rings = (uint32_t) rings_.size();
+    const int32_t pid = (int32_t) getpid();
+    std::fwrite("ATRC", 1, 4, f);
+    std::fwrite(&version, sizeof(version), 1, f);
+    std::fwrite(&pid, sizeof(pid), 1, f);
+    std::fwrite(comm, 1, sizeof(comm), f);
+    std::fwrite(&n_rings, sizeof(n_rings), 1, f);
+
+    std::map<uint64_t, std::string> labels;
+    for (const auto & ring : rings_) {
+      const uint64_t head = ring->head.load(std::memory_order_acquire);
+      const uint64_t n = head < Ring::n_records ? head : Ring::n_records;
+      const uint64_t dropped = head - n;
+      std::fwrite(&ring->tid, sizeof(ring->tid), 1, f);
+      std::fwrite(&n, sizeof(n), 1, f);
+      std::fwrite(&dropped, sizeof(dropped), 1, f);
+      for (uint64_t i=head-n; i<head; i++) {
+        const Record & r = ring->records[i % Ring::n_records];
+        std::fwrite(&r, sizeof(Record), 1, f);
+        if (!labels.count(r.label)) labels[r.label] = r.label ? reinterpret_cast<const char *>(r.label) : "";
+      }
+    }
+
+    const uint32_t n_labels = (uint32_t) labels.size();
+    std::fwrite(&n_labels, sizeof(n_labels), 1, f);
+    for (const auto & l : labels) {
+      const uint32_t len = (uint32_t) l.second.size();
+      std::fwrite(&l.first, sizeof(l.first), 1, f);
+      std::fwrite(&len, sizeof(len), 1, f);
+      std::fwrite(l.second.data(), 1, len, f);
+    }
+    std::fclose(f);
+  }
+
+private:
+
+  std::mutex mutex_;
+  std::vector<Ring *> rings_;
+};
+
+inline void record(Event event, const char * label, int64_t value)
+{
+  thread_local Ring * ring = Registry::instance().add_ring();
+  const uint64_t head = ring->head.load(std::memory_order_relaxed);
+  Record & r = ring->records[head % Ring::n_records];
+  r.t_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  r.event = event;
+  r.label = reinterpret_cast<uint64_t>(label);
+  r.value = value;
+  ring->head.store(head + 1, std::memory_order_release);
+}
+
+// callback_start now, callback_end when the scope is left
+class CallbackScope
+{
+public:
+  CallbackScope(const char * label, int64_t value)
+  : label_(label), value_(value)
+  {
+    AUTONOMY_TRACE_USDT(callback_start, label_, value_);
+    record(callback_start, label_, value_);
+  }
+  ~CallbackScope()
+  {
+    AUTONOMY_TRACE_USDT(callback_end, label_, value_);
+    record(callback_end, label_, value_);
+  }
+
+private:
+  const char * label_;
+  int64_t value_;
+};
+
+}  // namespace tracing
+}  // namespace ros2_package
+
+#define AUTONOMY_TRACE(event, label, value) \
+  do { \
+    AUTONOMY_TRACE_USDT(event, label, (int64_t) (value)); \
+    ::ros2_package::tracing::record(::ros2_package::tracing::event, label, (int64_t) (value)); \
+  } while (0)
+#define AUTONOMY_TRACE_CALLBACK(label, value) \
+  ::ros2_package::tracing::CallbackScope autonomy_trace_callback_scope_(label, (int64_t) (value))
+
+#else
+
+#define AUTONOMY_TRACE(event, label, value) do {} while (0)
+#define AUTONOMY_TRACE_CALLBACK(label, value) do {} while (0)
+
+#endif  // AUTONOMY_TRACING
+
+#endif  // ROS2_PACKAGE__TRACING_HPP_
@@ -0,0 +1,73 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Shared definition of the sum-of-sines reference trajectory
+//   (C++ counterpart of ros2_package/traj_utils.py)
+//
+// - Main functionalities:
+//   1. Maps a traj_id onto its sine curve parameters
+//   2. Evaluates the reference offset (from the task-space origin)
+//      at a trajectory parameter t in [0, 2pi]
+//
+// - Used by the controllers and the marker publisher, so that every
+//   node computes exactly the same reference from the same formula
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__TRAJ_UTILS_HPP_
+#define ROS2_PACKAGE__TRAJ_UTILS_HPP_
+
+#include <cmath>
+
+
+namespace ros2_package
+{
+
+struct SineTrajectory
+{
+  // sine curve parameters
+  int pa = 1;
+  int pb = 1;
+  int pc = 4;
+  double ps = M_PI;
+  double ph = 0.25;
+
+  // size of the trajectory [m]
+  double height = 0.1;
+  double width = 0.3;
+  double depth = 0.1;
+  int use_depth = 0;
+
+  static SineTrajectory from_id(int traj_id, int use_depth)
+  {
+    SineTrajectory traj;
+    switch (traj_id) {
+      case 0: traj.pa = 1; traj.pb = 1; traj.pc = 4; traj.ps = M_PI;     traj.ph = 0.25; break;
+      case 1: traj.pa = 2; traj.pb = 3; traj.pc = 4; traj.ps = 4*M_PI/3; traj.ph = 0.25; break;
+      case 2: traj.pa = 1; traj.pb = 3; traj.pc = 4; traj.ps = M_PI;     traj.ph = 0.25; break;
+      case 3: traj.pa = 2; traj.pb = 2; traj.pc = 5; traj.ps = M_PI;     traj.ph = 0.2; break;
+      case 4: traj.pa = 2; traj.pb = 3; traj.pc = 5; traj.ps = 8*M_PI/5; traj.ph = 0.2; break;
+      case 5: traj.pa = 2; traj.pb = 4; traj.pc = 5; traj.ps = M_PI;     traj.ph = 0.2; break;
+    }
+    traj.use_depth = use_depth;
+    return traj;
+  }
+
+  // reference offset from the origin at parameter t, clamped to [0, 2pi]
+  void offset(double t, double out[3]) const
+  {
+    if (t < 0.0) t = 0.0;
+    if (t > 2*M_PI) t = 2*M_PI;
+
+    out[0] = 0.0;
+    if (use_depth) out[0] = std::fabs(t-M_PI) / M_PI * depth - (depth/2);
+    out[1] = t / (2*M_PI) * width - (width/2);
+    out[2] = (ph*height) * (std::sin(pa*(t+ps)) + std::sin(pb*(t+ps)) + std::sin(pc*(t+ps)));
+  }
+};
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__TRAJ_UTILS_HPP_
@@ -0,0 +1,579 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Pluggable reference trajectories, selected by a spec string
+//   ("trajectory" parameter of the controller, the marker publisher and
+//   the recorder, announced on trial_event):
+//
+//     sines[:key=value,...]       sum of sines of traj_id (the default)
+//     spiral[:...]                helix of traj_utils.get_spiral_ref_points
+//     lissajous[:...]             a:b(:c) Lissajous figure
+//     spline:file=<csv>[,...]     uniform cubic B-spline through control points
+//
+// - Main functionalities:
+//   1. TrajectoryGenerator, the interface: reference offset from the
+//      task-space origin and its first and second derivatives w.r.t. the
+//      trajectory parameter t in [0, 2pi]
+//   2. Compile-time registry of the generators (trajectory_generators[]),
+//      a new generator is a class with a make() and one more entry
+//   3. TrajectoryTable, the generator sampled once at arm time into dense
+//      per-axis columns (positions, velocities, accelerations), queried in
+//      O(1) per tick by cubic Hermite interpolation between two samples
+//
+// - Lengths in [m], angles in [rad]; values may be written as multiples
+//   of pi ("s=1.5pi", "angle=-0.5pi")
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__TRAJECTORY_GENERATORS_HPP_
+#define ROS2_PACKAGE__TRAJECTORY_GENERATORS_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ros2_package/traj_utils.hpp"
+
+
+namespace ros2_package
+{
+
+//////////////////// INTERFACE ////////////////////
+
+class TrajectoryGenerator
+{
+public:
+
+  virtual ~TrajectoryGenerator() = default;
+
+  // offset from the origin and its derivatives d/dt, d2/dt2 at t in [0, 2pi]
+  virtual void evaluate(double t, double pos[3], double vel[3], double acc[3]) const = 0;
+
+  virtual std::string describe() const = 0;
+};
+
+
+//////////////////// SPEC ////////////////////
+
+// "name:key=value,key=value", keys a generator does not read are reported as errors
+class TrajectorySpec
+{
+public:
+
+  std::string name;
+
+  bool parse(const std::string & text, std::string & error)
+  {
+    const size_t colon = text.find(':');
+    name = trim(text.substr(0, colon));
+    if (name.empty()) name = "sines";
+    values.clear();
+    if (colon == std::string::npos) return true;
+
+    std::stringstream ss(text.substr(colon + 1));
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+      if (trim(item).empty()) continue;
+      const size_t eq = item.find('=');
+      if (eq == std::string::npos) {
+        error = "expected key=value, got \"" + item + "\"";
+        return false;
+      }
+      values.push_back(Value{trim(item.substr(0, eq)), trim(item.substr(eq + 1)), false});
+    }
+    return true;
+  }
+
+  double number(const std::string & key, double fallback, std::string & error) const
+  {
+    const Value * v = find(key);
+    if (v == nullptr) return fallback;
+    std::string s = v->text;
+    double scale = 1.0;
+    if (s.size() >= 2 && s.compare(s.size() - 2, 2, "pi") == 0) {
+      scale = M_PI;
+      s = s.substr(0, s.size() - 2);
+      if (s.empty()) s = "1";
+    }
+    try {
+      size_t used = 0;
+      const double x = std::stod(s, &used);
+      if (used == s.size()) return x * scale;
+    } catch (const std::exception &) {}
+    error = key + " = \"" + v->text + "\" is not a number";
+    return fallback;
+  }
+
+  std::string text(const std::string & key, const std::string & fallback) const
+  {
+    const Value * v = find(key);
+    return v == nullptr ? fallback : v->text;
+  }
+
+  // first key no generator asked for, empty if none
+  std::string unused_key() const
+  {
+    for (const Value & v : values) {
+      if (!v.used) return v.key;
+    }
+    return "";
+  }
+
+private:
+
+  struct Value
+  {
+    std::string key;
+    std::string text;
+    mutable bool used;
+  };
+
+  const Value * find(const std::string & key) const
+  {
+    for (const Value & v : values) {
+      if (v.key == key) {
+        v.used = true;
+        return &v;
+      }
+    }
+    return nullptr;
+  }
+
+  static std::string trim(const std::string & s)
+  {
+    const size_t b = s.find_first_not_of(" \t");
+    if (b == std::string::npos) return "";
+    return s.substr(b, s.find_last_not_of(" \t") - b + 1);
+  }
+
+  std::vector<Value> values;
+};
+
+
+//////////////////// GENERATORS ////////////////////
+
+// the six sum-of-sines references of traj_id, keys a, b, c, s, h, height, width, depth override them
+class SumOfSinesGenerator : public TrajectoryGenerator
+{
+public:
+
+  SineTrajectory traj;
+
+  static std::unique_ptr<TrajectoryGenerator> make(const TrajectorySpec & spec, int traj_id, std::string & error)
+  {
+    auto g = std::make_unique<SumOfSinesGenerator>();
+    g->traj = SineTrajectory::from_id(traj_id, 1);    // x is zeroed by the table without depth
+    g->traj_id = traj_id;
+    g->traj.pa = (int) spec.number("a", g->traj.pa, error);
+    g->traj.pb = (int) spec.number("b", g->traj.pb, error);
+    g->traj.pc = (int) spec.number("c", g->traj.pc, error);
+    g->traj.ps = spec.number("s", g->traj.ps, error);
+    g->traj.ph = spec.number("h", g->traj.ph, error);
+    g->traj.height = spec.number("height", g->traj.height, error);
+    g->traj.width = spec.number("width", g->traj.width, error);
+    g->traj.depth = spec.number("depth", g->traj.depth, error);
+    return g;
+  }
+
+  void evaluate(double t, double pos[3], double vel[3], double acc[3]) const override
+  {
+    traj.offset(t, pos);    // same formula as before the generators, bit for bit
+
+    const double amp = traj.ph * traj.height;
+    const int k[3] = {traj.pa, traj.pb, traj.pc};
+    vel[0] = (t < M_PI ? -1.0 : 1.0) * traj.depth / M_PI;
+    vel[1] = traj.width / (2*M_PI);
+    vel[2] = 0.0;
+    acc[0] = acc[1] = acc[2] = 0.0;
+    for (int i=0; i<3; i++) {
+      vel[2] += amp * k[i] * std::cos(k[i] * (t + traj.ps));
+      acc[2] -= amp * k[i] * k[i] * std::sin(k[i] * (t + traj.ps));
+    }
+  }
+
+  std::string describe() const override
+  {
+    std::ostringstream ss;
+    ss << "sines (traj_id " << traj_id << ": a = " << traj.pa << ", b = " << traj.pb << ", c = " << traj.pc
+       << ", s = " << traj.ps << ", h = " << traj.ph << ")";
+    return ss.str();
+  }
+
+private:
+
+  int traj_id {0};
+};
+
+
+// helix of radius r and length h around a rotated axis, like traj_utils.get_spiral_ref_points
+// (keys r, h, turns, axis = x/y/z, angle [rad]; the default runs left to right along y)
+class SpiralGenerator : public TrajectoryGenerator
+{
+public:
+
+  double r {0.05};
+  double h {0.3};
+  double turns {2.0};
+  std::string axis {"x"};
+  double angle {-M_PI_2};
+
+  static std::unique_ptr<TrajectoryGenerator> make(const TrajectorySpec & spec, int, std::string & error)
+  {
+    auto g = std::make_unique<SpiralGenerator>();
+    g->r = spec.number("r", g->r, error);
+    g->h = spec.number("h", g->h, error);
+    g->turns = spec.number("turns", g->turns, error);
+    g->axis = spec.text("axis", g->axis);
+    g->angle = spec.number("angle", g->angle, error);
+    if (g->axis != "x" && g->axis != "y" && g->axis != "z") error = "axis must be x, y or z";
+    g->set_rotation();
+    return g;
+  }
+
+  void evaluate(double t, double pos[3], double vel[3], double acc[3]) const override
+  {
+    const double k = turns;
+    const double p[3] = {r * std::sin(k * t), r * std::cos(k * t), h * (t / (2*M_PI) - 0.5)};
+    const double v[3] = {r * k * std::cos(k * t), -r * k * std::sin(k * t), h / (2*M_PI)};
+    const double a[3] = {-r * k * k * std::sin(k * t), -r * k * k * std::cos(k * t), 0.0};
+    rotate(p, pos);
+    rotate(v, vel);
+    rotate(a, acc);
+  }
+
+  std::string describe() const override
+  {
+    std::ostringstream ss;
+    ss << "spiral (r = " << r << ", h = " << h << ", turns = " << turns << ", rotated " << angle << " rad about " << axis << ")";
+    return ss.str();
+  }
+
+private:
+
+  double rot[9] {1, 0, 0, 0, 1, 0, 0, 0, 1};
+
+  void set_rotation()
+  {
+    const double c = std::cos(angle), s = std::sin(angle);
+    const double rx[9] = {1, 0, 0, 0, c, -s, 0, s, c};
+    const double ry[9] = {c, 0, s, 0, 1, 0, -s, 0, c};
+    const double rz[9] = {c, -s, 0, s, c, 0, 0, 0, 1};
+    const double * m = axis == "x" ? rx : (axis == "y" ? ry : rz);
+    std::copy(m, m + 9, rot);
+  }
+
+  void rotate(const double in[3], double out[3]) const
+  {
+    for (int i=0; i<3; i++) out[i] = rot[3*i] * in[0] + rot[3*i + 1] * in[1] + rot[3*i + 2] * in[2];
+  }
+};
+
+
+// y = width/2 sin(a t + delta), z = height/2 sin(b t), x = depth/2 sin(c t + phase_x)
+// (keys a, b, c, delta, phase_x, height, width, depth; the default is a figure eight)
+class LissajousGenerator : public TrajectoryGenerator
+{
+public:
+
+  double a {1.0};
+  double b {2.0};
+  double c {1.0};
+  double delta {0.0};
+  double phase_x {M_PI / 2};
+  double height {0.1};
+  double width {0.3};
+  double depth {0.1};
+
+  static std::unique_ptr<TrajectoryGenerator> make(const TrajectorySpec & spec, int, std::string & error)
+  {
+    auto g = std::make_unique<LissajousGenerator>();
+    g->a = spec.number("a", g->a, error);
+    g->b = spec.number("b", g->b, error);
+    g->c = spec.number("c", g->c, error);
+    g->delta = spec.number("delta", g->delta, error);
+    g->phase_x = spec.number("phase_x", g->phase_x, error);
+    g->height = spec.number("height", g->height, error);
+    g->width = spec.number("width", g->width, error);
+    g->depth = spec.number("depth", g->depth, error);
+    return g;
+  }
+
+  void evaluate(double t, double pos[3], double vel[3], double acc[3]) const override
+  {
+    const double amp[3] = {depth / 2, width / 2, height / 2};
+    const double k[3] = {c, a, b};
+    const double ph[3] = {phase_x, delta, 0.0};
+    for (int i=0; i<3; i++) {
+      pos[i] = amp[i] * std::sin(k[i] * t + ph[i]);
+      vel[i] = amp[i] * k[i] * std::cos(k[i] * t + ph[i]);
+      acc[i] = -amp[i] * k[i] * k[i] * std::sin(k[i] * t + ph[i]);
+    }
+  }
+
+  std::string describe() const override
+  {
+    std::ostringstream ss;
+    ss << "lissajous (a = " << a << ", b = " << b << ", c = " << c << ", delta = " << delta << ")";
+    return ss.str();
+  }
+};
+
+
+// uniform cubic B-spline over the control points of a csv file (x, y, z offsets from the origin in [m] per line,
+// '#' comments and a header line allowed); keys file, closed (0/1), scale. An open spline starts and ends
+// near, not at, its first and last points: repeat them three times to pin the ends
+class BSplineGenerator : public TrajectoryGenerator
+{
+public:
+
+  std::string file;
+  bool closed {false};
+  std::vector<double> points;   // {x0, y0, z0, x1, ...}
+
+  static std::unique_ptr<TrajectoryGenerator> make(const TrajectorySpec & spec, int, std::string & error)
+  {
+    auto g = std::make_unique<BSplineGenerator>();
+    g->file = spec.text("file", "");
+    g->closed = spec.number("closed", 0.0, error) != 0.0;
+    const double scale = spec.number("scale", 1.0, error);
+    if (g->file.empty()) {
+      error = "spline needs file=<csv of control points>";
+      return g;
+    }
+    if (!g->load(scale, error)) return g;
+
+    const size_t n = g->points.size() / 3;
+    if (n < (g->closed ? 3u : 4u)) error = g->file + ": " + std::to_string(n) + " control points, a cubic spline needs " +
+                                           (g->closed ? "3 (closed)" : "4");
+    return g;
+  }
+
+  size_t segments() const
+  {
+    const size_t n = points.size() / 3;
+    return closed ? n : n - 3;
+  }
+
+  void evaluate(double t, double pos[3], double vel[3], double acc[3]) const override
+  {
+    const size_t n = points.size() / 3;
+    const size_t m = segments();
+    const double du = m / (2*M_PI);     // segments per unit of t
+
+    double u = std::clamp(t, 0.0, 2*M_PI) * du;
+    size_t i = std::min((size_t) u, m - 1);
+    const double f = u - i, g = 1.0 - f;
+
+    // basis functions and their derivatives w.r.t. the segment parameter
+    const double b[4] = {g*g*g / 6, (3*f*f*f - 6*f*f + 4) / 6, (-3*f*f*f + 3*f*f + 3*f + 1) / 6, f*f*f / 6};
+    const double db[4] = {-g*g / 2, (3*f*f - 4*f) / 2, (-3*f*f + 2*f + 1) / 2, f*f / 2};
+    const double ddb[4] = {g, 3*f - 2, -3*f + 1, f};
+
+    for (int k=0; k<3; k++) pos[k] = vel[k] = acc[k] = 0.0;
+    for (int j=0; j<4; j++) {
+      const double * p = &points[3 * ((i + j) % n)];
+      for (int k=0; k<3; k++) {
+        pos[k] += b[j] * p[k];
+        vel[k] += db[j] * du * p[k];
+        acc[k] += ddb[j] * du * du * p[k];
+      }
+    }
+  }
+
+  std::string describe() const override
+  {
+    return "spline (" + std::to_string(points.size() / 3) + " control points from " + file + (closed ? ", closed)" : ")");
+  }
+
+private:
+
+  bool load(double scale, std::string & error)
+  {
+    std::ifstream in(file);
+    if (!in) {
+      error = "cannot open " + file;
+      return false;
+    }
+    std::string line;
+    int line_number = 0;
+    bool header_allowed = true;
+    while (std::getline(in, line)) {
+      line_number++;
+      line = line.substr(0, line.find('#'));
+      if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+      std::replace(line.begin(), line.end(), ',', ' ');
+      std::istringstream ss(line);
+      double p[3];
+      if (!(ss >> p[0] >> p[1] >> p[2])) {
+        if (std::exchange(header_allowed, false)) continue;
+        error = file + ":" + std::to_string(line_number) + ": expected x, y, z";
+        return false;
+      }
+      header_allowed = false;
+      for (int k=0; k<3; k++) points.push_back(scale * p[k]);
+    }
+    return true;
+  }
+};
+
+
+//////////////////// REGISTRY ////////////////////
+
+struct TrajectoryGeneratorEntry
+{
+  const char * name;
+  std::unique_ptr<TrajectoryGenerator> (*make)(const TrajectorySpec & spec, int traj_id, std::string & error);
+};
+
+inline constexpr TrajectoryGeneratorEntry trajectory_generators[] = {
+  {"sines", &SumOfSinesGenerator::make},
+  {"spiral", &SpiralGenerator::make},
+  {"lissajous", &LissajousGenerator::make},
+  {"spline", &BSplineGenerator::make},
+};
+
+// generator of a spec string (traj_id is used by "sines"), nullptr and error set if invalid
+inline std::unique_ptr<TrajectoryGenerator> make_trajectory(const std::string & text, int traj_id, std::string & error)
+{
+  TrajectorySpec spec;
+  if (!spec.parse(text, error)) return nullptr;
+
+  for (const TrajectoryGeneratorEntry & entry : trajectory_generators) {
+    if (spec.name != entry.name) continue;
+    std::unique_ptr<TrajectoryGenerator> generator = entry.make(spec, traj_id, error);
+    if (error.empty() && !spec.unused_key().empty()) error = "unknown key \"" + spec.unused_key() + "\" for " + spec.name;
+    if (!error.empty()) return nullptr;
+    return generator;
+  }
+
+  error = "unknown trajectory generator \"" + spec.name + "\", one of:";
+  for (const TrajectoryGeneratorEntry & entry : trajectory_generators) error += std::string(" ") + entry.name;
+  return nullptr;
+}
+
+
+//////////////////// SAMPLE TABLE ////////////////////
+
+// one sample per control tick of the 10 s recording at 500 Hz
+constexpr size_t default_table_samples = 5001;
+
+class TrajectoryTable
+{
+public:
+
+  // samples the generator at n points over [0, 2pi], both ends included (x is zeroed without depth)
+  void arm(const TrajectoryGenerator & generator, size_t n_samples, int use_depth)
+  {
+    n_ = std::max<size_t>(n_samples, 2);
+    step_ = 2*M_PI / (n_ - 1);
+    for (int k=0; k<3; k++) {
+      pos_[k].assign(n_, 0.0);
+      vel_[k].assign(n_, 0.0);
+      acc_[k].assign(n_, 0.0);
+    }
+    for (size_t i=0; i<n_; i++) {
+      const double t = (i == n_ - 1) ? 2*M_PI : i * step_;
+      double p[3], v[3], a[3];
+      generator.evaluate(t, p, v, a);
+      for (int k=(use_depth ? 0 : 1); k<3; k++) {
+        pos_[k][i] = p[k];
+        vel_[k][i] = v[k];
+        acc_[k][i] = a[k];
+      }
+    }
+    description_ = generator.describe();
+  }
+
+  // builds the generator of a spec string and arms with it, false (and the table untouched) if the spec is invalid
+  bool arm(const std::string & spec, int traj_id, int use_depth, size_t n_samples, std::string & error)
+  {
+    std::unique_ptr<TrajectoryGenerator> generator = make_trajectory(spec, traj_id, error);
+    if (!generator) return false;
+    arm(*generator, n_samples, use_depth);
+    return true;
+  }
+
+  bool armed() const { return n_ > 0; }
+  size_t size() const { return n_; }
+  const std::string & describe() const { return description_; }
+
+  // offset from the origin at t (clamped to [0, 2pi]), between the samples around t, zero until armed
+  void offset(double t, double out[3]) const
+  {
+    if (!armed()) {
+      for (int k=0; k<3; k++) out[k] = 0.0;
+      return;
+    }
+    size_t i;
+    double s;
+    locate(t, i, s);
+    const double h00 = (1 + 2*s) * (1 - s) * (1 - s), h10 = s * (1 - s) * (1 - s);
+    const double h01 = s * s * (3 - 2*s), h11 = s * s * (s - 1);
+    for (int k=0; k<3; k++) {
+      out[k] = h00 * pos_[k][i] + h10 * step_ * vel_[k][i] + h01 * pos_[k][i+1] + h11 * step_ * vel_[k][i+1];
+    }
+  }
+
+  // offset and its derivatives d/dt, d2/dt2 at t (scale by 2pi / duration for [m/s])
+  void sample(double t, double pos[3], double vel[3], double acc[3]) const
+  {
+    offset(t, pos);
+    if (!armed()) {
+      for (int k=0; k<3; k++) vel[k] = acc[k] = 0.0;
+      return;
+    }
+    size_t i;
+    double s;
+    locate(t, i, s);
+    const double d00 = 6 * s * (s - 1), d10 = (1 - s) * (1 - 3*s), d11 = s * (3*s - 2);
+    for (int k=0; k<3; k++) {
+      vel[k] = d00 * (pos_[k][i] - pos_[k][i+1]) / step_ + d10 * vel_[k][i] + d11 * vel_[k][i+1];
+      acc[k] = (1 - s) * acc_[k][i] + s * acc_[k][i+1];
+    }
+  }
+
+  // largest |d/dt| and |d2/dt2| over the samples
+  void peaks(double & vel, double & acc) const
+  {
+    vel = acc = 0.0;
+    for (size_t i=0; i<n_; i++) {
+      vel = std::max(vel, std::sqrt(vel_[0][i] * vel_[0][i] + vel_[1][i] * vel_[1][i] + vel_[2][i] * vel_[2][i]));
+      acc = std::max(acc, std::sqrt(acc_[0][i] * acc_[0][i] + acc_[1][i] * acc_[1][i] + acc_[2][i] * acc_[2][i]));
+    }
+  }
+
+  // the columns, one per axis
+  const std::vector<double> & positions(int axis) const { return pos_[axis]; }
+  const std::vector<double> & velocities(int axis) const { return vel_[axis]; }
+  const std::vector<double> & accelerations(int axis) const { return acc_[axis]; }
+
+private:
+
+  // sample i and fraction s in [0, 1] towards sample i + 1
+  void locate(double t, size_t & i, double & s) const
+  {
+    const double u = std::clamp(t, 0.0, 2*M_PI) / step_;
+    i = std::min((size_t) u, n_ - 2);
+    s = std::min(u - i, 1.0);
+  }
+
+  size_t n_ {0};
+  double step_ {1.0};
+  std::vector<double> pos_[3];
+  std::vector<double> vel_[3];
+  std::vector<double> acc_[3];
+  std::string description_;
+};
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__TRAJECTORY_GENERATORS_HPP_
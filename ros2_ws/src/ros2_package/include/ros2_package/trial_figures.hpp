@@ -0,0 +1,318 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - The standard figures of one trial, drawn on any Surface
+//   (include/ros2_package/plot_surface.hpp, PNG or SVG)
+//
+// - Main functionalities:
+//   1. "axes": x, y and z against time_from_start, one panel each
+//   2. "3d": the trajectory in an equal-scale cube, projected like the 3D
+//      axes of matplotlib (elevation 30, azimuth -60), as plot_with_scale()
+//      of ros2_package/traj_utils.py
+//   3. "error": distance of the tcp and of the human to the reference
+//      against time_from_start, with the RMSE of both
+//   4. the reference (black), human (blue), robot (orange) and tcp (green)
+//      series, the robot one is absent from the early logs (NaN)
+//   5. a compact variant without legend for the cells of a contact sheet
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__TRIAL_FIGURES_HPP_
+#define ROS2_PACKAGE__TRIAL_FIGURES_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ros2_package/plot_surface.hpp"
+#include "ros2_package/trial_log.hpp"
+
+
+namespace ros2_package
+{
+
+namespace trial_figures
+{
+
+enum Figure { axes, three_d, error };
+
+inline bool figure_from_name(const std::string & name, Figure & figure)
+{
+  if (name == "axes") figure = axes;
+  else if (name == "3d") figure = three_d;
+  else if (name == "error") figure = error;
+  else return false;
+  return true;
+}
+
+inline std::string figure_name(Figure figure) { return figure == axes ? "axes" : figure == three_d ? "3d" : "error"; }
+
+const Color black {0, 0, 0};
+const Color frame_color {90, 90, 90};
+const Color grid_color {228, 228, 228};
+
+// reference, human, robot, tcp (the matplotlib default cycle after black)
+const std::array<Color, 4> series_colors = {{{40, 40, 40}, {31, 119, 180}, {255, 127, 14}, {44, 160, 44}}};
+const std::array<const char *, 4> series_names = {{"reference", "human", "robot", "tcp"}};
+const std::array<trial_log::Column, 4> series_x = {{trial_log::ref_x, trial_log::human_x, trial_log::robot_x, trial_log::tcp_x}};
+
+struct Series
+{
+  const std::vector<double> * x;
+  std::vector<double> y;
+  Color color;
+};
+
+// 1, 2 or 5 times a power of ten, about n of them over [lo, hi]
+inline std::vector<double> nice_ticks(double lo, double hi, int n)
+{
+  std::vector<double> ticks;
+  if (!(hi > lo)) return ticks;
+  const double raw = (hi - lo) / std::max(n, 1);
+  const double magnitude = std::pow(10.0, std::floor(std::log10(raw)));
+  const double step = magnitude * (raw / magnitude < 1.5 ? 1 : raw / magnitude < 3.5 ? 2 : raw / magnitude < 7.5 ? 5 : 10);
+  for (double t = std::ceil(lo / step) * step; t <= hi + step * 1e-9; t += step) ticks.push_back(std::abs(t) < step * 1e-9 ? 0.0 : t);
+  return ticks;
+}
+
+inline std::string tick_label(double v, double step)
+{
+  const int decimals = std::max(0, (int) -std::floor(std::log10(step) + 1e-9));
+  char s[32];
+  std::snprintf(s, sizeof(s), "%.*f", decimals, v);
+  return s;
+}
+
+// finite range of several series, padded by margin (fraction of the range)
+inline void data_range(const std::vector<const std::vector<double> *> & columns, double margin, double & lo, double & hi)
+{
+  lo = INFINITY;
+  hi = -INFINITY;
+  for (const auto * c : columns) {
+    for (double v : *c) {
+      if (!std::isfinite(v)) continue;
+      lo = std::min(lo, v);
+      hi = std::max(hi, v);
+    }
+  }
+  if (!std::isfinite(lo)) {
+    lo = 0.0;
+    hi = 1.0;
+  }
+  const double pad = std::max(hi - lo, 1e-6) * margin;
+  lo -= pad;
+  hi += pad;
+}
+
+// font sizes (cap height) of a figure in a frame of this height
+inline double font_size(const Rect & frame) { return std::clamp(frame.h / 55.0, 6.0, 13.0); }
+
+
+///////////////////////////////////// 2D PANEL /////////////////////////////////////
+
+// fs: font size of the figure
+inline void draw_panel(Surface & s, const Rect & frame, const std::vector<Series> & series, double x_lo, double x_hi,
+                       const std::string & x_label, const std::string & y_label, double fs, bool compact)
+{
+  const Rect plot = frame.inset(compact ? fs * 5.5 : fs * 7.5, fs * 0.5, fs, x_label.empty() ? fs * 2.2 : fs * 4.2);
+
+  std::vector<const std::vector<double> *> ys;
+  for (const auto & se : series) ys.push_back(&se.y);
+  double y_lo, y_hi;
+  data_range(ys, 0.05, y_lo, y_hi);
+
+  auto px = [&](double x) { return plot.x + (x - x_lo) / (x_hi - x_lo) * plot.w; };
+  auto py = [&](double y) { return plot.bottom() - (y - y_lo) / (y_hi - y_lo) * plot.h; };
+
+  // grid and ticks
+  const std::vector<double> x_ticks = nice_ticks(x_lo, x_hi, compact ? 4 : 8);
+  const std::vector<double> y_ticks = nice_ticks(y_lo, y_hi, compact ? 3 : 5);
+  for (double t : x_ticks) {
+    s.line({px(t), plot.y}, {px(t), plot.bottom()}, grid_color, 1.0);
+    const double step = x_ticks.size() > 1 ? x_ticks[1] - x_ticks[0] : 1.0;
+    s.text(px(t), plot.bottom() + fs * 1.6, tick_label(t, step), fs, black, Align::center);
+  }
+  for (double t : y_ticks) {
+    s.line({plot.x, py(t)}, {plot.right(), py(t)}, grid_color, 1.0);
+    const double step = y_ticks.size() > 1 ? y_ticks[1] - y_ticks[0] : 1.0;
+    s.text(plot.x - fs * 0.6, py(t) + fs * 0.5, tick_label(t, step), fs, black, Align::right);
+  }
+
+  for (const auto & se : series) {
+    std::vector<Point> points(se.y.size());
+    for (size_t i=0; i<se.y.size(); i++) points[i] = {px((*se.x)[i]), std::isfinite(se.y[i]) ? py(se.y[i]) : NAN};
+    s.polyline(points, se.color, compact ? 1.0 : 1.6);
+  }
+
+  s.stroke_rect(plot, frame_color, 1.0);
+  if (!x_label.empty()) s.text(plot.x + plot.w / 2, plot.bottom() + fs * 3.6, x_label, fs, black, Align::center);
+  if (!y_label.empty()) s.text(plot.x + fs * 0.6, plot.y + fs * 1.6, y_label, fs, black);   // inside, no rotated text
+}
+
+inline void draw_legend(Surface & s, double x, double y, double fs, const std::vector<int> & which)
+{
+  for (int k : which) {
+    s.line({x, y - fs * 0.45}, {x + fs * 2.5, y - fs * 0.45}, series_colors[(size_t) k], 2.0);
+    s.text(x + fs * 3.2, y, series_names[(size_t) k], fs, black);
+    x += fs * (4.5 + 1.2 * std::string(series_names[(size_t) k]).size());
+  }
+}
+
+// the series the table has (no robot in the early logs)
+inline std::vector<int> logged_series(const trial_log::Table & t)
+{
+  std::vector<int> which;
+  for (int k=0; k<4; k++) {
+    const auto & c = t.columns.at(series_x[(size_t) k]);
+    if (std::any_of(c.begin(), c.end(), [](double v) { return std::isfinite(v); })) which.push_back(k);
+  }
+  return which;
+}
+
+
+///////////////////////////////////// FIGURES /////////////////////////////////////
+
+inline void draw_axes(Surface & s, const Rect & frame, const trial_log::Table & t, const std::vector<int> & which, bool compact)
+{
+  const std::vector<double> & time = t.columns.at(trial_log::time);
+  double x_lo, x_hi;
+  data_range({&time}, 0.0, x_lo, x_hi);
+
+  const double fs = font_size(frame) * (compact ? 0.8 : 1.0);
+  const char * names[3] = {"x [m]", "y [m]", "z [m]"};
+  for (int axis=0; axis<3; axis++) {
+    std::vector<Series> series;
+    for (int k : which) series.push_back({&time, t.columns.at(series_x[(size_t) k] + axis), series_colors[(size_t) k]});
+    const Rect panel {frame.x, frame.y + frame.h * axis / 3, frame.w, frame.h / 3};
+    draw_panel(s, panel, series, x_lo, x_hi, axis == 2 && !compact ? "time from start [s]" : "", names[axis], fs, compact);
+  }
+}
+
+inline void draw_error(Surface & s, const Rect & frame, const trial_log::Table & t, bool compact)
+{
+  using namespace trial_log;
+  const std::vector<double> & time = t.columns.at(trial_log::time);
+  double x_lo, x_hi;
+  data_range({&time}, 0.0, x_lo, x_hi);
+
+  // {human, tcp} - reference, like the h_err / t_err of the DataLogger
+  std::vector<Series> series;
+  std::string summary;
+  for (int k : {1, 3}) {
+    Series se {&time, std::vector<double>(t.size()), series_colors[(size_t) k]};
+    double sum = 0.0;
+    for (size_t i=0; i<t.size(); i++) {
+      double d2 = 0.0;
+      for (int a=0; a<3; a++) {
+        const double d = t.columns.at(series_x[(size_t) k] + a)[i] - t.columns.at(ref_x + a)[i];
+        d2 += d * d;
+      }
+      se.y[i] = std::sqrt(d2) * 100;
+      sum += d2;
+    }
+    char rmse[64];
+    std::snprintf(rmse, sizeof(rmse), "%s%s RMSE %.2f cm", summary.empty() ? "" : ", ", series_names[(size_t) k],
+                  100 * std::sqrt(sum / std::max<size_t>(t.size(), 1)));
+    summary += rmse;
+    series.push_back(std::move(se));
+  }
+
+  const double fs = font_size(frame) * (compact ? 0.8 : 1.0);
+  s.text(frame.x + frame.w / 2, frame.y + fs * 1.5, summary, fs, black, Align::center);
+  draw_panel(s, frame.inset(0, fs * 2.5, 0, 0), series, x_lo, x_hi, compact ? "" : "time from start [s]", "error [cm]", fs, compact);
+}
+
+inline void draw_3d(Surface & s, const Rect & frame, const trial_log::Table & t, const std::vector<int> & which, bool compact)
+{
+  using namespace trial_log;
+
+  // equal scale on the three axes, like plot_with_scale()
+  double lo[3], hi[3], center[3], half = 0.0;
+  for (int a=0; a<3; a++) {
+    std::vector<const std::vector<double> *> columns;
+    for (int k : which) columns.push_back(&t.columns.at(series_x[(size_t) k] + a));
+    data_range(columns, 0.0, lo[a], hi[a]);
+    center[a] = (lo[a] + hi[a]) / 2;
+    half = std::max(half, (hi[a] - lo[a]) / 2);
+  }
+  half = std::max(half * 1.1, 1e-3);
+
+  const double elev = 30 * M_PI / 180, azim = -60 * M_PI / 180;
+  const double right[3] = {-std::sin(azim), std::cos(azim), 0.0};
+  const double up[3] = {-std::sin(elev) * std::cos(azim), -std::sin(elev) * std::sin(azim), std::cos(elev)};
+
+  const double fs = font_size(frame) * (compact ? 0.8 : 1.0);
+  const Rect plot = frame.inset(fs * 2, fs * 2, fs * 2, fs * 3);
+  const double scale = std::min(plot.w, plot.h) / (2 * std::sqrt(3.0));   // the cube diagonal fits
+  const Point mid {plot.x + plot.w / 2, plot.y + plot.h / 2};
+
+  auto project = [&](double x, double y, double z) -> Point {
+    const double p[3] = {(x - center[0]) / half, (y - center[1]) / half, (z - center[2]) / half};
+    return {mid.x + scale * (p[0] * right[0] + p[1] * right[1] + p[2] * right[2]),
+            mid.y - scale * (p[0] * up[0] + p[1] * up[1] + p[2] * up[2])};
+  };
+
+  // the three back panes of the cube, seen from +x, -y and above
+  const double x0 = center[0] - half, x1 = center[0] + half, y0 = center[1] - half, y1 = center[1] + half;
+  const double z0 = center[2] - half, z1 = center[2] + half;
+  const std::vector<std::array<double, 3>> corners = {{x0, y0, z0}, {x1, y0, z0}, {x1, y1, z0}, {x0, y1, z0},
+                                                      {x0, y0, z1}, {x1, y0, z1}, {x1, y1, z1}, {x0, y1, z1}};
+  auto corner = [&](int i) { return project(corners[(size_t) i][0], corners[(size_t) i][1], corners[(size_t) i][2]); };
+  const int panes[3][4] = {{0, 1, 2, 3}, {0, 3, 7, 4}, {2, 3, 7, 6}};   // floor, x = min, y = max
+  for (const auto & pane : panes) {
+    s.polyline({corner(pane[0]), corner(pane[1]), corner(pane[2]), corner(pane[3]), corner(pane[0])}, frame_color, 1.0);
+  }
+
+  for (int k : which) {
+    std::vector<Point> points(t.size());
+    for (size_t i=0; i<t.size(); i++) {
+      const double x = t.columns.at(series_x[(size_t) k])[i], y = t.columns.at(series_x[(size_t) k] + 1)[i];
+      const double z = t.columns.at(series_x[(size_t) k] + 2)[i];
+      points[i] = std::isfinite(x) && std::isfinite(y) && std::isfinite(z) ? project(x, y, z) : Point {NAN, NAN};
+    }
+    s.polyline(points, series_colors[(size_t) k], compact ? 1.0 : 1.6);
+  }
+
+  // axis names and extents on the front edges of the floor, z on top of the back corner
+  char label[64];
+  const Point ex = project(center[0], y0, z0), ey = project(x1, center[1], z0), ez = project(x0, y1, z1);
+  std::snprintf(label, sizeof(label), compact ? "x" : "x %.3f - %.3f m", x0, x1);
+  s.text(ex.x - fs, ex.y + fs * 2.2, label, fs, black, Align::right);
+  std::snprintf(label, sizeof(label), compact ? "y" : "y %.3f - %.3f m", y0, y1);
+  s.text(ey.x + fs, ey.y + fs * 2.2, label, fs, black, Align::left);
+  std::snprintf(label, sizeof(label), compact ? "z" : "z %.3f - %.3f m", z0, z1);
+  s.text(ez.x, ez.y - fs, label, fs, black, Align::center);
+}
+
+// one figure of the trial in frame, with its title (and the legend unless compact)
+inline void draw_trial_figure(Surface & s, const Rect & frame, const trial_log::Table & t, Figure figure, bool compact)
+{
+  const double fs = font_size(frame) * (compact ? 0.9 : 1.2);
+  char title[96];
+  std::snprintf(title, sizeof(title), "part %d, trial %d (alpha %d, traj %d)", t.part_id, t.trial_number, t.alpha_id, t.traj_id);
+  s.text(frame.x + frame.w / 2, frame.y + fs * 1.6, title, fs, black, Align::center);
+
+  const std::vector<int> which = logged_series(t);
+  Rect body = frame.inset(0, fs * 2.6, 0, 0);
+  if (!compact) {
+    const double lfs = font_size(frame);
+    std::vector<int> legend = figure == error ? std::vector<int> {1, 3} : which;
+    draw_legend(s, frame.x + lfs * 7.5, body.y + lfs, lfs, legend);
+    body = body.inset(0, lfs * 2.2, 0, 0);
+  }
+
+  if (figure == axes) draw_axes(s, body, t, which, compact);
+  else if (figure == three_d) draw_3d(s, body, t, which, compact);
+  else draw_error(s, body, t, compact);
+}
+
+}  // namespace trial_figures
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__TRIAL_FIGURES_HPP_
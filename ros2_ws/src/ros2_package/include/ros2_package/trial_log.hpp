@@ -0,0 +1,353 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Indexed, memory-mapped trial logs for the playback node
+//
+// - Main functionalities:
+//   1. parse_trial_csv() reads a trial csv of the DataLogger, in both the
+//      current layout (ref, human, robot, tcp, errors, times) and the early
+//      one (human, ref, tcp, errors, times, no robot position)
+//   2. write_trial_log() stores it column by column (time, nominal time,
+//      ref, human, robot, tcp, joints) in a binary .trial file
+//   3. TrialLog maps the file, at(c, i) / column(c) read it in place, and
+//      seek(t) is a binary search over the time column, O(log n)
+//   4. TrialCatalog indexes a log directory (part<N>/trial<M>.csv, with the
+//      alpha and trajectory ids from part<N>_header.csv)
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__TRIAL_LOG_HPP_
+#define ROS2_PACKAGE__TRIAL_LOG_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ros2_package/mapped_file.hpp"
+
+
+namespace ros2_package
+{
+
+namespace trial_log
+{
+
+// columns of a .trial file, in file order
+enum Column : uint32_t
+{
+  time = 0,            // time_from_start [s], 0 = trajectory origin
+  nominal_time,        // nominal_time_from_start [s] (= time in the early logs)
+  ref_x, ref_y, ref_z,
+  human_x, human_y, human_z,
+  robot_x, robot_y, robot_z,    // NaN in the early logs
+  tcp_x, tcp_y, tcp_z,
+  joint_1, joint_2, joint_3, joint_4, joint_5, joint_6, joint_7,   // IK of the tcp, filled when converting
+  n_columns
+};
+
+struct Header
+{
+  char magic[4];
+  uint32_t version;
+  uint64_t n_samples;
+  int32_t part_id;
+  int32_t trial_number;
+  int32_t alpha_id;
+  int32_t traj_id;
+  uint32_t n_columns;
+  uint32_t reserved;
+};
+static_assert(sizeof(Header) == 40, "the columns start 8-byte aligned");
+
+const uint32_t version = 1;
+
+// whole trial in memory, column major (columns[c][i])
+struct Table
+{
+  int part_id {-1};
+  int trial_number {-1};
+  int alpha_id {-1};
+  int traj_id {-1};
+  std::vector<std::vector<double>> columns = std::vector<std::vector<double>>(n_columns);
+
+  size_t size() const { return columns.at(time).size(); }
+};
+
+}  // namespace trial_log
+
+
+// fields of one csv line, the quoted ones ("[...]" lists) kept whole
+inline std::vector<std::string> split_csv_line(const std::string & line)
+{
+  std::vector<std::string> fields(1);
+  bool quoted = false;
+  for (char c : line) {
+    if (c == '"') quoted = !quoted;
+    else if (c == ',' && !quoted) fields.emplace_back();
+    else if (c != '\r') fields.back().push_back(c);
+  }
+  return fields;
+}
+
+// reads a DataLogger trial csv into table (joints left at 0), false if the layout is unknown
+inline bool parse_trial_csv(const std::string & path, trial_log::Table & table, std::string & error)
+{
+  using namespace trial_log;
+
+  std::ifstream file(path);
+  if (!file) {
+    error = "cannot open " + path;
+    return false;
+  }
+  for (auto & c : table.columns) c.clear();
+
+  // field index of {time, nominal time, ref, human, robot, tcp} (-1 = not logged)
+  int layout_time = -1, layout_nominal = -1, layout_ref = -1, layout_human = -1, layout_robot = -1, layout_tcp = -1;
+
+  std::string line;
+  size_t line_number = 0;
+  while (std::getline(file, line)) {
+    line_number++;
+    if (line.empty() || line == "\r") continue;
+    std::vector<std::string> f = split_csv_line(line);
+
+    if (layout_time < 0) {
+      if (f.size() >= 27) {
+        // ref, human, robot, tcp, h_err, [h_err list], t_err, 9 dim errors, time_from_start, time, datetime (, nominal)
+        layout_ref = 0; layout_human = 3; layout_robot = 6; layout_tcp = 9; layout_time = 24;
+        layout_nominal = f.size() >= 28 ? 27 : -1;
+      } else if (f.size() == 20) {
+        // human, ref, tcp, h_err, t_err, 6 dim errors, time_from_start, time, datetime
+        layout_human = 0; layout_ref = 3; layout_tcp = 6; layout_time = 17;
+      } else {
+        error = path + ": unknown layout with " + std::to_string(f.size()) + " fields";
+        return false;
+      }
+    }
+
+    auto value = [&](int field) { return field < 0 ? std::nan("") : std::stod(f.at((size_t) field)); };
+    try {
+      const double t = value(layout_time);
+      table.columns.at(time).push_back(t);
+      table.columns.at(nominal_time).push_back(layout_nominal < 0 ? t : value(layout_nominal));
+      for (int k=0; k<3; k++) {
+        table.columns.at(ref_x + k).push_back(value(layout_ref + k));
+        table.columns.at(human_x + k).push_back(value(layout_human + k));
+        table.columns.at(robot_x + k).push_back(layout_robot < 0 ? std::nan("") : value(layout_robot + k));
+        table.columns.at(tcp_x + k).push_back(value(layout_tcp + k));
+      }
+      for (int j=0; j<7; j++) table.columns.at(joint_1 + j).push_back(0.0);
+    } catch (const std::exception &) {
+      error = path + ":" + std::to_string(line_number) + ": not a number";
+      return false;
+    }
+  }
+
+  if (table.size() == 0) {
+    error = path + ": no samples";
+    return false;
+  }
+
+  // the time index needs increasing times (they are, unless the clock jumped while recording)
+  const std::vector<double> & t = table.columns.at(time);
+  if (!std::is_sorted(t.begin(), t.end())) {
+    std::vector<size_t> order(t.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return t[a] < t[b]; });
+    for (auto & c : table.columns) {
+      std::vector<double> sorted(c.size());
+      for (size_t i=0; i<order.size(); i++) sorted[i] = c[order[i]];
+      c.swap(sorted);
+    }
+  }
+  return true;
+}
+
+inline bool write_trial_log(const std::string & path, const trial_log::Table & table)
+{
+  using namespace trial_log;
+
+  Header header {};
+  std::memcpy(header.magic, "ATRL", 4);
+  header.version = version;
+  header.n_samples = table.size();
+  header.part_id = table.part_id;
+  header.trial_number = table.trial_number;
+  header.alpha_id = table.alpha_id;
+  header.traj_id = table.traj_id;
+  header.n_columns = n_columns;
+
+  // written next to the target and renamed, a reader never maps a half-written file
+  const std::string tmp = path + ".tmp";
+  FILE * f = std::fopen(tmp.c_str(), "wb");
+  if (!f) return false;
+  bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1;
+  for (const auto & c : table.columns) {
+    ok = ok && c.size() == table.size() && std::fwrite(c.data(), sizeof(double), c.size(), f) == c.size();
+  }
+  ok = std::fclose(f) == 0 && ok;
+  if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+    std::remove(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+
+// a mapped .trial file, nothing is copied
+class TrialLog
+{
+public:
+
+  bool open(const std::string & path)
+  {
+    using namespace trial_log;
+    if (!file_.open(path) || file_.size() < sizeof(Header)) return fail();
+
+    header_ = file_.as<Header>();
+    if (std::memcmp(header_->magic, "ATRL", 4) != 0 || header_->version != version || header_->n_columns != n_columns) return fail();
+    if (file_.size() != sizeof(Header) + header_->n_samples * n_columns * sizeof(double)) return fail();
+    if (header_->n_samples == 0) return fail();
+    return true;
+  }
+
+  bool is_open() const { return header_ != nullptr; }
+  size_t size() const { return (size_t) header_->n_samples; }
+  int part_id() const { return header_->part_id; }
+  int trial_number() const { return header_->trial_number; }
+  int alpha_id() const { return header_->alpha_id; }
+  int traj_id() const { return header_->traj_id; }
+
+  const double * column(trial_log::Column c) const
+  {
+    return file_.as<double>(sizeof(trial_log::Header) + (size_t) c * size() * sizeof(double));
+  }
+  double at(trial_log::Column c, size_t i) const { return column(c)[i]; }
+
+  double start_time() const { return at(trial_log::time, 0); }
+  double end_time() const { return at(trial_log::time, size() - 1); }
+
+  // index of the last sample at or before t (0 before the start)
+  size_t seek(double t) const
+  {
+    const double * times = column(trial_log::time);
+    const double * it = std::upper_bound(times, times + size(), t);
+    return it == times ? 0 : (size_t) (it - times) - 1;
+  }
+
+private:
+
+  bool fail()
+  {
+    file_.close();
+    header_ = nullptr;
+    return false;
+  }
+
+  MappedFile file_;
+  const trial_log::Header * header_ = nullptr;
+};
+
+
+// trials of a DataLogger directory: <dir>/part<N>/trial<M>.csv
+class TrialCatalog
+{
+public:
+
+  struct Entry
+  {
+    int part_id {-1};
+    int trial_number {-1};
+    int alpha_id {-1};
+    int traj_id {-1};
+    std::string csv_path;
+  };
+
+  // returns the number of trials found
+  size_t scan(const std::string & log_dir)
+  {
+    namespace fs = std::filesystem;
+    entries_.clear();
+    std::error_code ec;
+
+    for (const auto & part : fs::directory_iterator(log_dir, ec)) {
+      int part_id = number_after(part.path().filename().string(), "part");
+      if (!part.is_directory() || part_id < 0) continue;
+
+      // trial_number -> {alpha_id, traj_id}
+      std::map<int, std::pair<int, int>> ids;
+      std::ifstream header(part.path() / ("part" + std::to_string(part_id) + "_header.csv"));
+      std::string line;
+      std::getline(header, line);   // column names
+      while (std::getline(header, line)) {
+        std::vector<std::string> f = split_csv_line(line);
+        if (f.size() < 3) continue;
+        try {
+          ids[std::stoi(f.at(0))] = {std::stoi(f.at(1)), std::stoi(f.at(2))};
+        } catch (const std::exception &) {}
+      }
+
+      for (const auto & trial : fs::directory_iterator(part.path(), ec)) {
+        if (trial.path().extension() != ".csv") continue;
+        int trial_number = number_after(trial.path().stem().string(), "trial");
+        if (trial_number < 0) continue;
+
+        Entry e;
+        e.part_id = part_id;
+        e.trial_number = trial_number;
+        e.csv_path = trial.path().string();
+        auto it = ids.find(trial_number);
+        if (it != ids.end()) {
+          e.alpha_id = it->second.first;
+          e.traj_id = it->second.second;
+        }
+        entries_[{part_id, trial_number}] = e;
+      }
+    }
+    return entries_.size();
+  }
+
+  const Entry * find(int part_id, int trial_number) const
+  {
+    auto it = entries_.find({part_id, trial_number});
+    return it == entries_.end() ? nullptr : &it->second;
+  }
+
+  size_t size() const { return entries_.size(); }
+
+  // every trial, by participant then trial number
+  std::vector<Entry> entries() const
+  {
+    std::vector<Entry> all;
+    for (const auto & e : entries_) all.push_back(e.second);
+    return all;
+  }
+
+private:
+
+  // "trial12" -> 12 for prefix "trial", -1 if it does not match
+  static int number_after(const std::string & name, const std::string & prefix)
+  {
+    if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0) return -1;
+    const std::string digits = name.substr(prefix.size());
+    if (!std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; })) return -1;
+    return std::stoi(digits);
+  }
+
+  std::map<std::pair<int, int>, Entry> entries_;
+};
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__TRIAL_LOG_HPP_
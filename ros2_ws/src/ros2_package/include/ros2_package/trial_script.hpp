@@ -0,0 +1,529 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Trial scripts as C++20 coroutines, resumed by the control tick, so the
+//   phases of a trial read top to bottom instead of as count thresholds
+//
+// - Main functionalities:
+//   1. TrialTask, the coroutine type of a script; its frame comes from the
+//      fixed arena of the scheduler that creates (spawn) or runs (tick) it,
+//      never from the heap (a script that does not fit fails to spawn, a
+//      sub-script that does not fit throws std::bad_alloc in its parent)
+//   2. TrialScheduler::tick(count) resumes the scripts that are due, the
+//      cost per tick is one comparison unless a script waits on a condition
+//   3. What a script can co_await:
+//        s.ticks(n) / s.at(tick)    control ticks, on the nominal timeline:
+//                                   skipped ticks are caught up in order, in
+//                                   the same tick, like the old crossed()
+//        s.when(predicate)          checked once per tick while waited on
+//        signal (ScriptSignal)      notified from a callback, resumed at the
+//                                   next tick
+//        another TrialTask          runs the sub-script to its end
+//   4. PhaseRamp, the 0 -> 1 blends the scripts start and the tick evaluates
+//
+// - Example (see RealController::trial_script):
+//     ros2_package::TrialTask script(ros2_package::TrialScheduler & s) {
+//       co_await s.at(2500);               // 5 s after control started
+//       record_flag = true;
+//       co_await s.ticks(5000);
+//       ...
+//     }
+//     scheduler.spawn([&] { return script(scheduler); });  // once
+//     scheduler.tick(count);               // every control tick
+//
+// - Not thread-safe, the owner serializes tick(), spawn() and notify()
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__TRIAL_SCRIPT_HPP_
+#define ROS2_PACKAGE__TRIAL_SCRIPT_HPP_
+
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace ros2_package
+{
+
+class TrialScheduler;
+
+//////////////////// FRAME ARENA ////////////////////
+
+// fixed pool of equally sized coroutine frames, allocated once at construction
+class FrameArena
+{
+public:
+
+  FrameArena(size_t n_frames, size_t frame_size)
+  : stride_(round_up(header_size + frame_size, sizeof(std::max_align_t))),
+    storage_(new std::max_align_t[n_frames * stride_ / sizeof(std::max_align_t)])
+  {
+    char * base = reinterpret_cast<char *>(storage_.get());
+    for (size_t i = n_frames; i-- > 0;) free_ = new (base + i * stride_) Header{this, free_};
+  }
+
+  FrameArena(const FrameArena &) = delete;
+  FrameArena & operator=(const FrameArena &) = delete;
+
+  // nullptr if the frame is too large or every slot is taken
+  void * allocate(size_t size) noexcept
+  {
+    if (free_ == nullptr || header_size + size > stride_) {
+      failures_++;
+      return nullptr;
+    }
+    Header * header = free_;
+    free_ = header->next;
+    in_use_++;
+    peak_ = std::max(peak_, in_use_);
+    largest_ = std::max(largest_, size);
+    return reinterpret_cast<char *>(header) + header_size;
+  }
+
+  // the header in front of the frame knows its arena, so operator delete needs no context
+  static void release(void * frame) noexcept
+  {
+    Header * header = reinterpret_cast<Header *>(static_cast<char *>(frame) - header_size);
+    FrameArena * arena = header->arena;
+    header->next = arena->free_;
+    arena->free_ = header;
+    arena->in_use_--;
+  }
+
+  size_t frame_size() const { return stride_ - header_size; }
+  size_t in_use() const { return in_use_; }
+  size_t peak() const { return peak_; }
+  size_t largest() const { return largest_; }     // largest frame requested so far [bytes]
+  size_t failures() const { return failures_; }
+
+private:
+
+  struct Header
+  {
+    FrameArena * arena;
+    Header * next;
+  };
+
+  static constexpr size_t round_up(size_t n, size_t m) { return (n + m - 1) / m * m; }
+  static const size_t header_size;
+
+  size_t stride_;
+  std::unique_ptr<std::max_align_t[]> storage_;
+  Header * free_ {nullptr};
+  size_t in_use_ {0};
+  size_t peak_ {0};
+  size_t largest_ {0};
+  size_t failures_ {0};
+};
+
+
+inline const size_t FrameArena::header_size = FrameArena::round_up(sizeof(FrameArena::Header), alignof(std::max_align_t));
+
+
+//////////////////// TRIAL TASK ////////////////////
+
+class TrialTask
+{
+public:
+
+  struct promise_type
+  {
+    TrialScheduler * scheduler;
+    std::coroutine_handle<> continuation;   // script awaiting this one, none for a spawned script
+    std::exception_ptr exception;
+
+    promise_type() noexcept;
+
+    // frames only ever come from the arena of the scheduler creating or running the script
+    static void * operator new(std::size_t size) noexcept;
+    static void operator delete(void * frame) noexcept { FrameArena::release(frame); }
+
+    TrialTask get_return_object() noexcept
+    {
+      return TrialTask(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    static TrialTask get_return_object_on_allocation_failure() noexcept { return TrialTask(); }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter
+    {
+      bool await_ready() noexcept { return false; }
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+      void await_resume() noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { exception = std::current_exception(); }
+  };
+
+  using Handle = std::coroutine_handle<promise_type>;
+
+  TrialTask() = default;
+  explicit TrialTask(Handle handle) : handle_(handle) {}
+  TrialTask(TrialTask && other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+  TrialTask & operator=(TrialTask && other) noexcept
+  {
+    if (this != &other) {
+      if (handle_) handle_.destroy();
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+  ~TrialTask() { if (handle_) handle_.destroy(); }
+
+  // false if the frame did not fit the arena
+  bool valid() const { return static_cast<bool>(handle_); }
+  bool done() const { return handle_ && handle_.done(); }
+
+  Handle release() { return std::exchange(handle_, nullptr); }
+
+  // a script awaiting another one runs it to its end (a sub-script that did not fit throws std::bad_alloc)
+  struct Awaiter
+  {
+    Handle child;
+    bool await_ready() const noexcept { return !child || child.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> parent) noexcept
+    {
+      child.promise().continuation = parent;
+      return child;
+    }
+    void await_resume()
+    {
+      if (!child) throw std::bad_alloc();
+      if (child.promise().exception) std::rethrow_exception(child.promise().exception);
+    }
+  };
+  Awaiter operator co_await() const & noexcept { return Awaiter{handle_}; }
+
+private:
+
+  Handle handle_;
+};
+
+
+//////////////////// SCHEDULER ////////////////////
+
+class ScriptSignal;
+
+class TrialScheduler
+{
+public:
+
+  // at most max_scripts spawned scripts and max_frames frames of frame_size bytes (sub-scripts included)
+  explicit TrialScheduler(size_t max_scripts = 4, size_t max_frames = 8, size_t frame_size = 1024)
+  : arena_(max_frames, frame_size), roots_(max_scripts) {}
+
+  TrialScheduler(const TrialScheduler &) = delete;
+  TrialScheduler & operator=(const TrialScheduler &) = delete;
+
+  ~TrialScheduler() { cancel(); }
+
+  // creates a script with make_script() and takes it over, it starts at the next tick;
+  // false if its frame did not fit the arena or all slots are taken
+  template<typename F>
+  bool spawn(F && make_script)
+  {
+    TrialTask task;
+    {
+      ActiveScope scope(this);
+      task = make_script();
+    }
+    if (!task.valid()) return false;
+    for (Root & root : roots_) {
+      if (root.handle) continue;
+      root.handle = task.release();
+      root.start.handle = root.handle;
+      ready_.push_back(&root.start);
+      return true;
+    }
+    return false;
+  }
+
+  // resumes everything due at the control tick count (non-decreasing), an exception of a script is rethrown here
+  void tick(int64_t count)
+  {
+    ActiveScope scope(this);
+    count_ = count;
+
+    // started or notified since the last tick
+    while (Waiter * w = ready_.pop_front()) resume(w, count);
+
+    // in due order, so the phases of skipped ticks still happen one after the other
+    while (due_.head != nullptr && due_.head->due <= count) {
+      Waiter * w = due_.pop_front();
+      resume(w, w->due);
+    }
+
+    // predicates registered by this very pass are first checked at the next tick
+    if (conditions_.head != nullptr) {
+      WaitList pending = std::exchange(conditions_, WaitList{});
+      while (Waiter * w = pending.pop_front()) {
+        if (w->check(w)) resume(w, count);
+        else conditions_.push_back(w);
+      }
+    }
+
+    now_ = count;
+    if (finished_) reap();
+  }
+
+  // destroys every script, waiting or not
+  void cancel()
+  {
+    ready_ = due_ = conditions_ = signaled_ = WaitList{};
+    for (Root & root : roots_) {
+      if (root.handle) root.handle.destroy();
+      root.handle = nullptr;
+    }
+    finished_ = false;
+  }
+
+  // script time, i.e. the tick the running script was due at (behind count_ while skipped ticks are caught up)
+  int64_t now() const { return now_; }
+  int64_t count() const { return count_; }
+
+  size_t running() const
+  {
+    return std::count_if(roots_.begin(), roots_.end(), [](const Root & root) { return static_cast<bool>(root.handle); });
+  }
+  const FrameArena & arena() const { return arena_; }
+
+  // one entry per suspended script, lives in the awaiter (so in the frame of the script)
+  struct Waiter
+  {
+    std::coroutine_handle<> handle;
+    Waiter * next {nullptr};
+    int64_t due {0};
+    const ScriptSignal * signal {nullptr};
+    bool (*check)(Waiter *) {nullptr};
+  };
+
+  struct TickAwaiter : Waiter
+  {
+    TrialScheduler & scheduler;
+    TickAwaiter(TrialScheduler & s, int64_t tick) : scheduler(s) { due = tick; }
+    bool await_ready() const noexcept { return due <= scheduler.now_; }
+    void await_suspend(std::coroutine_handle<> h) noexcept
+    {
+      handle = h;
+      scheduler.insert_due(this);
+    }
+    void await_resume() const noexcept {}
+  };
+
+  template<typename F>
+  struct ConditionAwaiter : Waiter
+  {
+    TrialScheduler & scheduler;
+    F predicate;
+    ConditionAwaiter(TrialScheduler & s, F && f) : scheduler(s), predicate(std::move(f))
+    {
+      check = [](Waiter * w) { return static_cast<bool>(static_cast<ConditionAwaiter *>(w)->predicate()); };
+    }
+    bool await_ready() { return static_cast<bool>(predicate()); }
+    void await_suspend(std::coroutine_handle<> h) noexcept
+    {
+      handle = h;
+      scheduler.conditions_.push_back(this);
+    }
+    void await_resume() const noexcept {}
+  };
+
+  // wait until script time reaches tick / for n ticks of script time
+  TickAwaiter at(int64_t tick) { return TickAwaiter(*this, tick); }
+  TickAwaiter ticks(int64_t n) { return TickAwaiter(*this, now_ + n); }
+  TickAwaiter next_tick() { return ticks(1); }
+
+  // wait until predicate() is true, it is checked now and then once per tick
+  template<typename F>
+  ConditionAwaiter<std::decay_t<F>> when(F && predicate)
+  {
+    return ConditionAwaiter<std::decay_t<F>>(*this, std::decay_t<F>(std::forward<F>(predicate)));
+  }
+
+private:
+
+  friend class TrialTask;
+  friend class ScriptSignal;
+
+  // the scheduler whose arena the frames come from, set while spawn() creates a script and while tick() runs them
+  static inline thread_local TrialScheduler * active_ {nullptr};
+
+  struct ActiveScope
+  {
+    TrialScheduler * previous;
+    explicit ActiveScope(TrialScheduler * scheduler) : previous(std::exchange(active_, scheduler)) {}
+    ~ActiveScope() { active_ = previous; }
+  };
+
+  struct WaitList
+  {
+    Waiter * head {nullptr};
+    Waiter * tail {nullptr};
+
+    void push_back(Waiter * w)
+    {
+      w->next = nullptr;
+      if (tail != nullptr) tail->next = w;
+      else head = w;
+      tail = w;
+    }
+    Waiter * pop_front()
+    {
+      Waiter * w = head;
+      if (w == nullptr) return nullptr;
+      head = w->next;
+      if (head == nullptr) tail = nullptr;
+      w->next = nullptr;
+      return w;
+    }
+  };
+
+  struct Root
+  {
+    TrialTask::Handle handle;
+    Waiter start;
+  };
+
+  // sorted by due tick, ties in wait order
+  void insert_due(Waiter * w)
+  {
+    if (due_.tail == nullptr || due_.tail->due <= w->due) {
+      due_.push_back(w);
+      return;
+    }
+    Waiter ** link = &due_.head;
+    while ((*link)->due <= w->due) link = &(*link)->next;
+    w->next = *link;
+    *link = w;
+  }
+
+  void resume(Waiter * w, int64_t now)
+  {
+    now_ = now;
+    w->handle.resume();
+  }
+
+  void wake(const ScriptSignal * signal)
+  {
+    WaitList pending = std::exchange(signaled_, WaitList{});
+    while (Waiter * w = pending.pop_front()) {
+      if (w->signal == signal) ready_.push_back(w);
+      else signaled_.push_back(w);
+    }
+  }
+
+  void reap()
+  {
+    finished_ = false;
+    std::exception_ptr exception;
+    for (Root & root : roots_) {
+      if (!root.handle || !root.handle.done()) continue;
+      if (!exception) exception = root.handle.promise().exception;
+      root.handle.destroy();
+      root.handle = nullptr;
+    }
+    if (exception) std::rethrow_exception(exception);
+  }
+
+  FrameArena arena_;
+  std::vector<Root> roots_;
+  WaitList ready_;
+  WaitList due_;
+  WaitList conditions_;
+  WaitList signaled_;
+  int64_t now_ {0};
+  int64_t count_ {0};
+  bool finished_ {false};
+};
+
+
+// edge-triggered event a script can co_await, notify() wakes the scripts waiting right now
+class ScriptSignal
+{
+public:
+
+  explicit ScriptSignal(TrialScheduler & scheduler) : scheduler_(scheduler) {}
+
+  // the woken scripts run at the next tick, not inside the caller
+  void notify() { scheduler_.wake(this); }
+
+  struct Awaiter : TrialScheduler::Waiter
+  {
+    TrialScheduler & scheduler;
+    Awaiter(TrialScheduler & s, const ScriptSignal * sig) : scheduler(s) { signal = sig; }
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) noexcept
+    {
+      handle = h;
+      scheduler.signaled_.push_back(this);
+    }
+    void await_resume() const noexcept {}
+  };
+  Awaiter operator co_await() const noexcept { return Awaiter(scheduler_, this); }
+
+private:
+
+  TrialScheduler & scheduler_;
+};
+
+
+//////////////////// TASK INTERNALS ////////////////////
+
+inline TrialTask::promise_type::promise_type() noexcept
+: scheduler(TrialScheduler::active_) {}
+
+// outside of spawn() and tick() there is no arena, the script is not created
+inline void * TrialTask::promise_type::operator new(std::size_t size) noexcept
+{
+  return TrialScheduler::active_ != nullptr ? TrialScheduler::active_->arena_.allocate(size) : nullptr;
+}
+
+inline std::coroutine_handle<> TrialTask::promise_type::FinalAwaiter::await_suspend(
+  std::coroutine_handle<promise_type> handle) noexcept
+{
+  promise_type & promise = handle.promise();
+  if (promise.continuation) return promise.continuation;
+  promise.scheduler->finished_ = true;    // spawned script, destroyed at the end of the tick
+  return std::noop_coroutine();
+}
+
+
+//////////////////// PHASE RAMP ////////////////////
+
+// linear 0 -> 1 over a window of control ticks, started by a script and evaluated by the tick (0 until started)
+struct PhaseRamp
+{
+  int64_t start_tick {-1};
+  int64_t length {1};
+
+  void start(int64_t tick, int64_t n)
+  {
+    start_tick = tick;
+    length = std::max<int64_t>(n, 1);
+  }
+
+  bool started() const { return start_tick >= 0; }
+
+  double value(int64_t tick) const
+  {
+    if (!started()) return 0.0;
+    return std::clamp((double) (tick - start_tick) / length, 0.0, 1.0);
+  }
+};
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__TRIAL_SCRIPT_HPP_
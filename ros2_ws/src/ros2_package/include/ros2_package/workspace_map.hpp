@@ -0,0 +1,220 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Calibrated, nonlinear Falcon -> robot workspace mapping
+//   stored as a precomputed 3D lookup table
+//
+// - Main functionalities:
+//   1. Binary table format (header + nx*ny*nz*3 doubles), written
+//      once by the falcon_calibration tool and loaded with mmap
+//   2. Constant-cost trilinear interpolation per sample, extrapolated
+//      linearly from the edge cells outside the calibrated grid
+//   3. Optional per-axis nonlinear (power-law) scaling of the input
+//   4. Numerical inversion, used to find the Falcon centering position
+//
+// - Input: Falcon position in [meters] (as read from the SDK)
+// - Output: robot task-space offset in [meters] (i.e. human_offset)
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#ifndef ROS2_PACKAGE__WORKSPACE_MAP_HPP_
+#define ROS2_PACKAGE__WORKSPACE_MAP_HPP_
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "ros2_package/mapped_file.hpp"
+
+
+namespace ros2_package
+{
+
+/////////////// FILE HEADER //////////////
+
+struct WorkspaceMapHeader
+{
+  char magic[8];          // "CLTWMAP"
+  uint32_t version;
+  uint32_t n[3];          // grid points along {x, y, z}
+  uint32_t reserved;
+  double min[3];          // Falcon-space bounds of the grid [m]
+  double max[3];
+};
+
+static const char workspace_map_magic[8] = {'C', 'L', 'T', 'W', 'M', 'A', 'P', '\0'};
+static const uint32_t workspace_map_version = 1;
+
+
+// writes a table, values are ordered as ((ix * ny + iy) * nz + iz) * 3 + axis
+inline bool write_workspace_map(const std::string & path, const uint32_t n[3], const double min[3], const double max[3],
+                                const std::vector<double> & values)
+{
+  if (values.size() != (size_t) n[0] * n[1] * n[2] * 3) return false;
+
+  WorkspaceMapHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, workspace_map_magic, sizeof(header.magic));
+  header.version = workspace_map_version;
+  for (size_t i=0; i<3; i++) {
+    header.n[i] = n[i];
+    header.min[i] = min[i];
+    header.max[i] = max[i];
+  }
+
+  FILE * f = std::fopen(path.c_str(), "wb");
+  if (f == nullptr) return false;
+  bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1;
+  ok = ok && std::fwrite(values.data(), sizeof(double), values.size(), f) == values.size();
+  ok = (std::fclose(f) == 0) && ok;
+  return ok;
+}
+
+
+/////////////// MAPPING //////////////
+
+class WorkspaceMap
+{
+public:
+
+  // returns false (and leaves the map unloaded) if the file is missing or malformed
+  bool load(const std::string & path)
+  {
+    loaded_ = false;
+    if (!file_.open(path)) return false;
+    if (file_.size() < sizeof(WorkspaceMapHeader)) return false;
+
+    const WorkspaceMapHeader * h = file_.as<WorkspaceMapHeader>();
+    if (std::memcmp(h->magic, workspace_map_magic, sizeof(h->magic)) != 0) return false;
+    if (h->version != workspace_map_version) return false;
+    for (size_t i=0; i<3; i++) {
+      if (h->n[i] < 2 || !(h->max[i] > h->min[i])) return false;
+      n_[i] = h->n[i];
+      min_[i] = h->min[i];
+      max_[i] = h->max[i];
+      step_[i] = (max_[i] - min_[i]) / (n_[i] - 1);
+    }
+    if (file_.size() != sizeof(WorkspaceMapHeader) + (size_t) n_[0] * n_[1] * n_[2] * 3 * sizeof(double)) return false;
+
+    values_ = file_.as<double>(sizeof(WorkspaceMapHeader));
+    loaded_ = true;
+    return true;
+  }
+
+  bool loaded() const { return loaded_; }
+
+  // gamma = 1 is linear, gamma < 1 is more sensitive around the grid center, gamma > 1 less
+  void set_axis_scaling(const double gamma[3])
+  {
+    for (size_t i=0; i<3; i++) gamma_[i] = gamma[i] > 0.0 ? gamma[i] : 1.0;
+  }
+
+  // Falcon position p[3] -> robot offset out[3], constant cost
+  void apply(const double p[3], double out[3]) const
+  {
+    size_t idx[3];
+    double w[3];
+    for (size_t i=0; i<3; i++) {
+      double x = scale_axis(i, p[i]);
+      double u = (x - min_[i]) / step_[i];
+      // outside the grid the edge cell is extended (w < 0 or > 1), the mapping keeps its slope instead of saturating
+      size_t k = u > 0.0 ? (size_t) u : 0;
+      if (k > n_[i] - 2) k = n_[i] - 2;
+      idx[i] = k;
+      w[i] = u - k;
+    }
+
+    for (size_t a=0; a<3; a++) out[a] = 0.0;
+    for (size_t c=0; c<8; c++) {
+      const size_t dx = c & 1, dy = (c >> 1) & 1, dz = (c >> 2) & 1;
+      const double wc = (dx ? w[0] : 1.0 - w[0]) * (dy ? w[1] : 1.0 - w[1]) * (dz ? w[2] : 1.0 - w[2]);
+      const double * v = node(idx[0] + dx, idx[1] + dy, idx[2] + dz);
+      for (size_t a=0; a<3; a++) out[a] += wc * v[a];
+    }
+  }
+
+  // finds the Falcon position that maps onto target[3] (Newton iterations with a numerical Jacobian)
+  bool invert(const double target[3], double p[3], int max_iter = 20, double tol = 1e-6) const
+  {
+    for (size_t i=0; i<3; i++) p[i] = 0.5 * (min_[i] + max_[i]);
+
+    for (int it=0; it<max_iter; it++) {
+      double f[3];
+      apply(p, f);
+      double r[3] = {target[0] - f[0], target[1] - f[1], target[2] - f[2]};
+      if (std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]) < tol) return true;
+
+      // J(:, j) = d out / d p_j
+      double J[3][3];
+      for (size_t j=0; j<3; j++) {
+        double h = 0.25 * step_[j];
+        double pp[3] = {p[0], p[1], p[2]};
+        pp[j] += h;
+        double fp[3];
+        apply(pp, fp);
+        for (size_t i=0; i<3; i++) J[i][j] = (fp[i] - f[i]) / h;
+      }
+
+      double d[3];
+      if (!solve3(J, r, d)) return false;
+      for (size_t i=0; i<3; i++) p[i] += d[i];
+    }
+    return false;
+  }
+
+  const double * min() const { return min_; }
+  const double * max() const { return max_; }
+
+private:
+
+  const double * node(size_t ix, size_t iy, size_t iz) const
+  {
+    return values_ + ((ix * n_[1] + iy) * n_[2] + iz) * 3;
+  }
+
+  double scale_axis(size_t i, double x) const
+  {
+    if (gamma_[i] == 1.0) return x;
+    const double c = 0.5 * (min_[i] + max_[i]);
+    const double h = 0.5 * (max_[i] - min_[i]);
+    double u = (x - c) / h;
+    double s = u < 0.0 ? -1.0 : 1.0;
+    return c + h * s * std::pow(std::fabs(u), gamma_[i]);
+  }
+
+  // Cramer's rule for a 3x3 system
+  static bool solve3(const double A[3][3], const double b[3], double x[3])
+  {
+    double det = A[0][0] * (A[1][1] * A[2][2] - A[1][2] * A[2][1])
+               - A[0][1] * (A[1][0] * A[2][2] - A[1][2] * A[2][0])
+               + A[0][2] * (A[1][0] * A[2][1] - A[1][1] * A[2][0]);
+    if (std::fabs(det) < 1e-15) return false;
+    for (size_t k=0; k<3; k++) {
+      double M[3][3];
+      for (size_t i=0; i<3; i++) for (size_t j=0; j<3; j++) M[i][j] = (j == k) ? b[i] : A[i][j];
+      x[k] = (M[0][0] * (M[1][1] * M[2][2] - M[1][2] * M[2][1])
+            - M[0][1] * (M[1][0] * M[2][2] - M[1][2] * M[2][0])
+            + M[0][2] * (M[1][0] * M[2][1] - M[1][1] * M[2][0])) / det;
+    }
+    return true;
+  }
+
+  MappedFile file_;
+  const double * values_ = nullptr;
+  bool loaded_ = false;
+
+  size_t n_[3] {2, 2, 2};
+  double min_[3] {0.0, 0.0, 0.0};
+  double max_[3] {1.0, 1.0, 1.0};
+  double step_[3] {1.0, 1.0, 1.0};
+  double gamma_[3] {1.0, 1.0, 1.0};
+};
+
+}  // namespace ros2_package
+
+#endif  // ROS2_PACKAGE__WORKSPACE_MAP_HPP_
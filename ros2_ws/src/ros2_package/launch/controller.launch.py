@@ -1,13 +1,18 @@
 from launch import LaunchDescription
 from launch.actions import DeclareLaunchArgument
-from launch.substitutions import LaunchConfiguration
+from launch.substitutions import LaunchConfiguration, PathJoinSubstitution
 from launch_ros.actions import Node
+from launch_ros.substitutions import FindPackageShare
 
 from ros2_package.exp_params import *
+from ros2_package import placement
 
 
 def generate_launch_description():
 
+    # CPU placement of this machine (config/placement/<$AUTONOMY_MACHINE or host name>.yaml)
+    machine = placement.load_machine()
+
     # my own launch arguments
     free_drive_parameter_name = 'free_drive'
     mapping_ratio_parameter_name = 'mapping_ratio'
@@ -15,6 +20,11 @@ def generate_launch_description():
     participant_parameter_name = 'part_id'
     alpha_parameter_name = 'alpha_id'
     trajectory_parameter_name = 'traj_id'
+    generator_parameter_name = 'trajectory'
+    deadband_parameter_name = 'use_deadband'
+    heartbeat_parameter_name = 'deadband_heartbeat'
+    mapping_lut_parameter_name = 'mapping_lut'
+    lut_gamma_parameter_name = 'lut_gamma'
 
     free_drive = LaunchConfiguration(free_drive_parameter_name)
     mapping_ratio = LaunchConfiguration(mapping_ratio_parameter_name)
@@ -22,6 +32,11 @@ def generate_launch_description():
     participant = LaunchConfiguration(participant_parameter_name)
     alpha = LaunchConfiguration(alpha_parameter_name)
     trajectory = LaunchConfiguration(trajectory_parameter_name)
+    generator = LaunchConfiguration(generator_parameter_name)
+    deadband = LaunchConfiguration(deadband_parameter_name)
+    heartbeat = LaunchConfiguration(heartbeat_parameter_name)
+    mapping_lut = LaunchConfiguration(mapping_lut_parameter_name)
+    lut_gamma = LaunchConfiguration(lut_gamma_parameter_name)
 
 
     return LaunchDescription([
@@ -50,6 +65,26 @@ def generate_launch_description():
             trajectory_parameter_name,
             default_value=my_traj_id,
             description='Trajectory ID parameter'),
+        DeclareLaunchArgument(
+            generator_parameter_name,
+            default_value=my_trajectory,
+            description='Trajectory generator spec (sines, spiral, lissajous, spline:file=...)'),
+        DeclareLaunchArgument(
+            deadband_parameter_name,
+            default_value=my_use_deadband,
+            description='Perceptual deadband parameter'),
+        DeclareLaunchArgument(
+            heartbeat_parameter_name,
+            default_value=my_deadband_heartbeat,
+            description='Perceptual deadband heartbeat [s] (talker and controller)'),
+        DeclareLaunchArgument(
+            mapping_lut_parameter_name,
+            default_value=my_mapping_lut,
+            description='Calibrated Falcon -> robot lookup table (empty = the mapping ratio)'),
+        DeclareLaunchArgument(
+            lut_gamma_parameter_name,
+            default_value=my_lut_gamma,
+            description='Per-axis scaling of the lookup table, e.g. "[1.0, 1.0, 1.0]"'),
 
 
         # real robot controller node [need position_talker to be running]
@@ -57,13 +92,21 @@ def generate_launch_description():
             package='ros2_package',
             executable='real_controller',
             parameters=[
+                PathJoinSubstitution([FindPackageShare('ros2_package'), 'config', 'qos_profiles.yaml']),
                 {free_drive_parameter_name: free_drive},
                 {mapping_ratio_parameter_name: mapping_ratio},
                 {use_depth_parameter_name: use_depth},
                 {participant_parameter_name: participant},
                 {alpha_parameter_name: alpha},
-                {trajectory_parameter_name: trajectory}
+                {trajectory_parameter_name: trajectory},
+                {generator_parameter_name: generator},
+                {deadband_parameter_name: deadband},
+                {heartbeat_parameter_name: heartbeat},
+                {mapping_lut_parameter_name: mapping_lut},
+                {lut_gamma_parameter_name: lut_gamma},
+                placement.node_parameters(machine, 'real_controller')
             ],
+            prefix=placement.launch_prefix(machine, 'real_controller', in_process=True),
             output='screen',
             emulate_tty=True,
             name='real_controller'
@@ -0,0 +1,123 @@
+######################################################
+######################################################
+## FILE SUMMARY:
+##
+## - Review of a logged trial in RViz: the TrialPlayback node replays
+##   the csv log, the MarkerPublisher draws it like in the live session
+##   and the robot_state_publisher poses the Panda from the replayed joints
+##
+## - Control through the playback_control service, e.g.
+##   ros2 service call /playback_control tutorial_interfaces/srv/PlaybackControl "{command: 5, speed: 4.0}"
+##
+######################################################
+######################################################
+
+import os
+
+from ament_index_python.packages import get_package_share_directory
+from launch import LaunchDescription
+from launch.actions import DeclareLaunchArgument
+from launch.substitutions import LaunchConfiguration, PathJoinSubstitution
+from launch_ros.actions import Node
+from launch_ros.substitutions import FindPackageShare
+
+
+def generate_launch_description():
+
+    log_dir_parameter_name = 'log_dir'
+    participant_parameter_name = 'part_id'
+    trial_parameter_name = 'trial_number'
+    speed_parameter_name = 'speed'
+    loop_parameter_name = 'loop'
+    use_depth_parameter_name = 'use_depth'
+    generator_parameter_name = 'trajectory'
+
+    log_dir = LaunchConfiguration(log_dir_parameter_name)
+    participant = LaunchConfiguration(participant_parameter_name)
+    trial = LaunchConfiguration(trial_parameter_name)
+    speed = LaunchConfiguration(speed_parameter_name)
+    loop = LaunchConfiguration(loop_parameter_name)
+    use_depth = LaunchConfiguration(use_depth_parameter_name)
+    generator = LaunchConfiguration(generator_parameter_name)
+
+    qos_profiles = PathJoinSubstitution([FindPackageShare('ros2_package'), 'config', 'qos_profiles.yaml'])
+
+    with open(os.path.join(get_package_share_directory('ros2_package'), 'urdf', 'panda.urdf')) as f:
+        robot_description = f.read()
+
+    rviz_file = os.path.join(get_package_share_directory('franka_description'), 'rviz',
+                             'my_config.rviz')
+
+    return LaunchDescription([
+
+        DeclareLaunchArgument(
+            log_dir_parameter_name,
+            description='DataLogger directory (part<N>/trial<M>.csv)'),
+        DeclareLaunchArgument(
+            participant_parameter_name,
+            default_value='-1',
+            description='Participant of the trial loaded at startup'),
+        DeclareLaunchArgument(
+            trial_parameter_name,
+            default_value='-1',
+            description='Trial loaded at startup (-1 = wait for a LOAD request)'),
+        DeclareLaunchArgument(
+            speed_parameter_name,
+            default_value='1.0',
+            description='Playback speed, 0.1 - 50'),
+        DeclareLaunchArgument(
+            loop_parameter_name,
+            default_value='0',
+            description='Restart the trial when it ends'),
+        DeclareLaunchArgument(
+            use_depth_parameter_name,
+            default_value='0',
+            description='Draw the markers of a depth trial'),
+        DeclareLaunchArgument(
+            generator_parameter_name,
+            default_value='sines',
+            description='Trajectory generator spec the trial was run with (sines, spiral, lissajous, spline:file=...)'),
+
+        Node(
+            package='ros2_package',
+            executable='trial_playback',
+            parameters=[
+                qos_profiles,
+                {log_dir_parameter_name: log_dir},
+                {participant_parameter_name: participant},
+                {trial_parameter_name: trial},
+                {speed_parameter_name: speed},
+                {loop_parameter_name: loop},
+                {use_depth_parameter_name: use_depth},
+                {generator_parameter_name: generator}
+            ],
+            output='screen',
+            name='trial_playback'
+        ),
+
+        Node(
+            package='ros2_package',
+            executable='marker_publisher',
+            parameters=[
+                qos_profiles,
+                {use_depth_parameter_name: use_depth},
+                {generator_parameter_name: generator}
+            ],
+            name='marker_publisher'
+        ),
+
+        # joint_states -> TF of the Panda links (panda_hand_tcp for the tcp marker)
+        Node(
+            package='robot_state_publisher',
+            executable='robot_state_publisher',
+            parameters=[{'robot_description': robot_description}],
+            name='robot_state_publisher'
+        ),
+
+        Node(package='rviz2',
+             executable='rviz2',
+             name='rviz2',
+             arguments=['--display-config', rviz_file]
+             ),
+
+    ])
@@ -1,11 +1,18 @@
+import os
+
 from launch import LaunchDescription
-from launch.actions import DeclareLaunchArgument, IncludeLaunchDescription, ExecuteProcess
+from launch.actions import DeclareLaunchArgument, IncludeLaunchDescription, ExecuteProcess, EmitEvent, LogInfo, RegisterEventHandler
+from launch.actions import GroupAction, SetLaunchConfiguration, TimerAction
+from launch.conditions import IfCondition
+from launch.event_handlers import OnProcessExit
+from launch.events import Shutdown
 from launch.launch_description_sources import PythonLaunchDescriptionSource
 from launch.substitutions import LaunchConfiguration, PathJoinSubstitution
 from launch_ros.actions import Node
 from launch_ros.substitutions import FindPackageShare
 
 from ros2_package.exp_params import *
+from ros2_package import placement
 
 
 def generate_launch_description():
@@ -31,6 +38,11 @@ def generate_launch_description():
     participant_parameter_name = 'part_id'
     alpha_parameter_name = 'alpha_id'
     trajectory_parameter_name = 'traj_id'
+    generator_parameter_name = 'trajectory'
+    deadband_parameter_name = 'use_deadband'
+    heartbeat_parameter_name = 'deadband_heartbeat'
+    mapping_lut_parameter_name = 'mapping_lut'
+    lut_gamma_parameter_name = 'lut_gamma'
 
     free_drive = LaunchConfiguration(free_drive_parameter_name)
     mapping_ratio = LaunchConfiguration(mapping_ratio_parameter_name)
@@ -38,9 +50,29 @@ def generate_launch_description():
     participant = LaunchConfiguration(participant_parameter_name)
     alpha = LaunchConfiguration(alpha_parameter_name)
     trajectory = LaunchConfiguration(trajectory_parameter_name)
+    generator = LaunchConfiguration(generator_parameter_name)
+    deadband = LaunchConfiguration(deadband_parameter_name)
+    heartbeat = LaunchConfiguration(heartbeat_parameter_name)
+    mapping_lut = LaunchConfiguration(mapping_lut_parameter_name)
+    lut_gamma = LaunchConfiguration(lut_gamma_parameter_name)
+
+    ###### joint command upsampler (only useful with a 1 kHz controller reading desired_joint_vals_upsampled) ######
+    upsampler_parameter_name = 'use_upsampler'
+    use_upsampler = LaunchConfiguration(upsampler_parameter_name)
+
+    ###### pre-session self-test ######
+    session_dir_parameter_name = 'session_dir'
+    signing_key_parameter_name = 'signing_key_file'
 
+    session_dir = LaunchConfiguration(session_dir_parameter_name)
+    signing_key = LaunchConfiguration(signing_key_parameter_name)
 
-    return LaunchDescription([
+    ###### CPU placement (config/placement/<$AUTONOMY_MACHINE or host name>.yaml, None = nothing is placed) ######
+    placement_strict_parameter_name = 'placement_strict'
+    machine = placement.load_machine()
+
+
+    launch_arguments = [
         
         ###### franka_bringup franka.launch.py parameters ######
         DeclareLaunchArgument(
@@ -91,19 +123,74 @@ def generate_launch_description():
             trajectory_parameter_name,
             default_value=my_traj_id,
             description='Trajectory ID parameter'),
+        DeclareLaunchArgument(
+            generator_parameter_name,
+            default_value=my_trajectory,
+            description='Trajectory generator spec (sines, spiral, lissajous, spline:file=...)'),
+        DeclareLaunchArgument(
+            deadband_parameter_name,
+            default_value=my_use_deadband,
+            description='Perceptual deadband parameter'),
+        DeclareLaunchArgument(
+            heartbeat_parameter_name,
+            default_value=my_deadband_heartbeat,
+            description='Perceptual deadband heartbeat [s] (talker and controller)'),
+        DeclareLaunchArgument(
+            mapping_lut_parameter_name,
+            default_value=my_mapping_lut,
+            description='Calibrated Falcon -> robot lookup table (empty = the mapping ratio)'),
+        DeclareLaunchArgument(
+            lut_gamma_parameter_name,
+            default_value=my_lut_gamma,
+            description='Per-axis scaling of the lookup table, e.g. "[1.0, 1.0, 1.0]"'),
+        DeclareLaunchArgument(
+            session_dir_parameter_name,
+            default_value='{CSV_DIRECTORY}',
+            description='Directory the self-test report is written to'),
+        DeclareLaunchArgument(
+            signing_key_parameter_name,
+            default_value=os.path.join(os.path.expanduser('~'), '.ros', 'session_selftest.key'),
+            description='Key file used to sign the self-test report (the self-test fails without it)'),
+        DeclareLaunchArgument(
+            upsampler_parameter_name,
+            default_value='false',
+            description='Run the joint command upsampler (-> desired_joint_vals_upsampled), my_controller reads desired_joint_vals'),
+        DeclareLaunchArgument(
+            placement_strict_parameter_name,
+            default_value='0',
+            description='Stop the session when the CPU placement check fails (1) or only report it (0)'),
+    ]
+
+
+    # the Franka stack, its control node on the robot cores (launch-prefix-filter spares RViz and the state publishers)
+    franka_launch = IncludeLaunchDescription(
+        PythonLaunchDescriptionSource([PathJoinSubstitution(
+            [FindPackageShare('franka_bringup'), 'launch', 'franka.launch.py'])]),
+        launch_arguments={robot_ip_parameter_name: robot_ip,
+                          load_gripper_parameter_name: load_gripper,
+                          use_fake_hardware_parameter_name: use_fake_hardware,
+                          fake_sensor_commands_parameter_name: fake_sensor_commands,
+                          use_rviz_parameter_name: use_rviz
+                          }.items(),
+    )
+    robot_prefix = placement.launch_prefix(machine, 'ros2_control_node')
+    if robot_prefix:
+        franka_launch = GroupAction([
+            SetLaunchConfiguration('launch-prefix', robot_prefix),
+            SetLaunchConfiguration('launch-prefix-filter', 'ros2_control_node'),
+            franka_launch,
+        ])
+
 
+    # named QoS profile of every topic (config/qos_profiles.yaml)
+    qos_profiles = PathJoinSubstitution([FindPackageShare('ros2_package'), 'config', 'qos_profiles.yaml'])
+
+
+    # the whole session, only started once the self-test passed
+    session_actions = [
 
         ### franka_bringup launch ###
-        IncludeLaunchDescription(
-            PythonLaunchDescriptionSource([PathJoinSubstitution(
-                [FindPackageShare('franka_bringup'), 'launch', 'franka.launch.py'])]),
-            launch_arguments={robot_ip_parameter_name: robot_ip,
-                              load_gripper_parameter_name: load_gripper,
-                              use_fake_hardware_parameter_name: use_fake_hardware,
-                              fake_sensor_commands_parameter_name: fake_sensor_commands,
-                              use_rviz_parameter_name: use_rviz
-                              }.items(),
-        ),
+        franka_launch,
 
 
         ############################## OWN NODES ##############################
@@ -116,17 +203,36 @@ def generate_launch_description():
             output='screen',
         ),
 
+        # upsample the 500 Hz joint commands for a 1 kHz controller (-> desired_joint_vals_upsampled), off by default
+        Node(
+            package='ros2_package',
+            executable='joint_command_upsampler',
+            condition=IfCondition(use_upsampler),
+            parameters=[qos_profiles, placement.node_parameters(machine, 'joint_command_upsampler')],
+            prefix=placement.launch_prefix(machine, 'joint_command_upsampler', in_process=True),
+            output='screen',
+            emulate_tty=True,
+            name='joint_command_upsampler'
+        ),
+
         # activate Falcon node [need Falcon to be connected]
         Node(
             package='ros2_package',
             executable='position_talker',
             parameters=[
+                qos_profiles,
                 {mapping_ratio_parameter_name: mapping_ratio},
                 {use_depth_parameter_name: use_depth},
                 {participant_parameter_name: participant},
                 {alpha_parameter_name: alpha},
-                {trajectory_parameter_name: trajectory}
+                {trajectory_parameter_name: trajectory},
+                {deadband_parameter_name: deadband},
+                {heartbeat_parameter_name: heartbeat},
+                {mapping_lut_parameter_name: mapping_lut},
+                {lut_gamma_parameter_name: lut_gamma},
+                placement.node_parameters(machine, 'position_talker')
             ],
+            prefix=placement.launch_prefix(machine, 'position_talker', in_process=True),
             output='screen',
             emulate_tty=True,
             name='position_talker'
@@ -137,11 +243,15 @@ def generate_launch_description():
             package='ros2_package',
             executable='marker_publisher',
             parameters=[
+                qos_profiles,
                 {use_depth_parameter_name: use_depth},
                 {participant_parameter_name: participant},
                 {alpha_parameter_name: alpha},
-                {trajectory_parameter_name: trajectory}
+                {trajectory_parameter_name: trajectory},
+                {generator_parameter_name: generator},
+                placement.node_parameters(machine, 'marker_publisher')
             ],
+            prefix=placement.launch_prefix(machine, 'marker_publisher', in_process=True),
             output='screen',
             emulate_tty=True,
             name='marker_publisher'
@@ -157,8 +267,10 @@ def generate_launch_description():
                 {use_depth_parameter_name: use_depth},
                 {participant_parameter_name: participant},
                 {alpha_parameter_name: alpha},
-                {trajectory_parameter_name: trajectory}
+                {trajectory_parameter_name: trajectory},
+                {generator_parameter_name: generator}
             ],
+            prefix=placement.launch_prefix(machine, 'traj_recorder.py'),
             output='screen',
             emulate_tty=True
         ),
@@ -170,6 +282,20 @@ def generate_launch_description():
             name='const_br'
         ),
 
+        # clock of the external recording machines (eye tracker, tapping task) against the controller timeline
+        Node(
+            package='ros2_package',
+            executable='clock_sync_server',
+            parameters=[
+                qos_profiles,
+                {'offset_log': PathJoinSubstitution([session_dir, 'clock_offsets.csv'])}
+            ],
+            prefix=placement.launch_prefix(machine, 'clock_sync_server'),
+            output='screen',
+            emulate_tty=True,
+            name='clock_sync_server'
+        ),
+
         # publish recorded point cloud
         ExecuteProcess(
                 cmd=[
@@ -178,7 +304,58 @@ def generate_launch_description():
                     "play",
                     "{path_to_ros_bag_recording}",
                 ],
+                prefix=placement.launch_prefix(machine, 'ros2 bag'),
                 output="screen",
         )
 
+    ]
+
+
+    # place what the launch could not (e.g. the RViz of the Franka launch) and check the placement once everything
+    # runs [the controller is started separately, see controller.launch.py]
+    if machine is not None:
+        placement_check = ExecuteProcess(
+            cmd=['ros2', 'run', 'ros2_package', 'placement_check.py', '--apply',
+                 '--wait', '10', '--require', 'position_talker'],
+            output='screen'
+        )
+
+        def placement_checked(event, context):
+            if event.returncode == 0:
+                return []
+            if context.launch_configurations.get(placement_strict_parameter_name, '0') == '1':
+                return [LogInfo(msg='CPU placement check failed, stopping the session'),
+                        EmitEvent(event=Shutdown(reason='placement check failed'))]
+            return [LogInfo(msg='CPU placement check failed, the haptic / control threads are not isolated (see above)')]
+
+        session_actions += [
+            TimerAction(period=5.0, actions=[placement_check]),
+            RegisterEventHandler(OnProcessExit(target_action=placement_check, on_exit=placement_checked)),
+        ]
+
+
+    # machine check before anything else runs [needs the Falcon to be connected]
+    selftest_node = Node(
+        package='ros2_package',
+        executable='session_selftest',
+        parameters=[
+            {session_dir_parameter_name: session_dir},
+            {signing_key_parameter_name: signing_key},
+            {'use_falcon': 1}
+        ],
+        output='screen',
+        emulate_tty=True,
+        name='session_selftest'
+    )
+
+    def start_session(event, context):
+        if event.returncode == 0:
+            return session_actions
+        return [LogInfo(msg='Self-test failed (see the report in the session directory), not starting the session'),
+                EmitEvent(event=Shutdown(reason='self-test failed'))]
+
+
+    return LaunchDescription(launch_arguments + [
+        selftest_node,
+        RegisterEventHandler(OnProcessExit(target_action=selftest_node, on_exit=start_session)),
     ])
@@ -7,6 +7,8 @@ from launch.conditions import IfCondition
 from launch.substitutions import LaunchConfiguration
 from launch_ros.actions import Node
 
+from ros2_package import placement
+
 
 def generate_launch_description():
 
@@ -17,6 +19,9 @@ def generate_launch_description():
     rviz_file = os.path.join(get_package_share_directory('franka_description'), 'rviz',
                              'my_config.rviz')
 
+    # keep the rendering off the haptic / control cores (config/placement/<machine>.yaml)
+    machine = placement.load_machine()
+
     return LaunchDescription([
 
         DeclareLaunchArgument(
@@ -29,6 +34,7 @@ def generate_launch_description():
              executable='rviz2',
              name='rviz2',
              arguments=['--display-config', rviz_file],
+             prefix=placement.launch_prefix(machine, 'rviz2'),
              condition=IfCondition(use_rviz)
              ),
 
@@ -0,0 +1,199 @@
+######################################################
+######################################################
+## FILE SUMMARY:
+##
+## - One complete headless session: RealController against the
+##   SimRobot, driven by the SyntheticOperator, logged by the TrajRecorder
+##
+## - No Falcon, no robot, no RViz, so several sessions can run side by
+##   side, each in its own ROS_DOMAIN_ID (see scripts/session_runner.py)
+##
+## - The launch shuts down once the controller finishes its trial
+##
+######################################################
+######################################################
+
+from launch import LaunchDescription
+from launch.actions import DeclareLaunchArgument, EmitEvent, RegisterEventHandler
+from launch.event_handlers import OnProcessExit
+from launch.events import Shutdown
+from launch.substitutions import LaunchConfiguration, PathJoinSubstitution
+from launch_ros.actions import Node
+from launch_ros.substitutions import FindPackageShare
+
+from ros2_package.exp_params import *
+
+
+def generate_launch_description():
+
+    # my own launch arguments
+    free_drive_parameter_name = 'free_drive'
+    mapping_ratio_parameter_name = 'mapping_ratio'
+    use_depth_parameter_name = 'use_depth'
+    participant_parameter_name = 'part_id'
+    alpha_parameter_name = 'alpha_id'
+    trajectory_parameter_name = 'traj_id'
+    generator_parameter_name = 'trajectory'
+    deadband_parameter_name = 'use_deadband'
+
+    # session arguments
+    namespace_parameter_name = 'namespace'
+    csv_dir_parameter_name = 'csv_dir'
+    seed_parameter_name = 'seed'
+    urdf_path_parameter_name = 'urdf_path'
+    noise_dir_parameter_name = 'noise_dir'
+
+    free_drive = LaunchConfiguration(free_drive_parameter_name)
+    mapping_ratio = LaunchConfiguration(mapping_ratio_parameter_name)
+    use_depth = LaunchConfiguration(use_depth_parameter_name)
+    participant = LaunchConfiguration(participant_parameter_name)
+    alpha = LaunchConfiguration(alpha_parameter_name)
+    trajectory = LaunchConfiguration(trajectory_parameter_name)
+    generator = LaunchConfiguration(generator_parameter_name)
+    deadband = LaunchConfiguration(deadband_parameter_name)
+
+    namespace = LaunchConfiguration(namespace_parameter_name)
+    csv_dir = LaunchConfiguration(csv_dir_parameter_name)
+    seed = LaunchConfiguration(seed_parameter_name)
+    urdf_path = LaunchConfiguration(urdf_path_parameter_name)
+    noise_dir = LaunchConfiguration(noise_dir_parameter_name)
+
+    # named QoS profile of every topic (config/qos_profiles.yaml)
+    qos_profiles = PathJoinSubstitution([FindPackageShare('ros2_package'), 'config', 'qos_profiles.yaml'])
+    # both ends of the joint commands are in this package here (real_controller -> sim_robot)
+    command_qos = {'qos.desired_joint_vals': 'control'}
+
+    # real robot controller node, the session ends with it
+    controller_node = Node(
+        package='ros2_package',
+        executable='real_controller',
+        namespace=namespace,
+        parameters=[
+            qos_profiles,
+            command_qos,
+            {free_drive_parameter_name: free_drive},
+            {mapping_ratio_parameter_name: mapping_ratio},
+            {use_depth_parameter_name: use_depth},
+            {participant_parameter_name: participant},
+            {alpha_parameter_name: alpha},
+            {trajectory_parameter_name: trajectory},
+            {generator_parameter_name: generator},
+            {deadband_parameter_name: deadband},
+            {urdf_path_parameter_name: urdf_path},
+            {noise_dir_parameter_name: noise_dir}
+        ],
+        output='screen',
+        name='real_controller'
+    )
+
+
+    return LaunchDescription([
+
+        DeclareLaunchArgument(
+            free_drive_parameter_name,
+            default_value=my_free_drive,
+            description='Free drive parameter'),
+        DeclareLaunchArgument(
+            mapping_ratio_parameter_name,
+            default_value=my_mapping_ratio,
+            description='Mapping ratio parameter'),
+        DeclareLaunchArgument(
+            use_depth_parameter_name,
+            default_value=my_use_depth,
+            description='Use depth parameter'),
+        DeclareLaunchArgument(
+            participant_parameter_name,
+            default_value=my_part_id,
+            description='Participant ID parameter'),
+        DeclareLaunchArgument(
+            alpha_parameter_name,
+            default_value=my_alpha_id,
+            description='Alpha ID parameter'),
+        DeclareLaunchArgument(
+            trajectory_parameter_name,
+            default_value=my_traj_id,
+            description='Trajectory ID parameter'),
+        DeclareLaunchArgument(
+            generator_parameter_name,
+            default_value=my_trajectory,
+            description='Trajectory generator spec (sines, spiral, lissajous, spline:file=...)'),
+        DeclareLaunchArgument(
+            deadband_parameter_name,
+            default_value=my_use_deadband,
+            description='Perceptual deadband parameter'),
+
+        DeclareLaunchArgument(
+            namespace_parameter_name,
+            default_value='',
+            description='Namespace of every node of the session'),
+        DeclareLaunchArgument(
+            csv_dir_parameter_name,
+            default_value='{CSV_DIRECTORY}',
+            description='Directory the trial csv files are written to'),
+        DeclareLaunchArgument(
+            seed_parameter_name,
+            default_value='0',
+            description='Random seed of the synthetic operator'),
+        DeclareLaunchArgument(
+            urdf_path_parameter_name,
+            default_value='',
+            description='Panda URDF used for the kinematics (empty = the chain compiled in at build time)'),
+        DeclareLaunchArgument(
+            noise_dir_parameter_name,
+            default_value=PathJoinSubstitution([FindPackageShare('ros2_package'), 'noise']),
+            description='Directory of the robot noise csv files'),
+
+
+        controller_node,
+
+        # headless robot (-> franka/joint_states)
+        Node(
+            package='ros2_package',
+            executable='sim_robot',
+            namespace=namespace,
+            parameters=[qos_profiles, command_qos],
+            output='screen',
+            name='sim_robot'
+        ),
+
+        # simulated participant (-> falcon_position)
+        Node(
+            package='ros2_package',
+            executable='synthetic_operator',
+            namespace=namespace,
+            parameters=[
+                qos_profiles,
+                {mapping_ratio_parameter_name: mapping_ratio},
+                {seed_parameter_name: seed}
+            ],
+            output='screen',
+            name='synthetic_operator'
+        ),
+
+        # trajectory recorder node
+        Node(
+            package='ros2_package',
+            executable='traj_recorder.py',
+            namespace=namespace,
+            parameters=[
+                {free_drive_parameter_name: free_drive},
+                {mapping_ratio_parameter_name: mapping_ratio},
+                {use_depth_parameter_name: use_depth},
+                {participant_parameter_name: participant},
+                {alpha_parameter_name: alpha},
+                {trajectory_parameter_name: trajectory},
+                {generator_parameter_name: generator},
+                {csv_dir_parameter_name: csv_dir}
+            ],
+            output='screen'
+        ),
+
+        # end the session when the trial is over
+        RegisterEventHandler(
+            OnProcessExit(
+                target_action=controller_node,
+                on_exit=[EmitEvent(event=Shutdown(reason='trial finished'))]
+            )
+        ),
+
+    ])
@@ -20,7 +20,9 @@
 
 from csv import writer, DictReader, DictWriter
 from os.path import isfile
-from math import sqrt
+from numpy import column_stack
+
+from ros2_package.kernels import tracking_errors
 
 
 #####################################################################################################
@@ -28,7 +30,7 @@ class DataLogger:
 
     def __init__(self, csv_dir, part_id, alpha_id, traj_id, 
                  refxs, refys, refzs, hxs, hys, hzs, rxs, rys, rzs, txs, tys, tzs, 
-                 times_from_start, times, datetimes):
+                 times_from_start, times, datetimes, nominal_times_from_start=None):
         
         # trial info
         self.csv_dir = csv_dir
@@ -58,7 +60,8 @@ class DataLogger:
         self.tzs = tzs
 
         # other info
-        self.times_from_start = times_from_start
+        self.times_from_start = times_from_start       # measured on the controller's monotonic clock
+        self.nominal_times_from_start = nominal_times_from_start if nominal_times_from_start is not None else times_from_start
         self.times = times
         self.datetimes = datetimes
 
@@ -72,30 +75,21 @@ class DataLogger:
     def calc_error(self, use_depth):
         
         ########################################### THESE GO INTO THE 400-LINE FILE ###########################################
-        # human error lists in each dim
-        self.hx_err_list = [abs(self.hxs[i] - self.refxs[i]) for i in range(self.num_points)]
-        self.hy_err_list = [abs(self.hys[i] - self.refys[i]) for i in range(self.num_points)]
-        self.hz_err_list = [abs(self.hzs[i] - self.refzs[i]) for i in range(self.num_points)]
-
-        # robot error lists in each dim
-        self.rx_err_list = [abs(self.rxs[i] - self.refxs[i]) for i in range(self.num_points)]
-        self.ry_err_list = [abs(self.rys[i] - self.refys[i]) for i in range(self.num_points)]
-        self.rz_err_list = [abs(self.rzs[i] - self.refzs[i]) for i in range(self.num_points)]
-
-        # overall error lists in each dim
-        self.tx_err_list = [abs(self.txs[i] - self.refxs[i]) for i in range(self.num_points)]
-        self.ty_err_list = [abs(self.tys[i] - self.refys[i]) for i in range(self.num_points)]
-        self.tz_err_list = [abs(self.tzs[i] - self.refzs[i]) for i in range(self.num_points)]
-
-        # human, robot & overall Euclidean norm error list
-        if use_depth:
-            self.h_err_list = [sqrt((self.hx_err_list[i])**2 + (self.hy_err_list[i])**2 + (self.hz_err_list[i])**2) for i in range(self.num_points)]
-            self.r_err_list = [sqrt((self.rx_err_list[i])**2 + (self.ry_err_list[i])**2 + (self.rz_err_list[i])**2) for i in range(self.num_points)]
-            self.t_err_list = [sqrt((self.tx_err_list[i])**2 + (self.ty_err_list[i])**2 + (self.tz_err_list[i])**2) for i in range(self.num_points)]
-        else:
-            self.h_err_list = [sqrt((self.hy_err_list[i])**2 + (self.hz_err_list[i])**2) for i in range(self.num_points)]
-            self.r_err_list = [sqrt((self.ry_err_list[i])**2 + (self.rz_err_list[i])**2) for i in range(self.num_points)]
-            self.t_err_list = [sqrt((self.ty_err_list[i])**2 + (self.tz_err_list[i])**2) for i in range(self.num_points)]
+        ref = column_stack((self.refxs, self.refys, self.refzs))
+
+        # human, robot & overall error lists in each dim, and their Euclidean norm
+        # (same kernel as the controllers, NumPy fallback without the C++ module)
+        h_dim_err, h_err = tracking_errors(column_stack((self.hxs, self.hys, self.hzs)), ref, use_depth)
+        r_dim_err, r_err = tracking_errors(column_stack((self.rxs, self.rys, self.rzs)), ref, use_depth)
+        t_dim_err, t_err = tracking_errors(column_stack((self.txs, self.tys, self.tzs)), ref, use_depth)
+
+        self.hx_err_list, self.hy_err_list, self.hz_err_list = [h_dim_err[:, k].tolist() for k in range(3)]
+        self.rx_err_list, self.ry_err_list, self.rz_err_list = [r_dim_err[:, k].tolist() for k in range(3)]
+        self.tx_err_list, self.ty_err_list, self.tz_err_list = [t_dim_err[:, k].tolist() for k in range(3)]
+
+        self.h_err_list = h_err.tolist()
+        self.r_err_list = r_err.tolist()
+        self.t_err_list = t_err.tolist()
 
         ########################################### THESE GO INTO THE HEADER FILE ###########################################
 
@@ -207,7 +201,8 @@ class DataLogger:
                              self.hx_err_list[i], self.hy_err_list[i], self.hz_err_list[i],
                              self.rx_err_list[i], self.ry_err_list[i], self.rz_err_list[i],
                              self.tx_err_list[i], self.ty_err_list[i], self.tz_err_list[i],
-                             self.times_from_start[i], self.times[i], self.datetimes[i]])
+                             self.times_from_start[i], self.times[i], self.datetimes[i],
+                             self.nominal_times_from_start[i]])
 
             print("\nSuccesfully opened file %s and finished logging data !!!\n" % self.data_file_name)
 
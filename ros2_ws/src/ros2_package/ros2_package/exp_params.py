@@ -3,4 +3,9 @@ my_mapping_ratio = '3.0'
 my_use_depth = '0'
 my_part_id = '0'
 my_alpha_id = '0'
-my_traj_id = '0'
\ No newline at end of file
+my_traj_id = '0'
+my_use_deadband = '0'
+my_deadband_heartbeat = '0.1'
+my_mapping_lut = ''
+my_lut_gamma = '[1.0, 1.0, 1.0]'
+my_trajectory = 'sines'
@@ -0,0 +1,90 @@
+######################################################
+######################################################
+## FILE SUMMARY:
+##
+## - Array kernels of the Python side: trajectory, blend,
+##   tracking errors and Panda kinematics
+##
+## - Uses the C++ module ros2_package._kernels (the same
+##   code the controllers run) when it was built, and falls
+##   back to NumPy otherwise (no fk / ik without the module)
+##
+## - Points are (n, 3) float64 arrays, float64 C-contiguous
+##   inputs are passed to C++ without a copy
+##
+######################################################
+######################################################
+
+import numpy as np
+
+try:
+    from ros2_package import _kernels
+    HAVE_CPP_KERNELS = True
+except ImportError:
+    _kernels = None
+    HAVE_CPP_KERNELS = False
+
+
+####################################################################################
+def sine_ref_points(n_points: int, a, b, c, s, h, height, width, depth, origin, use_depth: int) -> np.ndarray:
+
+    if HAVE_CPP_KERNELS:
+        return _kernels.sine_ref_points(n_points, a, b, c, s, h, height, width, depth, np.asarray(origin, dtype=float), use_depth)
+
+    theta = np.linspace(0, 2*np.pi, n_points)
+    points = np.zeros((n_points, 3))
+    if use_depth == 1:
+        points[:, 0] = np.absolute(theta-np.pi)/np.pi*depth - (depth/2)
+    points[:, 1] = theta/(2*np.pi)*width - (width/2)
+    points[:, 2] = (h*height) * (np.sin(a*(theta+s)) + np.sin(b*(theta+s)) + np.sin(c*(theta+s)))
+    return points + np.asarray(origin, dtype=float)
+
+
+####################################################################################
+def trajectory_points(spec: str, traj_id: int, use_depth: int, n_points: int, origin) -> np.ndarray:
+    """ reference of a trajectory generator spec (include/ros2_package/trajectory_generators.hpp), shape (n_points, 3) """
+
+    if not HAVE_CPP_KERNELS:
+        raise RuntimeError("trajectory_points needs the C++ module ros2_package._kernels (build the package with pybind11)")
+    return _kernels.trajectory_points(spec, traj_id, use_depth, n_points, np.asarray(origin, dtype=float))
+
+
+####################################################################################
+def blend(alpha, human, robot, origin) -> np.ndarray:
+
+    if HAVE_CPP_KERNELS:
+        return _kernels.blend(alpha, human, robot, origin)
+
+    alpha = np.asarray(alpha, dtype=float)
+    return np.asarray(origin, dtype=float) + alpha * np.asarray(human, dtype=float) + (1-alpha) * np.asarray(robot, dtype=float)
+
+
+####################################################################################
+def tracking_errors(pos, ref, use_depth: int):
+    """ per-axis errors (n, 3) and Euclidean errors (n,), x left out of the norm without depth """
+
+    if HAVE_CPP_KERNELS:
+        return _kernels.tracking_errors(pos, ref, use_depth)
+
+    dim_err = np.absolute(np.asarray(pos, dtype=float) - np.asarray(ref, dtype=float)).reshape(-1, 3)
+    if use_depth:
+        norm_err = np.sqrt(dim_err[:, 0]*dim_err[:, 0] + dim_err[:, 1]*dim_err[:, 1] + dim_err[:, 2]*dim_err[:, 2])
+    else:
+        norm_err = np.sqrt(dim_err[:, 1]*dim_err[:, 1] + dim_err[:, 2]*dim_err[:, 2])
+    return dim_err, norm_err
+
+
+####################################################################################
+def fk(q) -> np.ndarray:
+
+    if not HAVE_CPP_KERNELS:
+        raise RuntimeError("fk needs the C++ module ros2_package._kernels (build the package with pybind11)")
+    return _kernels.fk(q)
+
+
+####################################################################################
+def ik(targets, seed) -> np.ndarray:
+
+    if not HAVE_CPP_KERNELS:
+        raise RuntimeError("ik needs the C++ module ros2_package._kernels (build the package with pybind11)")
+    return _kernels.ik(targets, seed)
@@ -0,0 +1,159 @@
+######################################################
+######################################################
+## FILE SUMMARY:
+##
+## - CPU placement of the session processes, from one config
+##   file per machine: config/placement/<machine>.yaml
+##   (machine = $AUTONOMY_MACHINE, or the host name)
+##
+## - Main functionalities:
+##   1. load_machine(): the placement of this machine, None if it
+##      has no file (the launch files then place nothing)
+##   2. node_parameters(): the "placement_*" parameters of our own
+##      C++ nodes, which place their threads themselves
+##      (include/ros2_package/thread_placement.hpp)
+##   3. launch_prefix(): taskset / chrt / nice (and an optional
+##      systemd scope with a cpuset) for the other processes
+##   4. core topology helpers shared with scripts/placement_check.py
+##
+######################################################
+######################################################
+
+import os
+import socket
+
+import yaml
+
+
+POLICIES = ['other', 'batch', 'idle', 'fifo', 'rr']
+REALTIME_POLICIES = ['fifo', 'rr']
+
+
+####################################################################################
+def config_dir():
+    try:
+        from ament_index_python.packages import get_package_share_directory
+        return os.path.join(get_package_share_directory('ros2_package'), 'config', 'placement')
+    except Exception:
+        # source tree
+        return os.path.join(os.path.dirname(os.path.dirname(os.path.abspath(__file__))), 'config', 'placement')
+
+
+def machine_name():
+    return os.environ.get('AUTONOMY_MACHINE') or socket.gethostname()
+
+
+def load_machine(machine=None, path=None):
+    """ placement dict of the machine (or of the file at path), None if there is none """
+
+    if path is None:
+        path = os.path.join(config_dir(), '%s.yaml' % (machine or machine_name()))
+        if not os.path.isfile(path):
+            return None
+
+    with open(path) as f:
+        config = yaml.safe_load(f) or {}
+
+    config.setdefault('machine', os.path.splitext(os.path.basename(path))[0])
+    config.setdefault('roles', {})
+    config.setdefault('isolated', [])
+    config.setdefault('processes', {})
+    config.setdefault('cpuset', False)
+
+    for name, role in config['roles'].items():
+        role.setdefault('cpus', [])
+        role.setdefault('policy', 'other')
+        role.setdefault('priority', 0)
+        if role['policy'] not in POLICIES:
+            raise ValueError("%s: unknown policy '%s' of role %s" % (path, role['policy'], name))
+    for process, role in config['processes'].items():
+        if role not in config['roles']:
+            raise ValueError("%s: process %s has the unknown role %s" % (path, process, role))
+    for role in config['isolated']:
+        if role not in config['roles']:
+            raise ValueError("%s: unknown isolated role %s" % (path, role))
+    return config
+
+
+def process_role(config, process):
+    if config is None or process not in config['processes']:
+        return None, None
+    name = config['processes'][process]
+    return name, config['roles'][name]
+
+
+####################################################################################
+def node_parameters(config, process):
+    """ parameters of one of our C++ nodes ({} = not placed) """
+
+    name, role = process_role(config, process)
+    if role is None:
+        return {}
+    return {'placement_role': name,
+            'placement_cpus': [int(c) for c in role['cpus']],
+            'placement_policy': role['policy'],
+            'placement_priority': int(role['priority'])}
+
+
+def cpu_list(cpus):
+    return ','.join(str(c) for c in cpus)
+
+
+def launch_prefix(config, process, in_process=False):
+    """ launch prefix of a process (None = not placed), in_process = the node places its threads itself """
+
+    name, role = process_role(config, process)
+    if role is None:
+        return None
+
+    prefix = []
+    if config['cpuset'] and role['cpus']:
+        # cgroup v2 cpuset, needs the cpuset controller delegated to the user session
+        prefix += ['systemd-run', '--user', '--scope', '--quiet', '-p', 'AllowedCPUs=%s' % cpu_list(role['cpus'])]
+    if not in_process:
+        if role['cpus']:
+            prefix += ['taskset', '-c', cpu_list(role['cpus'])]
+        if role['policy'] in REALTIME_POLICIES:
+            prefix += ['chrt', '--' + role['policy'], str(role['priority'])]
+        elif role['policy'] != 'other':
+            prefix += ['chrt', '--' + role['policy'], '0']
+        if role['policy'] not in REALTIME_POLICIES and role['priority'] != 0:
+            prefix += ['nice', '-n', str(role['priority'])]
+    return ' '.join(prefix) if prefix else None
+
+
+####################################################################################
+def core_siblings(cpu):
+    """ logical cpus sharing the physical core of cpu (SMT), cpu itself included """
+
+    path = '/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list' % cpu
+    try:
+        with open(path) as f:
+            return parse_cpu_list(f.read())
+    except OSError:
+        return {cpu}
+
+
+def parse_cpu_list(text):
+    """ '0-2,5' -> {0, 1, 2, 5} """
+
+    cpus = set()
+    for part in text.strip().split(','):
+        if not part:
+            continue
+        if '-' in part:
+            first, last = part.split('-')
+            cpus.update(range(int(first), int(last) + 1))
+        else:
+            cpus.add(int(part))
+    return cpus
+
+
+def isolated_cpus():
+    """ cpus taken out of the scheduler by the isolcpus= kernel argument """
+
+    try:
+        with open('/sys/devices/system/cpu/isolated') as f:
+            return parse_cpu_list(f.read())
+    except OSError:
+        return set()
@@ -2,28 +2,19 @@ from numpy import matrix, pi, ndarray, linspace, sin, cos, stack, asarray, absol
 # from math import sin, cos
 import matplotlib.pyplot as plt
 
+from ros2_package.kernels import sine_ref_points
+
 
 ####################################################################################
 def get_sine_ref_points(n_points: int, a, b, c, s, h, height, width, depth, origin: list[float], use_depth: int):
 
-    ampz = h * height
-
-    theta = linspace(0, 2*pi, n_points)
-    npx = zeros(n_points)
-    if use_depth == 1:
-        npx = absolute(asarray(theta-pi))/pi*depth - (depth/2)
-    npy = theta/(2*pi)*width - (width/2)
-    npz = ampz * (sin(a*(theta+s)) + sin(b*(theta+s)) + sin(c*(theta+s)))
+    # same kernel as the controllers (NumPy fallback without the C++ module)
+    points = sine_ref_points(n_points, a, b, c, s, h, height, width, depth, origin, use_depth)
 
     # extract each dimension vector and convert to python list
-    x = npx.tolist()
-    y = npy.tolist()
-    z = npz.tolist()
-
-    for i in range(n_points):
-        x[i] += origin[0]
-        y[i] += origin[1]
-        z[i] += origin[2]
+    x = points[:, 0].tolist()
+    y = points[:, 1].tolist()
+    z = points[:, 2].tolist()
 
     return x, y, z
 
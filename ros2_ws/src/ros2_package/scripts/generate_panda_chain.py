@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+
+######################################################
+######################################################
+## FILE SUMMARY:
+##
+## - Build step (called from CMakeLists.txt) compiling the
+##   panda_link0 -> panda_grasptarget chain of panda.urdf into a
+##   C++ header, so the controllers never parse the URDF at startup
+##
+## - The URDF is validated here, and the build fails if the chain is
+##   missing or does not have the 7 limited revolute joints of the arm
+##
+## - The header carries the sha256 of the source URDF, printed by the
+##   controllers so every log says which model was used
+##
+## - Usage:
+##   generate_panda_chain.py <panda.urdf> <output.hpp>
+##
+######################################################
+######################################################
+
+import hashlib
+import os
+import sys
+import xml.etree.ElementTree as ET
+
+from math import cos, sin
+
+
+BASE_LINK = "panda_link0"
+TIP_LINK = "panda_grasptarget"
+N_ARM_JOINTS = 7
+
+
+##############################################################################
+def fail(message):
+    sys.stderr.write("generate_panda_chain.py: error: %s\n" % message)
+    sys.exit(1)
+
+
+##############################################################################
+def parse_floats(text, n, what):
+    values = [float(v) for v in text.split()]
+    if len(values) != n:
+        fail("%s should have %d values, got '%s'" % (what, n, text))
+    return values
+
+
+##############################################################################
+def rpy_to_matrix(r, p, y):
+    """ row-major rotation matrix of the URDF roll-pitch-yaw (same as KDL::Rotation::RPY) """
+
+    cr, sr = cos(r), sin(r)
+    cp, sp = cos(p), sin(p)
+    cy, sy = cos(y), sin(y)
+    return [cy * cp, cy * sp * sr - sy * cr, cy * sp * cr + sy * sr,
+            sy * cp, sy * sp * sr + cy * cr, sy * sp * cr - cy * sr,
+            -sp,     cp * sr,                cp * cr]
+
+
+##############################################################################
+def read_chain(urdf_file_name):
+    """ joints from BASE_LINK to TIP_LINK, in order """
+
+    root = ET.parse(urdf_file_name).getroot()
+
+    # child link -> joint element
+    joint_of_child = {}
+    for joint in root.findall('joint'):
+        child = joint.find('child')
+        if child is None or joint.find('parent') is None:
+            fail("joint %s has no parent or child" % joint.get('name'))
+        joint_of_child[child.get('link')] = joint
+
+    # walk up from the tip
+    chain = []
+    link = TIP_LINK
+    while link != BASE_LINK:
+        if link not in joint_of_child:
+            fail("no chain from %s to %s (stuck at %s)" % (BASE_LINK, TIP_LINK, link))
+        joint = joint_of_child[link]
+        chain.append(joint)
+        link = joint.find('parent').get('link')
+    chain.reverse()
+
+    joints = []
+    for joint in chain:
+        name = joint.get('name')
+        joint_type = joint.get('type')
+        if joint_type not in ('revolute', 'fixed'):
+            fail("joint %s is of unsupported type %s" % (name, joint_type))
+
+        origin = joint.find('origin')
+        xyz = parse_floats(origin.get('xyz', '0 0 0'), 3, name + " origin xyz") if origin is not None else [0.0] * 3
+        rpy = parse_floats(origin.get('rpy', '0 0 0'), 3, name + " origin rpy") if origin is not None else [0.0] * 3
+
+        entry = {'joint': name, 'link': joint.find('child').get('link'), 'fixed': joint_type == 'fixed',
+                 'R': rpy_to_matrix(*rpy), 'p': xyz, 'axis': [0.0, 0.0, 0.0], 'lower': 0.0, 'upper': 0.0}
+
+        if not entry['fixed']:
+            axis = joint.find('axis')
+            entry['axis'] = parse_floats(axis.get('xyz'), 3, name + " axis") if axis is not None else [1.0, 0.0, 0.0]
+            if sum(a * a for a in entry['axis']) < 1e-12:
+                fail("joint %s has a zero axis" % name)
+            limit = joint.find('limit')
+            if limit is None or limit.get('lower') is None or limit.get('upper') is None:
+                fail("revolute joint %s has no position limits" % name)
+            entry['lower'] = float(limit.get('lower'))
+            entry['upper'] = float(limit.get('upper'))
+            if entry['lower'] >= entry['upper']:
+                fail("joint %s has an empty range [%g, %g]" % (name, entry['lower'], entry['upper']))
+        joints.append(entry)
+
+    n_movable = sum(not j['fixed'] for j in joints)
+    if n_movable != N_ARM_JOINTS:
+        fail("expected %d revolute joints between %s and %s, found %d" % (N_ARM_JOINTS, BASE_LINK, TIP_LINK, n_movable))
+    return joints
+
+
+##############################################################################
+def fmt(values):
+    return "{" + ", ".join(repr(float(v)) for v in values) + "}"
+
+
+##############################################################################
+def write_header(out_file_name, urdf_file_name, joints):
+
+    with open(urdf_file_name, 'rb') as f:
+        digest = hashlib.sha256(f.read()).hexdigest()
+
+    lines = []
+    lines.append("// generated by scripts/generate_panda_chain.py from %s, do not edit" % os.path.basename(urdf_file_name))
+    lines.append("")
+    lines.append("#ifndef ROS2_PACKAGE__PANDA_CHAIN_DATA_HPP_")
+    lines.append("#define ROS2_PACKAGE__PANDA_CHAIN_DATA_HPP_")
+    lines.append("")
+    lines.append("#include <cstddef>")
+    lines.append("")
+    lines.append("namespace ros2_package")
+    lines.append("{")
+    lines.append("")
+    lines.append("struct PandaChainJoint")
+    lines.append("{")
+    lines.append("  const char * joint;")
+    lines.append("  const char * link;     // child link = KDL segment name")
+    lines.append("  bool fixed;")
+    lines.append("  double R[9];           // joint origin in the parent link frame, row-major")
+    lines.append("  double p[3];")
+    lines.append("  double axis[3];        // in the joint frame")
+    lines.append("  double lower;          // [rad]")
+    lines.append("  double upper;")
+    lines.append("};")
+    lines.append("")
+    lines.append("static const char panda_urdf_sha256[] = \"%s\";" % digest)
+    lines.append("static const char panda_chain_base[] = \"%s\";" % BASE_LINK)
+    lines.append("static const char panda_chain_tip[] = \"%s\";" % TIP_LINK)
+    lines.append("")
+    lines.append("static const PandaChainJoint panda_chain_joints[] = {")
+    for j in joints:
+        lines.append("  {\"%s\", \"%s\", %s, %s, %s, %s, %r, %r}," % (j['joint'], j['link'], 'true' if j['fixed'] else 'false',
+                                                                  fmt(j['R']), fmt(j['p']), fmt(j['axis']), j['lower'], j['upper']))
+    lines.append("};")
+    lines.append("")
+    lines.append("static const size_t n_panda_chain_joints = %d;" % len(joints))
+    lines.append("static const size_t n_panda_chain_movable = %d;" % N_ARM_JOINTS)
+    lines.append("")
+    lines.append("}  // namespace ros2_package")
+    lines.append("")
+    lines.append("#endif  // ROS2_PACKAGE__PANDA_CHAIN_DATA_HPP_")
+
+    # only touch the output when it changes, so nothing rebuilds needlessly
+    text = "\n".join(lines) + "\n"
+    if os.path.isfile(out_file_name):
+        with open(out_file_name, 'r') as f:
+            if f.read() == text:
+                return
+    os.makedirs(os.path.dirname(os.path.abspath(out_file_name)), exist_ok=True)
+    with open(out_file_name, 'w') as f:
+        f.write(text)
+
+
+##############################################################################
+def main():
+    if len(sys.argv) != 3:
+        fail("usage: generate_panda_chain.py <panda.urdf> <output.hpp>")
+    try:
+        joints = read_chain(sys.argv[1])
+    except (ET.ParseError, OSError, ValueError) as e:
+        fail("cannot read %s: %s" % (sys.argv[1], e))
+    write_header(sys.argv[2], sys.argv[1], joints)
+
+
+if __name__ == '__main__':
+    main()
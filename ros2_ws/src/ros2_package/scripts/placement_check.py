@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+
+######################################################
+######################################################
+## FILE SUMMARY:
+##
+## - Checks the CPU placement of a running session against the
+##   config file of the machine (config/placement/<machine>.yaml)
+##
+## - Main functionalities:
+##   1. Finds the configured processes in /proc and reads the affinity,
+##      scheduling policy and priority of every one of their threads
+##   2. Reports the threads placed differently from their role
+##   3. Verifies that the isolated roles (haptic, control) do not share a
+##      physical core (SMT siblings included) with any thread of the other
+##      roles, and counts the unconfigured threads allowed on their cores
+##      (only isolcpus= or a cpuset keeps those away)
+##   4. --apply first places the threads of the processes the launch files
+##      could not place themselves (e.g. the RViz of the Franka launch)
+##   5. Exits with 1 on a violation, started by real.launch.py once the
+##      session is up
+##
+## - Usage:
+##   placement_check.py [--machine control_laptop] [--apply] [--wait 10] [--require position_talker real_controller]
+##
+######################################################
+######################################################
+
+import argparse
+import os
+import sys
+import time
+
+from ros2_package import placement
+
+
+POLICY_NAMES = {os.SCHED_OTHER: 'other', os.SCHED_BATCH: 'batch', os.SCHED_IDLE: 'idle',
+                os.SCHED_FIFO: 'fifo', os.SCHED_RR: 'rr'}
+POLICIES = {name: policy for (policy, name) in POLICY_NAMES.items()}
+
+
+####################################################################################
+def command_words(pid):
+    """ basenames of the command line arguments, joined by spaces """
+
+    try:
+        with open('/proc/%d/cmdline' % pid, 'rb') as f:
+            args = f.read().split(b'\0')
+    except OSError:
+        return ''
+    return ' '.join(os.path.basename(a.decode(errors='replace')) for a in args if a)
+
+
+def thread_state(pid, tid):
+    try:
+        with open('/proc/%d/task/%d/comm' % (pid, tid)) as f:
+            comm = f.read().strip()
+        policy = os.sched_getscheduler(tid)
+        priority = os.sched_getparam(tid).sched_priority
+        if policy not in (os.SCHED_FIFO, os.SCHED_RR):
+            priority = os.getpriority(os.PRIO_PROCESS, tid)
+        return {'tid': tid, 'comm': comm, 'cpus': set(os.sched_getaffinity(tid)),
+                'policy': POLICY_NAMES.get(policy, str(policy)), 'priority': priority}
+    except OSError:
+        return None    # the thread has exited
+
+
+def threads_of(pid):
+    try:
+        tids = [int(t) for t in os.listdir('/proc/%d/task' % pid)]
+    except OSError:
+        return []
+    return [s for s in (thread_state(pid, tid) for tid in tids) if s is not None]
+
+
+def find_processes(config):
+    """ {pid: (process key, words)} of the configured processes, the longest matching key wins """
+
+    own = os.getpid()
+    keys = sorted(config['processes'], key=len, reverse=True)
+    found = {}
+    for entry in os.listdir('/proc'):
+        if not entry.isdigit() or int(entry) == own:
+            continue
+        words = command_words(int(entry))
+        for key in keys:
+            if (' %s ' % key) in (' %s ' % words):
+                found[int(entry)] = (key, words)
+                break
+    return found
+
+
+####################################################################################
+def apply(config):
+    """ places every thread of the configured processes, returns the number of failures """
+
+    failed = 0
+    for pid, (key, _) in find_processes(config).items():
+        role = config['roles'][config['processes'][key]]
+        realtime = role['policy'] in placement.REALTIME_POLICIES
+        for t in threads_of(pid):
+            try:
+                if role['cpus']:
+                    os.sched_setaffinity(t['tid'], role['cpus'])
+                os.sched_setscheduler(t['tid'], POLICIES[role['policy']], os.sched_param(role['priority'] if realtime else 0))
+                if not realtime:
+                    os.setpriority(os.PRIO_PROCESS, t['tid'], role['priority'])
+            except OSError as e:
+                failed += 1
+                print("Could not place %s (pid %d) thread %s (%d): %s" % (key, pid, t['comm'], t['tid'], e))
+    return failed
+
+
+####################################################################################
+def check(config, args):
+
+    violations = []
+    processes = find_processes(config)
+    running = {key for (key, _) in processes.values()}
+
+    for key in args.require:
+        if key not in running:
+            violations.append("%s is not running" % key)
+
+    print("\nPlacement of machine '%s'\n" % config['machine'])
+    print("%-24s %-10s %7s %-16s %-8s %-10s %s" % ('process', 'role', 'pid', 'thread', 'policy', 'cpus', 'status'))
+
+    # cores actually used by the threads of every role
+    role_cpus = {name: set() for name in config['roles']}
+    placed_tids = set()
+
+    for pid, (key, _) in sorted(processes.items()):
+        name = config['processes'][key]
+        role = config['roles'][name]
+        want_cpus = set(role['cpus'])
+
+        for t in threads_of(pid):
+            placed_tids.add(t['tid'])
+            role_cpus[name] |= t['cpus']
+
+            problems = []
+            if want_cpus and not t['cpus'] <= want_cpus:
+                problems.append('cpus %s, expected %s' % (placement.cpu_list(sorted(t['cpus'])), placement.cpu_list(sorted(want_cpus))))
+            if t['policy'] != role['policy']:
+                problems.append('policy %s, expected %s' % (t['policy'], role['policy']))
+            elif t['priority'] != role['priority']:
+                problems.append('priority %d, expected %d' % (t['priority'], role['priority']))
+
+            for p in problems:
+                violations.append("%s (pid %d) thread %s (%d): %s" % (key, pid, t['comm'], t['tid'], p))
+            if problems or args.verbose:
+                print("%-24s %-10s %7d %-16s %-8s %-10s %s" % (key, name, pid, t['comm'], '%s %d' % (t['policy'], t['priority']),
+                                                             placement.cpu_list(sorted(t['cpus'])), '; '.join(problems) or 'ok'))
+        if not args.verbose:
+            print("%-24s %-10s %7d %-16s" % (key, name, pid, '%d threads' % len(threads_of(pid))))
+
+    # isolation, on physical cores
+    print()
+    isolcpus = placement.isolated_cpus()
+    for name in config['isolated']:
+        cores = set()
+        for cpu in config['roles'][name]['cpus'] or role_cpus[name]:
+            cores |= placement.core_siblings(cpu)
+
+        for other, cpus in role_cpus.items():
+            if other != name and cpus & cores:
+                violations.append("role %s shares cpus %s with the isolated role %s" % (other, placement.cpu_list(sorted(cpus & cores)), name))
+
+        # everything else on the machine that may run on the isolated cores
+        intruders = 0
+        for entry in os.listdir('/proc'):
+            if not entry.isdigit() or int(entry) in processes:
+                continue
+            for t in threads_of(int(entry)):
+                if t['tid'] not in placed_tids and t['cpus'] & cores:
+                    intruders += 1
+        shielded = cores <= isolcpus
+        print("Isolated role %-10s cores %-8s %d unconfigured threads allowed there%s" % (
+            name, placement.cpu_list(sorted(cores)), intruders,
+            " (isolcpus)" if shielded else ", add isolcpus=%s to the kernel command line or use a cpuset" % placement.cpu_list(sorted(cores)) if intruders else ""))
+
+    print()
+    for v in violations:
+        print("VIOLATION: %s" % v)
+    print("%d violation(s)\n" % len(violations))
+    return violations
+
+
+####################################################################################
+def main():
+
+    parser = argparse.ArgumentParser(description='Check the CPU placement of the session processes')
+    parser.add_argument('--machine', help='config/placement/<machine>.yaml (default: $AUTONOMY_MACHINE or the host name)')
+    parser.add_argument('--config', help='explicit placement file')
+    parser.add_argument('--apply', action='store_true', help='place the threads of the running processes before checking')
+    parser.add_argument('--require', nargs='*', default=[], help='processes that must be running')
+    parser.add_argument('--wait', type=float, default=0.0, help='keep checking for up to this many seconds until it passes')
+    parser.add_argument('--verbose', action='store_true', help='list every thread')
+    args = parser.parse_args()
+
+    config = placement.load_machine(args.machine, args.config)
+    if config is None:
+        print("No placement file for machine '%s' in %s, nothing to check" % (args.machine or placement.machine_name(), placement.config_dir()))
+        return 0
+
+    deadline = time.monotonic() + args.wait
+    while True:
+        if args.apply:
+            apply(config)
+        violations = check(config, args)
+        if not violations or time.monotonic() >= deadline:
+            break
+        time.sleep(1.0)
+    return 1 if violations else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
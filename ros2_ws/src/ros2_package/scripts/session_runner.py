@@ -0,0 +1,220 @@
+#!/usr/bin/env python3
+
+######################################################
+######################################################
+## FILE SUMMARY:
+##
+## - Runs many headless sessions (launch/sim_session.launch.py)
+##   in parallel, e.g. for pilot studies and regression runs
+##
+## - Every running session gets its own ROS_DOMAIN_ID (and is kept
+##   on localhost), so the sessions cannot see each other's topics
+##
+## - Each session logs into its own directory, and once it ends its
+##   trial errors are appended to the sessions catalog:
+##   <out_dir>/sessions_catalog.csv
+##
+## - Usage:
+##   ros2 run ros2_package session_runner.py --out_dir /tmp/sessions \
+##       --alpha_ids 1 2 3 4 5 --traj_ids 0 1 2 --repeats 2 --jobs 8
+##
+######################################################
+######################################################
+
+import argparse
+import os
+import queue
+import signal
+import subprocess
+import threading
+
+from concurrent.futures import ThreadPoolExecutor, as_completed
+from csv import DictReader, DictWriter
+from itertools import product
+from os.path import isfile, join
+from time import sleep, time
+
+from ament_index_python.packages import get_package_share_directory
+
+
+# ROS_DOMAIN_ID values that are safe on every platform are 0 - 101
+MAX_DOMAIN_ID = 101
+
+# [s] a session gets to shut down after SIGINT, before it is killed
+SHUTDOWN_GRACE = 10.0
+
+CATALOG_FIELD_NAMES = ['session', 'domain_id', 'part_id', 'alpha_id', 'traj_id', 'use_depth', 'seed', 'exit_code',
+                       'wall_time', 'trial_file', 'human_ave', 'robot_ave', 'overall_ave']
+
+
+##############################################################################
+def parse_args():
+    parser = argparse.ArgumentParser(description='Run headless sessions in parallel, each in its own ROS domain')
+    parser.add_argument('--out_dir', required=True, help='directory for the session logs and the catalog')
+    parser.add_argument('--part_id', type=int, default=0)
+    parser.add_argument('--alpha_ids', type=int, nargs='+', default=[1, 2, 3, 4, 5])
+    parser.add_argument('--traj_ids', type=int, nargs='+', default=[0])
+    parser.add_argument('--use_depth', type=int, default=0)
+    parser.add_argument('--mapping_ratio', type=float, default=3.0)
+    parser.add_argument('--noise_dir', default=join(get_package_share_directory('ros2_package'), 'noise'),
+                        help='directory of the robot noise csv files')
+    parser.add_argument('--repeats', type=int, default=1, help='sessions per (alpha_id, traj_id), with different seeds')
+    parser.add_argument('--jobs', type=int, default=max(1, (os.cpu_count() or 2) // 2),
+                        help='sessions running at once (every session keeps about two cores busy)')
+    parser.add_argument('--domain_base', type=int, default=10, help='first ROS_DOMAIN_ID handed out')
+    parser.add_argument('--timeout', type=float, default=120.0, help='[s] per session')
+    parser.add_argument('--launch_args', nargs='*', default=[], help='extra name:=value launch arguments')
+    return parser.parse_args()
+
+
+##############################################################################
+class DomainPool:
+    """ hands out ROS_DOMAIN_IDs, so that no two running sessions share one """
+
+    def __init__(self, base, size):
+        if base + size - 1 > MAX_DOMAIN_ID:
+            raise ValueError("not enough ROS domains for %d parallel sessions from %d" % (size, base))
+        self.free = queue.Queue()
+        for domain_id in range(base, base + size):
+            self.free.put(domain_id)
+
+    def acquire(self):
+        return self.free.get()
+
+    def release(self, domain_id):
+        self.free.put(domain_id)
+
+
+##############################################################################
+def read_last_trial(session_dir, part_id):
+    """ last row of the participant header file written by the DataLogger, or None """
+
+    header_file_name = join(session_dir, "part" + str(part_id), "part" + str(part_id) + "_header.csv")
+    if not isfile(header_file_name):
+        return None
+
+    row = None
+    with open(header_file_name, 'r', newline='') as f:
+        for row in DictReader(f):
+            pass
+    return row
+
+
+##############################################################################
+def group_alive(pgid):
+    try:
+        os.killpg(pgid, 0)
+    except ProcessLookupError:
+        return False
+    return True
+
+
+def stop_session(process, grace):
+    """ SIGINT to the process group of the launch (its nodes included), SIGKILL if it is still there after grace seconds """
+
+    for sig in (signal.SIGINT, signal.SIGKILL):
+        try:
+            os.killpg(process.pid, sig)
+        except ProcessLookupError:
+            return
+        deadline = time() + grace
+        while time() < deadline:
+            # poll() reaps the launch itself, a zombie would keep the group alive
+            if process.poll() is not None and not group_alive(process.pid):
+                return
+            sleep(0.1)
+
+
+##############################################################################
+def run_session(session, args, domains):
+
+    session_dir = join(args.out_dir, "session%03d" % session['session'])
+    os.makedirs(join(session_dir, "part" + str(args.part_id)), exist_ok=True)
+
+    cmd = ['ros2', 'launch', 'ros2_package', 'sim_session.launch.py',
+           'part_id:=%d' % args.part_id,
+           'alpha_id:=%d' % session['alpha_id'],
+           'traj_id:=%d' % session['traj_id'],
+           'use_depth:=%d' % args.use_depth,
+           'mapping_ratio:=%s' % args.mapping_ratio,
+           'seed:=%d' % session['seed'],
+           'noise_dir:=%s' % args.noise_dir,
+           'csv_dir:=%s/' % session_dir] + args.launch_args
+
+    domain_id = domains.acquire()
+    env = dict(os.environ, ROS_DOMAIN_ID=str(domain_id), ROS_LOCALHOST_ONLY='1')
+
+    start = time()
+    try:
+        with open(join(session_dir, "launch.log"), 'w') as log:
+            # own process group, so the nodes can be stopped together with the launch
+            process = subprocess.Popen(cmd, env=env, stdout=log, stderr=subprocess.STDOUT, start_new_session=True)
+            try:
+                exit_code = process.wait(timeout=args.timeout)
+            except subprocess.TimeoutExpired:
+                exit_code = 'timeout'
+            finally:
+                stop_session(process, SHUTDOWN_GRACE)
+    finally:
+        # the domain is handed out again only once no process of this session is left
+        domains.release(domain_id)
+
+    result = dict(session, domain_id=domain_id, part_id=args.part_id, use_depth=args.use_depth,
+                  exit_code=exit_code, wall_time=round(time() - start, 2))
+
+    trial = read_last_trial(session_dir, args.part_id)
+    if trial is not None:
+        result['trial_file'] = join(session_dir, "part" + str(args.part_id), "trial" + trial['trial_number'] + ".csv")
+        result['human_ave'] = trial['human_ave']
+        result['robot_ave'] = trial['robot_ave']
+        result['overall_ave'] = trial['overall_ave']
+    return result
+
+
+##############################################################################
+def append_to_catalog(catalog_file_name, result, lock):
+    with lock:
+        file_exists = isfile(catalog_file_name)
+        with open(catalog_file_name, 'a', newline='') as f:
+            writer = DictWriter(f, fieldnames=CATALOG_FIELD_NAMES, restval='')
+            if not file_exists:
+                writer.writeheader()
+            writer.writerow(result)
+
+
+##############################################################################
+def main():
+
+    args = parse_args()
+    os.makedirs(args.out_dir, exist_ok=True)
+    catalog_file_name = join(args.out_dir, "sessions_catalog.csv")
+
+    sessions = []
+    for (alpha_id, traj_id, repeat) in product(args.alpha_ids, args.traj_ids, range(args.repeats)):
+        sessions.append({'session': len(sessions) + 1, 'alpha_id': alpha_id, 'traj_id': traj_id, 'seed': repeat})
+
+    jobs = min(args.jobs, len(sessions))
+    domains = DomainPool(args.domain_base, jobs)
+    lock = threading.Lock()
+
+    print("\nRunning %d sessions, %d at a time\n" % (len(sessions), jobs))
+    start = time()
+    failed = 0
+
+    # the sessions are separate processes, the threads only wait for them
+    with ThreadPoolExecutor(max_workers=jobs) as executor:
+        futures = [executor.submit(run_session, session, args, domains) for session in sessions]
+        for future in as_completed(futures):
+            result = future.result()
+            append_to_catalog(catalog_file_name, result, lock)
+            if result['exit_code'] != 0 or 'trial_file' not in result:
+                failed += 1
+            print("session %03d (alpha_id = %d, traj_id = %d, domain %d): exit %s, %.1f s, overall error %s" %
+                  (result['session'], result['alpha_id'], result['traj_id'], result['domain_id'], result['exit_code'],
+                   result['wall_time'], result.get('overall_ave', '-')))
+
+    print("\nFinished %d sessions (%d failed) in %.1f s, catalog: %s\n" % (len(sessions), failed, time() - start, catalog_file_name))
+
+
+if __name__ == '__main__':
+    main()
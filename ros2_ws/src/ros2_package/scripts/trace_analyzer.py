@@ -0,0 +1,242 @@
+#!/usr/bin/env python3
+
+######################################################
+######################################################
+## FILE SUMMARY:
+##
+## - Offline analyzer of the autonomy_trace_<pid>.bin files
+##   written by the tracepoints (include/ros2_package/tracing.hpp)
+##
+## - Main functionalities:
+##   1. Merges the traces of every process of a session
+##      (the steady clock is shared by all processes of a host)
+##   2. Reconstructs the critical path of every controller tick:
+##      Falcon read -> talker publish -> transport -> controller
+##      receive -> wait for the tick -> wakeup lateness -> IK -> rest
+##      of the tick, and names the longest stage of each tick
+##   3. Writes the per-tick table as csv, prints percentiles, and
+##      exports a Chrome trace (chrome://tracing or ui.perfetto.dev)
+##
+## - Usage:
+##   trace_analyzer.py /tmp/autonomy_trace_*.bin --csv ticks.csv --chrome trace.json
+##
+######################################################
+######################################################
+
+import argparse
+import bisect
+import csv
+import json
+import struct
+import sys
+
+
+# keep in sync with the Event enum of include/ros2_package/tracing.hpp
+EVENTS = ['callback_start', 'callback_end', 'ik_start', 'ik_end', 'publish', 'device_read', 'device_write_start', 'device_write_end']
+RECORD = struct.Struct('<qHHIQq')
+
+STAGES = ['device_to_publish', 'transport', 'queued', 'wakeup', 'ik', 'rest_of_tick']
+
+
+####################################################################################
+def read_trace(path):
+
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    if data[:4] != b'ATRC':
+        raise ValueError("%s is not an autonomy trace" % path)
+    version, pid = struct.unpack_from('<Ii', data, 4)
+    comm = data[12:28].split(b'\0')[0].decode(errors='replace')
+    (n_rings,) = struct.unpack_from('<I', data, 28)
+    offset = 32
+
+    raw = []
+    dropped = 0
+    for _ in range(n_rings):
+        tid, n, ring_dropped = struct.unpack_from('<IQQ', data, offset)
+        offset += 20
+        dropped += ring_dropped
+        for i in range(n):
+            t_ns, event, _, _, label, value = RECORD.unpack_from(data, offset + i * RECORD.size)
+            raw.append((t_ns, tid, event, label, value))
+        offset += n * RECORD.size
+
+    (n_labels,) = struct.unpack_from('<I', data, offset)
+    offset += 4
+    labels = {}
+    for _ in range(n_labels):
+        address, length = struct.unpack_from('<QI', data, offset)
+        offset += 12
+        labels[address] = data[offset:offset + length].decode(errors='replace')
+        offset += length
+
+    events = [(t, tid, EVENTS[e] if e < len(EVENTS) else str(e), labels.get(l, hex(l)), v) for (t, tid, e, l, v) in raw]
+    events.sort()
+    return {'pid': pid, 'comm': comm, 'events': events, 'dropped': dropped}
+
+
+####################################################################################
+def spans(process, start_event, end_event):
+    """ (start, end, tid, label, value) of matching start/end pairs, nested per thread """
+
+    open_spans = {}
+    out = []
+    for (t, tid, event, label, value) in process['events']:
+        if event == start_event:
+            open_spans.setdefault(tid, []).append((t, label, value))
+        elif event == end_event and open_spans.get(tid):
+            start, start_label, start_value = open_spans[tid].pop()
+            out.append((start, t, tid, start_label, start_value))
+    out.sort()
+    return out
+
+
+####################################################################################
+def instants(processes, event_name, label):
+    return sorted(t for p in processes for (t, _, event, l, _) in p['events'] if event == event_name and (label is None or l == label))
+
+
+def latest_before(times, t):
+    i = bisect.bisect_right(times, t)
+    return times[i - 1] if i > 0 else None
+
+
+####################################################################################
+def critical_paths(processes, args):
+
+    period = args.period_ms * 1e6
+    device_reads = instants(processes, 'device_read', None)
+    input_publishes = instants(processes, 'publish', args.input_topic)
+
+    receives = []
+    ticks = []
+    for p in processes:
+        for (start, end, _, label, value) in spans(p, 'callback_start', 'callback_end'):
+            if label == args.input_callback:
+                receives.append(start)
+            elif label == args.tick:
+                ticks.append((start, end, value, p))
+    receives.sort()
+    ticks.sort(key=lambda tick: tick[0])
+    if not ticks:
+        return []
+
+    ik_spans = sorted((s, e) for p in processes for (s, e, _, _, _) in spans(p, 'ik_start', 'ik_end'))
+    ik_starts = [s for (s, _) in ik_spans]
+
+    first = ticks[0][0]
+    rows = []
+    for (start, end, value, p) in ticks:
+        # the tick was due on the latest period boundary of the timer
+        due = first + ((start - first) // period) * period
+        receive = latest_before(receives, start)
+        publish = latest_before(input_publishes, receive) if receive is not None else None
+        read = latest_before(device_reads, publish) if publish is not None else None
+
+        i = bisect.bisect_left(ik_starts, start)
+        ik = 0.0
+        while i < len(ik_spans) and ik_spans[i][0] < end:
+            ik += min(ik_spans[i][1], end) - ik_spans[i][0]
+            i += 1
+
+        stages = {
+            'device_to_publish': (publish - read) if read is not None else 0.0,
+            'transport': (receive - publish) if publish is not None else 0.0,
+            'queued': (start - receive) if receive is not None else 0.0,
+            'wakeup': start - due,
+            'ik': ik,
+            'rest_of_tick': (end - start) - ik,
+        }
+        row = {'tick': value, 'start_ms': (start - first) / 1e6, 'duration_ms': (end - start) / 1e6}
+        row.update({s + '_ms': stages[s] / 1e6 for s in STAGES})
+        row['critical'] = max(STAGES, key=lambda s: stages[s])
+        rows.append(row)
+    return rows
+
+
+####################################################################################
+def chrome_trace(processes):
+
+    origin = min(e[0] for p in processes for e in p['events'])
+    out = []
+    for p in processes:
+        pid = p['pid']
+        out.append({'name': 'process_name', 'ph': 'M', 'pid': pid, 'args': {'name': '%s (%d)' % (p['comm'], pid)}})
+
+        for (start, end, tid, label, value) in spans(p, 'callback_start', 'callback_end'):
+            out.append({'name': label, 'cat': 'callback', 'ph': 'X', 'pid': pid, 'tid': tid,
+                        'ts': (start - origin) / 1e3, 'dur': (end - start) / 1e3, 'args': {'value': value}})
+        for (start, end, tid, label, value) in spans(p, 'ik_start', 'ik_end'):
+            out.append({'name': label, 'cat': 'ik', 'ph': 'X', 'pid': pid, 'tid': tid,
+                        'ts': (start - origin) / 1e3, 'dur': (end - start) / 1e3, 'args': {'value': value}})
+        for (start, end, tid, label, value) in spans(p, 'device_write_start', 'device_write_end'):
+            out.append({'name': label, 'cat': 'device_write', 'ph': 'X', 'pid': pid, 'tid': tid,
+                        'ts': (start - origin) / 1e3, 'dur': (end - start) / 1e3, 'args': {'value': value}})
+        for (t, tid, event, label, value) in p['events']:
+            if event in ('publish', 'device_read'):
+                out.append({'name': '%s %s' % (event, label), 'cat': event, 'ph': 'i', 's': 't', 'pid': pid, 'tid': tid,
+                            'ts': (t - origin) / 1e3, 'args': {'value': value}})
+    return {'traceEvents': out, 'displayTimeUnit': 'ms'}
+
+
+####################################################################################
+def percentile(values, q):
+    values = sorted(values)
+    return values[int(q * (len(values) - 1))] if values else 0.0
+
+
+def print_summary(rows):
+
+    print("\n%d ticks\n" % len(rows))
+    print("%-18s %10s %10s %10s %10s" % ('stage', 'p50 [ms]', 'p99 [ms]', 'max [ms]', 'critical'))
+    for s in STAGES:
+        values = [r[s + '_ms'] for r in rows]
+        n_critical = sum(1 for r in rows if r['critical'] == s)
+        print("%-18s %10.3f %10.3f %10.3f %9.1f%%" % (s, percentile(values, 0.5), percentile(values, 0.99), max(values),
+                                                     100.0 * n_critical / len(rows)))
+    print()
+
+
+####################################################################################
+def main():
+
+    parser = argparse.ArgumentParser(description='Critical paths and Chrome trace from the autonomy tracepoints')
+    parser.add_argument('traces', nargs='+', help='autonomy_trace_<pid>.bin files of one session')
+    parser.add_argument('--tick', default='controller_publisher', help='callback label of the control tick')
+    parser.add_argument('--period-ms', type=float, default=2.0, help='period of the control tick')
+    parser.add_argument('--input-callback', default='falcon_pos_callback', help='callback label receiving the operator input')
+    parser.add_argument('--input-topic', default='falcon_position', help='publish label of the operator input')
+    parser.add_argument('--csv', help='per-tick critical path table')
+    parser.add_argument('--chrome', help='Chrome trace JSON')
+    args = parser.parse_args()
+
+    processes = [read_trace(path) for path in args.traces]
+    for p in processes:
+        print("%s (pid %d): %d events%s" % (p['comm'], p['pid'], len(p['events']),
+                                           ", %d overwritten" % p['dropped'] if p['dropped'] else ""))
+    processes = [p for p in processes if p['events']]
+    if not processes:
+        sys.exit("no events in the traces")
+
+    rows = critical_paths(processes, args)
+    if rows:
+        print_summary(rows)
+    else:
+        print("no '%s' ticks in the traces" % args.tick)
+
+    if args.csv and rows:
+        with open(args.csv, 'w', newline='') as f:
+            writer = csv.DictWriter(f, fieldnames=list(rows[0].keys()))
+            writer.writeheader()
+            writer.writerows(rows)
+        print("Wrote the critical paths to %s" % args.csv)
+
+    if args.chrome:
+        with open(args.chrome, 'w') as f:
+            json.dump(chrome_trace(processes), f)
+        print("Wrote the Chrome trace to %s" % args.chrome)
+
+
+if __name__ == '__main__':
+    main()
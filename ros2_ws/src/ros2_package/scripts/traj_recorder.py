@@ -27,6 +27,7 @@ from std_msgs.msg import Bool
 
 from ros2_package.data_logger import DataLogger
 from ros2_package.traj_utils import get_sine_ref_points
+from ros2_package.kernels import trajectory_points
 
 from datetime import datetime
 from time import time
@@ -62,7 +63,7 @@ class TrajRecorder(Node):
         super().__init__('traj_recorder')
 
         # parameter stuff
-        self.param_names = ['free_drive', 'mapping_ratio', 'use_depth', 'part_id', 'alpha_id', 'traj_id']
+        self.param_names = ['free_drive', 'mapping_ratio', 'use_depth', 'part_id', 'alpha_id', 'traj_id', 'csv_dir', 'trajectory']
         self.declare_parameters(
             namespace='',
             parameters=[
@@ -71,24 +72,33 @@ class TrajRecorder(Node):
                 (self.param_names[2], 0),
                 (self.param_names[3], 0),
                 (self.param_names[4], 0),
-                (self.param_names[5], 0)
+                (self.param_names[5], 0),
+                (self.param_names[6], ALL_CSV_DIR),
+                (self.param_names[7], 'sines')
             ]
         )
-        (free_drive_param, mapping_ratio_param, use_depth_param, part_param, alpha_param, traj_param) = self.get_parameters(self.param_names)
+        (free_drive_param, mapping_ratio_param, use_depth_param, part_param, alpha_param, traj_param, csv_dir_param,
+         trajectory_param) = self.get_parameters(self.param_names)
         self.free_drive = free_drive_param.value
         self.mapping_ratio = mapping_ratio_param.value
         self.use_depth = use_depth_param.value
         self.part_id = part_param.value
         self.alpha_id = alpha_param.value
         self.traj_id = traj_param.value
+        self.all_csv_dir = csv_dir_param.value    # per-session directory when run by the session runner
+        self.trajectory = trajectory_param.value  # generator spec, KEEP CONSISTENT WITH REAL CONTROLLER
 
         self.print_params()
 
-        # get the reference trajectory points
-        self.traj_params = TRAJ_DICT_LIST[self.traj_id]
-        self.refx, self.refy, self.refz = get_sine_ref_points(200, self.traj_params['a'], self.traj_params['b'], self.traj_params['c'], 
-                                                              self.traj_params['s'], self.traj_params['h'], TRAJ_HEIGHT, TRAJ_WIDTH, TRAJ_DEPTH, 
-                                                              ORIGIN, self.use_depth)
+        # get the reference trajectory points (the plain sums of sines also without the C++ module)
+        if self.trajectory in ('', 'sines'):
+            self.traj_params = TRAJ_DICT_LIST[self.traj_id]
+            self.refx, self.refy, self.refz = get_sine_ref_points(200, self.traj_params['a'], self.traj_params['b'], self.traj_params['c'], 
+                                                                  self.traj_params['s'], self.traj_params['h'], TRAJ_HEIGHT, TRAJ_WIDTH, TRAJ_DEPTH, 
+                                                                  ORIGIN, self.use_depth)
+        else:
+            ref = trajectory_points(self.trajectory, self.traj_id, self.use_depth, 200, ORIGIN)
+            self.refx, self.refy, self.refz = ref[:, 0].tolist(), ref[:, 1].tolist(), ref[:, 2].tolist()
 
         # tcp position subscriber
         self.tcp_pos_sub = self.create_subscription(PosInfo, 'tcp_position', self.tcp_pos_callback, 10)
@@ -135,11 +145,12 @@ class TrajRecorder(Node):
         self.tzs = []
 
         self.times_from_start = []
+        self.nominal_times_from_start = []
         self.times = []
         self.datetimes = []
 
         # file name of the csv sheet
-        self.csv_dir = ALL_CSV_DIR + "part" + str(self.part_id) + "/"
+        self.csv_dir = self.all_csv_dir + "part" + str(self.part_id) + "/"
 
 
     ##############################################################################
@@ -164,6 +175,7 @@ class TrajRecorder(Node):
             self.tzs.append(msg.tcp_position[2])
 
             self.times_from_start.append(msg.time_from_start)
+            self.nominal_times_from_start.append(msg.nominal_time_from_start)
             self.times.append(time())
             self.datetimes.append(datetime.now().strftime("%Y-%m-%d_%H-%M-%S"))
 
@@ -187,7 +199,8 @@ class TrajRecorder(Node):
     def write_to_csv(self):
 
         dl = DataLogger(self.csv_dir, self.part_id, self.alpha_id, self.traj_id, self.refxs, self.refys, self.refzs, self.hxs, self.hys, self.hzs,
-                        self.rxs, self.rys, self.rzs, self.txs, self.tys, self.tzs, self.times_from_start, self.times, self.datetimes)
+                        self.rxs, self.rys, self.rzs, self.txs, self.tys, self.tzs, self.times_from_start, self.times, self.datetimes,
+                        self.nominal_times_from_start)
 
         dl.calc_error(self.use_depth)
 
@@ -208,6 +221,7 @@ class TrajRecorder(Node):
         print("The participant_id = %d\n\n" % self.part_id)
         print("The alpha_id = %d\n\n" % self.alpha_id)
         print("The trajectory_id = %d\n\n" % self.traj_id)
+        print("The trajectory generator = %s\n\n" % self.trajectory)
 
         print("=" * 100)
         print("\n" * 10)
@@ -0,0 +1,174 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - C++ class implementation of the ClockSyncServer node, the robot PC end
+//   of the clock synchronization of the external recording machines (Tobii
+//   eye tracker and tapping task, experiment/secondary task/rhythm_method.py)
+//
+// - Main functionalities:
+//   1. Answers the NTP-style requests of the clients on a UDP port from its
+//      own thread, stamped with the kernel receive time and the controller
+//      clock (include/ros2_package/clock_sync.hpp)
+//   2. Adds the traj_origin of the current trial (trial_event) to the
+//      replies, so the clients map their samples onto time_from_start
+//   3. Publishes the offset, drift and uncertainty reported by every client
+//      (-> clock_offset) and appends them to a csv file, to map the external
+//      samples onto the controller timeline offline as well
+//
+// - Usage (runs for the whole session, the clients come and go):
+//   ros2 run ros2_package clock_sync_server --ros-args -p port:=15000 -p offset_log:=/tmp/part1_clock_offsets.csv
+//   python clock_sync.py --loopback 127.0.0.1     (stand-in client with a skewed clock)
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+
+#include "tutorial_interfaces/msg/trial_event.hpp"
+#include "tutorial_interfaces/msg/clock_offset.hpp"
+
+#include "ros2_package/clock_sync.hpp"
+#include "ros2_package/qos_profiles.hpp"
+
+using namespace std::chrono_literals;
+
+
+/////////////// DEFINITION OF NODE CLASS //////////////
+
+class ClockSyncServer : public rclcpp::Node
+{
+public:
+
+  // parameters name list
+  std::vector<std::string> param_names = {"port", "offset_log"};
+  int port {15000};
+  std::string offset_log {""};    // csv of the reported estimates, empty = no file
+
+  ros2_package::ClockSyncSocket sock;
+  std::thread serve_thread;
+  std::atomic<bool> running {true};
+  std::atomic<double> traj_origin {std::numeric_limits<double>::quiet_NaN()};
+
+  std::ofstream log_file;
+  std::map<std::string, uint64_t> requests;   // per client, serve thread only
+
+
+  ClockSyncServer()
+  : Node("clock_sync_server")
+  {
+    // parameter stuff
+    this->declare_parameter(param_names.at(0), 15000);
+    this->declare_parameter(param_names.at(1), "");
+
+    std::vector<rclcpp::Parameter> params = this->get_parameters(param_names);
+    port = std::stoi(params.at(0).value_to_string().c_str());
+    offset_log = params.at(1).as_string();
+
+    print_params();
+
+    std::string error;
+    if (!sock.open(port, error)) {
+      std::cout << "Could not open UDP port " << port << ": " << error << ", shutting down" << std::endl;
+      rclcpp::shutdown();
+      return;
+    }
+    if (!sock.kernel_stamps()) std::cout << "No kernel receive timestamps, stamping in user space" << std::endl;
+
+    if (!offset_log.empty()) {
+      const bool exists = std::ifstream(offset_log).good();
+      log_file.open(offset_log, std::ios::app);
+      if (!exists) log_file << "server_time,client,seq,offset,drift_ppm,uncertainty,round_trip,n_samples,traj_origin\n";
+      log_file << std::setprecision(17);
+    }
+
+    offset_pub_ = this->create_publisher<tutorial_interfaces::msg::ClockOffset>("clock_offset", 10);
+
+    trial_event_sub_ = this->create_subscription<tutorial_interfaces::msg::TrialEvent>(
+      "trial_event", ros2_package::topic_qos(this, "trial_event", "event"),
+      [this](const tutorial_interfaces::msg::TrialEvent & msg) { traj_origin = rclcpp::Time(msg.traj_origin).seconds(); });
+
+    serve_thread = std::thread(&ClockSyncServer::serve_loop, this);
+  }
+
+  ~ClockSyncServer()
+  {
+    running = false;
+    if (serve_thread.joinable()) serve_thread.join();
+  }
+
+
+private:
+
+  // the replies are sent from here, off the executor, so a busy callback never delays t3
+  void serve_loop()
+  {
+    ros2_package::clock_sync::Packet packet;
+    sockaddr_in from {};
+    while (running) {
+      if (!sock.serve_one(100, traj_origin.load(), packet, from)) continue;
+
+      const std::string client = std::string(packet.client, strnlen(packet.client, sizeof(packet.client))) +
+                                 "@" + inet_ntoa(from.sin_addr);
+      if (packet.type == ros2_package::clock_sync::REQUEST) {
+        if (requests[client]++ == 0) std::cout << "Clock sync client " << client << " connected" << std::endl;
+      } else {
+        report(client, packet);
+      }
+    }
+  }
+
+  void report(const std::string & client, const ros2_package::clock_sync::Packet & packet)
+  {
+    auto message = tutorial_interfaces::msg::ClockOffset();
+    message.stamp = this->now();
+    message.client = client;
+    message.seq = packet.seq;
+    message.offset = packet.offset;
+    message.drift = packet.drift;
+    message.uncertainty = packet.uncertainty;
+    message.round_trip = packet.round_trip;
+    message.n_samples = packet.n_samples;
+    offset_pub_->publish(message);
+
+    if (log_file.is_open()) {
+      log_file << rclcpp::Time(message.stamp).seconds() << "," << client << "," << packet.seq << "," << packet.offset << ","
+               << packet.drift << "," << packet.uncertainty << "," << packet.round_trip << "," << packet.n_samples << ","
+               << traj_origin.load() << "\n";
+      log_file.flush();
+    }
+  }
+
+  void print_params() {
+    std::cout << "\n\nThe current parameters [clock_sync_server] are as follows:\n" << std::endl;
+    std::cout << "UDP port = " << port << "\n" << std::endl;
+    std::cout << "Offset log = " << (offset_log.empty() ? "none" : offset_log) << "\n" << std::endl;
+  }
+
+  rclcpp::Publisher<tutorial_interfaces::msg::ClockOffset>::SharedPtr offset_pub_;
+  rclcpp::Subscription<tutorial_interfaces::msg::TrialEvent>::SharedPtr trial_event_sub_;
+};
+
+
+
+//////////////////// MAIN FUNCTION ///////////////////
+
+int main(int argc, char * argv[])
+{
+  rclcpp::init(argc, argv);
+  rclcpp::spin(std::make_shared<ClockSyncServer>());
+  rclcpp::shutdown();
+  return 0;
+}
@@ -0,0 +1,371 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - C++ class implementation of the DelayLine node, a teleoperation latency
+//   emulator inserted on one topic (operator -> controller, or controller -> robot)
+//
+// - Main functionalities:
+//   1. Relays the serialized messages of input_topic to output_topic after
+//      a constant or distributed delay (constant, uniform, normal, exponential),
+//      from tens of microseconds up to seconds
+//   2. Holds the messages in a hierarchical timing wheel over a preallocated
+//      ring (include/ros2_package/timing_wheel.hpp), released by its own
+//      thread, which sleeps until the next sample is due
+//   3. Keeps the message order by default, like a real link would
+//   4. Records the delay applied to every sample: a DelaySample message next
+//      to the output topic, and a csv file flushed periodically from a bounded
+//      ring (the samples dropped because the wheel was full are flagged in it)
+//
+// - Usage, e.g. 150 ms +- 20 ms between the Falcon and the controller:
+//   ros2 run ros2_package real_controller --ros-args -r falcon_position:=falcon_position_delayed
+//   ros2 run ros2_package delay_line --ros-args -p delay_ms:=150.0 -p distribution:=normal -p spread_ms:=20.0 -p delay_log:=/tmp/part1_delays.csv
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp/serialized_message.hpp"
+
+#include "tutorial_interfaces/msg/delay_sample.hpp"
+
+#include "ros2_package/timing_wheel.hpp"
+#include "ros2_package/qos_profiles.hpp"
+
+using namespace std::chrono_literals;
+
+
+// one message in flight
+struct DelayedSample
+{
+  std::shared_ptr<rclcpp::SerializedMessage> msg;
+  uint64_t seq = 0;
+  int64_t received_ns = 0;      // steady clock
+  rclcpp::Time received_stamp;  // node clock
+  double nominal_delay = 0.0;   // [s]
+};
+
+// one row of the delay log
+struct DelayRecord
+{
+  uint64_t seq;
+  double received;       // [s] node clock
+  double nominal_delay;  // [s]
+  double applied_delay;  // [s], NaN if dropped
+  bool dropped;          // the wheel was full, the sample was never forwarded
+};
+
+
+/////////////// DEFINITION OF NODE CLASS //////////////
+
+class DelayLine : public rclcpp::Node
+{
+public:
+
+  // parameters name list
+  std::vector<std::string> param_names = {"input_topic", "output_topic", "message_type", "delay_ms", "distribution", "spread_ms",
+                                          "keep_order", "seed", "tick_us", "capacity", "record_topic", "delay_log"};
+  std::string input_topic {"falcon_position"};
+  std::string output_topic {"falcon_position_delayed"};
+  std::string message_type {"tutorial_interfaces/msg/Falconpos"};
+  double delay_ms {50.0};                 // constant delay, or mean of the distribution
+  std::string distribution {"constant"};  // constant, uniform (+- spread), normal (std = spread), exponential (delay + mean spread)
+  double spread_ms {0.0};
+  int keep_order {1};                     // never let a sample overtake an earlier one
+  int seed {0};
+  int tick_us {10};                       // wheel resolution
+  int capacity {65536};                   // samples in flight at once
+  std::string record_topic {""};          // empty = <output_topic>_delay
+  std::string delay_log {""};             // csv of every sample, empty = no file
+
+  std::unique_ptr< ros2_package::TimingWheel<DelayedSample> > wheel;
+  std::mutex wheel_mutex;
+  std::condition_variable wheel_cv;       // a sample was scheduled, or the node stops
+  std::thread release_thread;
+  std::atomic<bool> running {true};
+
+  std::mt19937_64 rng;
+  uint64_t seq = 0;
+  int64_t last_release_ns = 0;
+  uint64_t overflows = 0;
+
+  // delay log: rows go through a bounded ring (release thread and input callback),
+  // flushed to the csv by a timer, so nothing is allocated per message
+  static constexpr size_t log_capacity = 1 << 16;
+  static constexpr auto log_period = 200ms;
+  std::ofstream log_file;
+  std::vector<DelayRecord> records;       // the ring
+  std::vector<DelayRecord> flush_buffer;  // what the timer writes out
+  size_t records_head = 0;
+  size_t records_count = 0;
+  uint64_t records_lost = 0;              // rows the flush could not keep up with
+  std::mutex records_mutex;
+
+  // summary, written by the release thread only
+  uint64_t forwarded = 0;
+  double delay_sum = 0.0;
+  double delay_max = 0.0;
+
+
+  DelayLine()
+  : Node("delay_line")
+  {
+    // parameter stuff
+    this->declare_parameter(param_names.at(0), "falcon_position");
+    this->declare_parameter(param_names.at(1), "falcon_position_delayed");
+    this->declare_parameter(param_names.at(2), "tutorial_interfaces/msg/Falconpos");
+    this->declare_parameter(param_names.at(3), 50.0);
+    this->declare_parameter(param_names.at(4), "constant");
+    this->declare_parameter(param_names.at(5), 0.0);
+    this->declare_parameter(param_names.at(6), 1);
+    this->declare_parameter(param_names.at(7), 0);
+    this->declare_parameter(param_names.at(8), 10);
+    this->declare_parameter(param_names.at(9), 65536);
+    this->declare_parameter(param_names.at(10), "");
+    this->declare_parameter(param_names.at(11), "");
+
+    std::vector<rclcpp::Parameter> params = this->get_parameters(param_names);
+    input_topic = params.at(0).as_string();
+    output_topic = params.at(1).as_string();
+    message_type = params.at(2).as_string();
+    delay_ms = std::stod(params.at(3).value_to_string().c_str());
+    distribution = params.at(4).as_string();
+    spread_ms = std::stod(params.at(5).value_to_string().c_str());
+    keep_order = std::stoi(params.at(6).value_to_string().c_str());
+    seed = std::stoi(params.at(7).value_to_string().c_str());
+    tick_us = std::max(1, std::stoi(params.at(8).value_to_string().c_str()));
+    capacity = std::max(1, std::stoi(params.at(9).value_to_string().c_str()));
+    record_topic = params.at(10).as_string();
+    delay_log = params.at(11).as_string();
+    if (record_topic.empty()) record_topic = output_topic + "_delay";
+    print_params();
+
+    if (distribution != "constant" && distribution != "uniform" && distribution != "normal" && distribution != "exponential") {
+      std::cout << "Unknown delay distribution '" << distribution << "', using constant" << std::endl;
+      distribution = "constant";
+    }
+
+    rng.seed((unsigned int) seed);
+    wheel = std::make_unique< ros2_package::TimingWheel<DelayedSample> >((int64_t) tick_us * 1000, (size_t) capacity);
+
+    if (!delay_log.empty()) {
+      log_file.open(delay_log);
+      if (log_file) {
+        log_file << "seq,received,nominal_delay,applied_delay,dropped\n";
+        log_file.precision(9);
+        records.resize(log_capacity);
+        flush_buffer.reserve(log_capacity);
+        log_timer_ = this->create_wall_timer(log_period, std::bind(&DelayLine::flush_log, this));
+      } else {
+        std::cout << "error: cannot write " << delay_log << ", no delay log\n" << std::endl;
+      }
+    }
+
+    // relay and delay record
+    output_pub_ = this->create_generic_publisher(output_topic, message_type, ros2_package::topic_qos(this, output_topic));
+    record_pub_ = this->create_publisher<tutorial_interfaces::msg::DelaySample>(record_topic, 100);
+    input_sub_ = this->create_generic_subscription(input_topic, message_type, ros2_package::topic_qos(this, input_topic, "control"),
+      std::bind(&DelayLine::input_callback, this, std::placeholders::_1));
+
+    release_thread = std::thread(&DelayLine::release_loop, this);
+  }
+
+  ~DelayLine()
+  {
+    stop();
+  }
+
+  // stops the release thread, before the log is written
+  void stop()
+  {
+    {
+      std::lock_guard<std::mutex> lock(wheel_mutex);
+      running = false;
+    }
+    wheel_cv.notify_all();
+    if (release_thread.joinable()) release_thread.join();
+  }
+
+  ///////////////////////////////////// DELAY LOG /////////////////////////////////////
+  // appends one row to the ring, the oldest row is lost if the flush fell behind
+  void log_record(const DelayRecord & r)
+  {
+    if (!log_file.is_open()) return;
+    std::lock_guard<std::mutex> lock(records_mutex);
+    if (records_count == records.size()) {
+      records_head = (records_head + 1) % records.size();
+      records_count--;
+      records_lost++;
+    }
+    records[(records_head + records_count) % records.size()] = r;
+    records_count++;
+  }
+
+  // moves the ring to the csv, the file is written outside of the lock
+  void flush_log()
+  {
+    if (!log_file.is_open()) return;
+    flush_buffer.clear();
+    {
+      std::lock_guard<std::mutex> lock(records_mutex);
+      for (size_t i=0; i<records_count; i++) flush_buffer.push_back(records[(records_head + i) % records.size()]);
+      records_head = (records_head + records_count) % records.size();
+      records_count = 0;
+    }
+    for (const DelayRecord & r : flush_buffer) {
+      log_file << r.seq << "," << r.received << "," << r.nominal_delay << "," << r.applied_delay << "," << (r.dropped ? 1 : 0) << "\n";
+    }
+  }
+
+  void write_log()
+  {
+    std::cout << "\nDelay line forwarded " << forwarded << " samples, mean delay = "
+              << (forwarded ? 1000 * delay_sum / forwarded : 0.0) << " ms, max = " << 1000 * delay_max << " ms"
+              << (overflows ? ", dropped " + std::to_string(overflows) + " samples (wheel full)" : "") << "\n" << std::endl;
+
+    if (!log_file.is_open()) return;
+    flush_log();
+    log_file.flush();
+    std::cout << (log_file ? "Wrote the delay log to " : "error: cannot write ") << delay_log
+              << (records_lost ? " (" + std::to_string(records_lost) + " rows lost, the flush fell behind)" : "") << "\n" << std::endl;
+  }
+
+
+private:
+
+  static int64_t steady_ns()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  // delay of the next sample in [s], never negative
+  double draw_delay()
+  {
+    const double mean = delay_ms / 1000, spread = spread_ms / 1000;
+    double d = mean;
+    if (distribution == "uniform") d = std::uniform_real_distribution<double>(mean - spread, mean + spread)(rng);
+    else if (distribution == "normal") d = std::normal_distribution<double>(mean, spread)(rng);
+    else if (distribution == "exponential" && spread > 0.0) d = mean + std::exponential_distribution<double>(1.0 / spread)(rng);
+    return std::max(d, 0.0);
+  }
+
+  ///////////////////////////////////// RELAY /////////////////////////////////////
+  void input_callback(std::shared_ptr<rclcpp::SerializedMessage> msg)
+  {
+    DelayedSample s;
+    s.msg = msg;
+    s.seq = seq++;
+    s.received_ns = steady_ns();
+    s.received_stamp = this->now();
+    s.nominal_delay = draw_delay();
+
+    int64_t release_ns = s.received_ns + (int64_t) (s.nominal_delay * 1e9);
+    const DelayRecord dropped {s.seq, s.received_stamp.seconds(), s.nominal_delay, std::numeric_limits<double>::quiet_NaN(), true};
+
+    bool scheduled;
+    {
+      std::lock_guard<std::mutex> lock(wheel_mutex);
+      if (keep_order) release_ns = std::max(release_ns, last_release_ns);
+      last_release_ns = release_ns;
+      scheduled = wheel->schedule(release_ns, std::move(s));
+      if (!scheduled) overflows++;
+    }
+    if (scheduled) wheel_cv.notify_one();
+    else log_record(dropped);
+  }
+
+  // sleeps until the next sample is due (or a new one is scheduled), publishing outside of the lock
+  void release_loop()
+  {
+    std::vector<DelayedSample> out;
+    out.reserve(capacity);
+    std::unique_lock<std::mutex> lock(wheel_mutex);
+    wheel->start(steady_ns());
+
+    while (running) {
+      const int64_t due = wheel->next_due_ns();
+      if (due < 0) wheel_cv.wait(lock);
+      else wheel_cv.wait_until(lock, std::chrono::steady_clock::time_point(std::chrono::nanoseconds(due)));
+      if (!running) break;
+
+      out.clear();
+      wheel->advance(steady_ns(), [&out](int64_t, DelayedSample & s) { out.push_back(std::move(s)); });
+      if (out.empty()) continue;
+
+      lock.unlock();
+      try {
+        publish_released(out);
+      } catch (const std::exception &) {
+        // the context is shut down (Ctrl-C), the samples still in flight are dropped
+        if (!rclcpp::ok()) return;
+        throw;
+      }
+      lock.lock();
+    }
+  }
+
+  void publish_released(std::vector<DelayedSample> & out)
+  {
+    for (DelayedSample & s : out) {
+      output_pub_->publish(*s.msg);
+      const double applied = (steady_ns() - s.received_ns) * 1e-9;
+
+      auto record = tutorial_interfaces::msg::DelaySample();
+      record.seq = s.seq;
+      record.received = s.received_stamp;
+      record.released = this->now();
+      record.nominal_delay = s.nominal_delay;
+      record.applied_delay = applied;
+      record_pub_->publish(record);
+
+      forwarded++;
+      delay_sum += applied;
+      delay_max = std::max(delay_max, applied);
+      log_record(DelayRecord{s.seq, s.received_stamp.seconds(), s.nominal_delay, applied, false});
+    }
+  }
+
+  void print_params() {
+    std::cout << "\n\nThe current parameters [delay_line] are as follows:\n" << std::endl;
+    std::cout << "Relay = " << input_topic << " -> " << output_topic << " (" << message_type << ")\n" << std::endl;
+    std::cout << "Delay = " << delay_ms << " ms, " << distribution << ", spread = " << spread_ms << " ms\n" << std::endl;
+    std::cout << "Keep order = " << keep_order << ", seed = " << seed << "\n" << std::endl;
+    std::cout << "Tick = " << tick_us << " us, capacity = " << capacity << "\n" << std::endl;
+    std::cout << "Delay record topic = " << record_topic << ", log = " << delay_log << "\n" << std::endl;
+  }
+
+  rclcpp::GenericPublisher::SharedPtr output_pub_;
+  rclcpp::Publisher<tutorial_interfaces::msg::DelaySample>::SharedPtr record_pub_;
+  rclcpp::GenericSubscription::SharedPtr input_sub_;
+  rclcpp::TimerBase::SharedPtr log_timer_;
+};
+
+
+
+//////////////////// MAIN FUNCTION ///////////////////
+
+int main(int argc, char * argv[])
+{
+  rclcpp::init(argc, argv);
+  auto delay_line = std::make_shared<DelayLine>();
+  rclcpp::spin(delay_line);
+  delay_line->stop();
+  delay_line->write_log();
+  rclcpp::shutdown();
+  return 0;
+}
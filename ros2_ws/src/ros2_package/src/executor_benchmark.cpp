@@ -0,0 +1,317 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Benchmark of the executor options of include/ros2_package/executor_utils.hpp
+//   under the message mix of the real controller
+//
+// - Main functionalities:
+//   1. A child process stands in for the robot and the Falcon, publishing
+//      JointState at 1 kHz and Falconpos at 500 Hz, stamped on the steady clock
+//   2. For every executor option, a fresh controller-shaped node runs for
+//      "duration" seconds: two 2 ms timers (control group, publishing the
+//      command and the record flag) and the two subscriptions (sensing group)
+//   3. Measures the timer wakeup-to-callback latency, the publish-to-callback
+//      latency of both subscriptions, and the CPU time of this process per
+//      control tick (the child's publishing cost is not counted)
+//   4. Prints a table and optionally writes it as csv to "output_file"
+//
+// - Usage:
+//   ros2 run ros2_package executor_benchmark --ros-args -p duration:=20.0 -p output_file:=/tmp/executors.csv
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "sensor_msgs/msg/joint_state.hpp"
+#include "std_msgs/msg/bool.hpp"
+
+#include "tutorial_interfaces/msg/falconpos.hpp"
+
+#include "ros2_package/executor_utils.hpp"
+#include "ros2_package/sample_stats.hpp"
+
+using namespace std::chrono_literals;
+
+
+/////////////////// global variables ///////////////////
+const unsigned int n_joints = 7;
+
+// [ns] on the steady clock
+static int64_t steady_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// [ns] of CPU time used by this process
+static int64_t process_cpu_ns()
+{
+  timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+/////////////// ROBOT AND FALCON STAND-IN (child process) //////////////
+
+class MixPublisher : public rclcpp::Node
+{
+public:
+
+  MixPublisher()
+  : Node("executor_benchmark_mix")
+  {
+    joint_msg.position.resize(n_joints, 0.0);
+    joint_pub_ = this->create_publisher<sensor_msgs::msg::JointState>("executor_benchmark/joint_states", 10);
+    falcon_pub_ = this->create_publisher<tutorial_interfaces::msg::Falconpos>("executor_benchmark/falcon_position", 10);
+
+    // franka/joint_states at 1 kHz, falcon_position at 500 Hz
+    joint_timer_ = this->create_wall_timer(1ms, [this]() {
+      joint_msg.header.stamp = rclcpp::Time(steady_ns());
+      joint_pub_->publish(joint_msg);
+    });
+    falcon_timer_ = this->create_wall_timer(2ms, [this]() {
+      tutorial_interfaces::msg::Falconpos msg;
+      msg.x = steady_ns() * 1e-9;   // send time in x, there is no header
+      falcon_pub_->publish(msg);
+    });
+  }
+
+private:
+
+  sensor_msgs::msg::JointState joint_msg;
+  rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr joint_pub_;
+  rclcpp::Publisher<tutorial_interfaces::msg::Falconpos>::SharedPtr falcon_pub_;
+  rclcpp::TimerBase::SharedPtr joint_timer_;
+  rclcpp::TimerBase::SharedPtr falcon_timer_;
+};
+
+
+/////////////// CONTROLLER-SHAPED NODE //////////////
+
+class ControllerMix : public rclcpp::Node
+{
+public:
+
+  // samples in [us], recorded after the warm-up
+  std::vector<double> timer_latency;
+  std::vector<double> joint_latency;
+  std::vector<double> falcon_latency;
+  uint64_t control_ticks = 0;
+  bool recording = false;
+  std::mutex state_mutex;   // shared by the sensing and control groups, like in the controller
+
+  ControllerMix()
+  : Node("executor_benchmark_controller")
+  {
+    sensing_group = this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+    control_group = this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+    rclcpp::SubscriptionOptions sensing_options;
+    sensing_options.callback_group = sensing_group;
+
+    command_msg.position.resize(n_joints, 0.0);
+    command_pub_ = this->create_publisher<sensor_msgs::msg::JointState>("executor_benchmark/desired_joint_vals", 10);
+    record_pub_ = this->create_publisher<std_msgs::msg::Bool>("executor_benchmark/record", 10);
+
+    // the timers fire on multiples of the period after their creation
+    timer_start = steady_ns();
+    controller_timer_ = this->create_wall_timer(2ms, [this]() {
+      std::lock_guard<std::mutex> lock(state_mutex);
+      if (recording) {
+        timer_latency.push_back(wakeup_latency_us());
+        control_ticks++;
+      }
+      for (unsigned int i=0; i<n_joints; i++) command_msg.position[i] = curr_joint_vals[i];
+      command_pub_->publish(command_msg);
+    }, control_group);
+    record_timer_ = this->create_wall_timer(2ms, [this]() {
+      std_msgs::msg::Bool msg;
+      {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        msg.data = recording;
+      }
+      record_pub_->publish(msg);
+    }, control_group);
+
+    joint_sub_ = this->create_subscription<sensor_msgs::msg::JointState>("executor_benchmark/joint_states", 10,
+      [this](const sensor_msgs::msg::JointState & msg) {
+        const double latency = (steady_ns() - rclcpp::Time(msg.header.stamp).nanoseconds()) * 1e-3;
+        std::lock_guard<std::mutex> lock(state_mutex);
+        for (unsigned int i=0; i<n_joints && i<msg.position.size(); i++) curr_joint_vals[i] = msg.position[i];
+        if (recording) joint_latency.push_back(latency);
+      }, sensing_options);
+    falcon_sub_ = this->create_subscription<tutorial_interfaces::msg::Falconpos>("executor_benchmark/falcon_position", 10,
+      [this](const tutorial_interfaces::msg::Falconpos & msg) {
+        const double latency = (steady_ns() * 1e-9 - msg.x) * 1e6;
+        std::lock_guard<std::mutex> lock(state_mutex);
+        if (recording) falcon_latency.push_back(latency);
+      }, sensing_options);
+  }
+
+private:
+
+  // time since the latest 2 ms boundary of the timer [us]
+  double wakeup_latency_us() const
+  {
+    const int64_t period = 2000000;
+    return ((steady_ns() - timer_start) % period) * 1e-3;
+  }
+
+  int64_t timer_start;
+  double curr_joint_vals[n_joints] = {0.0};
+  sensor_msgs::msg::JointState command_msg;
+
+  rclcpp::CallbackGroup::SharedPtr sensing_group;
+  rclcpp::CallbackGroup::SharedPtr control_group;
+  rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr command_pub_;
+  rclcpp::Publisher<std_msgs::msg::Bool>::SharedPtr record_pub_;
+  rclcpp::TimerBase::SharedPtr controller_timer_;
+  rclcpp::TimerBase::SharedPtr record_timer_;
+  rclcpp::Subscription<sensor_msgs::msg::JointState>::SharedPtr joint_sub_;
+  rclcpp::Subscription<tutorial_interfaces::msg::Falconpos>::SharedPtr falcon_sub_;
+};
+
+
+/////////////// BENCHMARK //////////////
+
+class ExecutorBenchmark : public rclcpp::Node
+{
+public:
+
+  // parameters name list
+  std::vector<std::string> param_names = {"executors", "duration", "warmup", "threads", "output_file"};
+  std::vector<std::string> executors {"single", "static", "multi", "events"};
+  double duration {10.0};   // [s] measured per executor
+  double warmup {1.0};      // [s] discarded per executor (discovery, first allocations)
+  int threads {2};          // threads of the multi-threaded executor
+  std::string output_file {""};
+
+  ExecutorBenchmark()
+  : Node("executor_benchmark")
+  {
+    // parameter stuff
+    this->declare_parameter(param_names.at(0), executors);
+    this->declare_parameter(param_names.at(1), duration);
+    this->declare_parameter(param_names.at(2), warmup);
+    this->declare_parameter(param_names.at(3), threads);
+    this->declare_parameter(param_names.at(4), output_file);
+
+    std::vector<rclcpp::Parameter> params = this->get_parameters(param_names);
+    executors = params.at(0).as_string_array();
+    duration = std::stod(params.at(1).value_to_string().c_str());
+    warmup = std::stod(params.at(2).value_to_string().c_str());
+    threads = std::stoi(params.at(3).value_to_string().c_str());
+    output_file = params.at(4).as_string();
+    print_params();
+  }
+
+  void run()
+  {
+    std::stringstream table;
+    table << "executor,ticks,cpu_per_tick_us,timer_p50_us,timer_p99_us,timer_max_us,"
+          << "joint_state_p50_us,joint_state_p99_us,falconpos_p50_us,falconpos_p99_us\n";
+
+    for (const std::string & name : executors) {
+      if (!ros2_package::valid_executor(name)) {
+        std::cout << "Skipping unknown executor '" << name << "'" << std::endl;
+        continue;
+      }
+      if (!rclcpp::ok()) break;
+      std::cout << "Measuring the '" << name << "' executor for " << duration << " s ..." << std::endl;
+
+      auto node = std::make_shared<ControllerMix>();
+      auto exec = ros2_package::make_executor(name, threads);
+      exec->add_node(node);
+      std::thread spinner([&exec]() { exec->spin(); });
+
+      std::this_thread::sleep_for(std::chrono::duration<double>(warmup));
+      int64_t cpu_start;
+      {
+        std::lock_guard<std::mutex> lock(node->state_mutex);
+        node->recording = true;
+        cpu_start = process_cpu_ns();
+      }
+      std::this_thread::sleep_for(std::chrono::duration<double>(duration));
+      int64_t cpu_end;
+      {
+        std::lock_guard<std::mutex> lock(node->state_mutex);
+        node->recording = false;
+        cpu_end = process_cpu_ns();
+      }
+
+      exec->cancel();
+      spinner.join();
+      exec->remove_node(node);
+
+      const ros2_package::SampleStats timer = ros2_package::SampleStats::of(node->timer_latency);
+      const ros2_package::SampleStats joint = ros2_package::SampleStats::of(node->joint_latency);
+      const ros2_package::SampleStats falcon = ros2_package::SampleStats::of(node->falcon_latency);
+      const double cpu_per_tick = node->control_ticks ? (cpu_end - cpu_start) * 1e-3 / node->control_ticks : 0.0;
+
+      table << name << "," << node->control_ticks << "," << cpu_per_tick << ","
+            << timer.p50 << "," << timer.p99 << "," << timer.max << ","
+            << joint.p50 << "," << joint.p99 << "," << falcon.p50 << "," << falcon.p99 << "\n";
+    }
+
+    std::cout << "\n" << table.str() << std::endl;
+    if (!output_file.empty()) {
+      std::ofstream f(output_file);
+      f << table.str();
+      std::cout << (f ? "Wrote the executor benchmark to " : "error: cannot write ") << output_file << "\n" << std::endl;
+    }
+  }
+
+private:
+
+  void print_params() {
+    std::cout << "\n\nThe current parameters [executor_benchmark] are as follows:\n" << std::endl;
+    std::cout << "Executors =";
+    for (const std::string & name : executors) std::cout << " " << name;
+    std::cout << "\n" << std::endl;
+    std::cout << "Duration = " << duration << " s, warm-up = " << warmup << " s\n" << std::endl;
+    std::cout << "Threads (multi) = " << threads << "\n" << std::endl;
+  }
+};
+
+
+
+//////////////////// MAIN FUNCTION ///////////////////
+
+int main(int argc, char * argv[])
+{
+  // the publishers get their own process, so their CPU time is not counted
+  pid_t child = fork();
+  if (child < 0) {
+    std::cout << "error: cannot start the publisher process" << std::endl;
+    return 1;
+  }
+  if (child == 0) {
+    rclcpp::init(argc, argv);
+    rclcpp::spin(std::make_shared<MixPublisher>());
+    rclcpp::shutdown();
+    return 0;
+  }
+
+  rclcpp::init(argc, argv);
+  auto benchmark = std::make_shared<ExecutorBenchmark>();
+  benchmark->run();
+
+  kill(child, SIGINT);
+  waitpid(child, nullptr, 0);
+  rclcpp::shutdown();
+  return 0;
+}
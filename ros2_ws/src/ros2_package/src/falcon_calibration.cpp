@@ -0,0 +1,216 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Calibration tool for the Falcon -> robot workspace mapping
+//
+// - Main functionalities:
+//   1. Guides the experimenter through a grid of physical jig points,
+//      recording the Falcon position (via ForceDimension SDK) at each one
+//   2. Fits a 3D lookup table over the Falcon workspace, correcting the
+//      position-dependent distortion of the device kinematics
+//   3. Writes the table in the binary format loaded (mmap) by the
+//      RealController / PositionTalker "mapping_lut" parameter
+//
+// - Usage:
+//   falcon_calibration <output.bin> [--ratio R] [--grid N] [--spacing S] [--lut N] [--identity]
+//
+//   --ratio    mapping ratio baked into the table (default 3.0)
+//   --grid     jig points per axis (default 3)
+//   --spacing  jig spacing in [meters] (default 0.02)
+//   --lut      table resolution per axis (default 9)
+//   --identity write the plain linear mapping, no device needed
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "dhdc.h"
+
+#include "ros2_package/workspace_map.hpp"
+
+
+struct CalibrationPoint
+{
+  double device[3];     // position reported by the SDK [m]
+  double physical[3];   // known position of the jig point [m]
+};
+
+
+/////////////////// function declarations ///////////////////
+bool record_grid(int grid, double spacing, std::vector<CalibrationPoint>& points);
+void fit_table(const std::vector<CalibrationPoint>& points, int lut_n, double ratio,
+               const double min[3], const double max[3], std::vector<double>& values);
+
+
+//////////////////// MAIN FUNCTION ///////////////////
+
+int main(int argc, char * argv[])
+{
+  if (argc < 2) {
+    printf ("usage: %s <output.bin> [--ratio R] [--grid N] [--spacing S] [--lut N] [--identity]\n", argv[0]);
+    return -1;
+  }
+
+  std::string output_file {argv[1]};
+  double ratio = 3.0;
+  int grid = 3;
+  double spacing = 0.02;
+  int lut_n = 9;
+  bool identity = false;
+
+  for (int i=2; i<argc; i++) {
+    if (!strcmp(argv[i], "--ratio") && i+1 < argc) ratio = std::atof(argv[++i]);
+    else if (!strcmp(argv[i], "--grid") && i+1 < argc) grid = std::atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--spacing") && i+1 < argc) spacing = std::atof(argv[++i]);
+    else if (!strcmp(argv[i], "--lut") && i+1 < argc) lut_n = std::atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--identity")) identity = true;
+  }
+  if (grid < 2 || lut_n < 2) {
+    printf ("error: --grid and --lut need at least 2 points per axis\n");
+    return -1;
+  }
+
+  // the Falcon workspace is about +-5 cm around the origin
+  double min[3] {-0.06, -0.06, -0.06};
+  double max[3] {0.06, 0.06, 0.06};
+  std::vector<CalibrationPoint> points;
+
+  if (!identity) {
+    if (!record_grid(grid, spacing, points)) return -1;
+
+    // cover the recorded points, plus a margin of one jig spacing
+    for (size_t a=0; a<3; a++) {
+      min[a] = points.at(0).device[a];
+      max[a] = points.at(0).device[a];
+      for (auto & pt : points) {
+        min[a] = std::min(min[a], pt.device[a]);
+        max[a] = std::max(max[a], pt.device[a]);
+      }
+      min[a] -= spacing;
+      max[a] += spacing;
+    }
+  }
+
+  std::vector<double> values;
+  fit_table(points, lut_n, ratio, min, max, values);
+
+  uint32_t n[3] = {(uint32_t) lut_n, (uint32_t) lut_n, (uint32_t) lut_n};
+  if (!ros2_package::write_workspace_map(output_file, n, min, max, values)) {
+    printf ("error: cannot write %s\n", output_file.c_str());
+    return -1;
+  }
+
+  printf ("\nSuccess! Wrote a %d x %d x %d lookup table to %s\n\n", lut_n, lut_n, lut_n, output_file.c_str());
+  return 0;
+}
+
+
+/////////////////////////////// recording the jig points ///////////////////////////////
+
+bool record_grid(int grid, double spacing, std::vector<CalibrationPoint>& points)
+{
+  if (dhdOpen () < 0) {
+    printf ("error: cannot open device (%s)\n", dhdErrorGetLastStr());
+    dhdSleep (2.0);
+    return false;
+  }
+  printf ("%s device detected\n\n", dhdGetSystemName());
+
+  // no forces, the experimenter moves the handle freely
+  dhdEnableExpertMode ();
+  dhdEnableForce (DHD_OFF);
+  dhdEmulateButton (DHD_ON);
+
+  // guide:
+  // {x, y, z} = {1, 2, 3} DOFS = {in/out, left/right, up/down}
+  // positive axes directions are {out, right, up}
+  const double half = 0.5 * (grid - 1);
+
+  for (int ix=0; ix<grid; ix++) {
+    for (int iy=0; iy<grid; iy++) {
+      for (int iz=0; iz<grid; iz++) {
+
+        CalibrationPoint pt;
+        pt.physical[0] = (ix - half) * spacing;
+        pt.physical[1] = (iy - half) * spacing;
+        pt.physical[2] = (iz - half) * spacing;
+
+        printf ("Place the handle at jig point (%d, %d, %d) = (%.1f, %.1f, %.1f) cm and press the button ...\n",
+                ix, iy, iz, pt.physical[0] * 100, pt.physical[1] * 100, pt.physical[2] * 100);
+
+        // wait for a press, then for the release (so one press records one point)
+        while (!dhdGetButton(0)) {
+          if (dhdKbHit() && dhdKbGet() == 'q') { dhdClose(); return false; }
+          dhdSleep(0.01);
+        }
+        while (dhdGetButton(0)) dhdSleep(0.01);
+
+        // average the reading over 0.2 seconds
+        const int n_samples = 200;
+        double sum[3] {0.0, 0.0, 0.0};
+        for (int k=0; k<n_samples; k++) {
+          double p[3];
+          dhdGetPosition(&(p[0]), &(p[1]), &(p[2]));
+          for (size_t a=0; a<3; a++) sum[a] += p[a];
+          dhdSleep(0.001);
+        }
+        for (size_t a=0; a<3; a++) pt.device[a] = sum[a] / n_samples;
+
+        printf ("    recorded device position (%.2f, %.2f, %.2f) cm\n\n",
+                pt.device[0] * 100, pt.device[1] * 100, pt.device[2] * 100);
+        points.push_back(pt);
+      }
+    }
+  }
+
+  dhdClose();
+  return true;
+}
+
+
+/////////////////////////////// fitting the lookup table ///////////////////////////////
+
+// each table node gets its device position plus the inverse-distance weighted correction
+// {physical - device} of the recorded points, then the mapping ratio is applied
+void fit_table(const std::vector<CalibrationPoint>& points, int lut_n, double ratio,
+               const double min[3], const double max[3], std::vector<double>& values)
+{
+  values.assign((size_t) lut_n * lut_n * lut_n * 3, 0.0);
+
+  for (int ix=0; ix<lut_n; ix++) {
+    for (int iy=0; iy<lut_n; iy++) {
+      for (int iz=0; iz<lut_n; iz++) {
+
+        double node[3] = {
+          min[0] + (max[0] - min[0]) * ix / (lut_n - 1),
+          min[1] + (max[1] - min[1]) * iy / (lut_n - 1),
+          min[2] + (max[2] - min[2]) * iz / (lut_n - 1)
+        };
+
+        double corr[3] {0.0, 0.0, 0.0};
+        double w_sum = 0.0;
+        for (auto & pt : points) {
+          double d2 = 0.0;
+          for (size_t a=0; a<3; a++) d2 += (node[a] - pt.device[a]) * (node[a] - pt.device[a]);
+          double w = 1.0 / (d2 + 1e-10);
+          for (size_t a=0; a<3; a++) corr[a] += w * (pt.physical[a] - pt.device[a]);
+          w_sum += w;
+        }
+
+        double * v = &values.at((((size_t) ix * lut_n + iy) * lut_n + iz) * 3);
+        for (size_t a=0; a<3; a++) {
+          double c = w_sum > 0.0 ? corr[a] / w_sum : 0.0;
+          v[a] = (node[a] + c) * ratio;
+        }
+      }
+    }
+  }
+}
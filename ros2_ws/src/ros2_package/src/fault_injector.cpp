@@ -0,0 +1,382 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - C++ class implementation of the FaultInjector node, sitting between
+//   the publisher and the subscribers of one topic (of any message type)
+//
+// - Main functionalities:
+//   1. Relays the serialized messages of input_topic to output_topic,
+//      applying a scripted delay / jitter / drop / duplication / reorder
+//      profile (include/ros2_package/fault_profile.hpp)
+//   2. Releases the messages from a timing wheel (include/ros2_package/timing_wheel.hpp)
+//      with 100 us ticks, by its own thread sleeping until the next one is due
+//   3. Optionally loads chosen cores with CPU and memory stress threads
+//   4. Monitors the controller meanwhile: period jitter of desired_joint_vals
+//      and TCP tracking error from tcp_position, reported per profile phase
+//
+// - Usage, e.g. 20 ms of Falcon delay after 10 s, remapping the controller input:
+//   ros2 run ros2_package real_controller --ros-args -r falcon_position:=falcon_position_faulty
+//   ros2 run ros2_package fault_injector --ros-args -p phase_start:="[0.0, 10.0]" -p delay_ms:="[0.0, 20.0]"
+//
+//   or for a burst of dropped joint states (input franka/joint_states, output
+//   franka/joint_states_faulty, message_type sensor_msgs/msg/JointState)
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp/serialized_message.hpp"
+#include "sensor_msgs/msg/joint_state.hpp"
+
+#include "tutorial_interfaces/msg/pos_info.hpp"
+
+#include "ros2_package/fault_profile.hpp"
+#include "ros2_package/timing_wheel.hpp"
+#include "ros2_package/qos_profiles.hpp"
+
+using namespace std::chrono_literals;
+
+
+/////////////// DEFINITION OF NODE CLASS //////////////
+
+class FaultInjector : public rclcpp::Node
+{
+public:
+
+  // parameters name list
+  std::vector<std::string> param_names = {"input_topic", "output_topic", "message_type", "seed",
+                                          "phase_start", "delay_ms", "jitter_ms", "drop_prob", "drop_burst",
+                                          "dup_prob", "reorder_prob", "reorder_hold_ms",
+                                          "stress_cores", "stress_memory_mb", "duration", "report_file"};
+  std::string input_topic {"falcon_position"};
+  std::string output_topic {"falcon_position_faulty"};
+  std::string message_type {"tutorial_interfaces/msg/Falconpos"};
+  int seed {0};
+
+  // profile script, one entry per phase
+  std::vector<double> phase_start {0.0};     // [s] since the first message
+  std::vector<double> delay_ms {0.0};
+  std::vector<double> jitter_ms {0.0};
+  std::vector<double> drop_prob {0.0};
+  std::vector<double> drop_burst {1.0};
+  std::vector<double> dup_prob {0.0};
+  std::vector<double> reorder_prob {0.0};
+  double reorder_hold_ms {5.0};
+
+  // load
+  std::vector<int64_t> stress_cores {};      // one stress thread pinned on each
+  int stress_memory_mb {0};                  // buffer swept by every stress thread, 0 = CPU only
+
+  double duration {0.0};                     // [s] since the first message, 0 = until shut down
+  std::string report_file {""};
+
+  ros2_package::FaultProfile profile;
+
+  // timing wheel, shared by the subscription callback and the release thread
+  ros2_package::TimingWheel< std::shared_ptr<rclcpp::SerializedMessage> > wheel {100000, 65536};
+  std::mutex wheel_mutex;
+  std::condition_variable wheel_cv;          // a message was scheduled, or the node stops
+  size_t overflows = 0;                      // messages dropped with the wheel full
+  std::thread release_thread;
+  std::vector<std::thread> stress_threads;
+  std::atomic<bool> running {true};
+
+  std::chrono::steady_clock::time_point first_message;
+  bool got_first_message = false;
+  std::vector<double> delays;
+
+  // controller monitor, per phase
+  std::vector< std::vector<double> > period_jitter;     // [us]
+  std::vector< std::vector<double> > tracking_error;    // [m]
+  std::chrono::steady_clock::time_point prev_command;
+  bool got_command = false;
+
+
+  FaultInjector()
+  : Node("fault_injector")
+  {
+    // parameter stuff
+    this->declare_parameter(param_names.at(0), "falcon_position");
+    this->declare_parameter(param_names.at(1), "falcon_position_faulty");
+    this->declare_parameter(param_names.at(2), "tutorial_interfaces/msg/Falconpos");
+    this->declare_parameter(param_names.at(3), 0);
+    this->declare_parameter(param_names.at(4), std::vector<double>{0.0});
+    this->declare_parameter(param_names.at(5), std::vector<double>{0.0});
+    this->declare_parameter(param_names.at(6), std::vector<double>{0.0});
+    this->declare_parameter(param_names.at(7), std::vector<double>{0.0});
+    this->declare_parameter(param_names.at(8), std::vector<double>{1.0});
+    this->declare_parameter(param_names.at(9), std::vector<double>{0.0});
+    this->declare_parameter(param_names.at(10), std::vector<double>{0.0});
+    this->declare_parameter(param_names.at(11), 5.0);
+    this->declare_parameter(param_names.at(12), std::vector<int64_t>{});
+    this->declare_parameter(param_names.at(13), 0);
+    this->declare_parameter(param_names.at(14), 0.0);
+    this->declare_parameter(param_names.at(15), "");
+
+    std::vector<rclcpp::Parameter> params = this->get_parameters(param_names);
+    input_topic = params.at(0).as_string();
+    output_topic = params.at(1).as_string();
+    message_type = params.at(2).as_string();
+    seed = std::stoi(params.at(3).value_to_string().c_str());
+    phase_start = params.at(4).as_double_array();
+    delay_ms = params.at(5).as_double_array();
+    jitter_ms = params.at(6).as_double_array();
+    drop_prob = params.at(7).as_double_array();
+    drop_burst = params.at(8).as_double_array();
+    dup_prob = params.at(9).as_double_array();
+    reorder_prob = params.at(10).as_double_array();
+    reorder_hold_ms = std::stod(params.at(11).value_to_string().c_str());
+    stress_cores = params.at(12).as_integer_array();
+    stress_memory_mb = std::stoi(params.at(13).value_to_string().c_str());
+    duration = std::stod(params.at(14).value_to_string().c_str());
+    report_file = params.at(15).as_string();
+    print_params();
+
+    // build the phase script, every list holds one value per phase (or a single value for all)
+    const size_t n_phases = phase_start.size();
+    auto at = [n_phases](const std::vector<double>& v, size_t k) { return v.size() == n_phases ? v.at(k) : (v.empty() ? 0.0 : v.at(0)); };
+    std::vector<ros2_package::FaultPhase> phases(n_phases);
+    for (size_t k=0; k<n_phases; k++) {
+      phases.at(k).start = phase_start.at(k);
+      phases.at(k).delay = at(delay_ms, k) / 1000;
+      phases.at(k).jitter = at(jitter_ms, k) / 1000;
+      phases.at(k).drop_prob = at(drop_prob, k);
+      phases.at(k).drop_burst = (int) at(drop_burst, k);
+      phases.at(k).dup_prob = at(dup_prob, k);
+      phases.at(k).reorder_prob = at(reorder_prob, k);
+      phases.at(k).reorder_hold = reorder_hold_ms / 1000;
+    }
+    profile.configure(phases, (unsigned int) seed);
+    period_jitter.resize(profile.phases().size());
+    tracking_error.resize(profile.phases().size());
+
+    // relay, QoS of both sides from config/qos_profiles.yaml (a best effort input matches any publisher)
+    output_pub_ = this->create_generic_publisher(output_topic, message_type, ros2_package::topic_qos(this, output_topic));
+    input_sub_ = this->create_generic_subscription(input_topic, message_type, ros2_package::topic_qos(this, input_topic, "control"),
+      std::bind(&FaultInjector::input_callback, this, std::placeholders::_1));
+
+    // controller monitor
+    command_sub_ = this->create_subscription<sensor_msgs::msg::JointState>(
+      "desired_joint_vals", ros2_package::topic_qos(this, "desired_joint_vals", "control"), std::bind(&FaultInjector::command_callback, this, std::placeholders::_1));
+    tcp_pos_sub_ = this->create_subscription<tutorial_interfaces::msg::PosInfo>(
+      "tcp_position", 10, std::bind(&FaultInjector::tcp_pos_callback, this, std::placeholders::_1));
+
+    release_thread = std::thread(&FaultInjector::release_loop, this);
+    start_stress();
+
+    if (duration > 0.0) check_timer_ = this->create_wall_timer(100ms, std::bind(&FaultInjector::check_duration, this));
+  }
+
+  ~FaultInjector()
+  {
+    stop();
+  }
+
+  // stops the release and stress threads, before the report (and before the context is gone for good)
+  void stop()
+  {
+    {
+      std::lock_guard<std::mutex> lock(wheel_mutex);
+      running = false;
+    }
+    wheel_cv.notify_all();
+    if (release_thread.joinable()) release_thread.join();
+    for (auto & t : stress_threads) if (t.joinable()) t.join();
+  }
+
+  ///////////////////////////////////// REPORT /////////////////////////////////////
+  void write_report()
+  {
+    std::stringstream ss;
+    ss << "fault injection " << input_topic << " -> " << output_topic << " (" << message_type << "), seed " << seed
+       << ", stress on " << stress_cores.size() << " cores with " << stress_memory_mb << " MB, "
+       << overflows << " messages dropped with the timing wheel full\n";
+    ss << "phase,start_s,delay_ms,jitter_ms,drop_prob,drop_burst,dup_prob,reorder_prob,"
+       << "received,dropped,duplicated,reordered,"
+       << "command_jitter_p50_us,command_jitter_p99_us,command_jitter_max_us,tracking_error_mean_mm,tracking_error_max_mm\n";
+
+    for (size_t k=0; k<profile.phases().size(); k++) {
+      const ros2_package::FaultPhase & p = profile.phases().at(k);
+      const ros2_package::FaultCounters & c = profile.counters(k);
+
+      std::vector<double> j = period_jitter.at(k);
+      std::sort(j.begin(), j.end());
+      auto pct = [&j](double q) { return j.empty() ? 0.0 : j.at((size_t) (q * (j.size() - 1))); };
+
+      double err_sum = 0.0, err_max = 0.0;
+      for (double e : tracking_error.at(k)) {
+        err_sum += e;
+        err_max = std::max(err_max, e);
+      }
+      const double err_mean = tracking_error.at(k).empty() ? 0.0 : err_sum / tracking_error.at(k).size();
+
+      ss << k << "," << p.start << "," << 1000 * p.delay << "," << 1000 * p.jitter << "," << p.drop_prob << "," << p.drop_burst << ","
+         << p.dup_prob << "," << p.reorder_prob << "," << c.received << "," << c.dropped << "," << c.duplicated << "," << c.reordered << ","
+         << pct(0.5) << "," << pct(0.99) << "," << (j.empty() ? 0.0 : j.back()) << "," << 1000 * err_mean << "," << 1000 * err_max << "\n";
+    }
+
+    std::cout << "\n" << ss.str() << std::endl;
+    if (!report_file.empty()) {
+      std::ofstream f(report_file);
+      f << ss.str();
+      std::cout << (f ? "Wrote the fault injection report to " : "error: cannot write ") << report_file << "\n" << std::endl;
+    }
+  }
+
+
+private:
+
+  // [s] since the first relayed message, the clock of the profile script
+  double script_time() const
+  {
+    if (!got_first_message) return 0.0;
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - first_message).count();
+  }
+
+  static int64_t steady_ns()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  ///////////////////////////////////// RELAY /////////////////////////////////////
+  void input_callback(std::shared_ptr<rclcpp::SerializedMessage> msg)
+  {
+    if (!got_first_message) {
+      first_message = std::chrono::steady_clock::now();
+      got_first_message = true;
+    }
+    const int64_t now = steady_ns();
+    profile.decide(script_time(), delays);
+
+    if (delays.empty()) return;
+    {
+      std::lock_guard<std::mutex> lock(wheel_mutex);
+      for (double d : delays) {
+        if (!wheel.schedule(now + (int64_t) (d * 1e9), msg)) overflows++;
+      }
+    }
+    wheel_cv.notify_one();
+  }
+
+  // sleeps until the next message is due (or a new one is scheduled), publishing outside of the lock
+  void release_loop()
+  {
+    std::vector< std::shared_ptr<rclcpp::SerializedMessage> > out;
+    std::unique_lock<std::mutex> lock(wheel_mutex);
+    wheel.start(steady_ns());
+
+    while (running) {
+      const int64_t due = wheel.next_due_ns();
+      if (due < 0) wheel_cv.wait(lock);
+      else wheel_cv.wait_until(lock, std::chrono::steady_clock::time_point(std::chrono::nanoseconds(due)));
+      if (!running) break;
+
+      out.clear();
+      wheel.advance(steady_ns(), [&out](int64_t, std::shared_ptr<rclcpp::SerializedMessage>& msg) { out.push_back(std::move(msg)); });
+      if (out.empty()) continue;
+
+      // the context may already be shut down (Ctrl-C, duration reached), the messages still in flight are dropped
+      lock.unlock();
+      try {
+        for (auto & msg : out) output_pub_->publish(*msg);
+      } catch (const std::exception &) {
+        if (!rclcpp::ok()) return;
+        throw;
+      }
+      lock.lock();
+    }
+  }
+
+  ///////////////////////////////////// LOAD /////////////////////////////////////
+  void start_stress()
+  {
+    const size_t buffer_bytes = (size_t) std::max(stress_memory_mb, 0) * 1024 * 1024;
+    for (int64_t core : stress_cores) {
+      stress_threads.emplace_back([this, core, buffer_bytes]() {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET((int) core, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+          std::cout << "Cannot pin a stress thread on core " << core << std::endl;
+        }
+
+        // compute, then sweep the buffer one cache line at a time
+        std::vector<char> buffer(buffer_bytes, 1);
+        volatile double x = 1.0;
+        while (running) {
+          for (int i=0; i<100000; i++) x = std::sqrt(x + i);
+          for (size_t i=0; i<buffer.size(); i+=64) buffer[i]++;
+        }
+      });
+    }
+  }
+
+  ///////////////////////////////////// CONTROLLER MONITOR /////////////////////////////////////
+  void command_callback(const sensor_msgs::msg::JointState &)
+  {
+    auto now = std::chrono::steady_clock::now();
+    if (got_command && got_first_message) {
+      const double period_us = std::chrono::duration<double, std::micro>(now - prev_command).count();
+      period_jitter.at(profile.phase_at(script_time())).push_back(std::fabs(period_us - 2000.0));   // controller runs at 500 Hz
+    }
+    prev_command = now;
+    got_command = true;
+  }
+
+  void tcp_pos_callback(const tutorial_interfaces::msg::PosInfo & msg)
+  {
+    if (!got_first_message || msg.tcp_position.size() < 3 || msg.ref_position.size() < 3) return;
+    double e2 = 0.0;
+    for (size_t i=0; i<3; i++) e2 += std::pow(msg.tcp_position.at(i) - msg.ref_position.at(i), 2);
+    tracking_error.at(profile.phase_at(script_time())).push_back(std::sqrt(e2));
+  }
+
+  void check_duration()
+  {
+    if (got_first_message && script_time() >= duration) rclcpp::shutdown();
+  }
+
+  void print_params() {
+    std::cout << "\n\nThe current parameters [fault_injector] are as follows:\n" << std::endl;
+    std::cout << "Relay = " << input_topic << " -> " << output_topic << " (" << message_type << ")\n" << std::endl;
+    std::cout << "Phases = " << phase_start.size() << ", seed = " << seed << "\n" << std::endl;
+    std::cout << "Stress cores = " << stress_cores.size() << ", memory = " << stress_memory_mb << " MB\n" << std::endl;
+  }
+
+  rclcpp::GenericPublisher::SharedPtr output_pub_;
+  rclcpp::GenericSubscription::SharedPtr input_sub_;
+  rclcpp::Subscription<sensor_msgs::msg::JointState>::SharedPtr command_sub_;
+  rclcpp::Subscription<tutorial_interfaces::msg::PosInfo>::SharedPtr tcp_pos_sub_;
+  rclcpp::TimerBase::SharedPtr check_timer_;
+};
+
+
+
+//////////////////// MAIN FUNCTION ///////////////////
+
+int main(int argc, char * argv[])
+{
+  rclcpp::init(argc, argv);
+  auto fault_injector = std::make_shared<FaultInjector>();
+  rclcpp::spin(fault_injector);
+  fault_injector->stop();
+  fault_injector->write_report();
+  rclcpp::shutdown();
+  return 0;
+}
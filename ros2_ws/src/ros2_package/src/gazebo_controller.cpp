@@ -26,28 +26,20 @@
 
 #include "tutorial_interfaces/msg/falconpos.hpp"
 
+#include "ros2_package/panda_kinematics.hpp"
+#include "ros2_package/qos_profiles.hpp"
+
 #include <chrono>
 #include <functional>
 #include <memory>
 #include <string>
 #include <stdio.h>
 
-#include <kdl_parser/kdl_parser.hpp>
-#include <kdl/chain.hpp>
-#include <kdl/chainjnttojacsolver.hpp>
-#include <kdl/chainfksolverpos_recursive.hpp>
-#include <kdl/chainiksolverpos_nr.hpp>
-#include <kdl/chainiksolvervel_pinv.hpp>
-#include <kdl/frames.hpp>
-#include <kdl/jacobian.hpp>
-#include <kdl/jntarray.hpp>
-
 
 using namespace std::chrono_literals;
 
 
 /////////////////// global variables ///////////////////
-const std::string urdf_path = "{URDF_PATH}";
 const unsigned int n_joints = 7;
 
 const std::vector<double> lower_joint_limits {-2.8973, -1.7628, -2.8973, -3.0718, -2.8973, -0.0175, -2.8973};
@@ -55,23 +47,11 @@ const std::vector<double> upper_joint_limits {2.8973, 1.7628, 2.8973, -0.0698, 2
 
 const bool display_time = true;
 
-KDL::Tree panda_tree;
-KDL::Chain panda_chain;
-
-KDL::Rotation orientation;
-bool got_orientation = false;
-
-std::vector<double> tcp_pos {0.3069, 0.0, 0.4853};   // initialized the same as the "home" position
-
 
 /////////////////// function declarations ///////////////////
-void compute_ik(std::vector<double>& desired_tcp_pos, std::vector<double>& curr_vals, std::vector<double>& res_vals);
-
 void get_robot_control(double t, std::vector<double>& vals);
 
 bool within_limits(std::vector<double>& vals);
-bool create_tree();
-void get_chain();
 
 void print_joint_vals(std::vector<double>& joint_vals);
 
@@ -82,7 +62,15 @@ void print_joint_vals(std::vector<double>& joint_vals);
 class GazeboController : public rclcpp::Node
 {
 public:
+
+  // parameters name list
+  std::vector<std::string> param_names = {"urdf_path", "latency"};
+  std::string urdf_path {""};   // empty = the chain compiled in at build time
+  double latency {2.0};         // artificial latency of the joint points published, in control periods
+  ros2_package::PandaKinematics kinematics;
+
   std::vector<double> origin {0.4569, 0.0, 0.3853}; //////// can change the task-space origin point! ////////
+  std::vector<double> tcp_pos {0.3069, 0.0, 0.4853};   // initialized the same as the "home" position
 
   std::vector<double> human_offset {0.0, 0.0, 0.0};
   std::vector<double> robot_offset {0.0, 0.0, 0.0};
@@ -94,7 +82,6 @@ public:
   
   const double mapping_ratio = 2.0;    /////// this ratio is {end-effector movement} / {Falcon movement}
   const int control_freq = 20;   // the rate at which the "controller_publisher" function is called in [Hz]
-  const double latency = 2.0;  // this is the artificial latency introduced into the joint points published
 
   // used to initially smoothly incorporate the Falcon offset
   const int smoothing_time = 5;   /// smoothing time in [seconds]
@@ -123,6 +110,14 @@ public:
   GazeboController()
   : Node("gazebo_controller")
   { 
+    // parameter stuff
+    this->declare_parameter(param_names.at(0), urdf_path);
+    this->declare_parameter(param_names.at(1), latency);
+
+    std::vector<rclcpp::Parameter> params = this->get_parameters(param_names);
+    urdf_path = params.at(0).as_string();
+    latency = std::stod(params.at(1).value_to_string().c_str());
+
     // joint controller publisher & timer
     controller_pub_ = this->create_publisher<trajectory_msgs::msg::JointTrajectory>("joint_trajectory_controller/joint_trajectory", 10);
     controller_timer_ = this->create_wall_timer(50ms, std::bind(&GazeboController::controller_publisher, this));    // controls at 20 Hz 
@@ -139,11 +134,11 @@ public:
       "joint_states", 10, std::bind(&GazeboController::joint_states_callback, this, std::placeholders::_1));
 
     falcon_pos_sub_ = this->create_subscription<tutorial_interfaces::msg::Falconpos>(
-      "falcon_position", 10, std::bind(&GazeboController::falcon_pos_callback, this, std::placeholders::_1));
+      "falcon_position", ros2_package::topic_qos(this, "falcon_position", "control"), std::bind(&GazeboController::falcon_pos_callback, this, std::placeholders::_1));
 
-    //Create Panda tree and get its kinematic chain
-    if (!create_tree()) rclcpp::shutdown();
-    get_chain();
+    //Create Panda tree, its kinematic chain and the IK solver
+    if (!kinematics.load(urdf_path)) rclcpp::shutdown();
+    std::cout << "Kinematic model = " << kinematics.source() << std::endl;
 
   }
 
@@ -170,7 +165,7 @@ private:
       tcp_pos.at(2) = origin.at(2) + az * human_offset.at(2) + (1-az) * robot_offset.at(2);
 
       ///////// compute IK /////////
-      compute_ik(tcp_pos, curr_joint_vals, ik_joint_vals);
+      kinematics.compute_ik(tcp_pos, curr_joint_vals, ik_joint_vals, display_time);
 
       ///////// initial smooth transitioning from current position to Falcon-mapped position /////////
       count++;  // increase count
@@ -188,7 +183,7 @@ private:
       ///////// prepare the trajectory message, introducing artificial latency /////////
       auto point = trajectory_msgs::msg::JointTrajectoryPoint();
       point.positions = message_joint_vals;
-      point.time_from_start.nanosec = (int)(1000 / control_freq) * latency * 1000000;     //// => {milliseconds} * 1e6
+      point.time_from_start = rclcpp::Duration::from_seconds(latency / control_freq);     //// split into sec & nanosec, so latencies above a second work too
 
       traj_message.points = {point};
 
@@ -307,55 +302,6 @@ void get_robot_control(double t, std::vector<double>& vals) {
 }
 
 
-/////////////////////////////// my own ik function ///////////////////////////////
-
-void compute_ik(std::vector<double>& desired_tcp_pos, std::vector<double>& curr_vals, std::vector<double>& res_vals) {
-
-  auto start = std::chrono::high_resolution_clock::now();
-
-	//Create solvers
-	KDL::ChainFkSolverPos_recursive fk_solver(panda_chain);
-	KDL::ChainIkSolverVel_pinv vel_ik_solver(panda_chain, 0.0001, 1000);
-	KDL::ChainIkSolverPos_NR ik_solver(panda_chain, fk_solver, vel_ik_solver, 1000);
-
-  //Create the KDL array of current joint values
-  KDL::JntArray jnt_pos_start(n_joints);
-  for (unsigned int i=0; i<n_joints; i++) {
-    jnt_pos_start(i) = curr_vals.at(i);
-  }
-
-  //Write in the initial orientation if not already done so
-  if (!got_orientation) {
-    //Compute current tcp position
-    KDL::Frame tcp_pos_start;
-    fk_solver.JntToCart(jnt_pos_start, tcp_pos_start);
-    orientation = tcp_pos_start.M;
-    got_orientation = true;
-  }
-
-  //Create the task-space goal object
-  // KDL::Vector vec_tcp_pos_goal(origin.at(0), origin.at(1), origin.at(2));
-  KDL::Vector vec_tcp_pos_goal(desired_tcp_pos.at(0), desired_tcp_pos.at(1), desired_tcp_pos.at(2));
-  KDL::Frame tcp_pos_goal(orientation, vec_tcp_pos_goal);
-
-  //Compute inverse kinematics
-  KDL::JntArray jnt_pos_goal(n_joints);
-  ik_solver.CartToJnt(jnt_pos_start, tcp_pos_goal, jnt_pos_goal);
-
-  //Change the control joint values and finish the function
-  for (unsigned int i=0; i<n_joints; i++) {
-    res_vals.at(i) = jnt_pos_goal.data(i);
-  }
-
-  if (display_time) {
-    auto finish = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(finish - start);
-    std::cout << "Execution of my IK solver function took " << duration.count() << " [microseconds]" << std::endl;
-  }
-  
-}
-
-
 ///////////////// other helper functions /////////////////
 
 bool within_limits(std::vector<double>& vals) {
@@ -365,18 +311,6 @@ bool within_limits(std::vector<double>& vals) {
   return true;
 }
 
-bool create_tree() {
-  if (!kdl_parser::treeFromFile(urdf_path, panda_tree)){
-		std::cout << "Failed to construct kdl tree" << std::endl;
-   	return false;
-  }
-  return true;
-}
-
-void get_chain() {
-  panda_tree.getChain("panda_link0", "panda_grasptarget", panda_chain);
-}
-
 void print_joint_vals(std::vector<double>& joint_vals) {
   
   std::cout << "[ ";
@@ -0,0 +1,161 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - C++ class implementation of the JointCommandUpsampler node
+//   bridging the 500 Hz RealController to the 1 kHz robot controller
+//
+// - Main functionalities:
+//   1. Subscribes to the desired joint values (<- RealController)
+//   2. Fits cubic Hermite segments through the incoming commands
+//      (see include/ros2_package/joint_command_upsampler.hpp)
+//   3. Publishes the interpolated joint values at the output rate
+//      (-> Custom Controller), and reports late commands (underruns)
+//
+// - Note: the same upsampler header can be used directly inside the
+//   update() of the ros2_control controller, which avoids the extra hop
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "rclcpp/rclcpp.hpp"
+#include "sensor_msgs/msg/joint_state.hpp"
+
+#include "ros2_package/joint_command_upsampler.hpp"
+#include "ros2_package/executor_utils.hpp"
+#include "ros2_package/qos_profiles.hpp"
+#include "ros2_package/thread_placement.hpp"
+
+using namespace std::chrono_literals;
+
+const unsigned int n_joints = 7;
+
+
+/////////////// DEFINITION OF NODE CLASS //////////////
+
+class JointCommandUpsamplerNode : public rclcpp::Node
+{
+public:
+
+  // parameters name list
+  std::vector<std::string> param_names = {"output_freq", "look_behind", "executor"};
+  int output_freq {1000};       // [Hz], the ros2_control update rate
+  double look_behind {0.003};   // [s], a bit more than one 500 Hz command period
+  std::string executor {"single"};   // see include/ros2_package/executor_utils.hpp
+
+  ros2_package::JointCommandUpsampler<n_joints> upsampler;
+
+  // preallocated output message
+  sensor_msgs::msg::JointState q_upsampled;
+
+  // QoS from config/qos_profiles.yaml, statistics of the command subscription (-> topic_stats)
+  std::unique_ptr<ros2_package::TopicStatsPublisher> topic_stats;
+  std::shared_ptr<ros2_package::TopicStats> command_stats;
+
+  // cores and scheduling of the node
+  ros2_package::ThreadPlacement placement;
+
+  uint64_t reported_underruns {0};
+  int count {0};
+
+
+  JointCommandUpsamplerNode()
+  : Node("joint_command_upsampler")
+  {
+    // parameter stuff
+    this->declare_parameter(param_names.at(0), 1000);
+    this->declare_parameter(param_names.at(1), 0.003);
+    this->declare_parameter(param_names.at(2), executor);
+
+    std::vector<rclcpp::Parameter> params = this->get_parameters(param_names);
+    output_freq = std::stoi(params.at(0).value_to_string().c_str());
+    look_behind = std::stod(params.at(1).value_to_string().c_str());
+    executor = params.at(2).as_string();
+    print_params();
+
+    // CPU placement of the upsampler (config/placement/<machine>.yaml via the launch file)
+    placement = ros2_package::declare_placement(this, "control");
+    ros2_package::place_process(placement);
+    std::cout << "Placement = " << placement.describe() << "\n" << std::endl;
+
+    upsampler.configure(look_behind);
+    q_upsampled.position.resize(n_joints, 0.0);
+
+    // upsampled joint values publisher
+    upsampled_pub_ = this->create_publisher<sensor_msgs::msg::JointState>(
+      "desired_joint_vals_upsampled", ros2_package::topic_qos(this, "desired_joint_vals_upsampled"));
+
+    // desired joint values subscriber
+    topic_stats = std::make_unique<ros2_package::TopicStatsPublisher>(this, 1.0);
+    const std::string command_qos = ros2_package::topic_qos_profile(this, "desired_joint_vals", "control");
+    command_stats = topic_stats->track("desired_joint_vals", command_qos);
+    command_sub_ = this->create_subscription<sensor_msgs::msg::JointState>(
+      "desired_joint_vals", ros2_package::qos_profile(command_qos),
+      std::bind(&JointCommandUpsamplerNode::command_callback, this, std::placeholders::_1, std::placeholders::_2));
+
+    timer_ = this->create_wall_timer(std::chrono::microseconds(1000000 / output_freq),
+                                     std::bind(&JointCommandUpsamplerNode::timer_callback, this));
+  }
+
+
+private:
+
+  void command_callback(const sensor_msgs::msg::JointState & msg, const rclcpp::MessageInfo & info)
+  {
+    command_stats->add(info);
+    if (msg.position.size() < n_joints) return;
+
+    // use the publisher's stamp when it is set, otherwise the arrival time
+    double t = rclcpp::Time(msg.header.stamp).seconds();
+    if (t == 0.0) t = this->now().seconds();
+
+    upsampler.push(t, msg.position.data());
+  }
+
+  void timer_callback()
+  {
+    const rclcpp::Time now = this->now();
+    auto status = upsampler.evaluate(now.seconds(), q_upsampled.position.data());
+    if (status == upsampler.EMPTY) return;
+
+    q_upsampled.header.stamp = now;
+    upsampled_pub_->publish(q_upsampled);
+
+    // report new underruns every second
+    count++;
+    if (count % output_freq == 0 && upsampler.underruns() > reported_underruns) {
+      RCLCPP_WARN(this->get_logger(), "Upsampler: %lu underruns (%lu late ticks, worst %.2f ms late)",
+                  (unsigned long) upsampler.underruns(), (unsigned long) upsampler.late_ticks(), 1000.0 * upsampler.max_late());
+      reported_underruns = upsampler.underruns();
+    }
+  }
+
+  void print_params() {
+    std::cout << "\n\nThe current parameters [joint_command_upsampler] are as follows:\n" << std::endl;
+    std::cout << "Output frequency = " << output_freq << "\n" << std::endl;
+    std::cout << "Look-behind = " << look_behind << "\n" << std::endl;
+    std::cout << "Executor = " << executor << "\n" << std::endl;
+  }
+
+  rclcpp::TimerBase::SharedPtr timer_;
+  rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr upsampled_pub_;
+  rclcpp::Subscription<sensor_msgs::msg::JointState>::SharedPtr command_sub_;
+};
+
+
+
+//////////////////// MAIN FUNCTION ///////////////////
+
+int main(int argc, char * argv[])
+{
+  rclcpp::init(argc, argv);
+  auto upsampler_node = std::make_shared<JointCommandUpsamplerNode>();
+  ros2_package::spin_node(upsampler_node, upsampler_node->executor);
+  rclcpp::shutdown();
+  return 0;
+}
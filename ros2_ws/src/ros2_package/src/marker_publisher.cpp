@@ -6,9 +6,11 @@
 //   for rendering the task information in RViz
 //
 // - Main functionalities:
-//   1. Subscribes to the robot TCP position
-//   2. Subscribes to the countdown for display in RViz
-//   3. Publishes the visualization markers (-> RViz)
+//   1. Subscribes to the trial phase / trajectory time origin (<- RealController)
+//   2. Computes the reference position locally from the same trajectory table
+//      as the controller, so the reference ball moves smoothly at the display rate
+//   3. Subscribes to the countdown for display in RViz
+//   4. Publishes the visualization markers (-> RViz)
 //
 //////////////////////////////////////////////////////
 //////////////////////////////////////////////////////
@@ -26,7 +28,13 @@
 #include "visualization_msgs/msg/marker_array.hpp"
 
 #include "tutorial_interfaces/msg/falconpos.hpp"
-#include "tutorial_interfaces/msg/pos_info.hpp"
+#include "tutorial_interfaces/msg/trial_event.hpp"
+
+#include "ros2_package/trajectory_generators.hpp"
+#include "ros2_package/tracing.hpp"
+#include "ros2_package/qos_profiles.hpp"
+#include "ros2_package/thread_placement.hpp"
+#include "ros2_package/executor_utils.hpp"
 
 using namespace std::chrono_literals;
 
@@ -39,7 +47,7 @@ void generate_tcp_marker(visualization_msgs::msg::Marker &tcp_marker);
 visualization_msgs::msg::Marker generate_countdown(int count, std::vector<double> &center);
 
 void generate_traj_marker(visualization_msgs::msg::Marker &traj_marker, std::vector<double> &origin, int max_points,
-                          double pa, double pb, double pc, double ps, double ph, double height, double width, double depth, int use_depth);
+                          const ros2_package::TrajectoryTable &ref_table);
 
 
 class MarkerPublisher : public rclcpp::Node
@@ -47,11 +55,17 @@ class MarkerPublisher : public rclcpp::Node
   public:
 
     // parameters name list
-    std::vector<std::string> param_names = {"use_depth", "part_id", "alpha_id", "traj_id"};
+    std::vector<std::string> param_names = {"use_depth", "part_id", "alpha_id", "traj_id", "marker_freq", "trajectory", "executor"};
     int use_depth {0};
     int part_id {0};
     int alpha_id {0};
     int traj_id {0};
+    int marker_freq {100};   // rendering rate in [Hz], independent of the controller
+    std::string trajectory {"sines"};   // reference generator spec, KEEP CONSISTENT WITH REAL CONTROLLER
+    std::string executor {"single"};    // see include/ros2_package/executor_utils.hpp
+
+    // cores and scheduling of the node, away from the control loop
+    ros2_package::ThreadPlacement placement;
     
      //////// KEEP CONSISTENT WITH REAL CONTROLLER ////////
     std::vector<double> origin {0.5059, 0.0, 0.4346};
@@ -63,7 +77,6 @@ class MarkerPublisher : public rclcpp::Node
     // for the progress bar
     std::vector<double> bar_center {0.3, 0.0, 0.05};
 
-    const int pub_freq = 50;   // [Hz]
     const int control_freq = 500;    // [Hz]
     const int max_smoothing_time = 5;   // [seconds]
     const double max_smoothing_count = control_freq * max_smoothing_time;
@@ -73,16 +86,13 @@ class MarkerPublisher : public rclcpp::Node
     int controller_seconds {0};
     int countdown_count {5};
 
-    // sine curve parameters (initialization)
-    int pa = 0;
-    int pb = 0;
-    int pc = 0;
-    double ps = 0.0;
-    double ph = 0.0;
-    
-    double traj_height = 0.1;
-    double traj_width = 0.3;
-    double traj_depth = 0.1;
+    // reference trajectory, the same table as the controller (one sample per control tick)
+    ros2_package::TrajectoryTable ref_table;
+
+    // trajectory time origin, received from the controller
+    bool got_event = false;
+    rclcpp::Time traj_origin;
+    double traj_duration = 10.0;   // [s]
   
 
     MarkerPublisher()
@@ -93,34 +103,44 @@ class MarkerPublisher : public rclcpp::Node
       this->declare_parameter(param_names.at(1), 0);
       this->declare_parameter(param_names.at(2), 0);
       this->declare_parameter(param_names.at(3), 0);
+      this->declare_parameter(param_names.at(4), 100);
+      this->declare_parameter(param_names.at(5), trajectory);
+      this->declare_parameter(param_names.at(6), executor);
       
       std::vector<rclcpp::Parameter> params = this->get_parameters(param_names);
       use_depth = std::stoi(params.at(0).value_to_string().c_str());
       part_id = std::stoi(params.at(1).value_to_string().c_str());
       alpha_id = std::stoi(params.at(2).value_to_string().c_str());
       traj_id = std::stoi(params.at(3).value_to_string().c_str());
+      marker_freq = std::stoi(params.at(4).value_to_string().c_str());
+      trajectory = params.at(5).as_string();
+      executor = params.at(6).as_string();
       print_params();
 
-      // write the sine curve parameters
-      switch (traj_id) {
-        case 0: pa = 1; pb = 1; pc = 4; ps = M_PI;     ph = 0.25; break;
-        case 1: pa = 2; pb = 3; pc = 4; ps = 4*M_PI/3; ph = 0.25; break;
-        case 2: pa = 1; pb = 3; pc = 4; ps = M_PI;     ph = 0.25; break;
-        case 3: pa = 2; pb = 2; pc = 5; ps = M_PI;     ph = 0.2; break;
-        case 4: pa = 2; pb = 3; pc = 5; ps = 8*M_PI/5; ph = 0.2; break;
-        case 5: pa = 2; pb = 4; pc = 5; ps = M_PI;     ph = 0.2; break;
+      // CPU placement of the markers (config/placement/<machine>.yaml via the launch file)
+      placement = ros2_package::declare_placement(this, "rendering");
+      ros2_package::place_process(placement);
+      std::cout << "Placement = " << placement.describe() << "\n" << std::endl;
+
+      // arm the reference trajectory
+      std::string trajectory_error;
+      if (!ref_table.arm(trajectory, traj_id, use_depth, control_freq * max_recording_time + 1, trajectory_error)) {
+        std::cout << "Invalid trajectory \"" << trajectory << "\": " << trajectory_error << ", shutting down" << std::endl;
+        rclcpp::shutdown();
+        return;
       }
 
       // generate the trajectory marker
-      generate_traj_marker(traj_marker_, origin, max_points, pa, pb, pc, ps, ph, traj_height, traj_width, traj_depth, use_depth);
+      generate_traj_marker(traj_marker_, origin, max_points, ref_table);
 
       // create the marker publisher
-      marker_timer_ = this->create_wall_timer(20ms, std::bind(&MarkerPublisher::marker_callback, this));  // publish this at 50 Hz
+      marker_timer_ = this->create_wall_timer(std::chrono::microseconds(1000000 / marker_freq),
+                                              std::bind(&MarkerPublisher::marker_callback, this));  // publish this at marker_freq
       marker_pub_ = this->create_publisher<visualization_msgs::msg::MarkerArray>("visualization_marker_array", 10);
 
-      // reference tcp position subscriber
-      ref_sub_ = this->create_subscription<tutorial_interfaces::msg::PosInfo>(
-      "tcp_position", 10, std::bind(&MarkerPublisher::ref_callback, this, std::placeholders::_1));
+      // trial event subscriber (latched, so the last event is received even when starting late)
+      event_sub_ = this->create_subscription<tutorial_interfaces::msg::TrialEvent>(
+      "trial_event", ros2_package::topic_qos(this, "trial_event", "event"), std::bind(&MarkerPublisher::event_callback, this, std::placeholders::_1));
 
       count_sub_ = this->create_subscription<std_msgs::msg::Float64>(
       "countdown", 10, std::bind(&MarkerPublisher::count_callback, this, std::placeholders::_1));
@@ -131,6 +151,9 @@ class MarkerPublisher : public rclcpp::Node
 
     void marker_callback()
     { 
+      AUTONOMY_TRACE_CALLBACK("marker_callback", countdown_count);
+      update_ref_pos();
+
       auto marker_array_msg = visualization_msgs::msg::MarkerArray();
 
       // add in the certain ones
@@ -150,18 +173,49 @@ class MarkerPublisher : public rclcpp::Node
         marker_array_msg.markers.push_back(countdown_text);
       }
       
+      AUTONOMY_TRACE(publish, "visualization_marker_array", countdown_count);
       marker_pub_->publish(marker_array_msg);
 
     }
 
-    void ref_callback(const tutorial_interfaces::msg::PosInfo & msg) 
-    { 
-      ref_pos.at(0) = msg.ref_position[0];
-      ref_pos.at(1) = msg.ref_position[1];
-      ref_pos.at(2) = msg.ref_position[2];
+    // reference position at the current time, stays at zero (= "not started") before the trajectory starts
+    void update_ref_pos()
+    {
+      if (!got_event) return;
+
+      double t = (this->now() - traj_origin).seconds();
+      if (t < 0.0) return;
+
+      double offset[3];
+      ref_table.offset(t / traj_duration * 2 * M_PI, offset);
+      for (size_t i=0; i<3; i++) ref_pos.at(i) = origin.at(i) + offset[i];
+    }
+
+    void event_callback(const tutorial_interfaces::msg::TrialEvent & msg)
+    {
+      AUTONOMY_TRACE_CALLBACK("event_callback", msg.phase);
+      const std::string event_trajectory = msg.trajectory.empty() ? "sines" : msg.trajectory;
+      if (msg.traj_id != traj_id || msg.use_depth != use_depth || event_trajectory != trajectory) {
+        // the controller's trajectory wins, re-arm and redraw it
+        std::string error;
+        if (!ref_table.arm(event_trajectory, msg.traj_id, msg.use_depth, control_freq * max_recording_time + 1, error)) {
+          RCLCPP_WARN(this->get_logger(), "Invalid trajectory \"%s\" announced: %s", event_trajectory.c_str(), error.c_str());
+          return;
+        }
+        RCLCPP_INFO(this->get_logger(), "Re-armed the reference from the trial event: traj_id = %d, use_depth = %d, trajectory = %s",
+                    msg.traj_id, msg.use_depth, event_trajectory.c_str());
+        traj_id = msg.traj_id;
+        use_depth = msg.use_depth;
+        trajectory = event_trajectory;
+        generate_traj_marker(traj_marker_, origin, max_points, ref_table);
+      }
+      traj_origin = rclcpp::Time(msg.traj_origin, this->get_clock()->get_clock_type());
+      traj_duration = msg.traj_duration;
+      got_event = true;
     }
 
     void count_callback(const std_msgs::msg::Float64 & msg) {
+      AUTONOMY_TRACE_CALLBACK("count_callback", (int64_t) msg.data);
       controller_seconds = (int) msg.data;
       if (controller_seconds != 0) {
         countdown_count = max_smoothing_time - controller_seconds;
@@ -174,14 +228,16 @@ class MarkerPublisher : public rclcpp::Node
       std::cout << "Use depth parameter = " << use_depth << "\n" << std::endl;
       std::cout << "Participant ID = " << part_id << "\n" << std::endl;
       std::cout << "Alpha ID = " << alpha_id << "\n" << std::endl;
-      std::cout << "Trajectory ID = " << traj_id << "\n" << std::endl;
+      std::cout << "Trajectory ID = " << traj_id << ", generator = " << trajectory << "\n" << std::endl;
+      std::cout << "Marker rate = " << marker_freq << " Hz\n" << std::endl;
+      std::cout << "Executor = " << executor << "\n" << std::endl;
       for (unsigned int i=0; i<10; i++) std::cout << "\n";
     }
 
     rclcpp::TimerBase::SharedPtr marker_timer_;
     rclcpp::Publisher<visualization_msgs::msg::MarkerArray>::SharedPtr marker_pub_;
 
-    rclcpp::Subscription<tutorial_interfaces::msg::PosInfo>::SharedPtr ref_sub_;
+    rclcpp::Subscription<tutorial_interfaces::msg::TrialEvent>::SharedPtr event_sub_;
     rclcpp::Subscription<std_msgs::msg::Float64>::SharedPtr count_sub_;
 
     visualization_msgs::msg::Marker traj_marker_;
@@ -302,7 +358,7 @@ visualization_msgs::msg::Marker generate_countdown(int count, std::vector<double
 
 /////////////////////////////////// FUNCTIONS TO GENERATE REFERENCE TRAJECTORY MARKERS ///////////////////////////////////
 void generate_traj_marker(visualization_msgs::msg::Marker &traj_marker, std::vector<double> &origin, int max_points,
-                          double pa, double pb, double pc, double ps, double ph, double height, double width, double depth, int use_depth)
+                          const ros2_package::TrajectoryTable &ref_table)
 {
   // fill-in the traj_marker message
   traj_marker.header.frame_id = "/panda_link0";
@@ -319,21 +375,19 @@ void generate_traj_marker(visualization_msgs::msg::Marker &traj_marker, std::vec
   traj_marker.color.b = 1.0;
   traj_marker.color.a = 0.2;
 
-  // Create the vertices for the points and lines
+  // Create the vertices for the points and lines (replacing those of a previous trajectory)
+  traj_marker.points.clear();
   for (int count=0; count<=max_points; count++) {
 
     double t = (double) count / max_points * 2 * M_PI;   // parametrized in the range [0, 2pi]
 
-    double x = 0.0;
-    if (use_depth) x = abs(t-M_PI) / M_PI * depth - (depth/2);
-    
-    double y = t / (2*M_PI) * width - (width/2);
-    double z = (ph*height) * (sin(pa*(t+ps)) + sin(pb*(t+ps)) + sin(pc*(t+ps)));
+    double offset[3];
+    ref_table.offset(t, offset);
 
     geometry_msgs::msg::Point p;
-    p.x = x + origin.at(0);
-    p.y = y + origin.at(1);
-    p.z = z + origin.at(2);
+    p.x = offset[0] + origin.at(0);
+    p.y = offset[1] + origin.at(1);
+    p.z = offset[2] + origin.at(2);
 
     traj_marker.points.push_back(p);
   }
@@ -344,7 +398,8 @@ void generate_traj_marker(visualization_msgs::msg::Marker &traj_marker, std::vec
 int main(int argc, char * argv[])
 {
   rclcpp::init(argc, argv);
-  rclcpp::spin(std::make_shared<MarkerPublisher>());
+  auto marker_publisher = std::make_shared<MarkerPublisher>();
+  ros2_package::spin_node(marker_publisher, marker_publisher->executor);
   rclcpp::shutdown();
   return 0;
 }
\ No newline at end of file
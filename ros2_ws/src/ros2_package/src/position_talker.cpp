@@ -7,13 +7,17 @@
 //
 // - Main functionalities:
 //   1. Listens to the Falcon joystick position (via ForceDimension SDK)
-//   2. Publishes the joystick position (-> GazeboController / RealController)
+//   2. Filters the joystick state with a Kalman filter at the servo rate
+//   3. Keeps the rendered forces passive (passivity observer / controller)
+//   4. Publishes the joystick position (-> GazeboController / RealController),
+//      optionally only when it leaves the perceptual deadband
 //
 //////////////////////////////////////////////////////
 //////////////////////////////////////////////////////
 
 #include <chrono>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <string>
 
@@ -22,6 +26,15 @@
 
 #include "tutorial_interfaces/msg/falconpos.hpp"
 
+#include "ros2_package/state_estimator.hpp"
+#include "ros2_package/passivity_controller.hpp"
+#include "ros2_package/perceptual_deadband.hpp"
+#include "ros2_package/workspace_map.hpp"
+#include "ros2_package/tracing.hpp"
+#include "ros2_package/qos_profiles.hpp"
+#include "ros2_package/thread_placement.hpp"
+#include "ros2_package/executor_utils.hpp"
+
 #include <stdio.h>
 #include "dhdc.h"
 
@@ -36,23 +49,62 @@ class PositionTalker : public rclcpp::Node
 public:
 
   // parameters name list
-  std::vector<std::string> param_names = {"mapping_ratio", "use_depth", "part_id", "alpha_id", "traj_id"};
+  std::vector<std::string> param_names = {"mapping_ratio", "use_depth", "part_id", "alpha_id", "traj_id",
+                                          "use_filter", "damping", "filter_meas_std", "filter_jerk_psd",
+                                          "use_passivity", "pc_max_damping",
+                                          "use_deadband", "deadband_k", "deadband_min", "deadband_heartbeat",
+                                          "mapping_lut", "lut_gamma", "executor"};
   double mapping_ratio {3.0};
   int use_depth {0};
   int part_id {0};
   int alpha_id {0};
   int traj_id {0};
 
+  // state estimator settings (the filtered velocity is much cleaner than dhdGetLinearVelocity,
+  // so the damping can be raised above 5 without exciting vibrations when the filter is on)
+  int use_filter {1};
+  double damping {5.0};
+  double filter_meas_std {6e-5};    // [m]
+  double filter_jerk_psd {10.0};    // [m^2/s^5]
+
+  // passivity controller settings (only adds damping when the rendered spring generates energy,
+  // e.g. when K is stepped up by the centering schedule below)
+  int use_passivity {1};
+  double pc_max_damping {40.0};     // [N.s/m]
+
+  // perceptual deadband settings (KEEP CONSISTENT WITH REAL CONTROLLER)
+  int use_deadband {0};
+  double deadband_k {0.05};         // Weber fraction
+  double deadband_min {3e-4};       // [m]
+  double deadband_heartbeat {0.1};  // [s]
+
+  // calibrated lookup table, only used here to find the centering position (KEEP CONSISTENT WITH REAL CONTROLLER)
+  std::string mapping_lut {""};
+  std::vector<double> lut_gamma {1.0, 1.0, 1.0};
+
+  std::string executor {"single"};  // see include/ros2_package/executor_utils.hpp
+
   // other arrays
   double p[3] {0.0, 0.0, 0.0};
   double v[3] {0.0, 0.0, 0.0};
   double f[3] {0.0, 0.0, 0.0};
   double K[3] {200.0, 50.0, 50.0};     //////////////////// -> this is the initial gain vector K, will be changed after a few seconds!
-  double C[3] {5.0, 5.0, 5.0};      //////////// -> damping vector C, having values higher than 5 will likely cause vibrations
+  double C[3] {5.0, 5.0, 5.0};      //////////// -> damping vector C, having values higher than 5 will likely cause vibrations with the raw velocity
   int choice;
 
+  // filtered joystick state
+  ros2_package::StateEstimator estimator;
+  ros2_package::PassivityController passivity;
+  ros2_package::DeadbandEncoder deadband;
+  double raw_p[3] {0.0, 0.0, 0.0};
+  std::chrono::steady_clock::time_point last_tick;
+  bool first_tick = true;
+
   const int pub_freq = 500;    // publishing rate in [Hz]
 
+  // cores and scheduling of the haptic loop
+  ros2_package::ThreadPlacement placement;
+
   ///////// -> this is the centering / starting Falcon pos, but is NOT THE ORIGIN => ORIGIN IS ALWAYS (0, 0, 0)
   ///////// -> max bounds are around +-0.05m (5cm)
   ///////// -> this depends on the alpha_id parameter
@@ -77,6 +129,19 @@ public:
     this->declare_parameter(param_names.at(2), 0);
     this->declare_parameter(param_names.at(3), 0);
     this->declare_parameter(param_names.at(4), 0);
+    this->declare_parameter(param_names.at(5), 1);
+    this->declare_parameter(param_names.at(6), 5.0);
+    this->declare_parameter(param_names.at(7), 6e-5);
+    this->declare_parameter(param_names.at(8), 10.0);
+    this->declare_parameter(param_names.at(9), 1);
+    this->declare_parameter(param_names.at(10), 40.0);
+    this->declare_parameter(param_names.at(11), 0);
+    this->declare_parameter(param_names.at(12), 0.05);
+    this->declare_parameter(param_names.at(13), 3e-4);
+    this->declare_parameter(param_names.at(14), 0.1);
+    this->declare_parameter(param_names.at(15), "");
+    this->declare_parameter(param_names.at(16), std::vector<double>{1.0, 1.0, 1.0});
+    this->declare_parameter(param_names.at(17), executor);
     
     std::vector<rclcpp::Parameter> params = this->get_parameters(param_names);
     mapping_ratio = std::stod(params.at(0).value_to_string().c_str());
@@ -84,16 +149,55 @@ public:
     part_id = std::stoi(params.at(2).value_to_string().c_str());
     alpha_id = std::stoi(params.at(3).value_to_string().c_str());
     traj_id = std::stoi(params.at(4).value_to_string().c_str());
+    use_filter = std::stoi(params.at(5).value_to_string().c_str());
+    damping = std::stod(params.at(6).value_to_string().c_str());
+    filter_meas_std = std::stod(params.at(7).value_to_string().c_str());
+    filter_jerk_psd = std::stod(params.at(8).value_to_string().c_str());
+    use_passivity = std::stoi(params.at(9).value_to_string().c_str());
+    pc_max_damping = std::stod(params.at(10).value_to_string().c_str());
+    use_deadband = std::stoi(params.at(11).value_to_string().c_str());
+    deadband_k = std::stod(params.at(12).value_to_string().c_str());
+    deadband_min = std::stod(params.at(13).value_to_string().c_str());
+    deadband_heartbeat = std::stod(params.at(14).value_to_string().c_str());
+    mapping_lut = params.at(15).as_string();
+    lut_gamma = params.at(16).as_double_array();
+    executor = params.at(17).as_string();
     print_params();
 
+    // CPU placement of the haptic loop and of the device SDK threads (config/placement/<machine>.yaml via the launch file)
+    placement = ros2_package::declare_placement(this, "haptic");
+    ros2_package::place_process(placement);
+    std::cout << "Placement = " << placement.describe() << "\n" << std::endl;
+
+    // set up the damping vector and the state estimator
+    for (size_t i=0; i<3; i++) C[i] = damping;
+    estimator.configure(filter_meas_std, filter_jerk_psd);
+    passivity.configure(pc_max_damping, std::numeric_limits<double>::infinity());
+    deadband.configure(deadband_k, deadband_min, deadband_heartbeat);
+
     // update first point if not using depth
     if (use_depth == 0) first_point = {0.01, -0.16, -0.01};
 
     // update centering position using "post_point" computed above
     for (size_t i=0; i<3; i++) centering.at(i) = first_point.at(i) / mapping_ratio;
 
-    // publisher
-    publisher_ = this->create_publisher<tutorial_interfaces::msg::Falconpos>("falcon_position", 10);
+    // with a calibrated lookup table, center on the Falcon position that maps onto the first point
+    if (!mapping_lut.empty()) {
+      ros2_package::WorkspaceMap workspace_map;
+      double target[3] = {first_point.at(0), first_point.at(1), first_point.at(2)};
+      double falcon_p[3];
+      // same per-axis scaling as the controller's forward map
+      const bool loaded = workspace_map.load(mapping_lut) && lut_gamma.size() == 3;
+      if (loaded) workspace_map.set_axis_scaling(lut_gamma.data());
+      if (loaded && workspace_map.invert(target, falcon_p)) {
+        for (size_t i=0; i<3; i++) centering.at(i) = falcon_p[i];
+      } else {
+        std::cout << "Failed to use the mapping lookup table " << mapping_lut << ", centering with the mapping ratio" << std::endl;
+      }
+    }
+
+    // publisher (QoS from config/qos_profiles.yaml)
+    publisher_ = this->create_publisher<tutorial_interfaces::msg::Falconpos>("falcon_position", ros2_package::topic_qos(this, "falcon_position"));
     timer_ = this->create_wall_timer(2ms, std::bind(&PositionTalker::timer_callback, this));       ///////// publishing at 500 Hz /////////
   }
 
@@ -102,9 +206,28 @@ private:
 
   void timer_callback()
   { 
+    AUTONOMY_TRACE_CALLBACK("timer_callback", count);
+
     ///////////////////////// FALCON STUFF /////////////////////////
-    dhdGetPosition(&(p[0]), &(p[1]), &(p[2]));
-    dhdGetLinearVelocity (&(v[0]), &(v[1]), &(v[2]));
+    // measure the actual servo period, the wall timer is not exactly 2 ms
+    auto now = std::chrono::steady_clock::now();
+    double dt = 1.0 / pub_freq;
+    if (!first_tick) dt = std::chrono::duration<double>(now - last_tick).count();
+    last_tick = now;
+    first_tick = false;
+
+    if (use_filter) {
+      // run the filter on the raw position, then use its position and velocity estimates
+      dhdGetPosition(&(raw_p[0]), &(raw_p[1]), &(raw_p[2]));
+      AUTONOMY_TRACE(device_read, "dhdGetPosition", count);
+      estimator.step(raw_p, dt);
+      estimator.get_position(p);
+      estimator.get_velocity(v);
+    } else {
+      dhdGetPosition(&(p[0]), &(p[1]), &(p[2]));
+      dhdGetLinearVelocity (&(v[0]), &(v[1]), &(v[2]));
+      AUTONOMY_TRACE(device_read, "dhdGetPosition", count);
+    }
 
     if (count < count_thres2) {
       // gradually perform centering {in increasing levels of K = 1000 -> K = 2000, after 1 -> 2 seconds}
@@ -118,19 +241,35 @@ private:
       }
     }
 
-    if (dhdSetForceAndTorqueAndGripperForce (f[0], f[1], f[2], 0.0, 0.0, 0.0, 0.0) < DHD_NO_ERROR) {
+    // add damping only when the rendered environment has become active
+    if (use_passivity) passivity.step(f, v, dt);
+
+    AUTONOMY_TRACE(device_write_start, "dhdSetForce", count);
+    const int force_status = dhdSetForceAndTorqueAndGripperForce (f[0], f[1], f[2], 0.0, 0.0, 0.0, 0.0);
+    AUTONOMY_TRACE(device_write_end, "dhdSetForce", count);
+    if (force_status < DHD_NO_ERROR) {
       printf ("error: cannot set force (%s)\n", dhdErrorGetLastStr());
       printf ("\n\n=============================== THANK YOU FOR FLYING WITH FALCON ===============================\n\n");
       rclcpp::shutdown();
     }
 
-    // generate and publish the message
-    auto message = tutorial_interfaces::msg::Falconpos();
-    message.x = p[0] * 100;
-    message.y = p[1] * 100;
-    message.z = p[2] * 100;
-    // RCLCPP_INFO(this->get_logger(), "Publishing position: px = %.3f, py = %.3f, pz = %.3f  [in cm]", message.x, message.y, message.z);
-    publisher_->publish(message);
+    // generate and publish the message (skipped while the hand stays inside the deadband)
+    double t_now = std::chrono::duration<double>(now.time_since_epoch()).count();
+    if (!use_deadband || deadband.should_send(p, t_now)) {
+      auto message = tutorial_interfaces::msg::Falconpos();
+      message.x = p[0] * 100;
+      message.y = p[1] * 100;
+      message.z = p[2] * 100;
+      // RCLCPP_INFO(this->get_logger(), "Publishing position: px = %.3f, py = %.3f, pz = %.3f  [in cm]", message.x, message.y, message.z);
+      AUTONOMY_TRACE(publish, "falcon_position", count);
+      publisher_->publish(message);
+    }
+
+    // log the transmitted vs suppressed ratio every 5 seconds
+    if (use_deadband && count > 0 && count % (5 * pub_freq) == 0) {
+      RCLCPP_INFO(this->get_logger(), "Deadband: transmitted = %lu, suppressed = %lu (%.1f %% sent)",
+                  (unsigned long) deadband.transmitted(), (unsigned long) deadband.suppressed(), 100.0 * deadband.transmit_ratio());
+    }
 
 
 
@@ -157,6 +296,11 @@ private:
     std::cout << "Participant ID = " << part_id << "\n" << std::endl;
     std::cout << "Alpha ID = " << alpha_id << "\n" << std::endl;
     std::cout << "Trajectory ID = " << traj_id << "\n" << std::endl;
+    std::cout << "Use filter = " << use_filter << "\n" << std::endl;
+    std::cout << "Damping = " << damping << "\n" << std::endl;
+    std::cout << "Use passivity controller = " << use_passivity << "\n" << std::endl;
+    std::cout << "Use deadband = " << use_deadband << "\n" << std::endl;
+    std::cout << "Executor = " << executor << "\n" << std::endl;
     for (unsigned int i=0; i<10; i++) std::cout << "\n";
   }
 
@@ -223,7 +367,7 @@ int main(int argc, char * argv[])
 
   std::shared_ptr<PositionTalker> position_talker = std::make_shared<PositionTalker>(choice);
 
-  rclcpp::spin(position_talker);
+  ros2_package::spin_node(position_talker, position_talker->executor);
 
   return 0;
 }
@@ -0,0 +1,196 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - pybind11 module ros2_package._kernels, exposing the C++ kernels the
+//   controllers use to the Python side (TrajRecorder, DataLogger, notebooks)
+//
+// - Main functionalities:
+//   1. sine_ref_points: the reference trajectory (include/ros2_package/error_kernels.hpp)
+//   2. blend: convex combination of human and robot offsets
+//   3. tracking_errors: per-axis and Euclidean errors against the reference
+//   4. fk / ik: Panda kinematics over the chain compiled in at build time
+//   5. trajectory_points: the reference table of a trajectory generator spec
+//      (include/ros2_package/trajectory_generators.hpp)
+//
+// - Arrays go through the buffer protocol, float64 C-contiguous inputs are
+//   read in place (anything else is converted once), outputs are new arrays
+//
+// - Use it through ros2_package/kernels.py, which falls back to NumPy when
+//   the module was not built
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ros2_package/error_kernels.hpp"
+#include "ros2_package/panda_kinematics.hpp"
+#include "ros2_package/traj_utils.hpp"
+#include "ros2_package/trajectory_generators.hpp"
+
+namespace py = pybind11;
+
+// float64, C-contiguous: no copy when the caller already passes that
+using array_d = py::array_t<double, py::array::c_style | py::array::forcecast>;
+
+
+// rows of an (n, cols) array, a single row may also be given as a (cols,) vector
+static size_t rows(const array_d & a, py::ssize_t cols, const char * name)
+{
+  if (a.ndim() == 1 && a.shape(0) == cols) return 1;
+  if (a.ndim() == 2 && a.shape(1) == cols) return (size_t) a.shape(0);
+  throw std::invalid_argument(std::string(name) + " must have shape (n, " + std::to_string(cols) + ")");
+}
+
+static const double * vec3(const array_d & a, const char * name)
+{
+  if (a.size() != 3) throw std::invalid_argument(std::string(name) + " must have 3 values");
+  return a.data();
+}
+
+// one model per process, loaded on first use
+static ros2_package::PandaKinematics & kinematics()
+{
+  static ros2_package::PandaKinematics model;
+  static bool loaded = false;
+  if (!loaded) {
+    if (!model.load()) throw std::runtime_error("cannot load the embedded Panda chain");
+    loaded = true;
+  }
+  return model;
+}
+
+
+//////////////////////////////////// KERNELS ////////////////////////////////////
+
+static array_d sine_ref_points(size_t n_points, int a, int b, int c, double s, double h, double height, double width, double depth,
+                               const array_d & origin, int use_depth)
+{
+  ros2_package::SineTrajectory traj;
+  traj.pa = a;
+  traj.pb = b;
+  traj.pc = c;
+  traj.ps = s;
+  traj.ph = h;
+  traj.height = height;
+  traj.width = width;
+  traj.depth = depth;
+  traj.use_depth = use_depth;
+
+  array_d out({(py::ssize_t) n_points, (py::ssize_t) 3});
+  const double * o = vec3(origin, "origin");
+  {
+    py::gil_scoped_release release;
+    ros2_package::sine_ref_points(traj, n_points, o, out.mutable_data());
+  }
+  return out;
+}
+
+// the samples of the same table the controller arms, plus the origin
+static array_d trajectory_points(const std::string & spec, int traj_id, int use_depth, size_t n_points, const array_d & origin)
+{
+  if (n_points < 2) throw std::invalid_argument("n_points must be at least 2");
+  ros2_package::TrajectoryTable table;
+  std::string error;
+  if (!table.arm(spec, traj_id, use_depth, n_points, error)) throw std::invalid_argument(error);
+
+  array_d out({(py::ssize_t) n_points, (py::ssize_t) 3});
+  const double * o = vec3(origin, "origin");
+  double * p = out.mutable_data();
+  for (size_t i=0; i<n_points; i++) {
+    for (int k=0; k<3; k++) p[3*i + k] = table.positions(k)[i] + o[k];
+  }
+  return out;
+}
+
+static array_d blend(const array_d & alpha, const array_d & human, const array_d & robot, const array_d & origin)
+{
+  const size_t n = rows(human, 3, "human");
+  if (rows(robot, 3, "robot") != n) throw std::invalid_argument("human and robot must have the same number of points");
+
+  array_d out({(py::ssize_t) n, (py::ssize_t) 3});
+  const double * al = vec3(alpha, "alpha");
+  const double * o = vec3(origin, "origin");
+  {
+    py::gil_scoped_release release;
+    ros2_package::blend_points(al, human.data(), robot.data(), o, n, out.mutable_data());
+  }
+  return out;
+}
+
+static py::tuple tracking_errors(const array_d & pos, const array_d & ref, int use_depth)
+{
+  const size_t n = rows(pos, 3, "pos");
+  if (rows(ref, 3, "ref") != n) throw std::invalid_argument("pos and ref must have the same number of points");
+
+  array_d dim_err({(py::ssize_t) n, (py::ssize_t) 3});
+  array_d norm_err((py::ssize_t) n);
+  {
+    py::gil_scoped_release release;
+    ros2_package::tracking_errors(pos.data(), ref.data(), n, use_depth, dim_err.mutable_data(), norm_err.mutable_data());
+  }
+  return py::make_tuple(dim_err, norm_err);
+}
+
+static array_d fk(const array_d & q)
+{
+  const size_t n = rows(q, ros2_package::PandaKinematics::n_joints, "q");
+  ros2_package::PandaKinematics & model = kinematics();
+
+  array_d out({(py::ssize_t) n, (py::ssize_t) 3});
+  const double * in = q.data();
+  double * o = out.mutable_data();
+  for (size_t i=0; i<n; i++) model.compute_fk(in + i * ros2_package::PandaKinematics::n_joints, o + 3*i);
+  return out;
+}
+
+// joint values reaching every target in turn, each solve seeded with the previous
+// result and keeping the TCP orientation of the seed (like the controllers do)
+static array_d ik(const array_d & targets, const array_d & seed)
+{
+  const unsigned int nj = ros2_package::PandaKinematics::n_joints;
+  const size_t n = rows(targets, 3, "targets");
+  if (seed.size() != nj) throw std::invalid_argument("seed must have 7 joint values");
+  ros2_package::PandaKinematics & model = kinematics();
+
+  array_d out({(py::ssize_t) n, (py::ssize_t) nj});
+  const double * t = targets.data();
+  double * o = out.mutable_data();
+
+  // the GIL stays held, it guards the shared model
+  std::vector<double> curr(seed.data(), seed.data() + nj), res(nj), target(3);
+  model.reset_orientation();
+  for (size_t i=0; i<n; i++) {
+    target.assign(t + 3*i, t + 3*i + 3);
+    model.compute_ik(target, curr, res);
+    for (unsigned int j=0; j<nj; j++) o[i*nj + j] = res[j];
+    curr = res;
+  }
+  return out;
+}
+
+
+//////////////////////////////////// MODULE ////////////////////////////////////
+
+PYBIND11_MODULE(_kernels, m)
+{
+  m.doc() = "C++ trajectory, blend, error and kinematics kernels of ros2_package";
+
+  m.def("sine_ref_points", &sine_ref_points, "Reference trajectory points, shape (n_points, 3)",
+        py::arg("n_points"), py::arg("a"), py::arg("b"), py::arg("c"), py::arg("s"), py::arg("h"),
+        py::arg("height"), py::arg("width"), py::arg("depth"), py::arg("origin"), py::arg("use_depth"));
+  m.def("trajectory_points", &trajectory_points, "Reference points of a trajectory generator spec, shape (n_points, 3)",
+        py::arg("spec"), py::arg("traj_id"), py::arg("use_depth"), py::arg("n_points"), py::arg("origin"));
+  m.def("blend", &blend, "origin + alpha * human + (1 - alpha) * robot, shape (n, 3)",
+        py::arg("alpha"), py::arg("human"), py::arg("robot"), py::arg("origin"));
+  m.def("tracking_errors", &tracking_errors, "Per-axis (n, 3) and Euclidean (n,) errors of pos against ref",
+        py::arg("pos"), py::arg("ref"), py::arg("use_depth"));
+  m.def("fk", &fk, "TCP positions of joint values, shape (n, 3)", py::arg("q"));
+  m.def("ik", &ik, "Joint values reaching the targets in turn, shape (n, 7)", py::arg("targets"), py::arg("seed"));
+}
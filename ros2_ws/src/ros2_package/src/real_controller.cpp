@@ -11,38 +11,59 @@
 //   3. Publishes the Boolean data logging flag (-> TrajRecorder)
 //   4. Publishes the robot TCP position (-> TrajRecorder, MarkerPublisher)
 //   5. Publishes the joint values to track (-> Joint Trajectory Controller / Custom Controller)
+//   6. Identifies the robot response online and publishes its parameters (Smith predictor)
+//   7. Publishes the trial phase and trajectory time origin (-> MarkerPublisher)
+//   8. Checks self-collision and table clearance of every command (capsule model)
+//   9. Keeps the TCP clear of the static scene (precomputed distance field)
+//  10. Takes the QoS of its topics from config/qos_profiles.yaml and publishes
+//      the statistics of its subscriptions (-> topic_stats)
+//  11. Runs the trial phases as a coroutine script resumed by the control tick
+//      (RealController::trial_script, include/ros2_package/trial_script.hpp)
 //
 //////////////////////////////////////////////////////
 //////////////////////////////////////////////////////
 
 #include "rclcpp/rclcpp.hpp"
+#include "ament_index_cpp/get_package_share_directory.hpp"
 #include "std_msgs/msg/string.hpp"
 #include "std_msgs/msg/float64.hpp"
 #include "std_msgs/msg/bool.hpp"
+#include "std_msgs/msg/float64_multi_array.hpp"
 #include "trajectory_msgs/msg/joint_trajectory.hpp"
 #include "trajectory_msgs/msg/joint_trajectory_point.hpp"
 #include "sensor_msgs/msg/joint_state.hpp"
 
 #include "tutorial_interfaces/msg/falconpos.hpp"
 #include "tutorial_interfaces/msg/pos_info.hpp"
+#include "tutorial_interfaces/msg/trial_event.hpp"
+
+#include "ros2_package/perceptual_deadband.hpp"
+#include "ros2_package/workspace_map.hpp"
+#include "ros2_package/robot_response_model.hpp"
+#include "ros2_package/trajectory_generators.hpp"
+#include "ros2_package/error_kernels.hpp"
+#include "ros2_package/capsule_collision.hpp"
+#include "ros2_package/distance_field.hpp"
+#include "ros2_package/panda_kinematics.hpp"
+#include "ros2_package/executor_utils.hpp"
+#include "ros2_package/tracing.hpp"
+#include "ros2_package/qos_profiles.hpp"
+#include "ros2_package/thread_placement.hpp"
+#include "ros2_package/trial_script.hpp"
 
 #include <chrono>
+#include <filesystem>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <stdio.h>
 
-#include <kdl_parser/kdl_parser.hpp>
 #include <kdl/chain.hpp>
-#include <kdl/chainjnttojacsolver.hpp>
-#include <kdl/chainfksolverpos_recursive.hpp>
-#include <kdl/chainiksolverpos_nr.hpp>
-#include <kdl/chainiksolvervel_pinv.hpp>
 #include <kdl/frames.hpp>
-#include <kdl/jacobian.hpp>
-#include <kdl/jntarray.hpp>
 
 #include <algorithm>
+#include <cmath>
 
 #include <iostream>
 #include <fstream>
@@ -53,7 +74,6 @@ using namespace std::chrono_literals;
 
 
 /////////////////// global variables ///////////////////
-const std::string urdf_path = "/home/michael/HRI/ros2_ws/src/cpp_pubsub/urdf/panda.urdf";
 const unsigned int n_joints = 7;
 
 const std::vector<double> lower_joint_limits {-2.8973, -1.7628, -2.8973, -3.0718, -2.8973, -0.0175, -2.8973};
@@ -61,16 +81,8 @@ const std::vector<double> upper_joint_limits {2.8973, 1.7628, 2.8973, -0.0698, 2
 
 const bool display_time = false;
 
-KDL::Tree panda_tree;
-KDL::Chain panda_chain;
-
-KDL::Rotation orientation;
-bool got_orientation = false;
-
-std::vector<double> tcp_pos {0.5059, 0.0, 0.4346};   // initialized the same as the "home" position
-
 //////// global dictionaries ////////
-std::vector< std::vector<double> > alphas_dict {
+const std::vector< std::vector<double> > alphas_dict {
   {0.0, 0.0, 0.0},  // 0
   {0.2, 0.2, 0.2},  // 1
   {0.4, 0.4, 0.4},  // 2
@@ -81,8 +93,6 @@ std::vector< std::vector<double> > alphas_dict {
 
 
 /////////////////// function declarations ///////////////////
-void compute_ik(std::vector<double>& desired_tcp_pos, std::vector<double>& curr_vals, std::vector<double>& res_vals);
-
 void readCSV(const std::string& filename, std::vector<double>& dataArray);
 double linearInterpolate(double y1, double y2, double mu);
 double cosineInterpolate(double y1, double y2, double mu);
@@ -90,8 +100,6 @@ std::vector<double> linear_interpolate_vec(std::vector<double> old_vec, int num_
 std::vector<double> cosine_interpolate_vec(std::vector<double> old_vec, int num_interp);
 
 bool within_limits(std::vector<double>& vals);
-bool create_tree();
-void get_chain();
 double get_min(double a, double b);
 
 void print_joint_vals(std::vector<double>& joint_vals);
@@ -104,15 +112,76 @@ class RealController : public rclcpp::Node
 public:
 
   // parameters name list
-  std::vector<std::string> param_names = {"free_drive", "mapping_ratio", "use_depth", "part_id", "alpha_id", "traj_id"};
+  std::vector<std::string> param_names = {"free_drive", "mapping_ratio", "use_depth", "part_id", "alpha_id", "traj_id",
+                                          "use_deadband", "deadband_k", "deadband_min", "deadband_extrapolate",
+                                          "deadband_heartbeat", "mapping_lut", "lut_gamma", "use_predictor",
+                                          "collision_margin", "table_height", "scene_sdf", "obstacle_clearance",
+                                          "urdf_path", "noise_dir", "executor", "trajectory"};
   int free_drive {0};
   double mapping_ratio {3.0};
   int use_depth {0};
   int part_id {0};
   int alpha_id {0};
   int traj_id {0};
+
+  // perceptual deadband reconstruction (KEEP CONSISTENT WITH POSITION TALKER)
+  int use_deadband {0};
+  double deadband_k {0.05};         // Weber fraction
+  double deadband_min {3e-4};       // [m]
+  int deadband_extrapolate {1};     // 0 = hold, 1 = first-order extrapolation
+  double deadband_heartbeat {0.1};  // [s], the talker's heartbeat bounds how long we extrapolate for
+  ros2_package::DeadbandDecoder falcon_decoder;
+
+  // calibrated Falcon -> robot lookup table (falls back to the scalar mapping_ratio if empty)
+  std::string mapping_lut {""};
+  std::vector<double> lut_gamma {1.0, 1.0, 1.0};
+  ros2_package::WorkspaceMap workspace_map;
+
+  // robot response model (commanded -> measured joints), used to seed IK with the
+  // predicted joint state at command time instead of the lagging measurement
+  int use_predictor {1};
+  ros2_package::RobotResponseModel<7> response_model;
+  std::vector<double> predicted_joint_vals {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+
+  // self-collision / table check, commands closer than collision_margin are clamped towards the last safe one
+  double collision_margin {0.02};   // [m]
+  double table_height {0.0};        // [m], in the robot base frame
+  ros2_package::CapsuleCollisionChecker collision;
+  std::vector<double> safe_joint_vals {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  bool got_safe_joint_vals = false;
+  double min_self_margin {1e9};
+  double min_table_margin {1e9};
+  int clamped_ticks = 0;
+
+  // static scene distance field (from scene_sdf_builder), the TCP is pushed out of the obstacle clearance
+  std::string scene_sdf {""};
+  double obstacle_clearance {0.05};   // [m]
+  ros2_package::DistanceField scene_field;
+  double min_obstacle_distance {1e9};
+  int pushed_ticks = 0;
   
+  // robot description and data files (per node, so several sessions can run side by side)
+  std::string urdf_path {""};   // empty = the chain compiled in at build time
+  std::string noise_dir {""};   // empty = the noise directory installed with the package
+  ros2_package::PandaKinematics kinematics;
+
+  // executor (include/ros2_package/executor_utils.hpp), sensing and control callbacks are in separate
+  // groups so "multi" runs them in parallel, state_mutex guards what they share
+  std::string executor {"single"};
+  rclcpp::CallbackGroup::SharedPtr sensing_group;
+  rclcpp::CallbackGroup::SharedPtr control_group;
+  std::mutex state_mutex;
+
+  // cores and scheduling of the executor threads ("multi" threads inherit them)
+  ros2_package::ThreadPlacement placement;
+
+  // named QoS profile per topic and live statistics of the subscriptions (include/ros2_package/qos_profiles.hpp)
+  std::unique_ptr<ros2_package::TopicStatsPublisher> topic_stats;
+  std::shared_ptr<ros2_package::TopicStats> joint_vals_stats;
+  std::shared_ptr<ros2_package::TopicStats> falcon_pos_stats;
+
   std::vector<double> origin {0.5059, 0.0, 0.4346}; //////// can change the task-space origin point! ////////
+  std::vector<double> tcp_pos {0.5059, 0.0, 0.4346};   // initialized the same as the "home" position
 
   std::vector<double> human_offset {0.0, 0.0, 0.0};
   std::vector<double> ref_offset {0.0, 0.0, 0.0};
@@ -141,7 +210,23 @@ public:
   const int float_time = 2;     // time to float at starting position [seconds]
 
   // IMPORTANT: BIG BOSS COUNTER HERE
+  // -> derived from the measured time since control started, so it can jump over missed ticks
   int count = 0;
+  int prev_count = 0;       // count at the end of the previous control tick
+  int nominal_count = 0;    // number of control ticks actually executed
+
+  // monotonic time bases and tick timing statistics
+  std::chrono::steady_clock::time_point prep_start;
+  std::chrono::steady_clock::time_point control_start;
+  bool prep_started = false;
+  bool control_started = false;
+  double elapsed_time = 0.0;      // measured time since control started [s]
+  int missed_ticks = 0;
+  double max_tick_late = 0.0;     // [s]
+
+  int record_start_nominal = 0;
+  double record_start_elapsed = 0.0;
+  int record_start_missed = 0;
 
   // alpha values = amount of HUMAN INPUT, in the range [0, 1]
   double ax = 0.0;
@@ -157,20 +242,27 @@ public:
   const int traj_duration = 10;   // in [seconds]
   int max_recording_count = control_freq * traj_duration;
   bool record_flag = false;
+  bool last_point = false;   // set by the trial script for the last few tcp_position samples of the recording
+  const int last_point_count = 3 * control_freq / tcp_pub_frequency;   // in [ticks], 3 samples in case one is missed
 
   // for robot trajectory following
   double t_param = 0.0;
 
-  // sine curve parameters (initialization)
-  int pa = 0;
-  int pb = 0;
-  int pc = 0;
-  double ps = 0.0;
-  double ph = 0.0;
+  // reference trajectory generator spec (include/ros2_package/trajectory_generators.hpp), sampled once
+  // per control tick of the recording into ref_table (shared with the marker publisher through trial_event)
+  std::string trajectory {"sines"};
+  ros2_package::TrajectoryTable ref_table;
+
+  // current trial phase, announced on the "trial_event" topic
+  uint8_t trial_phase = tutorial_interfaces::msg::TrialEvent::PREP;
+  bool trial_event_sent = false;
+  bool trial_event_pending = false;
 
-  double depth = 0.1;
-  double width = 0.3;
-  double height = 0.1;
+  // the phases of the trial (trial_script), resumed once per control tick, and the blends they start
+  ros2_package::TrialScheduler script;
+  ros2_package::PhaseRamp approach_ramp;    // initial joint values -> Falcon-mapped position
+  ros2_package::PhaseRamp shifting_ramp;    // control authority human -> robot
+  ros2_package::PhaseRamp homing_ramp;      // final trajectory position -> home
 
   // for gradually shifting control to robot after 10 second trajectory
   const int shifting_time = 3;   // seconds
@@ -206,6 +298,22 @@ public:
     this->declare_parameter(param_names.at(3), 0);
     this->declare_parameter(param_names.at(4), 0);
     this->declare_parameter(param_names.at(5), 0);
+    this->declare_parameter(param_names.at(6), 0);
+    this->declare_parameter(param_names.at(7), 0.05);
+    this->declare_parameter(param_names.at(8), 3e-4);
+    this->declare_parameter(param_names.at(9), 1);
+    this->declare_parameter(param_names.at(10), deadband_heartbeat);
+    this->declare_parameter(param_names.at(11), "");
+    this->declare_parameter(param_names.at(12), std::vector<double>{1.0, 1.0, 1.0});
+    this->declare_parameter(param_names.at(13), 1);
+    this->declare_parameter(param_names.at(14), 0.02);
+    this->declare_parameter(param_names.at(15), 0.0);
+    this->declare_parameter(param_names.at(16), "");
+    this->declare_parameter(param_names.at(17), 0.05);
+    this->declare_parameter(param_names.at(18), urdf_path);
+    this->declare_parameter(param_names.at(19), noise_dir);
+    this->declare_parameter(param_names.at(20), executor);
+    this->declare_parameter(param_names.at(21), trajectory);
     
     std::vector<rclcpp::Parameter> params = this->get_parameters(param_names);
     free_drive = std::stoi(params.at(0).value_to_string().c_str());
@@ -214,12 +322,53 @@ public:
     part_id = std::stoi(params.at(3).value_to_string().c_str());
     alpha_id = std::stoi(params.at(4).value_to_string().c_str());
     traj_id = std::stoi(params.at(5).value_to_string().c_str());
+    use_deadband = std::stoi(params.at(6).value_to_string().c_str());
+    deadband_k = std::stod(params.at(7).value_to_string().c_str());
+    deadband_min = std::stod(params.at(8).value_to_string().c_str());
+    deadband_extrapolate = std::stoi(params.at(9).value_to_string().c_str());
+    deadband_heartbeat = std::stod(params.at(10).value_to_string().c_str());
+    mapping_lut = params.at(11).as_string();
+    lut_gamma = params.at(12).as_double_array();
+    use_predictor = std::stoi(params.at(13).value_to_string().c_str());
+    collision_margin = std::stod(params.at(14).value_to_string().c_str());
+    table_height = std::stod(params.at(15).value_to_string().c_str());
+    scene_sdf = params.at(16).as_string();
+    obstacle_clearance = std::stod(params.at(17).value_to_string().c_str());
+    urdf_path = params.at(18).as_string();
+    noise_dir = params.at(19).as_string();
+    if (noise_dir.empty()) noise_dir = ament_index_cpp::get_package_share_directory("ros2_package") + "/noise";
+    executor = params.at(20).as_string();
+    trajectory = params.at(21).as_string();
+
+    // the heartbeat of the talker bounds how long we extrapolate for
+    falcon_decoder.configure(deadband_k, deadband_min, deadband_extrapolate, deadband_heartbeat);
+
+    // load the precomputed workspace mapping table
+    if (!mapping_lut.empty()) {
+      if (!workspace_map.load(mapping_lut) || lut_gamma.size() != 3) {
+        std::cout << "Failed to load the mapping lookup table " << mapping_lut << std::endl;
+        rclcpp::shutdown();
+      } else {
+        workspace_map.set_axis_scaling(lut_gamma.data());
+      }
+    }
+
+    // load the scene distance field (optional)
+    if (!scene_sdf.empty() && !scene_field.load(scene_sdf)) {
+      std::cout << "Failed to load the scene distance field " << scene_sdf << std::endl;
+      rclcpp::shutdown();
+    }
 
     // overwrite alpha_id if the free drive mode is activated
     if (free_drive == 1) alpha_id = 5;
 
     print_params();
 
+    // CPU placement of the control loop (config/placement/<machine>.yaml via the launch file)
+    placement = ros2_package::declare_placement(this, "control");
+    ros2_package::place_process(placement);
+    std::cout << "Placement = " << placement.describe() << "\n" << std::endl;
+
     // update {ax, ay, az} values using the parameter "alpha_id"
     ax = alphas_dict.at(alpha_id).at(0);
     ay = alphas_dict.at(alpha_id).at(1);
@@ -230,19 +379,27 @@ public:
     iay = ay;
     iaz = az;
 
-    // write the sine curve parameters
-    switch (traj_id) {
-      case 0: pa = 1; pb = 1; pc = 4; ps = M_PI;     ph = 0.25; break;
-      case 1: pa = 2; pb = 3; pc = 4; ps = 4*M_PI/3; ph = 0.25; break;
-      case 2: pa = 1; pb = 3; pc = 4; ps = M_PI;     ph = 0.25; break;
-      case 3: pa = 2; pb = 2; pc = 5; ps = M_PI;     ph = 0.2; break;
-      case 4: pa = 2; pb = 3; pc = 5; ps = 8*M_PI/5; ph = 0.2; break;
-      case 5: pa = 2; pb = 4; pc = 5; ps = M_PI;     ph = 0.2; break;
+    // arm the reference trajectory, the recording ticks fall exactly on the samples
+    std::string trajectory_error;
+    if (!ref_table.arm(trajectory, traj_id, use_depth, max_recording_count + 1, trajectory_error)) {
+      std::cout << "Invalid trajectory \"" << trajectory << "\": " << trajectory_error << ", shutting down" << std::endl;
+      rclcpp::shutdown();
+      return;
     }
+    double peak_vel, peak_acc;
+    ref_table.peaks(peak_vel, peak_acc);
+    const double rate = 2 * M_PI / traj_duration;
+    std::cout << "Reference = " << ref_table.describe() << ", peak speed = " << peak_vel * rate
+              << " m/s, peak acceleration = " << peak_acc * rate * rate << " m/s^2\n" << std::endl;
+
+    sensing_group = this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+    control_group = this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
+    rclcpp::SubscriptionOptions sensing_options;
+    sensing_options.callback_group = sensing_group;
 
     // joint controller publisher & timer
-    controller_pub_ = this->create_publisher<sensor_msgs::msg::JointState>("desired_joint_vals", 10);
-    controller_timer_ = this->create_wall_timer(2ms, std::bind(&RealController::controller_publisher, this));    // controls at 500 Hz
+    controller_pub_ = this->create_publisher<sensor_msgs::msg::JointState>("desired_joint_vals", ros2_package::topic_qos(this, "desired_joint_vals"));
+    controller_timer_ = this->create_wall_timer(2ms, std::bind(&RealController::controller_publisher, this), control_group);    // controls at 500 Hz
 
     // tcp position publisher & timer
     tcp_pos_pub_ = this->create_publisher<tutorial_interfaces::msg::PosInfo>("tcp_position", 10);
@@ -250,7 +407,7 @@ public:
 
     // recording flag publisher & timer
     record_flag_pub_ = this->create_publisher<std_msgs::msg::Bool>("record", 10);
-    record_flag_timer_ = this->create_wall_timer(2ms, std::bind(&RealController::record_flag_publisher, this));    // publishes at 500 Hz
+    record_flag_timer_ = this->create_wall_timer(2ms, std::bind(&RealController::record_flag_publisher, this), control_group);    // publishes at 500 Hz
 
     // second_last_point publisher
     last_point_pub_ = this->create_publisher<std_msgs::msg::Bool>("last_point", 10);  // publishes only once
@@ -258,18 +415,42 @@ public:
     // countdown publisher, only publishes at whole second points during smoothing
     countdown_pub_ = this->create_publisher<std_msgs::msg::Float64>("countdown", 10);
 
+    // trial event publisher, publishes on phase changes (latched for late joiners)
+    trial_event_pub_ = this->create_publisher<tutorial_interfaces::msg::TrialEvent>("trial_event", ros2_package::topic_qos(this, "trial_event", "event"));
+
+    // identified robot model publisher, publishes once per second during control
+    robot_model_pub_ = this->create_publisher<std_msgs::msg::Float64MultiArray>("robot_model", 10);
+
+    // the subscriptions only need the newest sample (best effort also matches the reliable publishers)
+    topic_stats = std::make_unique<ros2_package::TopicStatsPublisher>(this, 1.0);
+    const std::string joint_vals_qos = ros2_package::topic_qos_profile(this, "franka/joint_states", "control");
+    const std::string falcon_pos_qos = ros2_package::topic_qos_profile(this, "falcon_position", "control");
+    joint_vals_stats = topic_stats->track("franka/joint_states", joint_vals_qos);
+    falcon_pos_stats = topic_stats->track("falcon_position", falcon_pos_qos);
+
     joint_vals_sub_ = this->create_subscription<sensor_msgs::msg::JointState>(
-      "franka/joint_states", 10, std::bind(&RealController::joint_states_callback, this, std::placeholders::_1));
+      "franka/joint_states", ros2_package::qos_profile(joint_vals_qos),
+      std::bind(&RealController::joint_states_callback, this, std::placeholders::_1, std::placeholders::_2), sensing_options);
 
     falcon_pos_sub_ = this->create_subscription<tutorial_interfaces::msg::Falconpos>(
-      "falcon_position", 10, std::bind(&RealController::falcon_pos_callback, this, std::placeholders::_1));
+      "falcon_position", ros2_package::qos_profile(falcon_pos_qos),
+      std::bind(&RealController::falcon_pos_callback, this, std::placeholders::_1, std::placeholders::_2), sensing_options);
 
-    //Create Panda tree and get its kinematic chain
-    if (!create_tree()) rclcpp::shutdown();
-    get_chain();
+    //Create Panda tree, its kinematic chain and the IK solver
+    if (!kinematics.load(urdf_path)) rclcpp::shutdown();
+    std::cout << "Kinematic model = " << kinematics.source() << "\n" << std::endl;
+
+    // the capsule model links are posed by kinematics.link_poses()
+    collision.set_table_height(table_height);
 
     // read the noise data csv file
     generate_noise_vector(noise_file);
+
+    // the trial script starts with the first control tick
+    if (!script.spawn([this] { return trial_script(script); })) {
+      std::cout << "The trial script does not fit its frame arena (" << script.arena().frame_size() << " bytes), shutting down" << std::endl;
+      rclcpp::shutdown();
+    }
   }
 
 private:
@@ -277,84 +458,114 @@ private:
   ///////////////////////////////////// JOINT CONTROLLER /////////////////////////////////////
   void controller_publisher()
   { 
+    AUTONOMY_TRACE_CALLBACK("controller_publisher", count);
+    std::lock_guard<std::mutex> lock(state_mutex);
+
+    // all phases are driven by the monotonic clock sampled here, so a stalled executor
+    // skips ticks instead of silently stretching the trial
+    auto now = std::chrono::steady_clock::now();
+
     if (!control) {
 
-      prep_count++;
-      if (prep_count % control_freq == 0) std::cout << "The prep_count is currently " << prep_count << "\n" << std::endl; 
-      if (prep_count == max_prep_count) control = true;
+      if (!prep_started) {
+        prep_start = now;
+        prep_started = true;
+      }
+      int prep_index = (int) std::floor(std::chrono::duration<double>(now - prep_start).count() * control_freq) + 1;
+      if (prep_index <= prep_count) prep_index = prep_count + 1;
+
+      if (prep_index / control_freq != prep_count / control_freq) std::cout << "The prep_count is currently " << prep_index << "\n" << std::endl; 
+      prep_count = prep_index;
+      if (prep_count >= max_prep_count) control = true;
+      if (!trial_event_sent) trial_event_publisher();
 
       if (prep_count > max_prep_count - control_freq*2) {
         ///////// warm-up the wait-set 2 seconds before actual control /////////
         ///////// here we need to publish the initial_joint_vals /////////
         auto q_desired = sensor_msgs::msg::JointState();
+        q_desired.header.stamp = this->now();
         q_desired.position = initial_joint_vals;
+        AUTONOMY_TRACE(publish, "desired_joint_vals", count);
         controller_pub_->publish(q_desired);
       }
       
 
     } else {
 
-      // get the robot control offset in Cartesian space (calling the corresponding function of the traj_id)
+      ///////// derive the tick index from the measured time /////////
+      if (!control_started) {
+        control_start = now;
+        control_started = true;
+      }
+      elapsed_time = std::chrono::duration<double>(now - control_start).count();
+      int tick_index = (int) std::floor(elapsed_time * control_freq);
+      if (tick_index < prev_count) tick_index = prev_count;   // early tick, never repeat or go backwards
+
+      // prev_count is the index this tick was scheduled for
+      if (tick_index > prev_count) missed_ticks += tick_index - prev_count;
+      max_tick_late = std::max(max_tick_late, elapsed_time - (double) prev_count / control_freq);
+      count = tick_index;
+
+      // get the robot control offset in Cartesian space (from the reference table armed at startup)
       t_param = (double) (count - max_smoothing_count) / max_recording_count * 2 * M_PI;   // t_param is in the range [0, 2pi], but can be out of range
       get_robot_control(t_param);      
 
-      // gradually change control authority to fully robot after 10 second trajectory
-      if (count > max_smoothing_count+max_recording_count && count <= max_smoothing_count+max_recording_count+max_shifting_count) {
-        double shift_t = (double) (count - max_smoothing_count - max_recording_count) / max_shifting_count;
+      // reconstruct the human input between deadband-coded Falcon samples
+      if (use_deadband) {
+        double falcon_p[3];
+        falcon_decoder.sample(steady_seconds(), falcon_p);
+        set_human_offset(falcon_p);
+      }
+
+      // gradually change control authority to fully robot after 10 second trajectory (started by the script)
+      if (shifting_ramp.started()) {
+        double shift_t = shifting_ramp.value(count);
         ax = (1.0 - shift_t) * iax;
         ay = (1.0 - shift_t) * iay;
         az = (1.0 - shift_t) * iaz;
       }
-      // write the joint values at the final trajectory position
-      if (count == max_smoothing_count+max_recording_count+max_shifting_count) {
-        for (size_t i=0; i<7; i++) final_joint_vals.at(i) = curr_joint_vals.at(i);
+      // predict the joint state at command time (Smith predictor), falls back to the measurement
+      if (use_predictor && response_model.ready()) {
+        response_model.predict(curr_joint_vals.data(), predicted_joint_vals.data());
+      } else {
+        for (size_t i=0; i<7; i++) predicted_joint_vals.at(i) = curr_joint_vals.at(i);
       }
-      
+
       // perform the convex combination of robot and human offsets
       // also adding the origin and thus representing it as tcp_pos in the robot's base frame
-      tcp_pos.at(0) = origin.at(0) + ax * human_offset.at(0) + (1-ax) * robot_offset.at(0);
-      tcp_pos.at(1) = origin.at(1) + ay * human_offset.at(1) + (1-ay) * robot_offset.at(1);
-      tcp_pos.at(2) = origin.at(2) + az * human_offset.at(2) + (1-az) * robot_offset.at(2);
+      // (same kernel as ros2_package._kernels.blend on the Python side)
+      const double alpha[3] = {ax, ay, az};
+      ros2_package::blend_point(alpha, human_offset.data(), robot_offset.data(), origin.data(), tcp_pos.data());
 
-      ///////// compute IK /////////
-      compute_ik(tcp_pos, curr_joint_vals, ik_joint_vals);
+      // push the tcp out of the clearance around the static scene obstacles
+      if (scene_field.loaded()) push_from_obstacles(tcp_pos);
 
-      ///////////// publish the tcp position message /////////////
-      if (record_flag && ((count - max_smoothing_count) % (control_freq / 40) == 0)) RealController::tcp_pos_publisher();
+      ///////// compute IK /////////
+      AUTONOMY_TRACE(ik_start, "compute_ik", count);
+      kinematics.compute_ik(tcp_pos, predicted_joint_vals, ik_joint_vals, display_time);
+      AUTONOMY_TRACE(ik_end, "compute_ik", count);
+
+      ///////////// publish the tcp position message (once per 40 Hz period, even if ticks were skipped) /////////////
+      const int tcp_period = control_freq / tcp_pub_frequency;
+      if (record_flag && floor_div(count - max_smoothing_count, tcp_period) != floor_div(prev_count - 1 - max_smoothing_count, tcp_period)) {
+        RealController::tcp_pos_publisher();
+      }
 
-      ///////// initial smooth transitioning from current position to Falcon-mapped position /////////
       count++;  // increase count
+      nominal_count++;
 
-      if (count <= max_smoothing_count) {
-        double ratio = 0.0;
-        if (count <= max_smoothing_count - control_freq * float_time) {
-          // get lerp position using time
-          ratio = (double) count / (max_smoothing_count - control_freq * float_time);    // need to get there early and "float"
-        } else {
-          ratio = 1.0;
-        }
-
-        for (unsigned int i=0; i<n_joints; i++) message_joint_vals.at(i) = ratio * ik_joint_vals.at(i) + (1-ratio) * initial_joint_vals.at(i);
+      ///////// run the phases of the trial that are due (the skipped ones too, in order) /////////
+      script.tick(count);
 
-      } else {
-        for (unsigned int i=0; i<n_joints; i++) message_joint_vals.at(i) = ik_joint_vals.at(i);
-      }
+      ///////// initial smooth transitioning from current position to Falcon-mapped position /////////
+      double ratio = approach_ramp.value(count);
+      for (unsigned int i=0; i<n_joints; i++) message_joint_vals.at(i) = ratio * ik_joint_vals.at(i) + (1-ratio) * initial_joint_vals.at(i);
 
       // bring it home boys
-      if (count > max_smoothing_count + max_recording_count + max_shifting_count) {
-        double hr = 0.0;
-        if (count <= max_smoothing_count + max_recording_count + max_shifting_count + max_homing_count) {
-          hr = (double) (count - max_smoothing_count - max_recording_count - max_shifting_count) / max_homing_count;
-        } else {
-          hr = 1.0;
-        }
+      if (homing_ramp.started()) {
+        double hr = homing_ramp.value(count);
         for (size_t i=0; i<7; i++) message_joint_vals.at(i) = hr * home_joint_vals.at(i) + (1-hr) * final_joint_vals.at(i);
       }
-      // shutdown down 1 second after homing
-      if (count == max_smoothing_count + max_recording_count + max_shifting_count + max_homing_count + max_shutdown_count) {
-        std::cout << "\n    Trial finished cleanly! Shutting down now ... Bye-bye!    \n" << std::endl;
-        rclcpp::shutdown();
-      }
 
       ///////// check limits /////////
       if (!within_limits(message_joint_vals)) {
@@ -362,39 +573,171 @@ private:
         rclcpp::shutdown();
       }
 
+      ///////// check self-collision and table clearance /////////
+      if (!got_safe_joint_vals) {
+        safe_joint_vals = initial_joint_vals;
+        got_safe_joint_vals = true;
+      }
+      double self_margin = 0.0, table_margin = 0.0;
+      if (check_collision(message_joint_vals, self_margin, table_margin) < collision_margin) {
+        clamp_to_safe(message_joint_vals);
+        clamped_ticks++;
+      }
+      min_self_margin = std::min(min_self_margin, self_margin);     // margins of the requested commands
+      min_table_margin = std::min(min_table_margin, table_margin);
+      safe_joint_vals = message_joint_vals;
+
       ///////// prepare and publish the desired_joint_vals message /////////
       auto q_desired = sensor_msgs::msg::JointState();
+      q_desired.header.stamp = this->now();     // used by the upsampler to place the command in time
       q_desired.position = message_joint_vals;
+      AUTONOMY_TRACE(publish, "desired_joint_vals", count);
       controller_pub_->publish(q_desired);
 
-      // set the record flag as true
-      if ((count == max_smoothing_count) && (!record_flag)) {
-        record_flag = true;
-        std::cout << "\n\n\n\n\n\n======================= RECORD FLAG IS SET TO => TRUE =======================\n\n\n\n\n\n" << std::endl;
-      }
-
-      // set the record flag as false
-      if ((count == max_smoothing_count + max_recording_count) && (record_flag == true)) {
-        std::cout << "\n\n\n\n\n\n======================= RECORD FLAG IS SET TO => FALSE =======================\n\n\n\n\n\n" << std::endl;
-        record_flag = false; 
-      }
+      // identify the response to the command we just sent
+      response_model.update(message_joint_vals.data(), curr_joint_vals.data());
 
       ///////////// check if need to publish the countdown message /////////////
-      if (count % control_freq == 0) {
+      if (count / control_freq != prev_count / control_freq) {
         auto count_msg = std_msgs::msg::Float64();
         count_msg.data = count / control_freq;
         countdown_pub_->publish(count_msg);
+
+        robot_model_publisher();
       }
+
+      ///////////// announce the trial phase (on changes, and refresh the time origin once per second) /////////////
+      if (trial_event_pending || count / control_freq != prev_count / control_freq) {
+        trial_event_publisher();
+      }
+
+      prev_count = count;
     }
   }
 
+  static int floor_div(int a, int b) { return (a >= 0) ? a / b : -((-a + b - 1) / b); }
+
+  ///////////////////////////////////// TRIAL SCRIPT /////////////////////////////////////
+  // the phases of a trial, top to bottom; script time is the post-increment count of the control tick,
+  // so a phase whose tick was skipped still starts (late) and the following ones keep their nominal times
+  ros2_package::TrialTask trial_script(ros2_package::TrialScheduler & s)
+  {
+    using Event = tutorial_interfaces::msg::TrialEvent;
+
+    // step 2: smoothing, get to the Falcon-mapped position early and "float" there
+    set_trial_phase(Event::SMOOTHING);
+    approach_ramp.start(0, max_smoothing_count - control_freq * float_time);
+    co_await s.at(max_smoothing_count);
+
+    // step 3: recording
+    set_trial_phase(Event::RECORDING);
+    record_flag = true;
+    record_start_nominal = nominal_count;
+    record_start_elapsed = elapsed_time;
+    record_start_missed = missed_ticks;
+    std::cout << "\n\n\n\n\n\n======================= RECORD FLAG IS SET TO => TRUE =======================\n\n\n\n\n\n" << std::endl;
+    co_await s.ticks(max_recording_count - last_point_count);
+
+    last_point = true;
+    std::cout << "\n\n\n\n\n\n======================= SETTING LAST POINT TO => TRUE =======================\n\n\n\n\n\n" << std::endl;
+    co_await s.ticks(last_point_count);
+
+    std::cout << "\n\n\n\n\n\n======================= RECORD FLAG IS SET TO => FALSE =======================\n\n\n\n\n\n" << std::endl;
+    record_flag = false;
+    last_point = false;
+    print_timing_summary();
+
+    // step 4: gradually shift control authority to the robot
+    set_trial_phase(Event::SHIFTING);
+    shifting_ramp.start(s.now(), max_shifting_count);
+    co_await s.ticks(max_shifting_count);
+
+    // step 5: homing, from the joint values at the final trajectory position
+    for (size_t i=0; i<7; i++) final_joint_vals.at(i) = curr_joint_vals.at(i);
+    set_trial_phase(Event::HOMING);
+    homing_ramp.start(s.now(), max_homing_count);
+    co_await s.ticks(max_homing_count);
+
+    // shutdown down 1 second after homing
+    set_trial_phase(Event::FINISHED);
+    co_await s.ticks(max_shutdown_count);
+    std::cout << "\n    Trial finished cleanly! Shutting down now ... Bye-bye!    \n" << std::endl;
+    rclcpp::shutdown();
+  }
+
+  // announced at the end of the tick
+  void set_trial_phase(uint8_t phase)
+  {
+    trial_phase = phase;
+    trial_event_pending = true;
+  }
+
+  ///////////////////////////////////// OBSTACLE AVOIDANCE /////////////////////////////////////
+  // projects the tcp position onto the clearance surface along the distance gradient if it is too close
+  void push_from_obstacles(std::vector<double>& pos)
+  {
+    double distance, gradient[3];
+    if (!scene_field.query(pos.data(), distance, gradient)) return;   // outside the mapped workspace
+    min_obstacle_distance = std::min(min_obstacle_distance, distance);
+    if (distance >= obstacle_clearance) return;
+
+    double norm = std::sqrt(gradient[0] * gradient[0] + gradient[1] * gradient[1] + gradient[2] * gradient[2]);
+    if (norm < 1e-6) return;
+    for (size_t i=0; i<3; i++) pos.at(i) += (obstacle_clearance - distance) * gradient[i] / norm;
+    pushed_ticks++;
+  }
+
+  ///////////////////////////////////// COLLISION CHECK /////////////////////////////////////
+  // smallest capsule margin (self or table) of the joint values [m]
+  double check_collision(const std::vector<double>& joint_vals, double& self, double& table)
+  {
+    // forward kinematics of every link in one pass
+    kinematics.link_poses(joint_vals.data(), [this](int link, const double R[9], const double p[3]) { collision.set_link_pose(link, R, p); });
+
+    self = collision.self_margin();
+    table = collision.table_margin();
+    return std::min(self, table);
+  }
+
+  // moves only as far from the last safe command towards joint_vals as stays clear (bisection), else holds
+  void clamp_to_safe(std::vector<double>& joint_vals)
+  {
+    std::vector<double> target = joint_vals;
+    double safe_s = 0.0;
+    double step = 0.5;
+    for (int it=0; it<4; it++, step *= 0.5) {
+      double s = safe_s + step;
+      for (size_t i=0; i<n_joints; i++) joint_vals.at(i) = safe_joint_vals.at(i) + s * (target.at(i) - safe_joint_vals.at(i));
+      double self, table;
+      if (check_collision(joint_vals, self, table) >= collision_margin) safe_s = s;
+    }
+    for (size_t i=0; i<n_joints; i++) joint_vals.at(i) = safe_joint_vals.at(i) + safe_s * (target.at(i) - safe_joint_vals.at(i));
+  }
+
+  ///////////////////////////////////// FUNCTION TO PRINT THE TICK TIMING /////////////////////////////////////
+  void print_timing_summary() {
+    double measured = elapsed_time - record_start_elapsed;
+    double nominal = (double) (nominal_count - record_start_nominal) / control_freq;
+    std::cout << "Recording window: measured = " << measured << " s, nominal = " << nominal << " s ("
+              << nominal_count - record_start_nominal << " ticks executed)" << std::endl;
+    std::cout << "Identified robot delays [ms] = [ ";
+    for (size_t i=0; i<n_joints; i++) std::cout << 1000.0 * response_model.delay(i) / control_freq << ' ';
+    std::cout << "]" << std::endl;
+    std::cout << "Collision margins: min self = " << 1000 * min_self_margin << " mm, min table = " << 1000 * min_table_margin
+              << " mm, clamped ticks = " << clamped_ticks << std::endl;
+    if (scene_field.loaded()) {
+      std::cout << "Scene obstacles: min distance = " << 1000 * min_obstacle_distance << " mm, pushed ticks = " << pushed_ticks << std::endl;
+    }
+    std::cout << "Missed ticks: " << missed_ticks - record_start_missed << " during recording, " << missed_ticks << " in total"
+              << ", max lateness = " << max_tick_late * 1000 << " ms\n" << std::endl;
+  }
+
   ///////////////////////////////////// TCP POSITION PUBLISHER /////////////////////////////////////
   void tcp_pos_publisher()
   { 
-    if (count > max_smoothing_count + max_recording_count - tcp_pub_frequency) {
+    if (last_point) {
       auto lp = std_msgs::msg::Bool();
       lp.data = true;
-      std::cout << "\n\n\n\n\n\n======================= SETTING LAST POINT TO => TRUE =======================\n\n\n\n\n\n" << std::endl;
       last_point_pub_->publish(lp);
     }
 
@@ -425,23 +768,60 @@ private:
       tcp_pos.at(2)
     };
 
-    message.time_from_start = (double) (count - max_smoothing_count) / max_recording_count * 10;    // out of total of 10 seconds
+    // measured time (monotonic clock) and nominal time (executed ticks), out of total of 10 seconds
+    message.time_from_start = elapsed_time - smoothing_time;
+    message.nominal_time_from_start = (double) (nominal_count - record_start_nominal) / control_freq;
 
+    AUTONOMY_TRACE(publish, "tcp_position", count);
     tcp_pos_pub_->publish(message);
     
   }
 
+  ///////////////////////////////////// TRIAL EVENT PUBLISHER /////////////////////////////////////
+  void trial_event_publisher()
+  {
+    auto message = tutorial_interfaces::msg::TrialEvent();
+    message.phase = trial_phase;
+    message.traj_duration = traj_duration;
+    message.traj_id = traj_id;
+    message.use_depth = use_depth;
+    message.trajectory = trajectory;
+
+    // the trajectory parameter is 0 once the smoothing time has elapsed since control started
+    rclcpp::Time now = this->now();
+    double since_origin = control_started ? elapsed_time - smoothing_time : -(prep_time + smoothing_time);
+    message.traj_origin = now - rclcpp::Duration::from_seconds(since_origin);
+
+    trial_event_pub_->publish(message);
+    trial_event_sent = true;
+    trial_event_pending = false;
+  }
+
+  ///////////////////////////////////// ROBOT MODEL PUBLISHER /////////////////////////////////////
+  void robot_model_publisher()
+  {
+    // layout: {delay of joints 1-7 [ms], time constant of joints 1-7 [ms]}
+    auto message = std_msgs::msg::Float64MultiArray();
+    for (size_t i=0; i<n_joints; i++) message.data.push_back(1000.0 * response_model.delay(i) / control_freq);
+    for (size_t i=0; i<n_joints; i++) message.data.push_back(1000.0 * response_model.time_constant(i, 1.0 / control_freq));
+    robot_model_pub_->publish(message);
+  }
+
   ///////////////////////////////////// TRAJ RECORD FLAG PUBLISHER /////////////////////////////////////
   void record_flag_publisher()
   { 
+    AUTONOMY_TRACE_CALLBACK("record_flag_publisher", count);
     auto message = std_msgs::msg::Bool();
     message.data = record_flag;
     record_flag_pub_->publish(message);
   }
 
   ///////////////////////////////////// JOINT STATES SUBSCRIBER /////////////////////////////////////
-  void joint_states_callback(const sensor_msgs::msg::JointState & msg)
+  void joint_states_callback(const sensor_msgs::msg::JointState & msg, const rclcpp::MessageInfo & info)
   { 
+    std::lock_guard<std::mutex> lock(state_mutex);   // count and the stats are shared with the control timer
+    AUTONOMY_TRACE_CALLBACK("joint_states_callback", count);
+    joint_vals_stats->add(info);
     auto data = msg.position;
     for (unsigned int i=0; i<n_joints; i++) {
       curr_joint_vals.at(i) = data.at(i);
@@ -456,11 +836,37 @@ private:
   }
 
   ///////////////////////////////////// FALCON SUBSCRIBER /////////////////////////////////////
-  void falcon_pos_callback(const tutorial_interfaces::msg::Falconpos & msg)
+  void falcon_pos_callback(const tutorial_interfaces::msg::Falconpos & msg, const rclcpp::MessageInfo & info)
   { 
-    human_offset.at(0) = msg.x / 100 * mapping_ratio;
-    human_offset.at(1) = msg.y / 100 * mapping_ratio;
-    human_offset.at(2) = msg.z / 100 * mapping_ratio;
+    std::lock_guard<std::mutex> lock(state_mutex);   // count and the stats are shared with the control timer
+    AUTONOMY_TRACE_CALLBACK("falcon_pos_callback", count);
+    falcon_pos_stats->add(info);
+    if (use_deadband) {
+      // only feed the decoder, human_offset is reconstructed every control tick
+      double falcon_p[3] = {msg.x / 100, msg.y / 100, msg.z / 100};
+      falcon_decoder.receive(falcon_p, steady_seconds());
+      return;
+    }
+    double falcon_p[3] = {msg.x / 100, msg.y / 100, msg.z / 100};
+    set_human_offset(falcon_p);
+  }
+
+  // Falcon position [m] -> human_offset, through the lookup table if one is loaded
+  void set_human_offset(const double falcon_p[3])
+  {
+    if (workspace_map.loaded()) {
+      double out[3];
+      workspace_map.apply(falcon_p, out);
+      for (size_t i=0; i<3; i++) human_offset.at(i) = out[i];
+    } else {
+      for (size_t i=0; i<3; i++) human_offset.at(i) = falcon_p[i] * mapping_ratio;
+    }
+  }
+
+  // monotonic time in [seconds]
+  static double steady_seconds()
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
   }
 
   /////////////////////////////// robot control function ///////////////////////////////
@@ -473,14 +879,11 @@ private:
     if (t > 2*M_PI) {t = 2*M_PI; within_traj_count = 5000;}
 
     // assign the noise
-    double noise = robot_noise_vector.at(within_traj_count);
+    double noise = (size_t) within_traj_count < robot_noise_vector.size() ? robot_noise_vector.at(within_traj_count) : 0.0;
     if (within_traj_count%100==0) std::cout << "noise_value = " << noise << std::endl;
 
     // compute reference position and assign into ref_position vector
-    ref_offset.at(0) = 0.0;
-    if (use_depth) ref_offset.at(0) = abs(t-M_PI) / M_PI * depth - (depth/2);
-    ref_offset.at(1) = t / (2*M_PI) * width - (width/2);
-    ref_offset.at(2) = (ph*height) * (sin(pa*(t+ps)) + sin(pb*(t+ps)) + sin(pc*(t+ps)));
+    ref_table.offset(t, ref_offset.data());
 
     // compute robot target = reference position + noise
     robot_offset.at(0) = ref_offset.at(0);
@@ -491,7 +894,7 @@ private:
   ///////////////////////////////////// FUNCTION TO READ NOISE CSV AND INTERPOLATE /////////////////////////////////////
   void generate_noise_vector(const std::string filename) {
 
-    std::string csv_file_name {"/home/michael/HRI/ros2_ws/src/cpp_pubsub/robot_noise/noise_csv_files/"+filename};
+    std::string csv_file_name {(std::filesystem::path(noise_dir) / filename).string()};
 
     std::vector<double> raw_data;
     const int num_interp = 49;
@@ -500,6 +903,12 @@ private:
     readCSV(csv_file_name, raw_data);
     std::cout << "Length of raw noise array = " << raw_data.size() << std::endl;
 
+    // no noise file (e.g. not copied into <package>/noise on this machine) -> the robot follows the plain reference
+    if (raw_data.empty()) {
+      std::cout << "No robot noise in " << csv_file_name << ", running without noise" << std::endl;
+      return;
+    }
+
     // interpolate (linear / cosine)
     robot_noise_vector = linear_interpolate_vec(raw_data, num_interp);
     std::cout << "Success! Length of new noise vector = " << robot_noise_vector.size() << std::endl;
@@ -514,7 +923,13 @@ private:
     std::cout << "Use depth parameter = " << use_depth << "\n" << std::endl;
     std::cout << "Participant ID = " << part_id << "\n" << std::endl;
     std::cout << "Alpha ID = " << alpha_id << "\n" << std::endl;
-    std::cout << "Trajectory ID = " << traj_id << "\n" << std::endl;
+    std::cout << "Trajectory ID = " << traj_id << ", generator = " << trajectory << "\n" << std::endl;
+    std::cout << "Use deadband = " << use_deadband << ", heartbeat = " << deadband_heartbeat << " s\n" << std::endl;
+    std::cout << "Mapping lookup table = " << (mapping_lut.empty() ? "none" : mapping_lut) << "\n" << std::endl;
+    std::cout << "Collision margin = " << collision_margin << ", table height = " << table_height << "\n" << std::endl;
+    std::cout << "Scene distance field = " << (scene_sdf.empty() ? "none" : scene_sdf) << "\n" << std::endl;
+    std::cout << "Noise directory = " << noise_dir << "\n" << std::endl;
+    std::cout << "Executor = " << executor << "\n" << std::endl;
     for (unsigned int i=0; i<10; i++) std::cout << "\n";
   }
 
@@ -530,6 +945,10 @@ private:
 
   rclcpp::Publisher<std_msgs::msg::Float64>::SharedPtr countdown_pub_;
 
+  rclcpp::Publisher<std_msgs::msg::Float64MultiArray>::SharedPtr robot_model_pub_;
+
+  rclcpp::Publisher<tutorial_interfaces::msg::TrialEvent>::SharedPtr trial_event_pub_;
+
   rclcpp::Subscription<sensor_msgs::msg::JointState>::SharedPtr joint_vals_sub_;
 
   rclcpp::Subscription<tutorial_interfaces::msg::Falconpos>::SharedPtr falcon_pos_sub_;
@@ -539,55 +958,6 @@ private:
 
 
 
-/////////////////////////////// my own ik function ///////////////////////////////
-
-void compute_ik(std::vector<double>& desired_tcp_pos, std::vector<double>& curr_vals, std::vector<double>& res_vals) {
-
-  auto start = std::chrono::high_resolution_clock::now();
-
-	//Create solvers
-	KDL::ChainFkSolverPos_recursive fk_solver(panda_chain);
-	KDL::ChainIkSolverVel_pinv vel_ik_solver(panda_chain, 0.0001, 1000);
-	KDL::ChainIkSolverPos_NR ik_solver(panda_chain, fk_solver, vel_ik_solver, 1000);
-
-  //Create the KDL array of current joint values
-  KDL::JntArray jnt_pos_start(n_joints);
-  for (unsigned int i=0; i<n_joints; i++) {
-    jnt_pos_start(i) = curr_vals.at(i);
-  }
-
-  //Write in the initial orientation if not already done so
-  if (!got_orientation) {
-    //Compute current tcp position
-    KDL::Frame tcp_pos_start;
-    fk_solver.JntToCart(jnt_pos_start, tcp_pos_start);
-    orientation = tcp_pos_start.M;
-    got_orientation = true;
-  }
-
-  //Create the task-space goal object
-  // KDL::Vector vec_tcp_pos_goal(origin.at(0), origin.at(1), origin.at(2));
-  KDL::Vector vec_tcp_pos_goal(desired_tcp_pos.at(0), desired_tcp_pos.at(1), desired_tcp_pos.at(2));
-  KDL::Frame tcp_pos_goal(orientation, vec_tcp_pos_goal);
-
-  //Compute inverse kinematics
-  KDL::JntArray jnt_pos_goal(n_joints);
-  ik_solver.CartToJnt(jnt_pos_start, tcp_pos_goal, jnt_pos_goal);
-
-  //Change the control joint values and finish the function
-  for (unsigned int i=0; i<n_joints; i++) {
-    res_vals.at(i) = jnt_pos_goal.data(i);
-  }
-
-  if (display_time) {
-    auto finish = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(finish - start);
-    std::cout << "Execution of my IK solver function took " << duration.count() << " [microseconds]" << std::endl;
-  }
-  
-}
-
-
 ///////////////// Noise helper functions /////////////////
 
 // Function to read CSV file and store data in a C++ array
@@ -662,18 +1032,6 @@ bool within_limits(std::vector<double>& vals) {
   return true;
 }
 
-bool create_tree() {
-  if (!kdl_parser::treeFromFile(urdf_path, panda_tree)){
-		std::cout << "Failed to construct kdl tree" << std::endl;
-   	return false;
-  }
-  return true;
-}
-
-void get_chain() {
-  panda_tree.getChain("panda_link0", "panda_grasptarget", panda_chain);
-}
-
 void print_joint_vals(std::vector<double>& joint_vals) {
   
   std::cout << "[ ";
@@ -699,7 +1057,7 @@ int main(int argc, char * argv[])
 
   std::shared_ptr<RealController> real_controller = std::make_shared<RealController>();
 
-  rclcpp::spin(real_controller);
+  ros2_package::spin_node(real_controller, real_controller->executor);
 
   rclcpp::shutdown();
   return 0;
@@ -0,0 +1,244 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - C++ class implementation of the SceneSdfBuilder node, an offline
+//   stage turning the static scene point cloud into a distance field
+//
+// - Main functionalities:
+//   1. Accumulates a few point clouds (e.g. the replayed Kinect bag),
+//      transformed into the robot base frame via /tf (<- ConstBr)
+//   2. Voxelizes the points inside the task workspace bounds, dropping
+//      the points on the robot itself (capsule model at the current joint states)
+//   3. Computes the signed Euclidean distance field and writes it to disk,
+//      to be loaded by the RealController "scene_sdf" parameter
+//
+// - Usage (with the bag and const_br running):
+//   ros2 run ros2_package scene_sdf_builder --ros-args -p output_file:=scene.sdf
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "sensor_msgs/msg/joint_state.hpp"
+#include "sensor_msgs/msg/point_cloud2.hpp"
+#include "sensor_msgs/point_cloud2_iterator.hpp"
+
+#include "tf2/LinearMath/Matrix3x3.h"
+#include "tf2/LinearMath/Quaternion.h"
+#include "tf2/LinearMath/Vector3.h"
+#include "tf2/exceptions.h"
+#include "tf2_ros/buffer.h"
+#include "tf2_ros/transform_listener.h"
+
+#include <kdl/chain.hpp>
+#include <kdl/frames.hpp>
+
+#include "ros2_package/capsule_collision.hpp"
+#include "ros2_package/distance_field.hpp"
+#include "ros2_package/panda_kinematics.hpp"
+#include "ros2_package/qos_profiles.hpp"
+
+
+/////////////////// global variables ///////////////////
+const unsigned int n_joints = 7;
+
+
+/////////////// DEFINITION OF NODE CLASS //////////////
+
+class SceneSdfBuilder : public rclcpp::Node
+{
+public:
+
+  // parameters name list
+  std::vector<std::string> param_names = {"output_file", "cloud_topic", "base_frame", "num_clouds", "voxel_size",
+                                          "bounds_min", "bounds_max", "min_points", "robot_padding"};
+  std::string output_file {"scene.sdf"};
+  std::string cloud_topic {"points2"};
+  std::string base_frame {"panda_link0"};
+  int num_clouds {10};                  // clouds to accumulate
+  double voxel_size {0.01};             // [m]
+  std::vector<double> bounds_min {0.2, -0.45, -0.05};   // task workspace in the robot base frame [m]
+  std::vector<double> bounds_max {0.9, 0.45, 0.8};
+  int min_points {3};                   // hits for a voxel to count as occupied (removes sensor noise)
+  double robot_padding {0.05};          // points this close to the robot capsules are dropped [m]
+
+  uint32_t n[3] {0, 0, 0};
+  std::vector<uint16_t> hits;
+  int clouds_received = 0;
+
+  // robot model, to drop the robot from the scene
+  ros2_package::PandaKinematics kinematics;
+  ros2_package::CapsuleCollisionChecker robot;
+  std::vector<double> joint_vals {0, -M_PI_4/2, 0, -5 * M_PI_4/2, 0, M_PI_2, M_PI_4};   // home until joint states arrive
+  bool got_joint_vals = false;
+
+
+  SceneSdfBuilder()
+  : Node("scene_sdf_builder")
+  {
+    // parameter stuff
+    this->declare_parameter(param_names.at(0), "scene.sdf");
+    this->declare_parameter(param_names.at(1), "points2");
+    this->declare_parameter(param_names.at(2), "panda_link0");
+    this->declare_parameter(param_names.at(3), 10);
+    this->declare_parameter(param_names.at(4), 0.01);
+    this->declare_parameter(param_names.at(5), std::vector<double>{0.2, -0.45, -0.05});
+    this->declare_parameter(param_names.at(6), std::vector<double>{0.9, 0.45, 0.8});
+    this->declare_parameter(param_names.at(7), 3);
+    this->declare_parameter(param_names.at(8), 0.05);
+
+    std::vector<rclcpp::Parameter> params = this->get_parameters(param_names);
+    output_file = params.at(0).as_string();
+    cloud_topic = params.at(1).as_string();
+    base_frame = params.at(2).as_string();
+    num_clouds = std::stoi(params.at(3).value_to_string().c_str());
+    voxel_size = std::stod(params.at(4).value_to_string().c_str());
+    bounds_min = params.at(5).as_double_array();
+    bounds_max = params.at(6).as_double_array();
+    min_points = std::stoi(params.at(7).value_to_string().c_str());
+    robot_padding = std::stod(params.at(8).value_to_string().c_str());
+    print_params();
+
+    if (bounds_min.size() != 3 || bounds_max.size() != 3 || !(voxel_size > 0.0)) {
+      std::cout << "Invalid workspace bounds or voxel size, shutting down" << std::endl;
+      rclcpp::shutdown();
+      return;
+    }
+    for (size_t i=0; i<3; i++) n[i] = (uint32_t) std::floor((bounds_max.at(i) - bounds_min.at(i)) / voxel_size) + 1;
+    hits.assign((size_t) n[0] * n[1] * n[2], 0);
+
+    kinematics.load();
+
+    tf_buffer_ = std::make_unique<tf2_ros::Buffer>(this->get_clock());
+    tf_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_buffer_);
+
+    joint_vals_sub_ = this->create_subscription<sensor_msgs::msg::JointState>(
+      "franka/joint_states", ros2_package::topic_qos(this, "franka/joint_states", "control"), std::bind(&SceneSdfBuilder::joint_states_callback, this, std::placeholders::_1));
+
+    cloud_sub_ = this->create_subscription<sensor_msgs::msg::PointCloud2>(
+      cloud_topic, rclcpp::SensorDataQoS(), std::bind(&SceneSdfBuilder::cloud_callback, this, std::placeholders::_1));
+  }
+
+
+private:
+
+  void joint_states_callback(const sensor_msgs::msg::JointState & msg)
+  {
+    if (msg.position.size() < n_joints) return;
+    for (unsigned int i=0; i<n_joints; i++) joint_vals.at(i) = msg.position.at(i);
+    got_joint_vals = true;
+  }
+
+  void cloud_callback(const sensor_msgs::msg::PointCloud2 & msg)
+  {
+    if (clouds_received >= num_clouds) return;
+
+    // cloud frame -> robot base frame
+    geometry_msgs::msg::TransformStamped t;
+    try {
+      t = tf_buffer_->lookupTransform(base_frame, msg.header.frame_id, tf2::TimePointZero);
+    } catch (const tf2::TransformException & ex) {
+      RCLCPP_WARN(this->get_logger(), "Could not transform %s to %s: %s", msg.header.frame_id.c_str(), base_frame.c_str(), ex.what());
+      return;
+    }
+    tf2::Matrix3x3 R(tf2::Quaternion(t.transform.rotation.x, t.transform.rotation.y, t.transform.rotation.z, t.transform.rotation.w));
+    tf2::Vector3 p0(t.transform.translation.x, t.transform.translation.y, t.transform.translation.z);
+
+    if (!got_joint_vals) RCLCPP_WARN(this->get_logger(), "No joint states received, assuming the robot is at home");
+    update_robot_pose();
+
+    size_t used = 0;
+    sensor_msgs::PointCloud2ConstIterator<float> it_x(msg, "x"), it_y(msg, "y"), it_z(msg, "z");
+    for (; it_x != it_x.end(); ++it_x, ++it_y, ++it_z) {
+      if (!std::isfinite(*it_x) || !std::isfinite(*it_y) || !std::isfinite(*it_z)) continue;
+
+      tf2::Vector3 pb = R * tf2::Vector3(*it_x, *it_y, *it_z) + p0;
+      double p[3] = {pb.x(), pb.y(), pb.z()};
+
+      size_t idx[3];
+      bool inside = true;
+      for (size_t i=0; i<3 && inside; i++) {
+        double u = std::round((p[i] - bounds_min.at(i)) / voxel_size);
+        inside = u >= 0.0 && u < n[i];
+        idx[i] = (size_t) u;
+      }
+      if (!inside) continue;
+      if (robot.point_margin(p) < robot_padding) continue;
+
+      uint16_t & h = hits.at((idx[0] * n[1] + idx[1]) * n[2] + idx[2]);
+      if (h < UINT16_MAX) h++;
+      used++;
+    }
+
+    clouds_received++;
+    std::cout << "Cloud " << clouds_received << "/" << num_clouds << ": " << used << " points inside the workspace" << std::endl;
+
+    if (clouds_received == num_clouds) build_and_write();
+  }
+
+  // capsule poses of the robot at the latest joint values
+  void update_robot_pose()
+  {
+    kinematics.link_poses(joint_vals.data(), [this](int link, const double R[9], const double p[3]) { robot.set_link_pose(link, R, p); });
+  }
+
+  void build_and_write()
+  {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<uint8_t> occupied(hits.size(), 0);
+    size_t n_occupied = 0;
+    for (size_t i=0; i<hits.size(); i++) {
+      occupied[i] = hits[i] >= min_points;
+      n_occupied += occupied[i];
+    }
+
+    std::vector<float> sdf;
+    ros2_package::compute_signed_distance(occupied, n, voxel_size, sdf);
+
+    auto finish = std::chrono::steady_clock::now();
+    std::cout << "\nDistance field: " << n[0] << " x " << n[1] << " x " << n[2] << " voxels, " << n_occupied << " occupied, computed in "
+              << std::chrono::duration<double>(finish - start).count() << " s" << std::endl;
+
+    if (ros2_package::write_distance_field(output_file, n, bounds_min.data(), voxel_size, sdf)) {
+      std::cout << "\nSuccess! Wrote the distance field to " << output_file << "\n" << std::endl;
+    } else {
+      std::cout << "\nerror: cannot write " << output_file << "\n" << std::endl;
+    }
+    rclcpp::shutdown();
+  }
+
+  void print_params() {
+    std::cout << "\n\nThe current parameters [scene_sdf_builder] are as follows:\n" << std::endl;
+    std::cout << "Output file = " << output_file << "\n" << std::endl;
+    std::cout << "Cloud topic = " << cloud_topic << "\n" << std::endl;
+    std::cout << "Number of clouds = " << num_clouds << "\n" << std::endl;
+    std::cout << "Voxel size = " << voxel_size << "\n" << std::endl;
+  }
+
+  std::unique_ptr<tf2_ros::Buffer> tf_buffer_;
+  std::shared_ptr<tf2_ros::TransformListener> tf_listener_;
+
+  rclcpp::Subscription<sensor_msgs::msg::PointCloud2>::SharedPtr cloud_sub_;
+  rclcpp::Subscription<sensor_msgs::msg::JointState>::SharedPtr joint_vals_sub_;
+};
+
+
+
+//////////////////// MAIN FUNCTION ///////////////////
+
+int main(int argc, char * argv[])
+{
+  rclcpp::init(argc, argv);
+  rclcpp::spin(std::make_shared<SceneSdfBuilder>());
+  rclcpp::shutdown();
+  return 0;
+}
@@ -0,0 +1,475 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - Pre-session self-test, checking that the machine can keep the
+//   timing of a participant session before anything else is started
+//
+// - Main functionalities (fixed battery, a few seconds each):
+//   1. CPU frequency governor of every core ("performance" expected)
+//   2. Jitter of a 500 Hz ROS wall timer (the controller / talker rate)
+//   3. IK solve time over a set of targets (a recorded trial csv, or
+//      the reference trajectories), seeded like the controller does
+//   4. Publish -> subscribe latency on this host for the message types
+//      of the session (JointState, Falconpos, PosInfo)
+//   5. Rate and jitter of the haptic loop, with the Falcon or a stand-in device
+//
+// - Compares the results with the budget parameters, writes a report
+//   into the session directory and exits with 1 if out of spec
+//   (real.launch.py only starts the session after a 0 exit)
+//
+// - The report's last line is an HMAC-SHA256 of all the lines above it,
+//   keyed with the content of "signing_key_file" (trailing newlines
+//   stripped), a missing or empty key fails the self-test, it can be checked with:
+//   head -n -1 <report> | openssl dgst -sha256 -hmac "$(cat <key file>)"
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <glob.h>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+#include "rclcpp/rclcpp.hpp"
+#include "sensor_msgs/msg/joint_state.hpp"
+
+#include "tutorial_interfaces/msg/falconpos.hpp"
+#include "tutorial_interfaces/msg/pos_info.hpp"
+
+#include "dhdc.h"
+
+#include "ros2_package/panda_kinematics.hpp"
+#include "ros2_package/traj_utils.hpp"
+#include "ros2_package/sample_stats.hpp"
+
+using namespace std::chrono_literals;
+
+
+/////////////////// global variables ///////////////////
+const unsigned int n_joints = 7;
+
+
+/////////////// DEFINITION OF NODE CLASS //////////////
+
+class SessionSelftest : public rclcpp::Node
+{
+public:
+
+  // parameters name list
+  std::vector<std::string> param_names = {"session_dir", "signing_key_file", "use_falcon", "ik_targets", "ik_target_column",
+                                          "require_performance_governor", "timer_p99_jitter_us", "timer_max_jitter_us",
+                                          "ik_p99_us", "latency_p99_us", "haptic_min_rate", "haptic_p99_jitter_us"};
+  std::string session_dir {"."};
+  std::string signing_key_file {""};
+  int use_falcon {0};                 // 0 = stand-in device
+  std::string ik_targets {""};        // trial csv, empty = the reference trajectories
+  int ik_target_column {9};           // first of the 3 target columns (tcp position in the DataLogger layout)
+
+  // budgets
+  int require_performance_governor {1};
+  double timer_p99_jitter_us {250.0};
+  double timer_max_jitter_us {2000.0};
+  double ik_p99_us {1000.0};
+  double latency_p99_us {500.0};
+  double haptic_min_rate {495.0};     // [Hz], loop runs at 500 Hz
+  double haptic_p99_jitter_us {250.0};
+
+  // battery settings
+  const int timer_samples = 2500;       // 5 s at 500 Hz
+  const int latency_samples = 1000;     // per message type
+  const size_t max_ik_targets = 2000;
+  const double haptic_duration = 3.0;   // [s]
+
+  ros2_package::PandaKinematics kinematics;
+
+  // content of signing_key_file
+  std::string signing_key;
+
+  // report lines ("key = value") and the overall verdict
+  std::vector<std::string> report;
+  bool pass = true;
+
+
+  SessionSelftest()
+  : Node("session_selftest")
+  {
+    // parameter stuff
+    this->declare_parameter(param_names.at(0), ".");
+    this->declare_parameter(param_names.at(1), "");
+    this->declare_parameter(param_names.at(2), 0);
+    this->declare_parameter(param_names.at(3), "");
+    this->declare_parameter(param_names.at(4), 9);
+    this->declare_parameter(param_names.at(5), 1);
+    this->declare_parameter(param_names.at(6), 250.0);
+    this->declare_parameter(param_names.at(7), 2000.0);
+    this->declare_parameter(param_names.at(8), 1000.0);
+    this->declare_parameter(param_names.at(9), 500.0);
+    this->declare_parameter(param_names.at(10), 495.0);
+    this->declare_parameter(param_names.at(11), 250.0);
+
+    std::vector<rclcpp::Parameter> params = this->get_parameters(param_names);
+    session_dir = params.at(0).as_string();
+    signing_key_file = params.at(1).as_string();
+    use_falcon = std::stoi(params.at(2).value_to_string().c_str());
+    ik_targets = params.at(3).as_string();
+    ik_target_column = std::stoi(params.at(4).value_to_string().c_str());
+    require_performance_governor = std::stoi(params.at(5).value_to_string().c_str());
+    timer_p99_jitter_us = std::stod(params.at(6).value_to_string().c_str());
+    timer_max_jitter_us = std::stod(params.at(7).value_to_string().c_str());
+    ik_p99_us = std::stod(params.at(8).value_to_string().c_str());
+    latency_p99_us = std::stod(params.at(9).value_to_string().c_str());
+    haptic_min_rate = std::stod(params.at(10).value_to_string().c_str());
+    haptic_p99_jitter_us = std::stod(params.at(11).value_to_string().c_str());
+    print_params();
+
+    kinematics.load();
+  }
+
+  // runs the whole battery, returns the process exit code
+  int run()
+  {
+    char stamp[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%d_%H-%M-%S", std::localtime(&now));
+    add("date", stamp);
+    add("model", kinematics.source());
+
+    load_signing_key();
+    check_governor();
+    check_timer_jitter();
+    check_ik();
+    check_latency();
+    check_haptic_loop();
+
+    add("result", pass ? "PASS" : "FAIL");
+
+    const std::string report_file = session_dir + "/selftest_" + stamp + ".txt";
+    if (!write_report(report_file)) {
+      std::cout << "\nerror: cannot write the self-test report " << report_file << "\n" << std::endl;
+      return 1;
+    }
+    std::cout << "\nSelf-test " << (pass ? "PASSED" : "FAILED, the session will not start") << ", report: " << report_file << "\n" << std::endl;
+    return pass ? 0 : 1;
+  }
+
+
+private:
+
+  ///////////////////////////////////// REPORT HELPERS /////////////////////////////////////
+  void add(const std::string & key, const std::string & value)
+  {
+    report.push_back(key + " = " + value);
+    std::cout << key << " = " << value << std::endl;
+  }
+
+  void add_stats(const std::string & key, const ros2_package::SampleStats & s, double budget)
+  {
+    const bool ok = s.n > 0 && s.p99 <= budget;
+    char line[160];
+    std::snprintf(line, sizeof(line), "n %zu, mean %.1f, p50 %.1f, p99 %.1f, max %.1f [us], p99 budget %.1f -> %s",
+                  s.n, s.mean, s.p50, s.p99, s.max, budget, ok ? "ok" : "OUT OF SPEC");
+    add(key, line);
+    pass = pass && ok;
+  }
+
+  ///////////////////////////////////// SIGNING KEY /////////////////////////////////////
+  // an unsigned report cannot be told apart from an edited one, so no key = no session
+  void load_signing_key()
+  {
+    if (!signing_key_file.empty()) {
+      std::ifstream f(signing_key_file, std::ios::binary);
+      signing_key.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+      while (!signing_key.empty() && (signing_key.back() == '\n' || signing_key.back() == '\r')) signing_key.pop_back();
+    }
+    const bool ok = !signing_key.empty();
+    add("signing_key", (signing_key_file.empty() ? std::string("none") : signing_key_file) + (ok ? " -> ok" : " -> MISSING OR EMPTY"));
+    pass = pass && ok;
+  }
+
+  ///////////////////////////////////// 1. CPU GOVERNOR /////////////////////////////////////
+  void check_governor()
+  {
+    glob_t files;
+    std::vector<std::string> not_performance;
+    size_t n_cpus = 0;
+    if (glob("/sys/devices/system/cpu/cpu[0-9]*/cpufreq/scaling_governor", 0, nullptr, &files) == 0) {
+      for (size_t i=0; i<files.gl_pathc; i++) {
+        std::ifstream f(files.gl_pathv[i]);
+        std::string governor;
+        f >> governor;
+        n_cpus++;
+        // "/sys/devices/system/cpu/cpuN/..." -> "cpuN:governor"
+        const std::string path = files.gl_pathv[i];
+        if (governor != "performance") not_performance.push_back(path.substr(24, path.find('/', 24) - 24) + ":" + governor);
+      }
+    }
+    globfree(&files);
+
+    if (n_cpus == 0) {
+      add("cpu_governor", "not available (no cpufreq) -> ok");
+      return;
+    }
+    std::string line = std::to_string(n_cpus - not_performance.size()) + "/" + std::to_string(n_cpus) + " cores on performance";
+    for (auto & s : not_performance) line += ", " + s;
+    const bool ok = not_performance.empty() || !require_performance_governor;
+    add("cpu_governor", line + (ok ? " -> ok" : " -> OUT OF SPEC"));
+    pass = pass && ok;
+  }
+
+  ///////////////////////////////////// 2. TIMER JITTER /////////////////////////////////////
+  void check_timer_jitter()
+  {
+    std::vector<double> jitter;
+    jitter.reserve(timer_samples);
+    auto prev = std::chrono::steady_clock::now();
+    bool first = true;
+
+    auto timer = this->create_wall_timer(2ms, [&]() {
+      auto now = std::chrono::steady_clock::now();
+      if (!first) jitter.push_back(std::fabs(std::chrono::duration<double, std::micro>(now - prev).count() - 2000.0));
+      prev = now;
+      first = false;
+    });
+    spin_until([&]() { return (int) jitter.size() >= timer_samples; });
+    timer->cancel();
+
+    ros2_package::SampleStats s = ros2_package::SampleStats::of(jitter);
+    add_stats("timer_500hz_jitter", s, timer_p99_jitter_us);
+    const bool ok = s.max <= timer_max_jitter_us;
+    add("timer_500hz_max_jitter", std::to_string((int) s.max) + " us, budget " + std::to_string((int) timer_max_jitter_us) + " us -> " + (ok ? "ok" : "OUT OF SPEC"));
+    pass = pass && ok;
+  }
+
+  ///////////////////////////////////// 3. IK SOLVE TIME /////////////////////////////////////
+  void check_ik()
+  {
+    std::vector< std::vector<double> > targets;
+    std::string source = load_ik_targets(targets);
+
+    std::vector<double> seed {0, -M_PI_4/2, 0, -5 * M_PI_4/2, 0, M_PI_2, M_PI_4};   // home
+    std::vector<double> res(n_joints, 0.0);
+    std::vector<double> times;
+    times.reserve(targets.size());
+
+    // sequential targets, each seeded with the previous solution like the controller
+    for (auto & target : targets) {
+      auto start = std::chrono::steady_clock::now();
+      kinematics.compute_ik(target, seed, res);
+      times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+      seed = res;
+    }
+
+    add("ik_targets", source);
+    add_stats("ik_solve", ros2_package::SampleStats::of(times), ik_p99_us);
+  }
+
+  std::string load_ik_targets(std::vector< std::vector<double> >& targets)
+  {
+    if (!ik_targets.empty()) {
+      std::ifstream file(ik_targets);
+      std::string line;
+      while (targets.size() < max_ik_targets && std::getline(file, line)) {
+        std::stringstream ss(line);
+        std::string value;
+        std::vector<double> row;
+        for (int col=0; std::getline(ss, value, ','); col++) {
+          if (col >= ik_target_column && col < ik_target_column + 3) row.push_back(std::atof(value.c_str()));
+        }
+        if (row.size() == 3) targets.push_back(row);
+      }
+      if (!targets.empty()) return ik_targets + " (" + std::to_string(targets.size()) + " points)";
+      std::cout << "Could not read IK targets from " << ik_targets << ", using the reference trajectories" << std::endl;
+    }
+
+    // the six reference trajectories around the task-space origin, 10 s at 500 Hz would be 5000 points each
+    const std::vector<double> origin {0.5059, 0.0, 0.4346};
+    const size_t per_traj = max_ik_targets / 6;
+    for (int traj_id=0; traj_id<6; traj_id++) {
+      ros2_package::SineTrajectory traj = ros2_package::SineTrajectory::from_id(traj_id, 1);
+      for (size_t i=0; i<per_traj; i++) {
+        double offset[3];
+        traj.offset(2 * M_PI * i / (per_traj - 1), offset);
+        targets.push_back({origin.at(0) + offset[0], origin.at(1) + offset[1], origin.at(2) + offset[2]});
+      }
+    }
+    return "reference trajectories (" + std::to_string(targets.size()) + " points)";
+  }
+
+  ///////////////////////////////////// 4. PUB/SUB LATENCY /////////////////////////////////////
+  // one message in flight per type, sent at 500 Hz, latency = receive time - send time
+  void check_latency()
+  {
+    std::vector<double> lat_joint, lat_falcon, lat_info;
+    std::chrono::steady_clock::time_point sent_joint, sent_falcon, sent_info;
+    bool pending_joint = false, pending_falcon = false, pending_info = false;
+
+    auto us_since = [](std::chrono::steady_clock::time_point t) {
+      return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t).count();
+    };
+
+    auto joint_pub = this->create_publisher<sensor_msgs::msg::JointState>("selftest/joint_states", 10);
+    auto falcon_pub = this->create_publisher<tutorial_interfaces::msg::Falconpos>("selftest/falcon_position", 10);
+    auto info_pub = this->create_publisher<tutorial_interfaces::msg::PosInfo>("selftest/tcp_position", 10);
+
+    auto joint_sub = this->create_subscription<sensor_msgs::msg::JointState>("selftest/joint_states", 10,
+      [&](const sensor_msgs::msg::JointState &) { lat_joint.push_back(us_since(sent_joint)); pending_joint = false; });
+    auto falcon_sub = this->create_subscription<tutorial_interfaces::msg::Falconpos>("selftest/falcon_position", 10,
+      [&](const tutorial_interfaces::msg::Falconpos &) { lat_falcon.push_back(us_since(sent_falcon)); pending_falcon = false; });
+    auto info_sub = this->create_subscription<tutorial_interfaces::msg::PosInfo>("selftest/tcp_position", 10,
+      [&](const tutorial_interfaces::msg::PosInfo &) { lat_info.push_back(us_since(sent_info)); pending_info = false; });
+
+    // same sizes as in the session
+    sensor_msgs::msg::JointState joint_msg;
+    joint_msg.position.resize(n_joints, 0.0);
+    tutorial_interfaces::msg::Falconpos falcon_msg;
+    tutorial_interfaces::msg::PosInfo info_msg;
+    info_msg.ref_position.resize(3, 0.0);
+    info_msg.human_position.resize(3, 0.0);
+    info_msg.robot_position.resize(3, 0.0);
+    info_msg.tcp_position.resize(3, 0.0);
+
+    // let discovery match the endpoints first
+    auto discovery_end = std::chrono::steady_clock::now() + 1s;
+    spin_until([&]() { return std::chrono::steady_clock::now() > discovery_end; });
+
+    auto timer = this->create_wall_timer(2ms, [&]() {
+      if (!pending_joint) { pending_joint = true; sent_joint = std::chrono::steady_clock::now(); joint_pub->publish(joint_msg); }
+      if (!pending_falcon) { pending_falcon = true; sent_falcon = std::chrono::steady_clock::now(); falcon_pub->publish(falcon_msg); }
+      if (!pending_info) { pending_info = true; sent_info = std::chrono::steady_clock::now(); info_pub->publish(info_msg); }
+    });
+    auto deadline = std::chrono::steady_clock::now() + 10s;
+    spin_until([&]() {
+      return std::chrono::steady_clock::now() > deadline ||
+             ((int) lat_joint.size() >= latency_samples && (int) lat_falcon.size() >= latency_samples && (int) lat_info.size() >= latency_samples);
+    });
+    timer->cancel();
+
+    add_stats("latency_joint_state", ros2_package::SampleStats::of(lat_joint), latency_p99_us);
+    add_stats("latency_falconpos", ros2_package::SampleStats::of(lat_falcon), latency_p99_us);
+    add_stats("latency_pos_info", ros2_package::SampleStats::of(lat_info), latency_p99_us);
+  }
+
+  ///////////////////////////////////// 5. HAPTIC LOOP /////////////////////////////////////
+  // the position talker loop: read position and velocity, write the force, every 2 ms
+  void check_haptic_loop()
+  {
+    if (use_falcon) {
+      if (dhdOpen () < 0) {
+        add("haptic_device", std::string("cannot open device (") + dhdErrorGetLastStr() + ") -> OUT OF SPEC");
+        pass = false;
+        return;
+      }
+      dhdEnableExpertMode ();
+      dhdEnableForce (DHD_ON);
+      add("haptic_device", dhdGetSystemName());
+    } else {
+      add("haptic_device", "stand-in (no device calls)");
+    }
+
+    std::vector<double> jitter;
+    double p[3], v[3];
+    int errors = 0;
+    const auto period = std::chrono::microseconds(2000);
+    const auto start = std::chrono::steady_clock::now();
+    auto next = start + period;
+    auto prev = start;
+
+    while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < haptic_duration) {
+      std::this_thread::sleep_until(next);
+      auto now = std::chrono::steady_clock::now();
+      jitter.push_back(std::fabs(std::chrono::duration<double, std::micro>(now - prev).count() - 2000.0));
+      prev = now;
+      next += period;
+
+      if (use_falcon) {
+        if (dhdGetPosition (&p[0], &p[1], &p[2]) < DHD_NO_ERROR) errors++;
+        if (dhdGetLinearVelocity (&v[0], &v[1], &v[2]) < DHD_NO_ERROR) errors++;
+        if (dhdSetForceAndTorqueAndGripperForce (0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0) < DHD_NO_ERROR) errors++;
+      }
+    }
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double rate = jitter.size() / elapsed;
+
+    if (use_falcon) {
+      add("haptic_com_freq", std::to_string(dhdGetComFreq()) + " kHz");
+      dhdEnableForce (DHD_OFF);
+      dhdClose ();
+    }
+
+    add_stats("haptic_loop_jitter", ros2_package::SampleStats::of(jitter), haptic_p99_jitter_us);
+    const bool ok = rate >= haptic_min_rate && errors == 0;
+    add("haptic_loop_rate", std::to_string(rate) + " Hz, " + std::to_string(errors) + " device errors, min " +
+        std::to_string(haptic_min_rate) + " Hz -> " + (ok ? "ok" : "OUT OF SPEC"));
+    pass = pass && ok;
+  }
+
+  ///////////////////////////////////// SPIN / WRITE HELPERS /////////////////////////////////////
+  void spin_until(const std::function<bool()>& done)
+  {
+    rclcpp::executors::SingleThreadedExecutor executor;
+    executor.add_node(this->get_node_base_interface());
+    while (rclcpp::ok() && !done()) executor.spin_once(10ms);
+    executor.remove_node(this->get_node_base_interface());
+  }
+
+  bool write_report(const std::string & file_name)
+  {
+    std::string body;
+    for (auto & line : report) body += line + "\n";
+
+    // the signature covers every byte of the report above it (a FAIL report without a key stays unsigned)
+    std::string signature = "hmac_sha256 = ";
+    if (signing_key.empty()) {
+      std::cout << "No signing key (" << signing_key_file << "), the report is NOT signed" << std::endl;
+      signature += "unsigned";
+    } else {
+      unsigned char md[EVP_MAX_MD_SIZE];
+      unsigned int md_len = 0;
+      HMAC(EVP_sha256(), signing_key.data(), (int) signing_key.size(), (const unsigned char *) body.data(), body.size(), md, &md_len);
+      char hex[3];
+      for (unsigned int i=0; i<md_len; i++) {
+        std::snprintf(hex, sizeof(hex), "%02x", md[i]);
+        signature += hex;
+      }
+    }
+
+    std::ofstream out(file_name);
+    if (!out) return false;
+    out << body << signature << "\n";
+    return (bool) out;
+  }
+
+  void print_params() {
+    std::cout << "\n\nThe current parameters [session_selftest] are as follows:\n" << std::endl;
+    std::cout << "Session directory = " << session_dir << "\n" << std::endl;
+    std::cout << "Use Falcon = " << use_falcon << "\n" << std::endl;
+    std::cout << "IK targets = " << (ik_targets.empty() ? "reference trajectories" : ik_targets) << "\n" << std::endl;
+  }
+};
+
+
+
+//////////////////// MAIN FUNCTION ///////////////////
+
+int main(int argc, char * argv[])
+{
+  rclcpp::init(argc, argv);
+  int exit_code = std::make_shared<SessionSelftest>()->run();
+  rclcpp::shutdown();
+  return exit_code;
+}
@@ -0,0 +1,164 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - C++ class implementation of the SimRobot node, a headless
+//   kinematic stand-in for the robot (no Gazebo, no ros2_control)
+//
+// - Main functionalities:
+//   1. Subscribes to the desired joint values (<- RealController)
+//   2. Tracks them with a transport delay and a first-order lag per joint,
+//      roughly matching the identified response of the real arm
+//   3. Publishes the simulated joint states (-> RealController)
+//
+// - Used by the sim_session launch file, several of which can run in
+//   parallel (see scripts/session_runner.py)
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "sensor_msgs/msg/joint_state.hpp"
+
+#include "ros2_package/executor_utils.hpp"
+#include "ros2_package/qos_profiles.hpp"
+
+using namespace std::chrono_literals;
+
+const unsigned int n_joints = 7;
+
+
+/////////////// DEFINITION OF NODE CLASS //////////////
+
+class SimRobot : public rclcpp::Node
+{
+public:
+
+  // parameters name list
+  std::vector<std::string> param_names = {"update_freq", "delay", "time_constant", "initial_joint_vals", "executor"};
+  int update_freq {1000};           // [Hz]
+  double delay {0.004};             // command -> motion transport delay [s]
+  double time_constant {0.015};     // first-order lag of every joint [s]
+  std::vector<double> initial_joint_vals {0, -M_PI_4/2, 0, -5 * M_PI_4/2, 0, M_PI_2, M_PI_4};   // home
+  std::string executor {"single"};  // see include/ros2_package/executor_utils.hpp
+
+  std::vector<double> joint_vals;
+  std::vector<double> target_joint_vals;
+
+  // received commands waiting for the transport delay, oldest first
+  std::deque< std::pair<double, std::vector<double>> > pending;
+
+  sensor_msgs::msg::JointState joint_states;
+
+  // QoS from config/qos_profiles.yaml, statistics of the command subscription (-> topic_stats)
+  std::unique_ptr<ros2_package::TopicStatsPublisher> topic_stats;
+  std::shared_ptr<ros2_package::TopicStats> command_stats;
+
+
+  SimRobot()
+  : Node("sim_robot")
+  {
+    // parameter stuff
+    this->declare_parameter(param_names.at(0), 1000);
+    this->declare_parameter(param_names.at(1), 0.004);
+    this->declare_parameter(param_names.at(2), 0.015);
+    this->declare_parameter(param_names.at(3), initial_joint_vals);
+    this->declare_parameter(param_names.at(4), executor);
+
+    std::vector<rclcpp::Parameter> params = this->get_parameters(param_names);
+    update_freq = std::stoi(params.at(0).value_to_string().c_str());
+    delay = std::stod(params.at(1).value_to_string().c_str());
+    time_constant = std::stod(params.at(2).value_to_string().c_str());
+    initial_joint_vals = params.at(3).as_double_array();
+    executor = params.at(4).as_string();
+    print_params();
+
+    if (initial_joint_vals.size() != n_joints || update_freq <= 0) {
+      std::cout << "Invalid initial joint values or update frequency, shutting down" << std::endl;
+      rclcpp::shutdown();
+      return;
+    }
+    joint_vals = initial_joint_vals;
+    target_joint_vals = initial_joint_vals;
+
+    joint_states.name = {"panda_joint1", "panda_joint2", "panda_joint3", "panda_joint4", "panda_joint5", "panda_joint6", "panda_joint7"};
+    joint_states.position.resize(n_joints, 0.0);
+
+    // simulated joint states publisher
+    joint_states_pub_ = this->create_publisher<sensor_msgs::msg::JointState>("franka/joint_states", ros2_package::topic_qos(this, "franka/joint_states"));
+
+    // desired joint values subscriber
+    topic_stats = std::make_unique<ros2_package::TopicStatsPublisher>(this, 1.0);
+    const std::string command_qos = ros2_package::topic_qos_profile(this, "desired_joint_vals", "control");
+    command_stats = topic_stats->track("desired_joint_vals", command_qos);
+    command_sub_ = this->create_subscription<sensor_msgs::msg::JointState>(
+      "desired_joint_vals", ros2_package::qos_profile(command_qos), std::bind(&SimRobot::command_callback, this, std::placeholders::_1, std::placeholders::_2));
+
+    timer_ = this->create_wall_timer(std::chrono::microseconds(1000000 / update_freq), std::bind(&SimRobot::timer_callback, this));
+  }
+
+
+private:
+
+  void command_callback(const sensor_msgs::msg::JointState & msg, const rclcpp::MessageInfo & info)
+  {
+    command_stats->add(info);
+    if (msg.position.size() < n_joints) return;
+    pending.emplace_back(this->now().seconds() + delay,
+                         std::vector<double>(msg.position.begin(), msg.position.begin() + n_joints));
+  }
+
+  void timer_callback()
+  {
+    const rclcpp::Time now = this->now();
+
+    // the latest command whose delay has passed becomes the target
+    while (!pending.empty() && pending.front().first <= now.seconds()) {
+      target_joint_vals.swap(pending.front().second);
+      pending.pop_front();
+    }
+
+    // first-order lag, discretized exactly for the update period
+    const double k = time_constant > 0.0 ? 1.0 - std::exp(-1.0 / (update_freq * time_constant)) : 1.0;
+    for (unsigned int i=0; i<n_joints; i++) {
+      joint_vals.at(i) += k * (target_joint_vals.at(i) - joint_vals.at(i));
+      joint_states.position.at(i) = joint_vals.at(i);
+    }
+
+    joint_states.header.stamp = now;
+    joint_states_pub_->publish(joint_states);
+  }
+
+  void print_params() {
+    std::cout << "\n\nThe current parameters [sim_robot] are as follows:\n" << std::endl;
+    std::cout << "Update frequency = " << update_freq << "\n" << std::endl;
+    std::cout << "Delay = " << delay << ", time constant = " << time_constant << "\n" << std::endl;
+    std::cout << "Executor = " << executor << "\n" << std::endl;
+  }
+
+  rclcpp::TimerBase::SharedPtr timer_;
+  rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr joint_states_pub_;
+  rclcpp::Subscription<sensor_msgs::msg::JointState>::SharedPtr command_sub_;
+};
+
+
+
+//////////////////// MAIN FUNCTION ///////////////////
+
+int main(int argc, char * argv[])
+{
+  rclcpp::init(argc, argv);
+  auto sim_robot = std::make_shared<SimRobot>();
+  ros2_package::spin_node(sim_robot, sim_robot->executor);
+  rclcpp::shutdown();
+  return 0;
+}
@@ -0,0 +1,174 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - C++ class implementation of the SyntheticOperator node, a simulated
+//   participant standing in for the Falcon (and the human holding it)
+//
+// - Main functionalities:
+//   1. Subscribes to the trial phase and trajectory time origin (<- RealController)
+//   2. Follows the reference trajectory with a reaction delay, a first-order
+//      lag and Gaussian tremor (seeded, so a session can be reproduced)
+//   3. Publishes the resulting Falcon position in [cm] (-> RealController),
+//      scaled back by the mapping ratio like a real participant would be
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+
+#include "tutorial_interfaces/msg/falconpos.hpp"
+#include "tutorial_interfaces/msg/trial_event.hpp"
+
+#include "ros2_package/trajectory_generators.hpp"
+#include "ros2_package/executor_utils.hpp"
+#include "ros2_package/qos_profiles.hpp"
+
+using namespace std::chrono_literals;
+
+
+/////////////// DEFINITION OF NODE CLASS //////////////
+
+class SyntheticOperator : public rclcpp::Node
+{
+public:
+
+  // parameters name list
+  std::vector<std::string> param_names = {"mapping_ratio", "publish_freq", "reaction_delay", "time_constant", "tremor", "seed", "executor"};
+  double mapping_ratio {3.0};
+  int publish_freq {500};         // [Hz], same as the position talker
+  double reaction_delay {0.15};   // [s]
+  double time_constant {0.1};     // [s]
+  double tremor {0.002};          // standard deviation of the hand noise, in the robot frame [m]
+  int seed {0};
+  std::string executor {"single"};  // see include/ros2_package/executor_utils.hpp
+
+  // latest trial event, the reference is re-armed only when the announced trajectory changes
+  ros2_package::TrajectoryTable ref_table;
+  std::string armed_trajectory;
+  rclcpp::Time traj_origin;
+  double traj_duration = 10.0;   // [s]
+  bool got_event = false;
+
+  // hand position (offset from the task-space origin) in the robot frame [m]
+  std::vector<double> hand_offset {0.0, 0.0, 0.0};
+
+  std::mt19937 rng;
+  std::normal_distribution<double> noise {0.0, 1.0};
+
+
+  SyntheticOperator()
+  : Node("synthetic_operator")
+  {
+    // parameter stuff
+    this->declare_parameter(param_names.at(0), 3.0);
+    this->declare_parameter(param_names.at(1), 500);
+    this->declare_parameter(param_names.at(2), 0.15);
+    this->declare_parameter(param_names.at(3), 0.1);
+    this->declare_parameter(param_names.at(4), 0.002);
+    this->declare_parameter(param_names.at(5), 0);
+    this->declare_parameter(param_names.at(6), executor);
+
+    std::vector<rclcpp::Parameter> params = this->get_parameters(param_names);
+    mapping_ratio = std::stod(params.at(0).value_to_string().c_str());
+    publish_freq = std::stoi(params.at(1).value_to_string().c_str());
+    reaction_delay = std::stod(params.at(2).value_to_string().c_str());
+    time_constant = std::stod(params.at(3).value_to_string().c_str());
+    tremor = std::stod(params.at(4).value_to_string().c_str());
+    seed = std::stoi(params.at(5).value_to_string().c_str());
+    executor = params.at(6).as_string();
+    print_params();
+
+    if (publish_freq <= 0 || !(mapping_ratio > 0.0)) {
+      std::cout << "Invalid publish frequency or mapping ratio, shutting down" << std::endl;
+      rclcpp::shutdown();
+      return;
+    }
+    rng.seed((unsigned int) seed);
+
+    // Falcon position publisher
+    falcon_pos_pub_ = this->create_publisher<tutorial_interfaces::msg::Falconpos>("falcon_position", ros2_package::topic_qos(this, "falcon_position"));
+
+    // trial event subscriber (latched)
+    event_sub_ = this->create_subscription<tutorial_interfaces::msg::TrialEvent>(
+      "trial_event", ros2_package::topic_qos(this, "trial_event", "event"), std::bind(&SyntheticOperator::event_callback, this, std::placeholders::_1));
+
+    timer_ = this->create_wall_timer(std::chrono::microseconds(1000000 / publish_freq), std::bind(&SyntheticOperator::timer_callback, this));
+  }
+
+
+private:
+
+  void timer_callback()
+  {
+    // the operator aims at where the reference was one reaction delay ago
+    // (the trajectory start before the trial, the end point after it)
+    double target[3] = {0.0, 0.0, 0.0};
+    if (got_event) {
+      double t = (this->now() - traj_origin).seconds() - reaction_delay;
+      ref_table.offset(t / traj_duration * 2 * M_PI, target);
+    }
+
+    const double k = time_constant > 0.0 ? 1.0 - std::exp(-1.0 / (publish_freq * time_constant)) : 1.0;
+    auto message = tutorial_interfaces::msg::Falconpos();
+    double falcon_p[3];
+    for (size_t i=0; i<3; i++) {
+      hand_offset.at(i) += k * (target[i] - hand_offset.at(i));
+      falcon_p[i] = (hand_offset.at(i) + tremor * noise(rng)) / mapping_ratio * 100;   // [m] -> [cm]
+    }
+    message.x = falcon_p[0];
+    message.y = falcon_p[1];
+    message.z = falcon_p[2];
+    falcon_pos_pub_->publish(message);
+  }
+
+  void event_callback(const tutorial_interfaces::msg::TrialEvent & msg)
+  {
+    const std::string trajectory = (msg.trajectory.empty() ? "sines" : msg.trajectory) +
+                                   "|" + std::to_string(msg.traj_id) + "|" + std::to_string(msg.use_depth);
+    if (trajectory != armed_trajectory) {
+      std::string error;
+      if (!ref_table.arm(msg.trajectory, msg.traj_id, msg.use_depth, ros2_package::default_table_samples, error)) {
+        RCLCPP_WARN(this->get_logger(), "Invalid trajectory \"%s\" announced: %s", msg.trajectory.c_str(), error.c_str());
+        return;
+      }
+      armed_trajectory = trajectory;
+    }
+    traj_origin = rclcpp::Time(msg.traj_origin, this->get_clock()->get_clock_type());
+    traj_duration = msg.traj_duration;
+    got_event = true;
+  }
+
+  void print_params() {
+    std::cout << "\n\nThe current parameters [synthetic_operator] are as follows:\n" << std::endl;
+    std::cout << "Mapping ratio = " << mapping_ratio << "\n" << std::endl;
+    std::cout << "Reaction delay = " << reaction_delay << ", time constant = " << time_constant << "\n" << std::endl;
+    std::cout << "Tremor = " << tremor << ", seed = " << seed << "\n" << std::endl;
+    std::cout << "Executor = " << executor << "\n" << std::endl;
+  }
+
+  rclcpp::TimerBase::SharedPtr timer_;
+  rclcpp::Publisher<tutorial_interfaces::msg::Falconpos>::SharedPtr falcon_pos_pub_;
+  rclcpp::Subscription<tutorial_interfaces::msg::TrialEvent>::SharedPtr event_sub_;
+};
+
+
+
+//////////////////// MAIN FUNCTION ///////////////////
+
+int main(int argc, char * argv[])
+{
+  rclcpp::init(argc, argv);
+  auto synthetic_operator = std::make_shared<SyntheticOperator>();
+  ros2_package::spin_node(synthetic_operator, synthetic_operator->executor);
+  rclcpp::shutdown();
+  return 0;
+}
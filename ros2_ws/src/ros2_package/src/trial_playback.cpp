@@ -0,0 +1,401 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - C++ class implementation of the TrialPlayback node, replaying
+//   logged trials in RViz with the markers used live
+//
+// - Main functionalities:
+//   1. Indexes the trial csv files of the log directory and converts the
+//      requested one once into a memory-mapped .trial file in the cache
+//      directory (include/ros2_package/trial_log.hpp), with the joint values
+//      of every sample solved by IK
+//   2. Republishes the samples (-> tcp_position) and the joint states
+//      (-> joint_states, for robot_state_publisher) at 0.1x - 50x speed
+//   3. Publishes the trial event matching the playback position and speed,
+//      so the MarkerPublisher draws the reference ball where it was
+//   4. Load / play / pause / seek / scrub / speed through the
+//      "playback_control" service, seeks are binary searches of the time index
+//
+// - Usage:
+//   ros2 launch ros2_package playback.launch.py log_dir:=<csv_logs/> part_id:=3 trial_number:=12
+//   ros2 service call /playback_control tutorial_interfaces/srv/PlaybackControl "{command: 3, time: 4.5}"
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "rclcpp/rclcpp.hpp"
+#include "std_msgs/msg/float64.hpp"
+#include "sensor_msgs/msg/joint_state.hpp"
+
+#include "tutorial_interfaces/msg/pos_info.hpp"
+#include "tutorial_interfaces/msg/trial_event.hpp"
+#include "tutorial_interfaces/srv/playback_control.hpp"
+
+#include "ros2_package/trial_log.hpp"
+#include "ros2_package/panda_kinematics.hpp"
+#include "ros2_package/qos_profiles.hpp"
+
+using namespace std::chrono_literals;
+using PlaybackControl = tutorial_interfaces::srv::PlaybackControl;
+
+const unsigned int n_joints = 7;
+
+
+/////////////// DEFINITION OF NODE CLASS //////////////
+
+class TrialPlayback : public rclcpp::Node
+{
+public:
+
+  // parameters name list
+  std::vector<std::string> param_names = {"log_dir", "cache_dir", "part_id", "trial_number", "speed", "publish_freq",
+                                          "loop", "use_depth", "traj_duration", "urdf_path", "trajectory"};
+  std::string log_dir {""};                        // DataLogger directory (part<N>/trial<M>.csv)
+  std::string cache_dir {"/tmp/trial_playback"};   // converted .trial files
+  int part_id {-1};             // trial loaded at startup (-1 = wait for a LOAD request)
+  int trial_number {-1};
+  double speed {1.0};
+  int publish_freq {500};       // [Hz], the playback clock, the samples keep their logged rate
+  int loop {0};
+  int use_depth {0};            // not in the logs, only forwarded to the markers
+  std::string trajectory {"sines"};   // generator spec of the trial, not in the logs either, announced to the markers
+  double traj_duration {10.0};  // [s], KEEP CONSISTENT WITH REAL CONTROLLER
+  std::string urdf_path {""};
+
+  const double min_speed = 0.1;
+  const double max_speed = 50.0;
+  const size_t max_samples_per_tick = 256;   // at 50x, older passed samples are skipped
+
+  ros2_package::TrialCatalog catalog;
+  ros2_package::TrialLog log;
+  ros2_package::PandaKinematics kinematics;
+  std::vector<double> home_joint_vals {0, -M_PI_4/2, 0, -5 * M_PI_4/2, 0, M_PI_2, M_PI_4};
+
+  // playback state
+  double play_time {0.0};     // position in the log time [s]
+  bool playing = false;
+  size_t cursor = 0;          // last published sample
+  std::chrono::steady_clock::time_point last_tick;
+  int count = 0;
+
+  // preallocated messages
+  tutorial_interfaces::msg::PosInfo pos_info;
+  sensor_msgs::msg::JointState joint_states;
+
+
+  TrialPlayback()
+  : Node("trial_playback")
+  {
+    // parameter stuff
+    this->declare_parameter(param_names.at(0), log_dir);
+    this->declare_parameter(param_names.at(1), cache_dir);
+    this->declare_parameter(param_names.at(2), -1);
+    this->declare_parameter(param_names.at(3), -1);
+    this->declare_parameter(param_names.at(4), 1.0);
+    this->declare_parameter(param_names.at(5), 500);
+    this->declare_parameter(param_names.at(6), 0);
+    this->declare_parameter(param_names.at(7), 0);
+    this->declare_parameter(param_names.at(8), 10.0);
+    this->declare_parameter(param_names.at(9), urdf_path);
+    this->declare_parameter(param_names.at(10), trajectory);
+
+    std::vector<rclcpp::Parameter> params = this->get_parameters(param_names);
+    log_dir = params.at(0).as_string();
+    cache_dir = params.at(1).as_string();
+    part_id = std::stoi(params.at(2).value_to_string().c_str());
+    trial_number = std::stoi(params.at(3).value_to_string().c_str());
+    speed = std::clamp(std::stod(params.at(4).value_to_string().c_str()), min_speed, max_speed);
+    publish_freq = std::stoi(params.at(5).value_to_string().c_str());
+    loop = std::stoi(params.at(6).value_to_string().c_str());
+    use_depth = std::stoi(params.at(7).value_to_string().c_str());
+    traj_duration = std::stod(params.at(8).value_to_string().c_str());
+    urdf_path = params.at(9).as_string();
+    trajectory = params.at(10).as_string();
+
+    if (!log_dir.empty() && log_dir.back() != '/') log_dir += "/";
+    print_params();
+
+    if (publish_freq <= 0 || traj_duration <= 0.0) {
+      std::cout << "Invalid publishing frequency or trajectory duration, shutting down" << std::endl;
+      rclcpp::shutdown();
+      return;
+    }
+
+    // IK of the logged tcp positions
+    if (!kinematics.load(urdf_path)) {
+      rclcpp::shutdown();
+      return;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(cache_dir, ec);
+    std::cout << "Indexed " << catalog.scan(log_dir) << " trials in " << log_dir << "\n" << std::endl;
+
+    joint_states.name = {"panda_joint1", "panda_joint2", "panda_joint3", "panda_joint4", "panda_joint5", "panda_joint6", "panda_joint7"};
+    joint_states.position.resize(n_joints, 0.0);
+    pos_info.ref_position.resize(3);
+    pos_info.human_position.resize(3);
+    pos_info.robot_position.resize(3);
+    pos_info.tcp_position.resize(3);
+
+    // same topics as a live session
+    tcp_pos_pub_ = this->create_publisher<tutorial_interfaces::msg::PosInfo>("tcp_position", 10);
+    joint_states_pub_ = this->create_publisher<sensor_msgs::msg::JointState>("joint_states", ros2_package::topic_qos(this, "joint_states"));
+    trial_event_pub_ = this->create_publisher<tutorial_interfaces::msg::TrialEvent>("trial_event", ros2_package::topic_qos(this, "trial_event", "event"));
+    countdown_pub_ = this->create_publisher<std_msgs::msg::Float64>("countdown", 10);
+
+    control_srv_ = this->create_service<PlaybackControl>(
+      "playback_control", std::bind(&TrialPlayback::control_callback, this, std::placeholders::_1, std::placeholders::_2));
+
+    if (part_id >= 0 && trial_number >= 0) {
+      std::string error;
+      if (load(part_id, trial_number, error)) playing = true;
+      else std::cout << error << std::endl;
+    }
+
+    last_tick = std::chrono::steady_clock::now();
+    timer_ = this->create_wall_timer(std::chrono::microseconds(1000000 / publish_freq), std::bind(&TrialPlayback::timer_callback, this));
+  }
+
+
+private:
+
+  ///////////////////////////////////// LOADING /////////////////////////////////////
+  bool load(int part, int trial, std::string & error)
+  {
+    const ros2_package::TrialCatalog::Entry * entry = catalog.find(part, trial);
+    if (entry == nullptr && catalog.scan(log_dir) > 0) entry = catalog.find(part, trial);   // logged since startup
+    if (entry == nullptr) {
+      error = "No trial " + std::to_string(trial) + " of participant " + std::to_string(part) + " in " + log_dir;
+      return false;
+    }
+
+    // the converted file is reused as long as it is newer than the csv
+    const std::string path = cache_dir + "/part" + std::to_string(part) + "_trial" + std::to_string(trial) + ".trial";
+    struct stat csv_stat, cache_stat;
+    const bool fresh = stat(entry->csv_path.c_str(), &csv_stat) == 0 && stat(path.c_str(), &cache_stat) == 0 &&
+                       cache_stat.st_mtime >= csv_stat.st_mtime;
+
+    if (!fresh || !log.open(path)) {
+      auto start = std::chrono::steady_clock::now();
+      ros2_package::trial_log::Table table;
+      if (!ros2_package::parse_trial_csv(entry->csv_path, table, error)) return false;
+      table.part_id = part;
+      table.trial_number = trial;
+      table.alpha_id = entry->alpha_id;
+      table.traj_id = entry->traj_id;
+      solve_joints(table);
+
+      if (!ros2_package::write_trial_log(path, table) || !log.open(path)) {
+        error = "Failed to write " + path;
+        return false;
+      }
+      std::cout << "Converted " << entry->csv_path << " (" << table.size() << " samples) in "
+                << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s" << std::endl;
+    }
+
+    std::cout << "Loaded participant " << part << ", trial " << trial << " (alpha_id = " << log.alpha_id()
+              << ", traj_id = " << log.traj_id() << ", " << log.size() << " samples, "
+              << log.start_time() << " - " << log.end_time() << " s)\n" << std::endl;
+
+    playing = false;
+    seek(log.start_time());
+    return true;
+  }
+
+  // joint values of every logged tcp position, each solution seeds the next one
+  void solve_joints(ros2_package::trial_log::Table & table)
+  {
+    using namespace ros2_package::trial_log;
+    std::vector<double> seed = home_joint_vals, q(n_joints), tcp(3);
+    kinematics.reset_orientation();
+    for (size_t i=0; i<table.size(); i++) {
+      for (int k=0; k<3; k++) tcp.at(k) = table.columns.at(tcp_x + k).at(i);
+      if (std::isfinite(tcp.at(0)) && std::isfinite(tcp.at(1)) && std::isfinite(tcp.at(2))) {
+        kinematics.compute_ik(tcp, seed, q);
+        seed = q;
+      }
+      for (unsigned int j=0; j<n_joints; j++) table.columns.at(joint_1 + j).at(i) = seed.at(j);
+    }
+  }
+
+  ///////////////////////////////////// PLAYBACK /////////////////////////////////////
+  void timer_callback()
+  {
+    auto now = std::chrono::steady_clock::now();
+    const double dt = std::chrono::duration<double>(now - last_tick).count();
+    last_tick = now;
+
+    // keep the countdown of the markers hidden (countdown_count = 5 - 6 < 0)
+    count++;
+    if (count % publish_freq == 0) {
+      auto message = std_msgs::msg::Float64();
+      message.data = 6.0;
+      countdown_pub_->publish(message);
+    }
+
+    if (!log.is_open() || !playing) return;
+
+    play_time += dt * speed;
+    if (play_time >= log.end_time()) {
+      if (loop) {
+        seek(log.start_time());
+        return;
+      }
+      play_time = log.end_time();
+      playing = false;
+    }
+
+    // every sample passed since the last tick, in order
+    const size_t target = log.seek(play_time);
+    if (target > cursor) {
+      const size_t first = std::max(cursor + 1, target + 1 > max_samples_per_tick ? target + 1 - max_samples_per_tick : 0);
+      for (size_t i=first; i<=target; i++) publish_sample(i);
+      cursor = target;
+      publish_joints(cursor);
+    }
+    if (!playing) publish_event();
+  }
+
+  void seek(double t)
+  {
+    play_time = std::clamp(t, log.start_time(), log.end_time());
+    cursor = log.seek(play_time);
+    publish_sample(cursor);
+    publish_joints(cursor);
+    publish_event();
+  }
+
+  void publish_sample(size_t i)
+  {
+    using namespace ros2_package::trial_log;
+    for (int k=0; k<3; k++) {
+      pos_info.ref_position.at(k) = log.at((Column) (ref_x + k), i);
+      pos_info.human_position.at(k) = log.at((Column) (human_x + k), i);
+      pos_info.robot_position.at(k) = log.at((Column) (robot_x + k), i);
+      pos_info.tcp_position.at(k) = log.at((Column) (tcp_x + k), i);
+    }
+    pos_info.time_from_start = log.at(ros2_package::trial_log::time, i);
+    pos_info.nominal_time_from_start = log.at(ros2_package::trial_log::nominal_time, i);
+    tcp_pos_pub_->publish(pos_info);
+  }
+
+  void publish_joints(size_t i)
+  {
+    using namespace ros2_package::trial_log;
+    for (unsigned int j=0; j<n_joints; j++) joint_states.position.at(j) = log.at((Column) (joint_1 + j), i);
+    joint_states.header.stamp = this->now();
+    joint_states_pub_->publish(joint_states);
+  }
+
+  // the markers compute the reference from the time since traj_origin over traj_duration, so the
+  // playback speed scales the duration, and a paused playback gets a duration long enough to stand still
+  void publish_event()
+  {
+    using Event = tutorial_interfaces::msg::TrialEvent;
+    auto message = Event();
+    const bool finished = !playing && play_time >= log.end_time();
+    const double duration = playing ? traj_duration / speed : 1e9;
+
+    message.phase = finished ? Event::FINISHED : Event::RECORDING;
+    message.traj_duration = duration;
+    message.traj_id = log.traj_id();
+    message.use_depth = use_depth;
+    message.trajectory = trajectory;
+    message.traj_origin = this->now() - rclcpp::Duration::from_seconds(play_time / traj_duration * duration);
+    trial_event_pub_->publish(message);
+  }
+
+  ///////////////////////////////////// SERVICE /////////////////////////////////////
+  void control_callback(const std::shared_ptr<PlaybackControl::Request> request, std::shared_ptr<PlaybackControl::Response> response)
+  {
+    std::string error;
+    response->success = true;
+
+    if (request->command == PlaybackControl::Request::LOAD) {
+      response->success = load(request->part_id, request->trial_number, error);
+    } else if (!log.is_open()) {
+      response->success = false;
+      error = "No trial loaded";
+    } else {
+      switch (request->command) {
+        case PlaybackControl::Request::PLAY:
+          if (play_time >= log.end_time()) seek(log.start_time());
+          playing = true;
+          last_tick = std::chrono::steady_clock::now();
+          publish_event();
+          break;
+        case PlaybackControl::Request::PAUSE:
+          playing = false;
+          publish_event();
+          break;
+        case PlaybackControl::Request::SEEK:
+          seek(request->time);
+          break;
+        case PlaybackControl::Request::SCRUB:
+          playing = false;
+          seek(play_time + request->time);
+          break;
+        case PlaybackControl::Request::SPEED:
+          if (!(request->speed >= min_speed && request->speed <= max_speed)) {
+            response->success = false;
+            error = "Speed must be within [" + std::to_string(min_speed) + ", " + std::to_string(max_speed) + "]";
+            break;
+          }
+          speed = request->speed;
+          publish_event();
+          break;
+        default:
+          response->success = false;
+          error = "Unknown command " + std::to_string(request->command);
+      }
+    }
+
+    response->message = response->success ? "ok" : error;
+    response->time = play_time;
+    response->start_time = log.is_open() ? log.start_time() : 0.0;
+    response->end_time = log.is_open() ? log.end_time() : 0.0;
+    response->speed = speed;
+    response->playing = playing;
+    if (!response->success) std::cout << error << std::endl;
+  }
+
+  void print_params() {
+    std::cout << "\n\nThe current parameters [trial_playback] are as follows:\n" << std::endl;
+    std::cout << "Log directory = " << log_dir << ", cache = " << cache_dir << "\n" << std::endl;
+    std::cout << "Participant ID = " << part_id << ", trial = " << trial_number << "\n" << std::endl;
+    std::cout << "Speed = " << speed << ", loop = " << loop << "\n" << std::endl;
+    std::cout << "Trajectory generator = " << trajectory << "\n" << std::endl;
+  }
+
+  rclcpp::TimerBase::SharedPtr timer_;
+  rclcpp::Publisher<tutorial_interfaces::msg::PosInfo>::SharedPtr tcp_pos_pub_;
+  rclcpp::Publisher<sensor_msgs::msg::JointState>::SharedPtr joint_states_pub_;
+  rclcpp::Publisher<tutorial_interfaces::msg::TrialEvent>::SharedPtr trial_event_pub_;
+  rclcpp::Publisher<std_msgs::msg::Float64>::SharedPtr countdown_pub_;
+  rclcpp::Service<PlaybackControl>::SharedPtr control_srv_;
+};
+
+
+
+//////////////////// MAIN FUNCTION ///////////////////
+
+int main(int argc, char * argv[])
+{
+  rclcpp::init(argc, argv);
+  rclcpp::spin(std::make_shared<TrialPlayback>());
+  rclcpp::shutdown();
+  return 0;
+}
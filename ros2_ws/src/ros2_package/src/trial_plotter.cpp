@@ -0,0 +1,301 @@
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+// FILE SUMMARY:
+//
+// - C++ class implementation of the TrialPlotter node, an offline batch
+//   renderer of the per-trial figures of a whole log directory
+//
+// - Main functionalities:
+//   1. Reads the trial csv files of the DataLogger (all participants, or one)
+//      on all cores (include/ros2_package/trial_log.hpp)
+//   2. Renders the "axes", "3d" and "error" figures of every trial
+//      (include/ros2_package/trial_figures.hpp) to PNG and / or SVG, one
+//      figure per job over a pool of worker threads, with software
+//      rasterization and one glyph cache shared by all of them
+//   3. Lays out one contact sheet per participant and figure, its cells
+//      drawn in parallel into disjoint regions of the same canvas
+//
+// - Usage:
+//   ros2 run ros2_package trial_plotter --ros-args -p log_dir:=<csv_logs/> -p out_dir:=/tmp/trial_plots -p figures:="axes,3d,error"
+//
+//////////////////////////////////////////////////////
+//////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+
+#include "ros2_package/trial_log.hpp"
+#include "ros2_package/plot_surface.hpp"
+#include "ros2_package/trial_figures.hpp"
+
+
+// runs job(i) for i in [0, n) on n_threads threads, the jobs are taken in order
+static void parallel_for(size_t n, unsigned int n_threads, const std::function<void(size_t)> & job)
+{
+  std::atomic<size_t> next {0};
+  auto worker = [&]() {
+    for (size_t i = next++; i < n; i = next++) job(i);
+  };
+  std::vector<std::thread> threads;
+  for (unsigned int t=1; t<std::min<size_t>(n_threads, n); t++) threads.emplace_back(worker);
+  worker();
+  for (auto & t : threads) t.join();
+}
+
+
+/////////////// DEFINITION OF NODE CLASS //////////////
+
+class TrialPlotter : public rclcpp::Node
+{
+public:
+
+  // parameters name list
+  std::vector<std::string> param_names = {"log_dir", "out_dir", "part_id", "figures", "format", "width", "height",
+                                          "threads", "per_trial", "contact_sheet", "sheet_columns", "cell_width", "cell_height"};
+  std::string log_dir {""};
+  std::string out_dir {"/tmp/trial_plots"};
+  int part_id {-1};                           // -1 = every participant
+  std::string figures {"axes,3d,error"};
+  std::string format {"png"};                 // png, svg or both
+  int width {1000};                           // [px] of a trial figure
+  int height {800};
+  int threads {0};                            // 0 = all cores
+  int per_trial {1};                          // one file per trial and figure
+  int contact_sheet {1};                      // one file per participant and figure
+  int sheet_columns {8};
+  int cell_width {360};
+  int cell_height {300};
+
+  std::vector<ros2_package::trial_figures::Figure> figure_list;
+  ros2_package::GlyphCache glyphs;
+
+
+  TrialPlotter()
+  : Node("trial_plotter")
+  {
+    // parameter stuff
+    this->declare_parameter(param_names.at(0), log_dir);
+    this->declare_parameter(param_names.at(1), out_dir);
+    this->declare_parameter(param_names.at(2), -1);
+    this->declare_parameter(param_names.at(3), figures);
+    this->declare_parameter(param_names.at(4), format);
+    this->declare_parameter(param_names.at(5), 1000);
+    this->declare_parameter(param_names.at(6), 800);
+    this->declare_parameter(param_names.at(7), 0);
+    this->declare_parameter(param_names.at(8), 1);
+    this->declare_parameter(param_names.at(9), 1);
+    this->declare_parameter(param_names.at(10), 8);
+    this->declare_parameter(param_names.at(11), 360);
+    this->declare_parameter(param_names.at(12), 300);
+
+    std::vector<rclcpp::Parameter> params = this->get_parameters(param_names);
+    log_dir = params.at(0).as_string();
+    out_dir = params.at(1).as_string();
+    part_id = std::stoi(params.at(2).value_to_string().c_str());
+    figures = params.at(3).as_string();
+    format = params.at(4).as_string();
+    width = std::stoi(params.at(5).value_to_string().c_str());
+    height = std::stoi(params.at(6).value_to_string().c_str());
+    threads = std::stoi(params.at(7).value_to_string().c_str());
+    per_trial = std::stoi(params.at(8).value_to_string().c_str());
+    contact_sheet = std::stoi(params.at(9).value_to_string().c_str());
+    sheet_columns = std::max(1, std::stoi(params.at(10).value_to_string().c_str()));
+    cell_width = std::stoi(params.at(11).value_to_string().c_str());
+    cell_height = std::stoi(params.at(12).value_to_string().c_str());
+
+    if (threads <= 0) threads = (int) std::max(1u, std::thread::hardware_concurrency());
+
+    std::stringstream names(figures);
+    std::string name;
+    while (std::getline(names, name, ',')) {
+      ros2_package::trial_figures::Figure f;
+      if (ros2_package::trial_figures::figure_from_name(name, f)) figure_list.push_back(f);
+      else std::cout << "Unknown figure '" << name << "' (axes, 3d, error), skipped" << std::endl;
+    }
+
+    print_params();
+  }
+
+  int run()
+  {
+    using Clock = std::chrono::steady_clock;
+    auto seconds_since = [](Clock::time_point t) { return std::chrono::duration<double>(Clock::now() - t).count(); };
+
+    if (format != "png" && format != "svg" && format != "both") {
+      std::cout << "Unknown format '" << format << "' (png, svg, both)" << std::endl;
+      return 1;
+    }
+
+    ros2_package::TrialCatalog catalog;
+    catalog.scan(log_dir);
+    std::vector<ros2_package::TrialCatalog::Entry> entries;
+    for (const auto & e : catalog.entries()) {
+      if (part_id < 0 || e.part_id == part_id) entries.push_back(e);
+    }
+    if (entries.empty() || figure_list.empty()) {
+      std::cout << "Nothing to plot in " << log_dir << std::endl;
+      return 1;
+    }
+
+    // 1. read every trial
+    auto start = Clock::now();
+    std::vector<ros2_package::trial_log::Table> tables(entries.size());
+    std::vector<char> loaded(entries.size(), 0);
+    parallel_for(entries.size(), (unsigned int) threads, [&](size_t i) {
+      std::string error;
+      const auto & e = entries[i];
+      if (!ros2_package::parse_trial_csv(e.csv_path, tables[i], error)) {
+        std::cout << error << std::endl;
+        return;
+      }
+      tables[i].part_id = e.part_id;
+      tables[i].trial_number = e.trial_number;
+      tables[i].alpha_id = e.alpha_id;
+      tables[i].traj_id = e.traj_id;
+      loaded[i] = 1;
+    });
+    std::vector<size_t> trials;
+    for (size_t i=0; i<entries.size(); i++) if (loaded[i]) trials.push_back(i);
+    std::cout << "Read " << trials.size() << " trials in " << seconds_since(start) << " s" << std::endl;
+
+    // participants, each with its trials in order
+    std::vector<std::vector<size_t>> parts;
+    for (size_t i : trials) {
+      if (parts.empty() || tables[parts.back().front()].part_id != tables[i].part_id) parts.emplace_back();
+      parts.back().push_back(i);
+    }
+    std::error_code ec;
+    for (const auto & p : parts) std::filesystem::create_directories(part_dir(tables[p.front()].part_id), ec);
+    std::filesystem::create_directories(out_dir, ec);
+
+    // 2. one figure per job
+    std::atomic<size_t> failed {0};
+    if (per_trial) {
+      start = Clock::now();
+      const size_t n_jobs = trials.size() * figure_list.size();
+      parallel_for(n_jobs, (unsigned int) threads, [&](size_t job) {
+        const auto & t = tables[trials[job / figure_list.size()]];
+        const auto figure = figure_list[job % figure_list.size()];
+        const std::string path = part_dir(t.part_id) + "/trial" + std::to_string(t.trial_number) + "_" +
+                                 ros2_package::trial_figures::figure_name(figure);
+        const ros2_package::Rect frame {0, 0, (double) width, (double) height};
+
+        if (format != "svg") {
+          ros2_package::Canvas canvas(width, height);
+          ros2_package::RasterSurface surface(canvas, glyphs);
+          ros2_package::trial_figures::draw_trial_figure(surface, frame, t, figure, false);
+          if (!ros2_package::write_png(path + ".png", canvas)) failed++;
+        }
+        if (format != "png") {
+          ros2_package::SvgSurface surface;
+          surface.fill_rect(frame, {255, 255, 255});
+          ros2_package::trial_figures::draw_trial_figure(surface, frame, t, figure, false);
+          if (!ros2_package::write_svg(path + ".svg", width, height, surface)) failed++;
+        }
+      });
+      std::cout << "Rendered " << n_jobs << " trial figures in " << seconds_since(start) << " s on " << threads << " threads" << std::endl;
+    }
+
+    // 3. contact sheets, the cells of a sheet are the jobs
+    if (contact_sheet) {
+      start = Clock::now();
+      for (const auto & p : parts) {
+        for (const auto figure : figure_list) {
+          if (!render_sheet(tables, p, figure)) failed++;
+        }
+      }
+      std::cout << "Rendered " << parts.size() * figure_list.size() << " contact sheets in " << seconds_since(start) << " s" << std::endl;
+    }
+
+    if (failed) std::cout << failed << " file(s) could not be written to " << out_dir << std::endl;
+    std::cout << "Plots written to " << out_dir << "\n" << std::endl;
+    return failed ? 1 : 0;
+  }
+
+
+private:
+
+  std::string part_dir(int part) const { return out_dir + "/part" + std::to_string(part); }
+
+  bool render_sheet(const std::vector<ros2_package::trial_log::Table> & tables, const std::vector<size_t> & trials,
+                    ros2_package::trial_figures::Figure figure)
+  {
+    using namespace ros2_package;
+    const int columns = std::min<int>(sheet_columns, (int) trials.size());
+    const int rows = ((int) trials.size() + columns - 1) / columns;
+    const int header = 40;
+    const int sheet_width = columns * cell_width, sheet_height = header + rows * cell_height;
+    const std::string path = out_dir + "/part" + std::to_string(tables[trials.front()].part_id) + "_" +
+                             trial_figures::figure_name(figure) + "_sheet";
+
+    auto cell = [&](size_t i) {
+      return Rect {(double) ((int) i % columns * cell_width), (double) (header + (int) i / columns * cell_height),
+                   (double) cell_width, (double) cell_height};
+    };
+    auto draw_header = [&](Surface & s) {
+      char title[96];
+      std::snprintf(title, sizeof(title), "participant %d, %s, %zu trials", tables[trials.front()].part_id,
+                    trial_figures::figure_name(figure).c_str(), trials.size());
+      s.text(12, 26, title, 13, trial_figures::black);
+      trial_figures::draw_legend(s, sheet_width - 430, 26, 10, figure == trial_figures::error ? std::vector<int> {1, 3}
+                                                                                              : std::vector<int> {0, 1, 2, 3});
+    };
+
+    bool ok = true;
+    if (format != "svg") {
+      Canvas canvas(sheet_width, sheet_height);
+      RasterSurface surface(canvas, glyphs);
+      draw_header(surface);
+      parallel_for(trials.size(), (unsigned int) threads, [&](size_t i) {
+        RasterSurface view(canvas, glyphs, cell(i));     // disjoint regions, no locking
+        trial_figures::draw_trial_figure(view, cell(i), tables[trials[i]], figure, true);
+        view.stroke_rect(cell(i), trial_figures::grid_color, 1.0);
+      });
+      ok = write_png(path + ".png", canvas) && ok;
+    }
+    if (format != "png") {
+      std::vector<SvgSurface> cells(trials.size());
+      parallel_for(trials.size(), (unsigned int) threads, [&](size_t i) {
+        trial_figures::draw_trial_figure(cells[i], cell(i), tables[trials[i]], figure, true);
+        cells[i].stroke_rect(cell(i), trial_figures::grid_color, 1.0);
+      });
+      SvgSurface sheet;
+      sheet.fill_rect({0, 0, (double) sheet_width, (double) sheet_height}, {255, 255, 255});
+      draw_header(sheet);
+      for (const auto & c : cells) sheet.append(c);
+      ok = write_svg(path + ".svg", sheet_width, sheet_height, sheet) && ok;
+    }
+    return ok;
+  }
+
+  void print_params() {
+    std::cout << "\n\nThe current parameters [trial_plotter] are as follows:\n" << std::endl;
+    std::cout << "Log directory = " << log_dir << ", participant = " << (part_id < 0 ? "all" : std::to_string(part_id)) << "\n" << std::endl;
+    std::cout << "Output directory = " << out_dir << ", format = " << format << ", figures = " << figures << "\n" << std::endl;
+    std::cout << "Threads = " << threads << "\n" << std::endl;
+  }
+};
+
+
+
+//////////////////// MAIN FUNCTION ///////////////////
+
+int main(int argc, char * argv[])
+{
+  rclcpp::init(argc, argv);
+  auto plotter = std::make_shared<TrialPlotter>();
+  int result = plotter->run();
+  rclcpp::shutdown();
+  return result;
+}